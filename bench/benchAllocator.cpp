@@ -0,0 +1,111 @@
+#include "nodePool.h"
+#include "vfs.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Compares building and tearing down directory structure with node per heap
+// allocation, as vfs did it before NodePool, and with NodePool slabs.
+
+namespace {
+
+/// Node with the same layout as VirtualFileSystem::Directory
+struct Node {
+  std::string name;
+  std::string timeCreated;
+  std::vector<Node *> subDirectories{};
+  Node *parentDirectory = nullptr;
+  std::vector<Node *> files{};
+
+  Node(std::string nodeName) : name(std::move(nodeName)) {}
+};
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+// every directory gets fanOut subdirectories, until count nodes are created
+template <typename Create>
+Node *buildTree(std::size_t count, std::size_t fanOut, Create create) {
+  std::vector<Node *> queue;
+  Node *root = create("home");
+  queue.push_back(root);
+  std::size_t created = 1;
+  for (std::size_t next = 0; created < count; ++next) {
+    Node *parent = queue[next];
+    for (std::size_t i = 0; i < fanOut && created < count; ++i, ++created) {
+      Node *node = create("dir" + std::to_string(i));
+      node->parentDirectory = parent;
+      parent->subDirectories.push_back(node);
+      queue.push_back(node);
+    }
+  }
+  return root;
+}
+
+void deleteTree(Node *node) {
+  for (auto dir : node->subDirectories)
+    deleteTree(dir);
+  delete node;
+}
+
+void benchHeap(std::size_t count, std::size_t fanOut) {
+  auto start = Clock::now();
+  Node *root = buildTree(count, fanOut, [](std::string name) {
+    return new Node(std::move(name));
+  });
+  double build = millisecondsSince(start);
+  start = Clock::now();
+  deleteTree(root);
+  double teardown = millisecondsSince(start);
+  std::cout << "heap     nodes " << count << " build " << build
+            << " ms teardown " << teardown << " ms\n";
+}
+
+void benchPool(std::size_t count, std::size_t fanOut) {
+  auto start = Clock::now();
+  auto *pool = new vfs::NodePool<Node>();
+  buildTree(count, fanOut,
+            [pool](std::string name) { return pool->create(std::move(name)); });
+  double build = millisecondsSince(start);
+  start = Clock::now();
+  delete pool;
+  double teardown = millisecondsSince(start);
+  std::cout << "pool     nodes " << count << " build " << build
+            << " ms teardown " << teardown << " ms\n";
+}
+
+void benchVirtualFileSystem(std::size_t count, std::size_t fanOut) {
+  auto start = Clock::now();
+  auto *virtualFileSystem = new vfs::VirtualFileSystem();
+  std::size_t created = 0;
+  while (created < count) {
+    for (std::size_t i = 0; i < fanOut && created < count; ++i, ++created)
+      virtualFileSystem->makeFile("file" + std::to_string(i));
+    virtualFileSystem->makeDirectory("dir");
+    virtualFileSystem->changeDirectory("dir");
+    ++created;
+  }
+  double build = millisecondsSince(start);
+  start = Clock::now();
+  delete virtualFileSystem;
+  double teardown = millisecondsSince(start);
+  std::cout << "vfs      nodes " << count << " build " << build
+            << " ms teardown " << teardown << " ms\n";
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  std::size_t fanOut = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 16;
+
+  benchHeap(count, fanOut);
+  benchPool(count, fanOut);
+  benchVirtualFileSystem(count, fanOut);
+  return 0;
+}
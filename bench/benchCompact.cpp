@@ -0,0 +1,103 @@
+#include "compactFileSystem.h"
+#include "vfs.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Memory and scan time of CompactFileSystem against VirtualFileSystem. The
+// same balanced tree, half directories and half files, is built in both, and
+// resident memory per node is read from /proc/self/statm. du of the whole
+// tree is timed, CompactFileSystem scans one array of types, while
+// VirtualFileSystem visits every directory.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// discards output of du
+class NullBuffer : public std::streambuf {
+protected:
+  int_type overflow(int_type character) override { return character; }
+  std::streamsize xsputn(const char *, std::streamsize size) override {
+    return size;
+  }
+};
+
+double millisecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+// resident memory of the process, in bytes
+std::size_t residentBytes() {
+  long pages = 0, resident = 0;
+  FILE *statm = std::fopen("/proc/self/statm", "r");
+  if (statm == nullptr)
+    return 0;
+  if (std::fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+    resident = 0;
+  std::fclose(statm);
+  return static_cast<std::size_t>(resident) *
+         static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+}
+
+// builds tree in fileSystem, times du, prints memory per node
+template <typename FileSystem>
+void run(const char *engine, const std::vector<std::string> &directories,
+         std::size_t repeats) {
+  // output of du is discarded, both engines write to std::cout
+  NullBuffer buffer;
+  std::streambuf *coutBuffer = std::cout.rdbuf(&buffer);
+  const std::size_t before = residentBytes();
+  auto start = Clock::now();
+  {
+    FileSystem fileSystem;
+    for (const auto &directory : directories) {
+      fileSystem.makeDirectory(directory);
+      fileSystem.makeFile(directory + ".f");
+    }
+    const double build = millisecondsSince(start);
+    const std::size_t nodes = directories.size() * 2;
+    const std::size_t memory = residentBytes() - before;
+
+    start = Clock::now();
+    for (std::size_t i = 0; i < repeats; ++i)
+      fileSystem.diskUsage("/home");
+    const double diskUsage = millisecondsSince(start) / repeats;
+    std::cout.rdbuf(coutBuffer);
+    std::cout << engine << ": build " << build << " ms, "
+              << static_cast<double>(memory) / nodes << " bytes per node, du "
+              << diskUsage << " ms\n";
+    std::cout.rdbuf(&buffer);
+    start = Clock::now();
+  }
+  std::cout.rdbuf(coutBuffer);
+  std::cout << engine << ": teardown " << millisecondsSince(start) << " ms\n";
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const std::size_t nodes =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  const std::size_t fanOut = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10;
+  const std::size_t repeats = 10;
+
+  // paths are built before memory is measured, directory i is child of
+  // directory (i - 1) / fanOut, directory 0 is /home/root
+  std::vector<std::string> directories{"/home/root"};
+  directories.reserve(nodes / 2);
+  for (std::size_t i = 1; i < nodes / 2; ++i)
+    directories.push_back(directories[(i - 1) / fanOut] + "/d" +
+                          std::to_string(i));
+
+  std::cout << directories.size() * 2 << " nodes, fanOut " << fanOut << "\n";
+  // compact engine runs first, its arrays are returned to the system
+  run<vfs::CompactFileSystem>("compact", directories, repeats);
+  run<vfs::VirtualFileSystem>("vfs", directories, repeats);
+  return 0;
+}
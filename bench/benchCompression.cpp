@@ -0,0 +1,99 @@
+#include "vfs.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Compression of cold file data. Files of log like text are written, and
+// when they are idle, the last chunk of every file is read, so it stays
+// uncompressed, and other chunks are compressed in one pass, memory before
+// and after is printed. Reads of 4 KiB are timed on chunks that stay
+// uncompressed, on compressed chunks, that are decompressed, and again on
+// the last decompressed chunks, while they are kept in LRU.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// reads one chunk of files from first to last, returns mean latency in
+// nanoseconds
+double readChunks(vfs::VirtualFileSystem &fileSystem, std::size_t first,
+                  std::size_t last, std::uint64_t offset) {
+  std::size_t checksum = 0;
+  auto start = Clock::now();
+  for (std::size_t f = first; f < last; ++f)
+    fileSystem.read("f" + std::to_string(f), offset,
+                    vfs::VirtualFileSystem::chunkSize,
+                    [&checksum](const char *data, std::size_t size) {
+                      checksum += static_cast<unsigned char>(data[size - 1]);
+                      return true;
+                    });
+  const double elapsed = secondsSince(start) * 1e9 / (last - first);
+  return checksum == 0 ? 0 : elapsed;
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const std::size_t files =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4096;
+  const std::size_t chunksPerFile = 16;
+  const std::size_t chunk = vfs::VirtualFileSystem::chunkSize;
+  std::mt19937_64 random(42);
+  const char *levels[] = {"INFO", "WARN", "DEBUG", "ERROR"};
+
+  vfs::VirtualFileSystem fileSystem;
+  for (std::size_t f = 0; f < files; ++f) {
+    std::string text;
+    while (text.size() < chunksPerFile * chunk)
+      text += "2024-05-01 12:" + std::to_string(random() % 60) + " " +
+              levels[random() % 4] + " request " +
+              std::to_string(random() % 100000) + " served in " +
+              std::to_string(random() % 1000) + " us\n";
+    const std::string path = "f" + std::to_string(f);
+    fileSystem.makeFile(path);
+    fileSystem.write(path, 0, text.data(), chunksPerFile * chunk);
+  }
+  const std::uint64_t before = fileSystem.dedupStats().physicalBytes;
+
+  // chunks are idle for 2 s, compressor thread wakes every second, so the
+  // pass below compresses them, while the last chunks stay uncompressed
+  const std::chrono::milliseconds idle(2000);
+  std::this_thread::sleep_for(idle + std::chrono::milliseconds(100));
+  const std::size_t hotChunks = 1024;
+  fileSystem.setCompression(idle, hotChunks);
+  const std::uint64_t hotOffset = (chunksPerFile - 1) * chunk;
+  readChunks(fileSystem, 0, files, hotOffset);
+  auto start = Clock::now();
+  const std::size_t compressed = fileSystem.compressIdle();
+  const double seconds = secondsSince(start);
+  const std::uint64_t after = fileSystem.dedupStats().physicalBytes;
+  std::cout << compressed << " chunks compressed in " << seconds * 1000
+            << " ms, " << static_cast<double>(compressed * chunk) /
+                              (1 << 20) / seconds
+            << " MiB/s\nmemory " << (before >> 20) << " MiB before, "
+            << (after >> 20) << " MiB after\n";
+
+  readChunks(fileSystem, 0, files, hotOffset);
+  std::cout << "read uncompressed chunk: "
+            << readChunks(fileSystem, 0, files, hotOffset) << " ns\n";
+  std::cout << "read compressed chunk: "
+            << readChunks(fileSystem, 0, files, 0) << " ns\n";
+  // LRU keeps the last decompressed chunks
+  const std::size_t hotFirst = files > hotChunks ? files - hotChunks : 0;
+  std::cout << "read decompressed chunk in LRU: "
+            << readChunks(fileSystem, hotFirst, files, 0) << " ns\n";
+  const vfs::Stats::Snapshot stats = fileSystem.stats();
+  const vfs::Stats::Histogram &decompress =
+      stats[vfs::Stats::Operation::Decompress];
+  std::cout << "decompress p50 " << decompress.percentile(50) << " ns, p99 "
+            << decompress.percentile(99) << " ns, saved "
+            << (stats.savedBytes >> 20) << " MiB\n";
+  return 0;
+}
@@ -0,0 +1,84 @@
+#include "vfs.h"
+#include "xxHash.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Cost and saving of deduplication. xxHash64 is timed on one chunk, then
+// files are written from a pool of distinct blocks, so part of the chunks
+// are duplicates, and write throughput, cp of all files and sizes from
+// dedupStats are printed for every share of duplicates.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const std::size_t files =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+  const std::size_t chunksPerFile = 64;
+  const std::size_t chunk = vfs::VirtualFileSystem::chunkSize;
+  std::mt19937_64 random(42);
+
+  std::vector<char> block(chunk);
+  for (auto &byte : block)
+    byte = static_cast<char>(random());
+  const std::size_t hashes = 1000000;
+  std::uint64_t sum = 0;
+  auto start = Clock::now();
+  for (std::size_t i = 0; i < hashes; ++i)
+    sum += vfs::xxHash64(block.data(), block.size(), i);
+  std::cout << "xxHash64 of chunk: "
+            << static_cast<double>(hashes * chunk) / (1 << 30) /
+                   secondsSince(start)
+            << " GiB/s (" << sum % 10 << ")\n";
+
+  for (std::size_t duplicates : {0, 50, 90}) {
+    // block is duplicate with probability duplicates %, it is taken from
+    // small pool then, otherwise it is new random block
+    std::vector<std::vector<char>> pool(16, std::vector<char>(chunk));
+    for (auto &pooled : pool)
+      for (auto &byte : pooled)
+        byte = static_cast<char>(random());
+    vfs::VirtualFileSystem fileSystem;
+    fileSystem.makeDirectory("d");
+    start = Clock::now();
+    for (std::size_t f = 0; f < files; ++f) {
+      const std::string path = "d/" + std::to_string(f);
+      fileSystem.makeFile(path);
+      for (std::size_t c = 0; c < chunksPerFile; ++c) {
+        const char *data = block.data();
+        if (random() % 100 < duplicates) {
+          data = pool[random() % pool.size()].data();
+        } else {
+          for (std::size_t i = 0; i < chunk; i += 8)
+            block[i] = static_cast<char>(random());
+        }
+        fileSystem.append(path, data, chunk);
+      }
+    }
+    const double written = secondsSince(start);
+    start = Clock::now();
+    fileSystem.copy("d", "e");
+    const double copied = secondsSince(start);
+    const vfs::VirtualFileSystem::DedupStats sizes = fileSystem.dedupStats();
+    std::cout << duplicates << "% duplicates: write "
+              << static_cast<double>(files * chunksPerFile * chunk) /
+                     (1 << 20) / written
+              << " MiB/s, cp " << copied * 1000 << " ms, logical "
+              << (sizes.logicalBytes >> 20) << " MiB, physical "
+              << (sizes.physicalBytes >> 20) << " MiB, ratio "
+              << static_cast<double>(sizes.logicalBytes) /
+                     static_cast<double>(sizes.physicalBytes)
+              << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,117 @@
+#include "session.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Latency of cd and ls in one directory, first without writers and then while
+// writers create and remove files and directories in the same directory.
+// Readers don't lock, so their latency should not grow with writers.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// discards output of ls
+class NullBuffer : public std::streambuf {
+protected:
+  int_type overflow(int_type character) override { return character; }
+  std::streamsize xsputn(const char *, std::streamsize size) override {
+    return size;
+  }
+};
+
+// latency of every reader command, in nanoseconds
+std::vector<std::int64_t> read(vfs::VirtualFileSystem &fileSystem,
+                               std::size_t operations) {
+  NullBuffer buffer;
+  std::ostream out(&buffer);
+  vfs::Session session(fileSystem, out);
+  std::vector<std::int64_t> latencies;
+  latencies.reserve(operations);
+  for (std::size_t i = 0; i < operations; ++i) {
+    const auto start = Clock::now();
+    if (i % 2 == 0) {
+      session.changeDirectory("/home/shared/d" + std::to_string(i % 8));
+      session.changeDirectory("..");
+    } else {
+      session.list("/home/shared");
+    }
+    latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            Clock::now() - start)
+                            .count());
+  }
+  return latencies;
+}
+
+void write(vfs::VirtualFileSystem &fileSystem, int thread,
+           const std::atomic<bool> &done) {
+  NullBuffer buffer;
+  std::ostream out(&buffer);
+  vfs::Session session(fileSystem, out);
+  const std::string name = "/home/shared/w" + std::to_string(thread);
+  while (!done.load()) {
+    session.makeFile(name);
+    session.remove(name);
+    session.makeDirectory(name);
+    session.remove(name);
+  }
+}
+
+void run(vfs::VirtualFileSystem &fileSystem, unsigned readers,
+         unsigned writers, std::size_t operations) {
+  std::atomic<bool> done{false};
+  std::vector<std::thread> writerThreads;
+  for (unsigned t = 0; t < writers; ++t)
+    writerThreads.emplace_back(write, std::ref(fileSystem), t, std::cref(done));
+
+  std::vector<std::vector<std::int64_t>> results(readers);
+  std::vector<std::thread> readerThreads;
+  for (unsigned t = 0; t < readers; ++t)
+    readerThreads.emplace_back([&, t]() {
+      results[t] = read(fileSystem, operations);
+    });
+  for (auto &thread : readerThreads)
+    thread.join();
+  done.store(true);
+  for (auto &thread : writerThreads)
+    thread.join();
+
+  std::vector<std::int64_t> latencies;
+  for (const auto &result : results)
+    latencies.insert(latencies.end(), result.begin(), result.end());
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies](double p) {
+    return latencies[static_cast<std::size_t>(p * (latencies.size() - 1))];
+  };
+  std::cout << "readers " << readers << " writers " << writers
+            << " p50 " << percentile(0.5) << " ns p99 " << percentile(0.99)
+            << " ns p99.9 " << percentile(0.999) << " ns\n";
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const std::size_t operations =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+  unsigned readers = argc > 2 ? std::strtoul(argv[2], nullptr, 10)
+                              : std::thread::hardware_concurrency() / 2;
+  if (readers == 0)
+    readers = 1;
+  const unsigned writers = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 2;
+
+  vfs::VirtualFileSystem fileSystem;
+  fileSystem.makeDirectory("shared");
+  for (int i = 0; i < 8; ++i)
+    fileSystem.makeDirectory("shared/d" + std::to_string(i));
+  for (int i = 0; i < 64; ++i)
+    fileSystem.makeFile("shared/f" + std::to_string(i));
+
+  run(fileSystem, readers, 0, operations);
+  run(fileSystem, readers, writers, operations);
+  return 0;
+}
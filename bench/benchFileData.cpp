@@ -0,0 +1,71 @@
+#include "vfs.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Throughput of file data. One file is written with sequential appends, and
+// then read sequentially, read at random offsets and overwritten at random
+// offsets, with block sizes from 4 KiB to 1 MiB. Reads visit views of chunks
+// and sum one byte of every view, so data is not copied.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void report(const char *name, std::size_t block, std::uint64_t bytes,
+            double seconds) {
+  std::cout << name << " " << block / 1024 << " KiB: "
+            << static_cast<double>(bytes) / (1 << 20) / seconds << " MiB/s\n";
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const std::uint64_t fileSize =
+      (argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 256) << 20;
+  std::mt19937_64 random(42);
+  std::size_t checksum = 0;
+  auto visit = [&checksum](const char *data, std::size_t size) {
+    checksum += static_cast<unsigned char>(data[size - 1]);
+    return true;
+  };
+
+  for (std::size_t block : {4096, 65536, 1048576}) {
+    vfs::VirtualFileSystem fileSystem;
+    fileSystem.makeFile("data");
+    std::vector<char> buffer(block);
+    for (auto &byte : buffer)
+      byte = static_cast<char>(random());
+
+    auto start = Clock::now();
+    for (std::uint64_t written = 0; written < fileSize; written += block)
+      fileSystem.append("data", buffer.data(), buffer.size());
+    report("sequential write", block, fileSize, secondsSince(start));
+
+    start = Clock::now();
+    for (std::uint64_t offset = 0; offset < fileSize; offset += block)
+      fileSystem.read("data", offset, block, visit);
+    report("sequential read", block, fileSize, secondsSince(start));
+
+    const std::size_t operations =
+        static_cast<std::size_t>(fileSize / block);
+    start = Clock::now();
+    for (std::size_t i = 0; i < operations; ++i)
+      fileSystem.read("data", random() % (fileSize - block), block, visit);
+    report("random read", block, fileSize, secondsSince(start));
+
+    start = Clock::now();
+    for (std::size_t i = 0; i < operations; ++i)
+      fileSystem.write("data", random() % (fileSize - block), buffer.data(),
+                       buffer.size());
+    report("random write", block, fileSize, secondsSince(start));
+  }
+  std::cout << "checksum " << checksum << "\n";
+  return 0;
+}
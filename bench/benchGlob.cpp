@@ -0,0 +1,65 @@
+#include "vfs.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <streambuf>
+#include <string>
+
+// Time of glob commands over one very large directory. rm *.tmp compiles the
+// pattern once, compares only the end of every name and unlinks all matches
+// at once, so it costs one pass over the directory. ls data_1* is looked up
+// in children sorted by name, so only names with the prefix are compared.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// discards output of ls and find
+class NullBuffer : public std::streambuf {
+protected:
+  int_type overflow(int_type character) override { return character; }
+  std::streamsize xsputn(const char *, std::streamsize size) override {
+    return size;
+  }
+};
+
+double millisecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const std::size_t count =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+  // every other file is temporary
+  vfs::VirtualFileSystem fileSystem;
+  fileSystem.makeDirectory("big");
+  for (std::size_t i = 0; i < count; ++i)
+    fileSystem.makeFile("big/data_" + std::to_string(i) +
+                        (i % 2 == 0 ? ".tmp" : ".log"));
+
+  NullBuffer buffer;
+  std::streambuf *coutBuffer = std::cout.rdbuf(&buffer);
+  auto start = Clock::now();
+  fileSystem.find("big", "*_7*.log");
+  const double find = millisecondsSince(start);
+  start = Clock::now();
+  fileSystem.remove("big/*.tmp");
+  const double rm = millisecondsSince(start);
+  start = Clock::now();
+  fileSystem.list("big/data_1*");
+  const double firstList = millisecondsSince(start);
+  start = Clock::now();
+  fileSystem.list("big/data_1*");
+  const double list = millisecondsSince(start);
+  std::cout.rdbuf(coutBuffer);
+
+  std::cout << "files " << count << "\n"
+            << "find -name *_7*.log " << find << " ms\n"
+            << "rm *.tmp " << rm << " ms\n"
+            << "ls data_1* (sort) " << firstList << " ms\n"
+            << "ls data_1* " << list << " ms\n";
+  return 0;
+}
@@ -0,0 +1,92 @@
+#include "substring.h"
+#include "vfs.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Throughput of grep. Tree of directories with files of log like text is
+// searched for rare and common patterns, with one worker and with all
+// hardware threads, time to the first line and to the end of search are
+// printed. Substring is compared with std::string::find on one buffer.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void search(const vfs::VirtualFileSystem &fileSystem,
+            const std::string &pattern, std::uint64_t bytes) {
+  std::size_t lines = 0;
+  double first = 0;
+  auto start = Clock::now();
+  fileSystem.grep(pattern, "/home",
+                  [&lines, &first, start](const std::string &, std::uint64_t,
+                                          const std::string &) {
+                    if (lines++ == 0)
+                      first = secondsSince(start);
+                    return true;
+                  });
+  const double seconds = secondsSince(start);
+  std::cout << "grep " << pattern << ": " << lines << " lines, first in "
+            << first * 1000 << " ms, "
+            << static_cast<double>(bytes) / (1 << 20) / seconds << " MiB/s\n";
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const std::uint64_t total =
+      (argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 256) << 20;
+  const std::size_t fileSize = 256 << 10;
+  const std::size_t filesPerDirectory = 16;
+  const std::size_t files = static_cast<std::size_t>(total / fileSize);
+  std::mt19937_64 random(42);
+  const char *levels[] = {"INFO", "WARN", "DEBUG", "ERROR"};
+  std::string text;
+  while (text.size() < 4 * fileSize)
+    text += "2024-05-01 12:" + std::to_string(random() % 60) + " " +
+            levels[random() % 4] + " request " +
+            std::to_string(random() % 100000) + " served in " +
+            std::to_string(random() % 1000) + " us\n";
+
+  for (std::size_t threads : {std::size_t(1), std::size_t(0)}) {
+    vfs::VirtualFileSystem fileSystem(threads);
+    for (std::size_t f = 0; f < files; ++f) {
+      const std::string directory =
+          "/home/d" + std::to_string(f / filesPerDirectory);
+      if (f % filesPerDirectory == 0)
+        fileSystem.makeDirectory(directory);
+      // files start at different offsets of text, so chunks are not shared
+      const std::string path = directory + "/f" + std::to_string(f);
+      fileSystem.makeFile(path);
+      fileSystem.write(path, 0, text.data() + f * 4099 % (3 * fileSize),
+                       fileSize);
+      fileSystem.write(path, random() % fileSize, "needle", 6);
+    }
+    std::cout << (threads == 0 ? std::thread::hardware_concurrency() : 1)
+              << " workers, " << (files * fileSize >> 20) << " MiB\n";
+    for (const char *pattern : {"needle", "request 99999 ", "ERROR"})
+      search(fileSystem, pattern, files * fileSize);
+  }
+
+  const vfs::Substring substring("request 99999 ");
+  std::size_t found = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < 100; ++i)
+    found += substring.find(text.data(), text.size()) != nullptr;
+  const double simd = secondsSince(start);
+  start = Clock::now();
+  for (int i = 0; i < 100; ++i)
+    found += text.find(substring.pattern()) != std::string::npos;
+  const double plain = secondsSince(start);
+  const double mebibytes = 100.0 * text.size() / (1 << 20);
+  std::cout << "Substring " << mebibytes / simd << " MiB/s, std::string::find "
+            << mebibytes / plain << " MiB/s, found " << found << "\n";
+  return 0;
+}
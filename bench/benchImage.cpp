@@ -0,0 +1,73 @@
+#include "vfs.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Saves vfs structures of growing size to image and measures load and first
+// commands after load. Load maps the image and copies only visited
+// directories, so it should not grow with the number of nodes.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+// every directory gets fanOut subdirectories and fanOut files, until count
+// nodes are created, returns path of the last created directory
+std::string buildTree(vfs::VirtualFileSystem &fileSystem, std::size_t count,
+                      std::size_t fanOut) {
+  std::vector<std::string> queue{"/home"};
+  std::size_t created = 1;
+  for (std::size_t next = 0; created < count; ++next) {
+    const std::string parent = queue[next];
+    for (std::size_t i = 0; i < fanOut && created < count; ++i) {
+      fileSystem.makeFile(parent + "/f" + std::to_string(i));
+      queue.push_back(parent + "/d" + std::to_string(i));
+      fileSystem.makeDirectory(queue.back());
+      created += 2;
+    }
+  }
+  return queue.back();
+}
+
+void bench(std::size_t count, std::size_t fanOut, const std::string &path) {
+  std::string deepest;
+  auto start = Clock::now();
+  {
+    vfs::VirtualFileSystem fileSystem;
+    deepest = buildTree(fileSystem, count, fanOut);
+    start = Clock::now();
+    fileSystem.save(path);
+  }
+  const double save = millisecondsSince(start);
+
+  vfs::VirtualFileSystem fileSystem;
+  start = Clock::now();
+  fileSystem.load(path);
+  const double load = millisecondsSince(start);
+  start = Clock::now();
+  fileSystem.changeDirectory(deepest);
+  fileSystem.makeFile("new");
+  const double firstCommands = millisecondsSince(start);
+  std::cout << "nodes " << count << " save " << save << " ms load " << load
+            << " ms cd and mkfile after load " << firstCommands << " ms\n";
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  std::size_t fanOut = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 16;
+  const std::string path = argc > 3 ? argv[3] : "benchImage.img";
+
+  for (std::size_t nodes = count / 100; nodes <= count; nodes *= 10)
+    bench(nodes == 0 ? 1 : nodes, fanOut, path);
+  std::remove(path.c_str());
+  return 0;
+}
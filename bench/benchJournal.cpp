@@ -0,0 +1,79 @@
+#include "session.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Throughput of mkfile and rm from many sessions, without journal and with
+// journal, for different commit delays. With journal every mutation waits
+// until it is synced, mutations of all sessions share syncs.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// discards output of commands
+class NullBuffer : public std::streambuf {
+protected:
+  int_type overflow(int_type character) override { return character; }
+  std::streamsize xsputn(const char *, std::streamsize size) override {
+    return size;
+  }
+};
+
+void work(vfs::VirtualFileSystem &fileSystem, int thread,
+          std::size_t operations) {
+  NullBuffer buffer;
+  std::ostream out(&buffer);
+  vfs::Session session(fileSystem, out);
+  const std::string name = "t" + std::to_string(thread) + "f";
+  for (std::size_t i = 0; i < operations; i += 2) {
+    session.makeFile(name + std::to_string(i));
+    session.remove(name + std::to_string(i));
+  }
+}
+
+void bench(const char *mode, unsigned threads, std::size_t operations,
+           const std::string &path, long delay) {
+  std::remove(path.c_str());
+  std::remove((path + ".img").c_str());
+  vfs::VirtualFileSystem fileSystem;
+  if (delay >= 0)
+    fileSystem.recover(path + ".img", path, std::chrono::microseconds(delay));
+
+  const auto start = Clock::now();
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; ++t)
+    workers.emplace_back(work, std::ref(fileSystem), t, operations);
+  for (auto &worker : workers)
+    worker.join();
+  const std::chrono::duration<double> elapsed = Clock::now() - start;
+  std::cout << mode;
+  if (delay >= 0)
+    std::cout << " commit delay " << delay << " us";
+  std::cout << " threads " << threads << " mutations/s "
+            << static_cast<std::size_t>(threads * operations /
+                                        elapsed.count())
+            << "\n";
+  fileSystem.closeJournal();
+  std::remove(path.c_str());
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const std::size_t operations =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+  unsigned threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 8;
+  if (threads == 0)
+    threads = 1;
+  const std::string path = argc > 3 ? argv[3] : "benchJournal.journal";
+
+  bench("no journal", threads, operations * 100, path, -1);
+  for (long delay : {0L, 100L, 1000L})
+    bench("journal", threads, operations, path, delay);
+  return 0;
+}
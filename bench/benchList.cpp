@@ -0,0 +1,89 @@
+#include "vfs.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <streambuf>
+#include <string>
+
+// Time of ordered and paginated ls of one very large directory. The first
+// sorted page sorts all children, next pages reuse sorted children until the
+// directory is changed and find their start with binary search, so time of
+// a page should not depend on how deep in the listing it is. Page after the
+// directory is changed merges the change, without sorting again. Full
+// listing is timed with forEach, that reuses one name buffer and doesn't
+// format output.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// discards output of ls
+class NullBuffer : public std::streambuf {
+protected:
+  int_type overflow(int_type character) override { return character; }
+  std::streamsize xsputn(const char *, std::streamsize size) override {
+    return size;
+  }
+};
+
+double microsecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(Clock::now() - start)
+      .count();
+}
+
+std::string name(std::size_t i) {
+  // names are not created in sorted order
+  return "f" + std::to_string((i * 7919) % 1000003) + "_" + std::to_string(i);
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const std::size_t count =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  const std::size_t limit = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100;
+
+  vfs::VirtualFileSystem fileSystem;
+  fileSystem.makeDirectory("big");
+  for (std::size_t i = 0; i < count; ++i)
+    fileSystem.makeFile("big/" + name(i));
+
+  NullBuffer buffer;
+  std::streambuf *coutBuffer = std::cout.rdbuf(&buffer);
+  vfs::VirtualFileSystem::ListOptions options;
+  options.order = vfs::VirtualFileSystem::Order::Name;
+  options.limit = limit;
+
+  auto start = Clock::now();
+  fileSystem.list("big", options);
+  const double first = microsecondsSince(start);
+  start = Clock::now();
+  fileSystem.list("big", options);
+  const double second = microsecondsSince(start);
+  options.after = name(count / 2);
+  start = Clock::now();
+  fileSystem.list("big", options);
+  const double deep = microsecondsSince(start);
+  fileSystem.makeFile("big/" + name(count));
+  start = Clock::now();
+  fileSystem.list("big", options);
+  const double merged = microsecondsSince(start);
+  options.after.clear();
+  options.limit = 0;
+  std::size_t visited = 0;
+  start = Clock::now();
+  fileSystem.forEach("big", options,
+                     [&visited](const vfs::VirtualFileSystem::Entry &) {
+                       ++visited;
+                       return true;
+                     });
+  const double all = microsecondsSince(start);
+  std::cout.rdbuf(coutBuffer);
+
+  std::cout << "children " << count << " page " << limit << "\n"
+            << "first page (sort) " << first << " us\n"
+            << "next page " << second << " us\n"
+            << "page after cursor " << deep << " us\n"
+            << "page after change (merge) " << merged << " us\n"
+            << "forEach of " << visited << " children " << all << " us\n";
+  return 0;
+}
@@ -0,0 +1,145 @@
+#include "vfs.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Latency of complete and locate on big tree. Every directory has files with
+// random names of lowercase letters, the first query builds the radix tree
+// of all names, and later queries with random prefixes are timed to their
+// first results. mkfile is timed before and after the tree is built, that
+// mkfile changes too.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// discards output of complete and locate
+class NullBuffer : public std::streambuf {
+protected:
+  int_type overflow(int_type character) override { return character; }
+  std::streamsize xsputn(const char *, std::streamsize size) override {
+    return size;
+  }
+};
+
+double microsecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(Clock::now() - start)
+      .count();
+}
+
+// resident memory of the process, in bytes
+std::size_t residentBytes() {
+  long pages = 0, resident = 0;
+  FILE *statm = std::fopen("/proc/self/statm", "r");
+  if (statm == nullptr)
+    return 0;
+  if (std::fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+    resident = 0;
+  std::fclose(statm);
+  return static_cast<std::size_t>(resident) *
+         static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+}
+
+std::string randomName(std::mt19937_64 &random, std::size_t size) {
+  std::string name(size, 'a');
+  for (auto &character : name)
+    character = static_cast<char>('a' + random() % 26);
+  return name;
+}
+
+// makes files in new directory, returns time per file
+double makeFiles(vfs::VirtualFileSystem &fileSystem,
+                 const std::string &directory, std::mt19937_64 &random,
+                 std::size_t files) {
+  fileSystem.makeDirectory(directory);
+  fileSystem.changeDirectory(directory);
+  auto start = Clock::now();
+  for (std::size_t i = 0; i < files; ++i)
+    fileSystem.makeFile(randomName(random, 10));
+  const double elapsed = microsecondsSince(start) * 1000 / files;
+  fileSystem.changeDirectory("/home");
+  return elapsed;
+}
+
+// times queries with random prefixes, prints mean and max
+template <typename Query>
+void timeQueries(const char *name, std::mt19937_64 &random,
+                 std::size_t prefixSize, std::size_t queries, Query query) {
+  NullBuffer buffer;
+  std::streambuf *coutBuffer = std::cout.rdbuf(&buffer);
+  double total = 0, slowest = 0;
+  for (std::size_t i = 0; i < queries; ++i) {
+    const std::string prefix = randomName(random, prefixSize);
+    auto start = Clock::now();
+    query(prefix);
+    const double elapsed = microsecondsSince(start);
+    total += elapsed;
+    slowest = std::max(slowest, elapsed);
+  }
+  std::cout.rdbuf(coutBuffer);
+  std::cout << name << " prefix of " << prefixSize << ": mean "
+            << total / queries << " us, max " << slowest << " us\n";
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const std::size_t nodes =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  const std::size_t filesPerDirectory = 100;
+  const std::size_t directories = nodes / (filesPerDirectory + 1);
+  const std::size_t queries = 10000;
+  const std::size_t timedFiles = 100000;
+
+  std::mt19937_64 random(42);
+  vfs::VirtualFileSystem fileSystem;
+  for (std::size_t d = 0; d < directories; ++d) {
+    const std::string directory = "d" + std::to_string(d);
+    fileSystem.makeDirectory(directory);
+    fileSystem.changeDirectory(directory);
+    for (std::size_t f = 0; f < filesPerDirectory; ++f)
+      fileSystem.makeFile(randomName(random, 8));
+    fileSystem.changeDirectory("..");
+  }
+  const double before = makeFiles(fileSystem, "before", random, timedFiles);
+
+  // the first query builds the tree
+  NullBuffer buffer;
+  std::streambuf *coutBuffer = std::cout.rdbuf(&buffer);
+  const std::size_t memory = residentBytes();
+  auto start = Clock::now();
+  fileSystem.locate("a", 1);
+  const double build = microsecondsSince(start) / 1000;
+  const std::size_t treeMemory = residentBytes() - memory;
+  std::cout.rdbuf(coutBuffer);
+  const std::size_t count = directories * (filesPerDirectory + 1);
+  std::cout << count + timedFiles << " nodes, tree built in " << build
+            << " ms, " << static_cast<double>(treeMemory) / count
+            << " bytes per node\n";
+
+  for (std::size_t prefixSize : {1, 3, 5}) {
+    timeQueries("locate first", random, prefixSize, queries,
+                [&fileSystem](const std::string &prefix) {
+                  fileSystem.locate(prefix, 1);
+                });
+    timeQueries("locate 100", random, prefixSize, queries,
+                [&fileSystem](const std::string &prefix) {
+                  fileSystem.locate(prefix);
+                });
+    timeQueries("complete", random, prefixSize, queries,
+                [&fileSystem](const std::string &prefix) {
+                  fileSystem.complete(prefix);
+                });
+  }
+
+  const double after = makeFiles(fileSystem, "after", random, timedFiles);
+  std::cout << "mkfile " << before << " ns without tree, " << after
+            << " ns with tree\n";
+  return 0;
+}
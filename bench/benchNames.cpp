@@ -0,0 +1,88 @@
+#include "vfs.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Memory of names on tree with repetitive names. Every directory has the
+// same files, half of them with long names, like segment-00001.log, that are
+// interned once, and half with short ones, like 00001, that are inline.
+// Resident memory per node is read from /proc/self/statm, and lookups of
+// long and short names are timed with rm of files that don't exist.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double nanosecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start)
+      .count();
+}
+
+// resident memory of the process, in bytes
+std::size_t residentBytes() {
+  long pages = 0, resident = 0;
+  FILE *statm = std::fopen("/proc/self/statm", "r");
+  if (statm == nullptr)
+    return 0;
+  if (std::fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+    resident = 0;
+  std::fclose(statm);
+  return static_cast<std::size_t>(resident) *
+         static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+}
+
+std::string shortName(std::size_t i) {
+  std::string name = std::to_string(100000 + i);
+  return name.substr(1);
+}
+
+std::string longName(std::size_t i) {
+  return "segment-" + shortName(i) + ".log";
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const std::size_t nodes =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  const std::size_t filesPerDirectory =
+      argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100;
+  const std::size_t directories = nodes / (filesPerDirectory + 1);
+  const std::size_t lookups = 100000;
+
+  std::vector<std::string> names;
+  for (std::size_t i = 0; i < filesPerDirectory; ++i)
+    names.push_back(i % 2 == 0 ? longName(i) : shortName(i));
+
+  const std::size_t before = residentBytes();
+  vfs::VirtualFileSystem fileSystem;
+  for (std::size_t d = 0; d < directories; ++d) {
+    const std::string directory = "d" + std::to_string(d);
+    fileSystem.makeDirectory(directory);
+    fileSystem.changeDirectory(directory);
+    for (const auto &name : names)
+      fileSystem.makeFile(name);
+    fileSystem.changeDirectory("..");
+  }
+  const std::size_t memory = residentBytes() - before;
+  const std::size_t count = directories * (filesPerDirectory + 1);
+  std::cout << count << " nodes, " << static_cast<double>(memory) / count
+            << " bytes per node\n";
+
+  // names that are not in the directory, lookup doesn't change it
+  fileSystem.changeDirectory("d0");
+  const std::string missingLong = longName(filesPerDirectory + 1);
+  const std::string missingShort = shortName(filesPerDirectory + 1);
+  for (const std::string *name : {&missingLong, &missingShort}) {
+    auto start = Clock::now();
+    for (std::size_t i = 0; i < lookups; ++i)
+      fileSystem.remove(*name);
+    std::cout << "lookup of " << *name << " "
+              << nanosecondsSince(start) / lookups << " ns\n";
+  }
+  return 0;
+}
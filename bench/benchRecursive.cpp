@@ -0,0 +1,92 @@
+#include "vfs.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Time of du, find, cp and rm of wide subtree, with growing number of
+// workers. Subtree is split between workers by work stealing, so time should
+// fall close to linearly with workers, up to the number of cores. rm only
+// unlinks the subtree, it is released by background reclaimer, so rm time
+// doesn't depend on the size of the subtree, release is timed with drain.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// discards output of du and find
+class NullBuffer : public std::streambuf {
+protected:
+  int_type overflow(int_type character) override { return character; }
+  std::streamsize xsputn(const char *, std::streamsize size) override {
+    return size;
+  }
+};
+
+double millisecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+// every directory gets fanOut subdirectories and fanOut files, until count
+// nodes are created below /home/tree
+void buildTree(vfs::VirtualFileSystem &fileSystem, std::size_t count,
+               std::size_t fanOut) {
+  std::vector<std::string> queue{"/home/tree"};
+  fileSystem.makeDirectory(queue.back());
+  std::size_t created = 1;
+  for (std::size_t next = 0; created < count; ++next) {
+    const std::string parent = queue[next];
+    for (std::size_t i = 0; i < fanOut && created < count; ++i) {
+      fileSystem.makeFile(parent + "/f" + std::to_string(i));
+      queue.push_back(parent + "/d" + std::to_string(i));
+      fileSystem.makeDirectory(queue.back());
+      created += 2;
+    }
+  }
+}
+
+void bench(std::size_t workers, std::size_t count, std::size_t fanOut) {
+  vfs::VirtualFileSystem fileSystem(workers);
+  buildTree(fileSystem, count, fanOut);
+  NullBuffer buffer;
+  std::streambuf *coutBuffer = std::cout.rdbuf(&buffer);
+
+  auto start = Clock::now();
+  fileSystem.diskUsage("tree");
+  const double du = millisecondsSince(start);
+  start = Clock::now();
+  fileSystem.find("tree", "f0");
+  const double find = millisecondsSince(start);
+  start = Clock::now();
+  fileSystem.copy("tree", "copy");
+  const double cp = millisecondsSince(start);
+  start = Clock::now();
+  fileSystem.remove("copy");
+  const double rm = millisecondsSince(start);
+  start = Clock::now();
+  fileSystem.drain();
+  const double release = millisecondsSince(start);
+
+  std::cout.rdbuf(coutBuffer);
+  std::cout << "workers " << workers << " du " << du << " ms find " << find
+            << " ms cp " << cp << " ms rm " << rm << " ms release " << release
+            << " ms\n";
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const std::size_t count =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  const std::size_t fanOut = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 16;
+  std::size_t maxWorkers = argc > 3 ? std::strtoul(argv[3], nullptr, 10)
+                                    : std::thread::hardware_concurrency();
+  if (maxWorkers == 0)
+    maxWorkers = 1;
+  for (std::size_t workers = 1; workers <= maxWorkers; workers *= 2)
+    bench(workers, count, fanOut);
+  return 0;
+}
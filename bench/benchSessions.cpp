@@ -0,0 +1,94 @@
+#include "session.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Throughput of sessions sharing one VirtualFileSystem, from 1 to N threads.
+// Every thread works in its own subtree, 90% of commands are cd and ls, 10%
+// are mkfile and rm.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// discards output of ls
+class NullBuffer : public std::streambuf {
+protected:
+  int_type overflow(int_type character) override { return character; }
+  std::streamsize xsputn(const char *, std::streamsize size) override {
+    return size;
+  }
+};
+
+void work(vfs::VirtualFileSystem &fileSystem, int thread,
+          std::size_t operations) {
+  NullBuffer buffer;
+  std::ostream out(&buffer);
+  vfs::Session session(fileSystem, out);
+  const std::string root = "/home/t" + std::to_string(thread);
+  const std::string deep = root + "/d0/d1/d2";
+  for (std::size_t i = 0; i < operations; ++i) {
+    switch (i % 10) {
+    case 0:
+      session.makeFile(deep + "/file");
+      break;
+    case 5:
+      session.remove(deep + "/file");
+      break;
+    case 1:
+    case 3:
+    case 7:
+      session.changeDirectory(deep);
+      break;
+    case 2:
+    case 6:
+      session.list();
+      break;
+    default:
+      session.changeDirectory("..");
+      break;
+    }
+  }
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const std::size_t operations =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+  unsigned maxThreads = argc > 2 ? std::strtoul(argv[2], nullptr, 10)
+                                 : std::thread::hardware_concurrency();
+  if (maxThreads == 0)
+    maxThreads = 1;
+
+  vfs::VirtualFileSystem fileSystem;
+  for (unsigned t = 0; t < maxThreads; ++t) {
+    const std::string root = "t" + std::to_string(t);
+    fileSystem.makeDirectory(root);
+    fileSystem.makeDirectory(root + "/d0");
+    fileSystem.makeDirectory(root + "/d0/d1");
+    fileSystem.makeDirectory(root + "/d0/d1/d2");
+    for (int i = 0; i < 64; ++i)
+      fileSystem.makeFile(root + "/d0/d1/d2/f" + std::to_string(i));
+  }
+
+  for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+    const auto start = Clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t)
+      workers.emplace_back(work, std::ref(fileSystem), t, operations);
+    for (auto &worker : workers)
+      worker.join();
+    const std::chrono::duration<double> elapsed = Clock::now() - start;
+    std::cout << "threads " << threads << " commands/s "
+              << static_cast<std::size_t>(threads * operations /
+                                          elapsed.count())
+              << "\n";
+    if (threads < maxThreads && threads * 2 > maxThreads)
+      threads = maxThreads / 2;
+  }
+  return 0;
+}
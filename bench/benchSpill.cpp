@@ -0,0 +1,76 @@
+#include "vfs.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Working set that is 10 times bigger than memory limit. Files of random
+// data are written under the limit, so writers spill the least recently
+// used chunks to backing file, then 4 KiB reads at random offsets of all
+// files are timed, most of them page chunks in from backing file. Memory of
+// chunks, evictions and latency of page-in are printed.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const std::uint64_t limit =
+      (argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 32) << 20;
+  const std::string backingPath = argc > 2 ? argv[2] : "/tmp/benchSpill";
+  const std::size_t fileSize = 1 << 20;
+  const std::size_t files = static_cast<std::size_t>(10 * limit / fileSize);
+  const std::size_t chunk = vfs::VirtualFileSystem::chunkSize;
+  std::mt19937_64 random(42);
+
+  vfs::VirtualFileSystem fileSystem;
+  if (!fileSystem.setMemoryLimit(limit, backingPath)) {
+    std::cout << "Can't create backing file " << backingPath << "\n";
+    return 1;
+  }
+  std::vector<char> buffer(fileSize);
+  std::uint64_t peak = 0;
+  auto start = Clock::now();
+  for (std::size_t f = 0; f < files; ++f) {
+    for (auto &byte : buffer)
+      byte = static_cast<char>(random());
+    const std::string path = "f" + std::to_string(f);
+    fileSystem.makeFile(path);
+    fileSystem.write(path, 0, buffer.data(), buffer.size());
+    peak = std::max(peak, fileSystem.dedupStats().physicalBytes);
+  }
+  double seconds = secondsSince(start);
+  std::cout << (files * fileSize >> 20) << " MiB written under limit of "
+            << (limit >> 20) << " MiB, "
+            << static_cast<double>(files * fileSize) / (1 << 20) / seconds
+            << " MiB/s, peak memory " << (peak >> 20) << " MiB\n";
+
+  const std::size_t reads = 100000;
+  std::size_t checksum = 0;
+  auto visit = [&checksum](const char *data, std::size_t size) {
+    checksum += static_cast<unsigned char>(data[size - 1]);
+    return true;
+  };
+  start = Clock::now();
+  for (std::size_t i = 0; i < reads; ++i)
+    fileSystem.read("f" + std::to_string(random() % files),
+                    random() % (fileSize / chunk) * chunk, chunk, visit);
+  seconds = secondsSince(start);
+  const vfs::Stats::Snapshot stats = fileSystem.stats();
+  const vfs::Stats::Histogram &pageIn = stats[vfs::Stats::Operation::PageIn];
+  std::cout << "random read: " << seconds * 1e9 / reads << " ns, "
+            << pageIn.count << " page-ins, p50 " << pageIn.percentile(50)
+            << " ns, p99 " << pageIn.percentile(99) << " ns\n"
+            << stats.spilledChunks << " chunks spilled, " << stats.evictions
+            << " evictions, memory "
+            << (fileSystem.dedupStats().physicalBytes >> 20)
+            << " MiB, checksum " << checksum << "\n";
+  return 0;
+}
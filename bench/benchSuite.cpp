@@ -0,0 +1,241 @@
+#include "session.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+// Benchmark suite of VirtualFileSystem operations. For every tree shape and
+// size, from 1e3 to maxNodes nodes, tree is built with mkdir and mkfile, then
+// cd, ls and rm are run on random directories and files, and at the end
+// VirtualFileSystem is destroyed. Throughput and p50/p99 latency of every
+// operation are written to JSON file, so runs can be compared.
+//
+// Shapes are:
+// wide, all directories and files in one directory
+// balanced, every directory has fanOut subdirectories
+// deep, chains of chainLength directories below one directory
+//
+// Every directory, except the first, has one file in its parent, so half of
+// the nodes are directories and half are files.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// discards output of ls
+class NullBuffer : public std::streambuf {
+protected:
+  int_type overflow(int_type character) override { return character; }
+  std::streamsize xsputn(const char *, std::streamsize size) override {
+    return size;
+  }
+};
+
+enum class Shape { Wide, Balanced, Deep };
+
+constexpr std::size_t fanOut = 10;
+constexpr std::size_t chainLength = 256;
+
+// cd, ls and rm are timed on at most this many random nodes
+constexpr std::size_t maxSamples = 10000;
+
+const char *shapeName(Shape shape) {
+  switch (shape) {
+  case Shape::Wide:
+    return "wide";
+  case Shape::Balanced:
+    return "balanced";
+  case Shape::Deep:
+    return "deep";
+  }
+  return "";
+}
+
+// directory 0 is /home/root, other directories are numbered in order of
+// creation
+std::size_t parentOf(Shape shape, std::size_t index) {
+  switch (shape) {
+  case Shape::Wide:
+    return 0;
+  case Shape::Balanced:
+    return (index - 1) / fanOut;
+  case Shape::Deep:
+    return (index - 1) % chainLength == 0 ? 0 : index - 1;
+  }
+  return 0;
+}
+
+std::string nameOf(std::size_t index) { return "d" + std::to_string(index); }
+
+std::string pathOf(Shape shape, std::size_t index) {
+  std::vector<std::size_t> chain;
+  for (; index != 0; index = parentOf(shape, index))
+    chain.push_back(index);
+  std::string path = "/home/root";
+  for (auto directory = chain.rbegin(); directory != chain.rend(); ++directory)
+    path += "/" + nameOf(*directory);
+  return path;
+}
+
+// latencies of one operation, in nanoseconds
+class Latencies {
+public:
+  explicit Latencies(std::size_t count) { nanoseconds.reserve(count); }
+
+  template <typename Operation> void time(Operation operation) {
+    const auto start = Clock::now();
+    operation();
+    nanoseconds.push_back(static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                             start)
+            .count()));
+  }
+
+  std::vector<std::uint64_t> nanoseconds;
+};
+
+struct Result {
+  const char *shape;
+  std::size_t nodes;
+  const char *operation;
+  std::size_t count;
+  double seconds;
+  std::uint64_t p50;
+  std::uint64_t p99;
+};
+
+Result summarize(Shape shape, std::size_t nodes, const char *operation,
+                 Latencies &latencies) {
+  std::vector<std::uint64_t> &sorted = latencies.nanoseconds;
+  std::sort(sorted.begin(), sorted.end());
+  const std::uint64_t total =
+      std::accumulate(sorted.begin(), sorted.end(), std::uint64_t(0));
+  Result result{shapeName(shape), nodes, operation, sorted.size(), total / 1e9,
+                0, 0};
+  if (!sorted.empty()) {
+    result.p50 = sorted[sorted.size() / 2];
+    result.p99 = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+  }
+  return result;
+}
+
+void run(Shape shape, std::size_t nodes, std::vector<Result> &results) {
+  const std::size_t directories = std::max<std::size_t>(nodes / 2, 2);
+  std::unique_ptr<vfs::VirtualFileSystem> fileSystem(
+      new vfs::VirtualFileSystem());
+  NullBuffer buffer;
+  std::ostream out(&buffer);
+  {
+    vfs::Session session(*fileSystem, out);
+    session.makeDirectory("/home/root");
+
+    // tree is built from current directory, with relative names
+    Latencies mkdir(directories), mkfile(directories);
+    std::size_t current = 0;
+    session.changeDirectory("/home/root");
+    for (std::size_t i = 1; i < directories; ++i) {
+      const std::size_t parent = parentOf(shape, i);
+      if (parent != current) {
+        if (parent != 0 && parentOf(shape, parent) == current)
+          session.changeDirectory(nameOf(parent));
+        else
+          session.changeDirectory(pathOf(shape, parent));
+        current = parent;
+      }
+      const std::string directory = nameOf(i);
+      const std::string file = "f" + std::to_string(i);
+      mkdir.time([&]() { session.makeDirectory(directory); });
+      mkfile.time([&]() { session.makeFile(file); });
+    }
+    results.push_back(summarize(shape, nodes, "mkdir", mkdir));
+    results.push_back(summarize(shape, nodes, "mkfile", mkfile));
+
+    // the same random nodes for every operation, without repetition
+    std::vector<std::size_t> sample(directories - 1);
+    std::iota(sample.begin(), sample.end(), std::size_t(1));
+    std::shuffle(sample.begin(), sample.end(), std::mt19937_64(nodes));
+    sample.resize(std::min(sample.size(), maxSamples));
+    std::vector<std::string> paths;
+    paths.reserve(sample.size());
+    for (auto index : sample)
+      paths.push_back(pathOf(shape, index));
+
+    Latencies cd(sample.size()), ls(sample.size()), rm(sample.size());
+    for (const auto &path : paths)
+      cd.time([&]() { session.changeDirectory(path); });
+    for (const auto &path : paths)
+      ls.time([&]() { session.list(path); });
+    for (std::size_t i = 0; i < sample.size(); ++i) {
+      const std::string file =
+          pathOf(shape, parentOf(shape, sample[i])) + "/f" +
+          std::to_string(sample[i]);
+      rm.time([&]() { session.remove(file); });
+    }
+    results.push_back(summarize(shape, nodes, "cd", cd));
+    results.push_back(summarize(shape, nodes, "ls", ls));
+    results.push_back(summarize(shape, nodes, "rm", rm));
+  }
+
+  // removed files are released before teardown is timed
+  fileSystem->drain();
+  Latencies teardown(1);
+  teardown.time([&]() { fileSystem.reset(); });
+  results.push_back(summarize(shape, nodes, "teardown", teardown));
+}
+
+void writeJson(std::ostream &json, const std::vector<Result> &results) {
+  json << "{\n  \"benchmark\": \"vfs\",\n  \"results\": [";
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const Result &result = results[i];
+    json << (i == 0 ? "\n" : ",\n") << "    {\"shape\": \"" << result.shape
+         << "\", \"nodes\": " << result.nodes << ", \"operation\": \""
+         << result.operation << "\", \"count\": " << result.count
+         << ", \"seconds\": " << result.seconds << ", \"opsPerSecond\": "
+         << (result.seconds > 0 ? result.count / result.seconds : 0)
+         << ", \"p50Ns\": " << result.p50 << ", \"p99Ns\": " << result.p99
+         << "}";
+  }
+  json << "\n  ]\n}\n";
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const std::size_t maxNodes =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+  const std::string jsonPath = argc > 2 ? argv[2] : "bench.json";
+
+  std::vector<Result> results;
+  for (std::size_t nodes = 1000; nodes <= maxNodes; nodes *= 10) {
+    for (Shape shape : {Shape::Wide, Shape::Balanced, Shape::Deep}) {
+      const std::size_t first = results.size();
+      run(shape, nodes, results);
+      for (std::size_t i = first; i < results.size(); ++i) {
+        const Result &result = results[i];
+        std::cout << result.shape << " " << result.nodes << " "
+                  << result.operation << " "
+                  << static_cast<std::size_t>(
+                         result.seconds > 0 ? result.count / result.seconds
+                                            : 0)
+                  << " ops/s p50 " << result.p50 << " ns p99 " << result.p99
+                  << " ns\n";
+      }
+    }
+  }
+
+  std::ofstream json(jsonPath);
+  writeJson(json, results);
+  if (!json) {
+    std::cerr << "Can't write " << jsonPath << "\n";
+    return 1;
+  }
+  std::cout << "Results written to " << jsonPath << "\n";
+  return 0;
+}
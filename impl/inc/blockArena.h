@@ -0,0 +1,150 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace vfs {
+
+/**
+ * Implementation of the BlockArena class.
+ *
+ * BlockArena allocates memory that directory and file nodes own: arrays of
+ * children, name indexes, sorted children and tables of chunks. Blocks are
+ * carved from big regions in size classes, four classes for every power of
+ * two, and released block is kept in freelist of its class for the next
+ * block of that class. Blocks bigger than the biggest class are allocated one
+ * by one and linked in a list.
+ *
+ * release frees all regions and big blocks at once, without visiting blocks,
+ * so nodes whose memory is in the arena are dropped with slabs of their
+ * NodePool, without calling their destructors. Arena is thread safe.
+ *
+ */
+class BlockArena {
+public:
+  /**
+   * Constructor of BlockArena
+   *
+   * Empty arena, first region is allocated on first allocate.
+   */
+  BlockArena() = default;
+
+  /**
+   * Destructor of BlockArena
+   *
+   * All blocks are released, calling release.
+   */
+  ~BlockArena() { release(); }
+
+  /// Disabling construction of BlockArena object using copy constructor
+  BlockArena(const BlockArena &rhs) = delete;
+
+  /// Disabling construction of BlockArena object using copy assignment
+  BlockArena &operator=(const BlockArena &rhs) = delete;
+
+  /**
+   * Allocate block
+   *
+   * @param size number of bytes
+   * @return ptr to block, aligned to alignment
+   */
+  void *allocate(std::size_t size);
+
+  /**
+   * Release block, memory is reused by next allocate of the same class
+   *
+   * @param block ptr returned by allocate, can be nullptr
+   * @param size number of bytes, passed to allocate
+   */
+  void deallocate(void *block, std::size_t size);
+
+  /**
+   * Release all blocks at once
+   *
+   * Blocks that were not deallocated are released too, nothing can use them
+   * after release.
+   */
+  void release();
+
+  /**
+   * Memory that arena took from the heap
+   *
+   * @return bytes of regions and big blocks
+   */
+  std::size_t bytes() const;
+
+  /// Alignment of every block
+  static constexpr std::size_t alignment = 16;
+
+private:
+  /// Size of the region, that blocks are carved from
+  static constexpr std::size_t regionSize = std::size_t(1) << 20;
+
+  /// Size of the biggest class, bigger blocks are allocated one by one
+  static constexpr std::size_t largeSize = std::size_t(64) << 10;
+
+  /// Number of classes, up to 128 bytes by 16, then 4 for every power of two
+  static constexpr std::size_t classCount = 44;
+
+  /**
+   * Block in freelist
+   *
+   * @param next next free block of the same class
+   */
+  struct FreeBlock {
+    FreeBlock *next;
+  };
+
+  /**
+   * Header of big block, block starts after it
+   *
+   * @param previous previous big block, nullptr for the first one
+   * @param next next big block, nullptr for the last one
+   * @param size number of bytes of the block
+   */
+  struct alignas(alignment) Large {
+    Large *previous;
+    Large *next;
+    std::size_t size;
+  };
+
+  /**
+   * Class of the block
+   *
+   * @param size number of bytes, at most largeSize
+   * @return index of the class
+   */
+  static std::size_t classOf(std::size_t size);
+
+  /**
+   * Size of the blocks of the class
+   *
+   * @param sizeClass index of the class
+   * @return number of bytes
+   */
+  static std::size_t classSize(std::size_t sizeClass);
+
+  /// Guards all members
+  mutable std::mutex mutex{};
+
+  /// Free blocks of every class
+  std::array<FreeBlock *, classCount> freeLists{};
+
+  /// Allocated regions
+  std::vector<char *> regions{};
+
+  /// Next free byte of the last region
+  char *cursor = nullptr;
+
+  /// End of the last region
+  char *limit = nullptr;
+
+  /// List of big blocks
+  Large *large = nullptr;
+
+  /// Bytes of regions and big blocks
+  std::size_t reserved = 0;
+};
+} // namespace vfs
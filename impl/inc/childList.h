@@ -0,0 +1,427 @@
+#pragma once
+
+#include "blockArena.h"
+#include "epoch.h"
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+
+namespace vfs {
+
+/**
+ * Implementation of the ChildList class.
+ *
+ * ChildList is list of pointers to subdirectories or files of directory, in
+ * order in which they were added. Readers don't lock, they iterate snapshot
+ * of the list. One writer at a time can push_back and erase. push_back writes
+ * after the last element and then publishes new size, so readers see element
+ * only when it is written, when array is full, bigger array is published.
+ * Every element keeps its index in the array, so erase finds it in O(1) and
+ * replaces it with nullptr, that readers skip. When more than half of the
+ * array are erased elements, array without them is published, so erase
+ * costs O(1) amortized. While slots are pinned, erased elements are kept
+ * and full array is copied with them, so slot of every element stays the
+ * same, and slots order elements that were erased with the others. Reader
+ * that iterates while element is erased may or may not see it, and sees
+ * other elements once. Replaced arrays are retired to EpochManager, so
+ * readers must be in epoch. Arrays are allocated from BlockArena, that owns
+ * memory of the directory.
+ *
+ * @tparam T type of the subdirectory or file, with std::size_t listSlot,
+ * index of the element in the array, that only ChildList changes
+ */
+template <typename T> class ChildList {
+  struct Array;
+
+public:
+  /**
+   * Implementation of the Snapshot class.
+   *
+   * Snapshot is view of the list, valid while reader is in epoch. Elements
+   * that are erased while reader iterates may be skipped.
+   *
+   */
+  class Snapshot {
+  public:
+    /**
+     * Implementation of the Iterator class.
+     *
+     * Iterator visits elements of the array that are not erased.
+     *
+     */
+    class Iterator {
+    public:
+      using iterator_category = std::input_iterator_tag;
+      using value_type = T *;
+      using difference_type = std::ptrdiff_t;
+      using pointer = T *const *;
+      using reference = T *;
+
+      /**
+       * Constructor of Iterator
+       *
+       * @param position first visited slot
+       * @param end past the last slot
+       */
+      Iterator(const std::atomic<T *> *position, const std::atomic<T *> *end)
+          : position(position), end(end) {
+        skip();
+      }
+
+      /// Current element
+      T *operator*() const { return current; }
+
+      /// Next element
+      Iterator &operator++() {
+        ++position;
+        skip();
+        return *this;
+      }
+
+      /// Compares positions
+      bool operator==(const Iterator &rhs) const {
+        return position == rhs.position;
+      }
+
+      /// Compares positions
+      bool operator!=(const Iterator &rhs) const {
+        return position != rhs.position;
+      }
+
+    private:
+      /// Current slot
+      const std::atomic<T *> *position;
+
+      /// Past the last slot
+      const std::atomic<T *> *end;
+
+      /// Element of the current slot, loaded once
+      T *current = nullptr;
+
+      /// Moves to the first slot that is not erased
+      void skip() {
+        while (position != end &&
+               (current = position->load(std::memory_order_acquire)) ==
+                   nullptr)
+          ++position;
+      }
+    };
+
+    /**
+     * Constructor of Snapshot
+     *
+     * @param items first slot
+     * @param count number of slots
+     */
+    Snapshot(const std::atomic<T *> *items, std::size_t count)
+        : items(items), count(count) {}
+
+    /// First element
+    Iterator begin() const { return Iterator(items, items + count); }
+
+    /// Past the last element
+    Iterator end() const { return Iterator(items + count, items + count); }
+
+    /// Check if there are no elements
+    bool empty() const { return !(begin() != end()); }
+
+  private:
+    /// First slot
+    const std::atomic<T *> *items;
+
+    /// Number of slots, with erased elements
+    std::size_t count;
+  };
+
+  /**
+   * Constructor of ChildList
+   *
+   * Empty list, array is allocated on first push_back.
+   *
+   * @param memory arena where arrays are allocated
+   */
+  explicit ChildList(BlockArena &memory) : memory(&memory) {}
+
+  /**
+   * Destructor of ChildList
+   *
+   * Array is released.
+   */
+  ~ChildList() { releaseArray(*memory, array.load()); }
+
+  /// Disabling construction of ChildList object using copy constructor
+  ChildList(const ChildList &rhs) = delete;
+
+  /// Disabling construction of ChildList object using copy assignment
+  ChildList &operator=(const ChildList &rhs) = delete;
+
+  /**
+   * Snapshot of the list
+   *
+   * @return snapshot
+   */
+  Snapshot snapshot() const {
+    const Array *current = array.load(std::memory_order_acquire);
+    if (current == nullptr)
+      return Snapshot(nullptr, 0);
+    return Snapshot(current->items(),
+                    current->size.load(std::memory_order_acquire));
+  }
+
+  /**
+   * Number of elements
+   *
+   * @return number of elements
+   */
+  std::size_t size() const { return count.load(std::memory_order_relaxed); }
+
+  /**
+   * Element at index
+   *
+   * Elements before it are visited, so it is used only by tests.
+   *
+   * @param index index of the element
+   * @return element
+   * @throw std::out_of_range if index is not less than size
+   */
+  T *at(std::size_t index) const {
+    for (auto item : snapshot()) {
+      if (index-- == 0)
+        return item;
+    }
+    throw std::out_of_range("ChildList::at");
+  }
+
+  /**
+   * Keep erased elements in the array, or drop them again
+   *
+   * @param pinned true if slots of elements don't change
+   */
+  void pinSlots(bool pinned) { this->pinned = pinned; }
+
+  /**
+   * Add element at the end
+   *
+   * @param item added element
+   * @param epochs epoch manager, where replaced array is retired
+   */
+  void push_back(T *item, EpochManager &epochs) {
+    Array *current = array.load(std::memory_order_relaxed);
+    if (current == nullptr ||
+        current->size.load(std::memory_order_relaxed) == current->capacity) {
+      current = pinned && current != nullptr ? grow(current)
+                                              : compact(current);
+      publish(current, epochs);
+    }
+    const std::size_t size = current->size.load(std::memory_order_relaxed);
+    item->listSlot = size;
+    current->items()[size].store(item, std::memory_order_relaxed);
+    current->size.store(size + 1, std::memory_order_release);
+    count.store(count.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+  }
+
+  /**
+   * Erase element
+   *
+   * @param item erased element
+   * @param epochs epoch manager, where replaced array is retired
+   * @return false if element is not in the list, true otherwise
+   */
+  bool erase(const T *item, EpochManager &epochs) {
+    Array *current = array.load(std::memory_order_relaxed);
+    if (current == nullptr)
+      return false;
+    const std::size_t slot = item->listSlot;
+    if (slot >= current->size.load(std::memory_order_relaxed) ||
+        current->items()[slot].load(std::memory_order_relaxed) != item)
+      return false;
+    // writes before erase, ex. copy of children, are seen by readers that
+    // skip the element
+    current->items()[slot].store(nullptr, std::memory_order_release);
+    erased(current, 1, epochs);
+    return true;
+  }
+
+  /**
+   * Erase all elements for which predicate is true
+   *
+   * At most one array is published, so erasing many elements costs as much
+   * as erasing one.
+   *
+   * @param erased predicate, called once for every element
+   * @param epochs epoch manager, where replaced array is retired
+   * @return number of erased elements
+   */
+  template <typename Predicate>
+  std::size_t eraseIf(Predicate erased, EpochManager &epochs) {
+    Array *current = array.load(std::memory_order_relaxed);
+    if (current == nullptr)
+      return 0;
+    const std::size_t size = current->size.load(std::memory_order_relaxed);
+    std::size_t erasedCount = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+      T *item = current->items()[i].load(std::memory_order_relaxed);
+      if (item != nullptr && erased(item)) {
+        current->items()[i].store(nullptr, std::memory_order_release);
+        ++erasedCount;
+      }
+    }
+    if (erasedCount != 0)
+      this->erased(current, erasedCount, epochs);
+    return erasedCount;
+  }
+
+private:
+  /**
+   * Array of elements
+   *
+   * @param capacity number of elements array can hold
+   * @param size number of elements in array
+   */
+  struct Array {
+    std::size_t capacity;
+    std::atomic<std::size_t> size{0};
+
+    explicit Array(std::size_t capacity) : capacity(capacity) {}
+
+    /// Slots, allocated after the array, nullptr for erased element
+    std::atomic<T *> *items() {
+      return reinterpret_cast<std::atomic<T *> *>(this + 1);
+    }
+
+    /// Slots, allocated after the array, nullptr for erased element
+    const std::atomic<T *> *items() const {
+      return reinterpret_cast<const std::atomic<T *> *>(this + 1);
+    }
+  };
+
+  /// Arena where arrays are allocated
+  BlockArena *memory;
+
+  /// Current array, nullptr before first push_back
+  std::atomic<Array *> array{nullptr};
+
+  /// Number of elements, without erased ones
+  std::atomic<std::size_t> count{0};
+
+  /// Set while erased elements keep their slots
+  bool pinned = false;
+
+  /**
+   * Count erased elements, and publish array without them, when they are
+   * more than half of the array
+   *
+   * @param current current array
+   * @param erasedCount number of elements that were erased
+   * @param epochs epoch manager, where replaced array is retired
+   */
+  void erased(Array *current, std::size_t erasedCount, EpochManager &epochs) {
+    const std::size_t remaining =
+        count.load(std::memory_order_relaxed) - erasedCount;
+    count.store(remaining, std::memory_order_relaxed);
+    if (!pinned &&
+        2 * remaining < current->size.load(std::memory_order_relaxed))
+      publish(compact(current), epochs);
+  }
+
+  /**
+   * Copy elements that are not erased to new array, twice as big as their
+   * number, and set their indexes
+   *
+   * @param current current array, can be nullptr
+   * @return new array
+   */
+  Array *compact(const Array *current) {
+    const std::size_t kept = count.load(std::memory_order_relaxed);
+    Array *next = allocateArray(kept < 2 ? 4 : kept * 2);
+    std::size_t size = 0;
+    if (current != nullptr) {
+      const Snapshot live(current->items(),
+                          current->size.load(std::memory_order_relaxed));
+      for (auto item : live) {
+        item->listSlot = size;
+        next->items()[size++].store(item, std::memory_order_relaxed);
+      }
+    }
+    next->size.store(size, std::memory_order_relaxed);
+    return next;
+  }
+
+  /**
+   * Copy all slots to new array, twice as big, so indexes don't change
+   *
+   * @param current current array, that is full
+   * @return new array
+   */
+  Array *grow(const Array *current) {
+    const std::size_t size = current->size.load(std::memory_order_relaxed);
+    Array *next = allocateArray(size * 2);
+    for (std::size_t i = 0; i < size; ++i)
+      next->items()[i].store(
+          current->items()[i].load(std::memory_order_relaxed),
+          std::memory_order_relaxed);
+    next->size.store(size, std::memory_order_relaxed);
+    return next;
+  }
+
+  /**
+   * Allocate array
+   *
+   * @param capacity number of elements
+   * @return ptr to empty array
+   */
+  Array *allocateArray(std::size_t capacity) {
+    Array *allocated =
+        new (memory->allocate(bytesOf(capacity))) Array(capacity);
+    for (std::size_t i = 0; i < capacity; ++i)
+      new (allocated->items() + i) std::atomic<T *>(nullptr);
+    return allocated;
+  }
+
+  /**
+   * Release array
+   *
+   * @param memory arena where array was allocated
+   * @param released array created by allocateArray, can be nullptr
+   */
+  static void releaseArray(BlockArena &memory, Array *released) {
+    if (released == nullptr)
+      return;
+    const std::size_t bytes = bytesOf(released->capacity);
+    released->~Array();
+    memory.deallocate(released, bytes);
+  }
+
+  /**
+   * Size of the array
+   *
+   * @param capacity number of elements
+   * @return bytes of the array with its slots
+   */
+  static std::size_t bytesOf(std::size_t capacity) {
+    return sizeof(Array) + capacity * sizeof(std::atomic<T *>);
+  }
+
+  /**
+   * Publish new array and retire old one
+   *
+   * @param next new array
+   * @param epochs epoch manager, where old array is retired
+   */
+  void publish(Array *next, EpochManager &epochs) {
+    Array *old = array.load(std::memory_order_relaxed);
+    array.store(next, std::memory_order_release);
+    if (old != nullptr)
+      epochs.retire(
+          old,
+          [](void *memory, void *pointer) {
+            releaseArray(*static_cast<BlockArena *>(memory),
+                         static_cast<Array *>(pointer));
+          },
+          memory);
+  }
+};
+} // namespace vfs
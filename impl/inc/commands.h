@@ -1,6 +1,9 @@
 #pragma once
 
 #include "commandsIf.h"
+#include "compactFileSystem.h"
+#include "tokenizer.h"
+#include <memory>
 
 namespace vfs {
 
@@ -12,14 +15,26 @@ namespace vfs {
  */
 class Commands : public CommandsIf {
 public:
+  /// Storage engine that commands work with
+  enum class Storage {
+    /// VirtualFileSystem, all commands are available
+    Tree,
+    /// CompactFileSystem, only mkdir, cd, ls without options, rm, mkfile, du
+    /// and find are available
+    Compact
+  };
+
   VirtualFileSystem vfs;
 
   /**
    * Constructor of Commands
    *
-   * Instantiation of VirtualFileSystem class too
+   * Instantiation of VirtualFileSystem class too, and of CompactFileSystem
+   * class for compact storage.
+   *
+   * @param storage storage engine that commands work with
    */
-  Commands();
+  explicit Commands(Storage storage = Storage::Tree);
 
   /**
    * Destructor of Commands
@@ -36,11 +51,24 @@ public:
    */
   void command() override;
 
+  /**
+   * Batch mode, commands are read from input without prompts, until end of
+   * input or until q is read. While commands are executed, std::cout writes
+   * to output, so all output can be collected in one big buffer. When input
+   * is executed, number of commands and commands per second are printed to
+   * std::cerr.
+   *
+   * @param input stream with one command per line
+   * @param output stream buffer where output of commands is written
+   * @return number of executed commands
+   */
+  std::size_t batch(std::istream &input, std::streambuf *output);
+
   /**
    * Implementation of mkdir command function, that calls for makeDirectory in
    * VirtualFileSystem class.
    *
-   * @param nameDirectory name of directory
+   * @param nameDirectory name or path of directory
    */
   void makeDirectory(const std::string &nameDirectory);
 
@@ -50,7 +78,7 @@ public:
    * Implementation of cd command function, that calls for changeDirectory in
    * VirtualFileSystem class.
    *
-   * @param nameDirectory name of directory
+   * @param nameDirectory name or path of directory
    */
   void changeDirectory(const std::string &nameDirectory);
 
@@ -61,11 +89,29 @@ public:
    */
   void list();
 
+  /**
+   * Implementation of ls command function with path, that calls for list in
+   * VirtualFileSystem class.
+   *
+   * @param path name or path of directory
+   */
+  void list(const std::string &path);
+
+  /**
+   * Implementation of ls command function with options, that calls for
+   * ordered list in VirtualFileSystem class.
+   *
+   * @param path name or path of directory, current directory if empty
+   * @param options order, limit and cursor of the listing
+   */
+  void list(const std::string &path,
+            const VirtualFileSystem::ListOptions &options);
+
   /**
    * Implementation of rm command function, that calls for remove in
    * VirtualFileSystem class.
    *
-   * @param name name of directory/file
+   * @param name name or path of directory/file
    */
   void remove(const std::string &name);
 
@@ -73,13 +119,134 @@ public:
    * Implementation of mkfile command function, that calls for makeFile in
    * VirtualFileSystem class.
    *
-   * @param nameFile name of file
+   * @param nameFile name or path of file
    */
   void makeFile(const std::string &nameFile);
 
   /**
-   * Implementation of function that parse input string, calls for
-   * splitString(const std::string &stringToSplit, char delimiter)
+   * Implementation of save command function, that calls for save in
+   * VirtualFileSystem class.
+   *
+   * @param path path of image file
+   */
+  void save(const std::string &path);
+
+  /**
+   * Implementation of load command function, that calls for load in
+   * VirtualFileSystem class.
+   *
+   * @param path path of image file
+   */
+  void load(const std::string &path);
+
+  /**
+   * Implementation of cp command function, that calls for copy in
+   * VirtualFileSystem class.
+   *
+   * @param source name or path of directory/file that is copied
+   * @param destination name or path of the copy
+   */
+  void copy(const std::string &source, const std::string &destination);
+
+  /**
+   * Implementation of du command function, that calls for diskUsage in
+   * VirtualFileSystem class.
+   *
+   * @param path name or path of directory, current directory if empty
+   */
+  void diskUsage(const std::string &path);
+
+  /**
+   * Implementation of find command function, that calls for find in
+   * VirtualFileSystem class.
+   *
+   * @param path name or path of directory, current directory if empty
+   * @param name name of directories/files that are found
+   */
+  void find(const std::string &path, const std::string &name);
+
+  /**
+   * Implementation of cat command function, that calls for cat in
+   * VirtualFileSystem class.
+   *
+   * @param path name or path of file
+   */
+  void cat(const std::string &path);
+
+  /**
+   * Implementation of write command function, that calls for truncate and
+   * write, or for append, in VirtualFileSystem class.
+   *
+   * @param path name or path of file
+   * @param text new data of the file
+   * @param append if set, text is appended to data of the file
+   */
+  void write(const std::string &path, const std::string &text, bool append);
+
+  /**
+   * Implementation of complete command function, that calls for complete in
+   * VirtualFileSystem class.
+   *
+   * @param prefix beginning of names that are completed
+   */
+  void complete(const std::string &prefix);
+
+  /**
+   * Implementation of locate command function, that calls for locate in
+   * VirtualFileSystem class.
+   *
+   * @param prefix beginning of names of directories/files that are located
+   */
+  void locate(const std::string &prefix);
+
+  /**
+   * Implementation of grep command function, that calls for grep in
+   * VirtualFileSystem class.
+   *
+   * @param pattern string that is found in lines of files
+   * @param path name or path of directory or file, current directory if
+   * empty
+   */
+  void grep(const std::string &pattern, const std::string &path);
+
+  /**
+   * Implementation of stats command function, that prints stats of
+   * VirtualFileSystem class. For every operation number of calls and p50,
+   * p99 and max latency are printed, then lookups, nodes, the largest
+   * number of children of directory, compressed chunks of file data with
+   * memory that their compression saves, and chunks that are spilled to
+   * backing file.
+   *
+   */
+  void stats();
+
+  /**
+   * Implementation of dedupstats command function, that prints logical size
+   * of all files, physical size of their chunks and ratio of the two, that
+   * is saving of deduplication.
+   *
+   */
+  void dedupStats();
+
+  /**
+   * Implementation of function that parse input string. Input is split in
+   * tokens with Tokenizer, first token is command, that must match one of
+   * shellCommands, rest are arguments. mkdir, mkfile, rm and ls are called
+   * for every argument, ex. "mkdir a b c" creates three directories. save and
+   * load take exactly one argument, path of image file. rm and cp accept -r,
+   * they always work recursively. cp takes source and destination, du is
+   * called for every argument, and find takes optional path and -name name.
+   * ls accepts options before paths, --sort name|time, --limit N and --after
+   * cursor, ex. "ls --sort name --limit 100 a" lists first 100 children of a.
+   * Paths of ls and rm, and name of find, can end with glob, ex. "rm *.tmp".
+   * stats and dedupstats take no arguments, complete and locate take
+   * exactly one argument, prefix of names, ex. "locate rep" prints paths of
+   * all directories and files whose names start with rep. cat prints data
+   * of every file, write [-a] file text replaces data of the file with the
+   * rest of the line and newline, or appends them with -a. grep [-r]
+   * pattern [path] prints lines of files below directory, or of the file,
+   * that have pattern, as path:line:text, -r is accepted, it always works
+   * recursively.
    *
    * @param inputCommand user command
    */
@@ -87,16 +254,66 @@ public:
 
 private:
   /// Implemented shell commands
-  std::vector<std::string> shellCommands{"mkdir", "cd", "ls", "rm", "mkfile"};
+  std::vector<std::string> shellCommands{
+      "mkdir", "cd", "ls", "rm", "mkfile", "save", "load", "cp", "du", "find",
+      "stats", "complete", "locate", "cat", "write", "dedupstats", "grep"};
+
+  /// Shell command, found from the first token of input
+  enum class ShellCommand {
+    Mkdir,
+    Cd,
+    Ls,
+    Rm,
+    Mkfile,
+    Save,
+    Load,
+    Cp,
+    Du,
+    Find,
+    Stats,
+    Complete,
+    Locate,
+    Cat,
+    Write,
+    DedupStats,
+    Grep,
+    Unknown
+  };
+
+  /// Argument of the command, reused so parsing doesn't allocate
+  std::string argument{};
+
+  /// Second argument of the command, for cp, find, write and grep
+  std::string secondArgument{};
+
+  /// Compact storage, commands work with it instead of vfs, if it is set
+  std::unique_ptr<CompactFileSystem> compact{};
+
+  /**
+   * Check if command works with current storage, commands that only
+   * VirtualFileSystem has print error with compact storage
+   *
+   * @return true if vfs is used
+   */
+  bool treeStorage() const;
+
+  /**
+   * Find shell command
+   *
+   * Switch on length of the token, so token is compared only with command
+   * names of its length, at most five of them, cd, ls, rm, cp and du.
+   *
+   * @param token first token of the input
+   * @return shell command, Unknown if token is not a command
+   */
+  static ShellCommand findCommand(const Token &token);
 
   /**
-   * Implementation of split command input string, ex. "mkdir some", with
-   * delimiter " " you split string and fetch "some" easily
+   * Copy token to argument
    *
-   * @param stringToSplit input string that is split
-   * @param delimiter char that is used as point where to split string, for now
-   * is one space char
+   * @param token argument token
+   * @return argument
    */
-  std::string splitString(const std::string &stringToSplit, char delimiter);
+  const std::string &toArgument(const Token &token);
 };
 } // namespace vfs
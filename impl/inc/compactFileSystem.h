@@ -0,0 +1,280 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace vfs {
+
+/**
+ * Implementation of the CompactFileSystem class.
+ *
+ * CompactFileSystem is storage engine with the same commands as
+ * VirtualFileSystem, for one thread, that keeps nodes in struct of arrays.
+ * Node is 32 bit id, index in arrays of parent, first and last child, next
+ * and previous sibling, offset and size of name in one shared string heap,
+ * time of creation and type byte. Children of directory are linked list of
+ * siblings, in order of creation, names are found in one open addressing
+ * hash table of ids, keyed by parent and name. Node costs about 40 bytes
+ * and its name, instead of directory or file object with its own strings,
+ * name index and child arrays.
+ *
+ * Ids of removed nodes are reused, names of removed nodes are compacted
+ * when they take more than half of the string heap. Scan of the whole tree
+ * is linear scan of type array, scan of subtree follows child and sibling
+ * ids with explicit stack.
+ *
+ */
+class CompactFileSystem {
+public:
+  /// Id of the node, index in arrays
+  using NodeId = std::uint32_t;
+
+  /// Id of no node
+  static constexpr NodeId none = UINT32_MAX;
+
+  /**
+   * Constructor of CompactFileSystem
+   *
+   * Head directory, home, is created, and current directory is set to it.
+   *
+   * @param output stream where directories are listed and errors are written
+   */
+  explicit CompactFileSystem(std::ostream &output = std::cout);
+
+  /// Disabling construction of CompactFileSystem object using copy
+  /// constructor
+  CompactFileSystem(const CompactFileSystem &rhs) = delete;
+
+  /// Disabling construction of CompactFileSystem object using copy
+  /// assignment
+  CompactFileSystem &operator=(const CompactFileSystem &rhs) = delete;
+
+  /**
+   * Make directory, see VirtualFileSystem::makeDirectory
+   *
+   * @param nameDirectory name or path of the directory
+   */
+  void makeDirectory(const std::string &nameDirectory);
+
+  /**
+   * Change directory, see VirtualFileSystem::changeDirectory
+   *
+   * @param nameDirectory name or path of the directory, home if empty
+   */
+  void changeDirectory(const std::string &nameDirectory);
+
+  /**
+   * List in current directory, see VirtualFileSystem::list
+   */
+  void list() const { list(std::string()); }
+
+  /**
+   * List in directory, see VirtualFileSystem::list
+   *
+   * @param path name or path of the directory, current directory if empty
+   */
+  void list(const std::string &path) const;
+
+  /**
+   * Remove directory or file, see VirtualFileSystem::remove
+   *
+   * Directory is removed with its subtree, ids and names of removed nodes
+   * are reused.
+   *
+   * @param name name or path of the directory/file
+   */
+  void remove(const std::string &name);
+
+  /**
+   * Make file, see VirtualFileSystem::makeFile
+   *
+   * @param nameFile name or path of the file
+   */
+  void makeFile(const std::string &nameFile);
+
+  /**
+   * Count directories and files below directory, see
+   * VirtualFileSystem::diskUsage
+   *
+   * @param path name or path of the directory, current directory if empty
+   */
+  void diskUsage(const std::string &path = std::string()) const;
+
+  /**
+   * Find directories and files by name, see VirtualFileSystem::find
+   *
+   * @param path name or path of the directory, current directory if empty
+   * @param name name of the directories/files that are found
+   */
+  void find(const std::string &path, const std::string &name) const;
+
+  /**
+   * Number of directories and files, with head
+   *
+   * @return number of nodes
+   */
+  std::size_t nodeCount() const { return count; }
+
+  /**
+   * Memory used by nodes
+   *
+   * @return bytes of arrays, string heap and hash table
+   */
+  std::size_t memoryUsage() const;
+
+private:
+  /// Type of the node
+  enum Type : std::uint8_t { Free, Directory, File };
+
+  /// Parent of the node, none for head
+  std::vector<NodeId> parents{};
+
+  /// First child of directory, none if it is empty
+  std::vector<NodeId> firstChildren{};
+
+  /// Last child of directory, new children are linked after it
+  std::vector<NodeId> lastChildren{};
+
+  /// Next sibling, or next free id, for free node
+  std::vector<NodeId> nextSiblings{};
+
+  /// Previous sibling, so node is unlinked in O(1)
+  std::vector<NodeId> previousSiblings{};
+
+  /// Offset of the name in names
+  std::vector<std::uint32_t> nameOffsets{};
+
+  /// Size of the name
+  std::vector<std::uint32_t> nameSizes{};
+
+  /// Time when directory/file was created
+  std::vector<std::int64_t> timesCreated{};
+
+  /// Type of the node
+  std::vector<Type> types{};
+
+  /// String heap, names of all nodes one after another
+  std::string names{};
+
+  /// Bytes of names of removed nodes, still in names
+  std::size_t garbage = 0;
+
+  /// The first free id, free ids are linked through nextSiblings
+  NodeId freeIds = none;
+
+  /// Number of nodes, with head
+  std::size_t count = 0;
+
+  /// Hash table of nodes, except head, keyed by parent and name
+  std::vector<NodeId> slots{};
+
+  /// Slots that are not empty, full and erased ones
+  std::size_t usedSlots = 0;
+
+  /// Current directory
+  NodeId currentDirectory = 0;
+
+  /// Stream where directories are listed and errors are written
+  std::ostream &out;
+
+  /// Slot of erased node
+  static constexpr NodeId erased = none - 1;
+
+  /// Head directory, home
+  static constexpr NodeId head = 0;
+
+  /**
+   * Hash of the name in directory
+   *
+   * @param parent id of the directory
+   * @param name first character of the name
+   * @param size length of the name
+   * @return hash
+   */
+  static std::uint64_t hashOf(NodeId parent, const char *name,
+                              std::size_t size);
+
+  /**
+   * Check if node has the name
+   *
+   * @param node id of the node
+   * @param name first character of the name
+   * @param size length of the name
+   * @return true if names are equal
+   */
+  bool hasName(NodeId node, const char *name, std::size_t size) const;
+
+  /**
+   * Find child by name
+   *
+   * @param parent id of the directory
+   * @param name first character of the name
+   * @param size length of the name
+   * @return id of the child, none if there is no such child
+   */
+  NodeId findChild(NodeId parent, const char *name, std::size_t size) const;
+
+  /**
+   * Find directory, path is resolved like in VirtualFileSystem::findDirectory
+   *
+   * @param path first character of the path
+   * @param size length of the path
+   * @return id of the directory, none if there is no such directory
+   */
+  NodeId findDirectory(const char *path, std::size_t size) const;
+
+  /**
+   * Find parent directory, like VirtualFileSystem::findParent
+   *
+   * @param path path of the directory/file
+   * @param leafStart position of the last component in path
+   * @param leafSize length of the last component
+   * @return id of the parent, none if there is no such directory
+   */
+  NodeId findParent(const std::string &path, std::size_t &leafStart,
+                    std::size_t &leafSize) const;
+
+  /**
+   * Create node and link it as the last child of parent
+   *
+   * @param path path whose last component is name of the node
+   * @param type Directory or File
+   */
+  void create(const std::string &path, Type type);
+
+  /**
+   * Insert node in hash table
+   *
+   * @param node id of the node, its parent and name are set
+   */
+  void insertSlot(NodeId node);
+
+  /**
+   * Erase node from hash table
+   *
+   * @param node id of the node
+   */
+  void eraseSlot(NodeId node);
+
+  /**
+   * Rebuild hash table, big enough for all nodes, without erased slots
+   */
+  void rehash();
+
+  /**
+   * Copy names of nodes to new string heap, without names of removed nodes
+   */
+  void compactNames();
+
+  /**
+   * Absolute path of the node
+   *
+   * @param node id of the node
+   * @return path, starting with /home
+   */
+  std::string pathOf(NodeId node) const;
+};
+} // namespace vfs
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "nameIndex.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace vfs {
+
+/**
+ * Implementation of the DentryCache class.
+ *
+ * DentryCache maps path, resolved from base directory, to the directory that
+ * path leads to. Absolute paths use nullptr as base. Every entry keeps
+ * generation of the vfs structure in which it was inserted, generation is
+ * incremented when some directory is removed, so whole cache is invalidated
+ * in O(1), entries from older generation are ignored and overwritten. When
+ * cache reaches its capacity, it is cleared. Cache is used by one session, so
+ * it is not synchronized.
+ *
+ * @tparam Directory type of the directory
+ */
+template <typename Directory> class DentryCache {
+public:
+  /**
+   * Constructor of DentryCache
+   *
+   * @param maxEntries capacity of the cache
+   */
+  explicit DentryCache(std::size_t maxEntries = 65536)
+      : capacity(maxEntries) {}
+
+  /**
+   * Find directory for the path
+   *
+   * @param base directory from which path is resolved, nullptr for absolute
+   * path
+   * @param data first character of the path
+   * @param size length of the path
+   * @param generation current generation of the vfs structure
+   * @return ptr to directory, nullptr if path is not in cache
+   */
+  Directory *find(const Directory *base, const char *data, std::size_t size,
+                  std::uint64_t generation) {
+    key.base = base;
+    key.path.assign(data, size);
+    auto entry = entries.find(key);
+    if (entry == entries.end() || entry->second.generation != generation)
+      return nullptr;
+    return entry->second.directory;
+  }
+
+  /**
+   * Insert directory for the path
+   *
+   * @param base directory from which path is resolved, nullptr for absolute
+   * path
+   * @param data first character of the path
+   * @param size length of the path
+   * @param directory directory that path leads to
+   * @param generation current generation of the vfs structure
+   */
+  void insert(const Directory *base, const char *data, std::size_t size,
+              Directory *directory, std::uint64_t generation) {
+    if (entries.size() >= capacity)
+      entries.clear();
+    key.base = base;
+    key.path.assign(data, size);
+    Entry &entry = entries[key];
+    entry.directory = directory;
+    entry.generation = generation;
+  }
+
+private:
+  /**
+   * Key of the cache
+   *
+   * @param base directory from which path is resolved
+   * @param path resolved path
+   */
+  struct Key {
+    const Directory *base = nullptr;
+    std::string path{};
+
+    bool operator==(const Key &rhs) const {
+      return base == rhs.base && path == rhs.path;
+    }
+  };
+
+  /// Hash of the key, hash of the path mixed with address of base
+  struct KeyHash {
+    std::size_t operator()(const Key &k) const {
+      std::uint64_t hash = hashName(k.path.data(), k.path.size());
+      hash ^= reinterpret_cast<std::uintptr_t>(k.base) * 0x9E3779B97F4A7C15ULL;
+      return static_cast<std::size_t>(hash);
+    }
+  };
+
+  /**
+   * Value of the cache
+   *
+   * @param directory directory that path leads to
+   * @param generation generation in which entry was inserted
+   */
+  struct Entry {
+    Directory *directory = nullptr;
+    std::uint64_t generation = 0;
+  };
+
+  /// Cached paths
+  std::unordered_map<Key, Entry, KeyHash> entries{};
+
+  /// Key reused for lookups, so path is not allocated on every lookup
+  Key key{};
+
+  /// Capacity of the cache
+  std::size_t capacity;
+};
+} // namespace vfs
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vfs {
+
+/**
+ * Implementation of the EpochManager class.
+ *
+ * EpochManager implements epoch based reclamation. Readers enter epoch with
+ * Guard and read shared structure without locks. Writer that unlinks memory
+ * from shared structure retires it, instead of releasing it, retired memory
+ * is tagged with global epoch. Global epoch is advanced when all readers,
+ * that are in some epoch, have seen current global epoch, memory retired two
+ * epochs before global epoch can't be seen by any reader, so it is released.
+ *
+ * Every reader is a Participant, participant is used by one thread at a time.
+ *
+ * Retired memory is released by retire, on thread of the writer, every 64
+ * retires, or, when reclaimer is started, by background reclaimer thread, so
+ * writers never wait while big retired structures are released.
+ *
+ */
+class EpochManager {
+public:
+  /// Function that releases retired memory
+  using Reclaim = void (*)(void *context, void *pointer);
+
+  /**
+   * Participant of epoch based reclamation
+   *
+   * @param epoch epoch in which participant is, idle when it is not reading
+   */
+  struct Participant {
+    std::atomic<std::uint64_t> epoch{idle};
+  };
+
+  /**
+   * Implementation of the Guard class.
+   *
+   * Participant is in current global epoch while Guard exists.
+   *
+   */
+  class Guard {
+  public:
+    /**
+     * Constructor of Guard
+     *
+     * @param manager epoch manager
+     * @param participant participant that enters epoch
+     */
+    Guard(EpochManager &manager, Participant &participant)
+        : participant(participant) {
+      participant.epoch.store(manager.globalEpoch.load());
+    }
+
+    /**
+     * Destructor of Guard
+     *
+     * Participant leaves epoch.
+     */
+    ~Guard() { participant.epoch.store(idle); }
+
+    /// Disabling construction of Guard object using copy constructor
+    Guard(const Guard &rhs) = delete;
+
+    /// Disabling construction of Guard object using copy assignment
+    Guard &operator=(const Guard &rhs) = delete;
+
+  private:
+    /// Participant that is in epoch
+    Participant &participant;
+  };
+
+  /**
+   * Constructor of EpochManager
+   *
+   * Default constructor
+   */
+  EpochManager() = default;
+
+  /**
+   * Destructor of EpochManager
+   *
+   * Reclaimer is stopped and all retired memory is released, calling
+   * reclaimAll.
+   */
+  ~EpochManager();
+
+  /// Disabling construction of EpochManager object using copy constructor
+  EpochManager(const EpochManager &rhs) = delete;
+
+  /// Disabling construction of EpochManager object using copy assignment
+  EpochManager &operator=(const EpochManager &rhs) = delete;
+
+  /**
+   * Creates participant
+   *
+   * @return ptr to participant, owned by EpochManager until leave
+   */
+  Participant *join();
+
+  /**
+   * Removes participant
+   *
+   * @param participant participant created by join
+   */
+  void leave(Participant *participant);
+
+  /**
+   * Retire memory
+   *
+   * Memory is released with reclaim, when no reader can see it. Every 64
+   * retires, collect is called, if reclaimer is not started.
+   *
+   * @param pointer retired memory
+   * @param reclaim function that releases memory
+   * @param context first argument of reclaim
+   */
+  void retire(void *pointer, Reclaim reclaim, void *context = nullptr);
+
+  /**
+   * Retire object
+   *
+   * Object is deleted, when no reader can see it.
+   *
+   * @param object object created with new
+   */
+  template <typename T> void retire(T *object) {
+    retire(object,
+           [](void *, void *pointer) { delete static_cast<T *>(pointer); });
+  }
+
+  /**
+   * Advance global epoch, if all participants have seen it, and release
+   * memory that no reader can see.
+   */
+  void collect();
+
+  /**
+   * Release all retired memory
+   *
+   * Called when no participant is in epoch. Waits until memory, that
+   * reclaimer is releasing, is released.
+   */
+  void reclaimAll();
+
+  /**
+   * Number of retired, not yet released, pointers
+   *
+   * @return number of pointers, with pointers that are being released
+   */
+  std::size_t pending() const;
+
+  /**
+   * Starts background reclaimer thread
+   *
+   * Reclaimer calls collect while there is retired memory, retire doesn't
+   * call it after that.
+   */
+  void startReclaimer();
+
+  /**
+   * Stops background reclaimer thread, retire calls collect again
+   */
+  void stopReclaimer();
+
+  /**
+   * Waits until all retired memory is released
+   *
+   * Memory is released when readers leave epoch, so drain is called when no
+   * participant stays in epoch, ex. in tests and at shutdown.
+   */
+  void drain();
+
+private:
+  /// Epoch of participant that is not reading
+  static constexpr std::uint64_t idle = ~std::uint64_t(0);
+
+  /**
+   * Retired memory
+   *
+   * @param pointer retired memory
+   * @param reclaim function that releases memory
+   * @param context first argument of reclaim
+   * @param epoch global epoch when memory was retired
+   */
+  struct Retired {
+    void *pointer;
+    Reclaim reclaim;
+    void *context;
+    std::uint64_t epoch;
+  };
+
+  /// Global epoch
+  std::atomic<std::uint64_t> globalEpoch{0};
+
+  /// All participants
+  std::vector<Participant *> participants{};
+
+  /// Retired memory, in order of retirement
+  std::vector<Retired> retired{};
+
+  /// Number of retires since last collect
+  std::size_t sinceCollect = 0;
+
+  /// Number of pointers that are being released, outside of lock
+  std::size_t releasing = 0;
+
+  /// Background reclaimer thread, not joinable if reclaimer is not started
+  std::thread reclaimer{};
+
+  /// Set when reclaimer should stop
+  bool stopping = false;
+
+  /// Guards participants, retired, sinceCollect, releasing and stopping
+  mutable std::mutex mutex{};
+
+  /// Wakes reclaimer, when memory is retired
+  std::condition_variable retiredCondition{};
+
+  /// Wakes reclaimAll, when released memory is released
+  std::condition_variable releasedCondition{};
+
+  /**
+   * Thread of the reclaimer
+   */
+  void reclaim();
+};
+} // namespace vfs
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace vfs {
+
+/**
+ * Implementation of the Glob class.
+ *
+ * Glob is shell wildcard pattern, compiled once and then matched against
+ * many names. * matches any number of characters, ? matches one character,
+ * [abc], [a-z] and [!abc] match one character of the set, or not in the set,
+ * and \ escapes the next character. [ without closing ] is ordinary
+ * character.
+ *
+ * Pattern is split on stars in chunks of fixed length. The first chunk must
+ * match at the start of the name, the last one at its end, and chunks
+ * between them are found from left to right, so name is matched in one pass
+ * without backtracking. Chunk that starts with literal characters is found
+ * with memchr and memcmp, that compare many bytes at a time.
+ *
+ */
+class Glob {
+public:
+  /**
+   * Constructor of Glob
+   *
+   * @param pattern pattern that is compiled
+   */
+  explicit Glob(const std::string &pattern);
+
+  /**
+   * Check if text is pattern, or plain name
+   *
+   * @param text name or pattern
+   * @param size number of characters in text
+   * @return true if text has *, ? or [
+   */
+  static bool isPattern(const char *text, std::size_t size);
+
+  /// @see isPattern
+  static bool isPattern(const std::string &text) {
+    return isPattern(text.data(), text.size());
+  }
+
+  /**
+   * Match name against pattern
+   *
+   * @param name first character of the name
+   * @param size number of characters in the name
+   * @return true if whole name matches pattern
+   */
+  bool match(const char *name, std::size_t size) const;
+
+  /// @see match
+  bool match(const std::string &name) const {
+    return match(name.data(), name.size());
+  }
+
+  /**
+   * Literal characters at the start of the pattern
+   *
+   * Every name that matches pattern starts with prefix, so names can be
+   * looked up in sorted index.
+   *
+   * @return prefix, empty if pattern starts with wildcard
+   */
+  const std::string &prefix() const { return literalPrefix; }
+
+private:
+  /**
+   * Part of the chunk that matches fixed number of characters
+   *
+   * @param literal characters that must match, for Literal
+   * @param set characters that match, for Set, one character
+   */
+  struct Element {
+    enum class Kind { Literal, Any, Set };
+    Kind kind;
+    std::string literal{};
+    std::bitset<256> set{};
+  };
+
+  /**
+   * Part of the pattern between stars
+   *
+   * @param elements elements that are matched one after another
+   * @param size number of characters chunk matches
+   */
+  struct Chunk {
+    std::vector<Element> elements{};
+    std::size_t size = 0;
+  };
+
+  /// Chunks between stars, first and last can be empty
+  std::vector<Chunk> chunks{};
+
+  /// Literal characters at the start of the pattern
+  std::string literalPrefix{};
+
+  /**
+   * Check if chunk matches characters at name
+   *
+   * @param chunk chunk that is matched
+   * @param name first character that is compared, chunk.size are compared
+   * @return true if chunk matches
+   */
+  static bool matchAt(const Chunk &chunk, const char *name);
+
+  /**
+   * Find the first position where chunk matches
+   *
+   * @param chunk chunk that is found
+   * @param begin first character where chunk can start
+   * @param end past the last character where chunk can end
+   * @return start of the chunk, nullptr if chunk is not found
+   */
+  static const char *find(const Chunk &chunk, const char *begin,
+                          const char *end);
+};
+} // namespace vfs
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace vfs {
+
+/**
+ * Header of the vfs image
+ *
+ * Image is header, node table and string heap, in native byte order. All
+ * positions in image are offsets, so image can be mapped at any address.
+ * String heap holds names of all nodes and data of all files.
+ *
+ * @param magic "VFSIMG3", with version of the format
+ * @param nodeCount number of nodes in node table, that follows the header
+ * @param stringOffset offset of string heap from the start of the image
+ * @param stringSize size of string heap
+ * @param journalSequence sequence number of the last journal record that is
+ * in the image
+ */
+struct ImageHeader {
+  char magic[8];
+  std::uint64_t nodeCount;
+  std::uint64_t stringOffset;
+  std::uint64_t stringSize;
+  std::uint64_t journalSequence;
+};
+
+/**
+ * Directory or file in node table of the vfs image
+ *
+ * Nodes are in breadth first order, root directory is the first node.
+ * Children of the directory are one range of nodes, first subdirectories and
+ * then files, in order in which they are listed.
+ *
+ * @param nameOffset offset of the name in string heap
+ * @param timeCreated time when directory/file was created, seconds since
+ * epoch
+ * @param nameSize length of the name
+ * @param directoryCount number of subdirectories, 0 for file
+ * @param fileCount number of files, 0 for file
+ * @param firstChild index of the first child in node table
+ * @param dataOffset offset of data of the file in string heap, 0 for
+ * directory
+ * @param dataSize size of data of the file, 0 for directory
+ */
+struct ImageNode {
+  std::uint64_t nameOffset;
+  std::int64_t timeCreated;
+  std::uint32_t nameSize;
+  std::uint32_t directoryCount;
+  std::uint32_t fileCount;
+  std::uint32_t firstChild;
+  std::uint64_t dataOffset;
+  std::uint64_t dataSize;
+};
+
+/**
+ * Implementation of the Image class.
+ *
+ * Image maps vfs image read only in memory. Only the header and the root are
+ * checked when image is opened, other nodes are checked when they are read,
+ * so opening doesn't depend on the number of nodes.
+ *
+ */
+class Image {
+public:
+  /**
+   * Constructor of Image
+   *
+   * Empty image, nothing is mapped.
+   */
+  Image() = default;
+
+  /**
+   * Destructor of Image
+   *
+   * Image is unmapped, calling close.
+   */
+  ~Image();
+
+  /// Disabling construction of Image object using copy constructor
+  Image(const Image &rhs) = delete;
+
+  /// Disabling construction of Image object using copy assignment
+  Image &operator=(const Image &rhs) = delete;
+
+  /**
+   * Maps the image
+   *
+   * Image that was mapped before is unmapped.
+   *
+   * @param path path of the image file
+   * @return false if file can't be mapped or it is not valid image
+   */
+  bool open(const std::string &path);
+
+  /**
+   * Unmaps the image
+   */
+  void close();
+
+  /**
+   * Swaps mapped images
+   *
+   * @param other image that is swapped with this one
+   */
+  void swap(Image &other);
+
+  /**
+   * Root directory of the image
+   *
+   * @return ptr to root node, nullptr if nothing is mapped
+   */
+  const ImageNode *root() const;
+
+  /**
+   * Child of the directory
+   *
+   * @param node directory node of this image
+   * @param index index of the child, subdirectories are before files
+   * @return ptr to child node, nullptr if child is outside of node table
+   */
+  const ImageNode *child(const ImageNode *node, std::size_t index) const;
+
+  /**
+   * Name of the node
+   *
+   * @param node node of this image
+   * @return first character of the name, nullptr if name is outside of string
+   * heap
+   */
+  const char *name(const ImageNode *node) const;
+
+  /**
+   * Data of the file
+   *
+   * @param node file node of this image
+   * @return first byte of the data, nullptr if data is outside of string
+   * heap
+   */
+  const char *fileData(const ImageNode *node) const;
+
+  /**
+   * Sequence number of the last journal record that is in the image
+   *
+   * @return sequence number, 0 if nothing is mapped
+   */
+  std::uint64_t journalSequence() const;
+
+private:
+  /// Mapped image
+  const char *data = nullptr;
+
+  /// Size of mapped image
+  std::size_t size = 0;
+
+  /// Node table
+  const ImageNode *nodes = nullptr;
+
+  /// Number of nodes in node table
+  std::size_t nodeCount = 0;
+
+  /// String heap
+  const char *strings = nullptr;
+
+  /// Size of string heap
+  std::size_t stringSize = 0;
+
+  /// Sequence number of the last journal record that is in the image
+  std::uint64_t journal = 0;
+};
+
+/**
+ * Implementation of the ImageWriter class.
+ *
+ * ImageWriter writes vfs image, nodes are added in breadth first order. Image
+ * is written and synced to temporary file, that replaces image file when it
+ * is closed, so image file is never partially written.
+ *
+ */
+class ImageWriter {
+public:
+  /**
+   * Opens temporary file of the image
+   *
+   * @param path path of the image file
+   * @return false if file can't be opened
+   */
+  bool open(const std::string &path);
+
+  /**
+   * Adds node
+   *
+   * @param name first character of the name
+   * @param nameSize length of the name
+   * @param timeCreated time when directory/file was created
+   * @param directoryCount number of subdirectories, 0 for file
+   * @param fileCount number of files, 0 for file
+   */
+  void add(const char *name, std::size_t nameSize, std::int64_t timeCreated,
+           std::size_t directoryCount, std::size_t fileCount);
+
+  /**
+   * Adds data of the file that is added next, data can be added in parts
+   *
+   * @param data first byte of the part
+   * @param size number of bytes of the part
+   */
+  void addData(const char *data, std::size_t size);
+
+  /**
+   * Writes string heap and header and replaces image file
+   *
+   * @param journalSequence sequence number of the last journal record that
+   * is in the image
+   * @return false if image can't be written
+   */
+  bool close(std::uint64_t journalSequence = 0);
+
+private:
+  /// Path of the image file
+  std::string path{};
+
+  /// Temporary file of the image
+  std::ofstream file{};
+
+  /// String heap, written after node table
+  std::string strings{};
+
+  /// Number of added nodes
+  std::uint64_t nodeCount = 0;
+
+  /// Index of first child of next added directory
+  std::uint64_t nextChild = 1;
+
+  /// Offset of data of next added file in string heap
+  std::uint64_t dataOffset = 0;
+
+  /// Size of data of next added file
+  std::uint64_t dataSize = 0;
+};
+} // namespace vfs
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vfs {
+
+/**
+ * Implementation of the Journal class.
+ *
+ * Journal is append only log of mutations of vfs structure and of data of
+ * files. Every record has operation, sequence number, creation time, offset
+ * and absolute path of the directory/file, record of write has written data
+ * too. Record ends with checksum, so record that was not completely written,
+ * when program crashed, is found and ignored by read.
+ *
+ * Records are appended to buffer, that is written and synced to disk by
+ * flusher thread. All records appended while previous buffer is synced, or
+ * during commitDelay, are synced together, with one fdatasync, group commit.
+ * Longer commitDelay syncs more records at once, for the price of longer wait
+ * in waitDurable.
+ *
+ */
+class Journal {
+public:
+  /// Mutation of vfs structure or of data of the file
+  enum class Operation : std::uint8_t {
+    MakeDirectory = 1,
+    MakeFile,
+    Remove,
+    Write,
+    Truncate
+  };
+
+  /**
+   * Record of the journal
+   *
+   * @param operation mutation of vfs structure or of data of the file
+   * @param sequence sequence number of the record
+   * @param timeCreated time when directory/file was created, 0 for other
+   * operations
+   * @param offset offset of written data for write, new size of the file
+   * for truncate, 0 for other operations
+   * @param path absolute path of the directory/file
+   * @param data written data for write, empty for other operations
+   */
+  struct Record {
+    Operation operation;
+    std::uint64_t sequence;
+    std::int64_t timeCreated;
+    std::uint64_t offset;
+    std::string path;
+    std::string data;
+  };
+
+  /**
+   * Constructor of Journal
+   *
+   * Closed journal, records can't be appended until it is opened.
+   */
+  Journal() = default;
+
+  /**
+   * Destructor of Journal
+   *
+   * Appended records are synced, calling close.
+   */
+  ~Journal();
+
+  /// Disabling construction of Journal object using copy constructor
+  Journal(const Journal &rhs) = delete;
+
+  /// Disabling construction of Journal object using copy assignment
+  Journal &operator=(const Journal &rhs) = delete;
+
+  /**
+   * Opens journal for appending
+   *
+   * Journal file is truncated to its valid records and flusher thread is
+   * started.
+   *
+   * @param path path of the journal file
+   * @param validSize size of valid records in file, as returned by read
+   * @param lastSequence sequence number of the last record, appended records
+   * continue after it
+   * @param commitDelay time that flusher waits for more records before sync
+   * @return false if file can't be opened
+   */
+  bool open(const std::string &path, std::size_t validSize,
+            std::uint64_t lastSequence,
+            std::chrono::microseconds commitDelay);
+
+  /**
+   * Syncs appended records, stops flusher thread and closes file
+   */
+  void close();
+
+  /**
+   * Checks if journal is open
+   *
+   * @return true if records can be appended
+   */
+  bool isOpen() const { return opened.load(); }
+
+  /**
+   * Appends record
+   *
+   * Record is buffered, it is durable when waitDurable returns.
+   *
+   * @param operation mutation of vfs structure or of data of the file
+   * @param timeCreated time when directory/file was created, 0 for other
+   * operations
+   * @param path absolute path of the directory/file
+   * @param offset offset of written data for write, new size of the file
+   * for truncate
+   * @param data written data for write
+   * @param size number of written bytes
+   * @return sequence number of the record
+   */
+  std::uint64_t append(Operation operation, std::int64_t timeCreated,
+                       const std::string &path, std::uint64_t offset = 0,
+                       const char *data = nullptr, std::size_t size = 0);
+
+  /**
+   * Waits until record is synced to disk
+   *
+   * @param sequence sequence number returned by append
+   * @return false if journal can't be written
+   */
+  bool waitDurable(std::uint64_t sequence);
+
+  /**
+   * Sequence number of the last appended record
+   *
+   * @return sequence number, 0 if no record was appended
+   */
+  std::uint64_t lastSequence() const;
+
+  /**
+   * Replaces journal file with empty one
+   *
+   * Called when all records are folded in checkpoint. Empty journal is
+   * written to temporary file, that replaces journal file, sequence numbers
+   * of appended records continue.
+   *
+   * @return false if journal can't be replaced
+   */
+  bool reset();
+
+  /**
+   * Reads valid records of journal file
+   *
+   * Records are read until the end of file or until record, that is not
+   * complete or has invalid checksum.
+   *
+   * @param path path of the journal file
+   * @param records read records
+   * @return size of valid records in file
+   */
+  static std::size_t read(const std::string &path,
+                          std::vector<Record> &records);
+
+private:
+  /// Path of the journal file
+  std::string path{};
+
+  /// Journal file, -1 when journal is closed
+  int fd = -1;
+
+  /// Set while journal is open
+  std::atomic<bool> opened{false};
+
+  /// Time that flusher waits for more records before sync
+  std::chrono::microseconds commitDelay{0};
+
+  /// Records appended since last write
+  std::string buffer{};
+
+  /// Sequence number of the last appended record
+  std::uint64_t appended = 0;
+
+  /// Sequence number of the last synced record
+  std::uint64_t durable = 0;
+
+  /// Set when journal can't be written
+  bool failed = false;
+
+  /// Set when flusher thread should stop
+  bool stopping = false;
+
+  /// Guards buffer, appended, durable, failed and stopping
+  mutable std::mutex mutex{};
+
+  /// Wakes flusher thread, when records are appended
+  std::condition_variable appendedCondition{};
+
+  /// Wakes waitDurable, when records are synced
+  std::condition_variable durableCondition{};
+
+  /// Thread that writes and syncs appended records
+  std::thread flusher{};
+
+  /**
+   * Writes and syncs appended records, until journal is closed
+   */
+  void flush();
+};
+} // namespace vfs
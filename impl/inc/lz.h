@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+
+namespace vfs {
+
+/**
+ * Compress data with LZ block compression
+ *
+ * Data is split in sequences of literals and matches, like in LZ4 block
+ * format. Matches of at least 4 bytes are found with hash table of 4 byte
+ * prefixes, their offsets are up to 65535 bytes back. Compression is fast
+ * and data like text is usually compressed to less than half, data that
+ * doesn't compress is skipped faster and faster, so it is given up on soon.
+ *
+ * @param source data that is compressed
+ * @param size number of bytes of the data
+ * @param destination where compressed data is written
+ * @param capacity size of destination
+ * @return size of compressed data, 0 if it doesn't fit in capacity
+ */
+std::size_t lzCompress(const char *source, std::size_t size, char *destination,
+                       std::size_t capacity);
+
+/**
+ * Decompress data compressed with lzCompress
+ *
+ * Every length and offset is checked, so corrupted data is never read or
+ * written out of bounds.
+ *
+ * @param source compressed data
+ * @param size number of bytes of compressed data
+ * @param destination where data is written
+ * @param length number of bytes of the data
+ * @return false if compressed data is not valid or is not length bytes
+ */
+bool lzDecompress(const char *source, std::size_t size, char *destination,
+                  std::size_t length);
+} // namespace vfs
@@ -0,0 +1,410 @@
+#pragma once
+
+#include "blockArena.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace vfs {
+
+class NameTable;
+
+/**
+ * Returns hash of the name
+ *
+ * FNV-1a hash, used by NameTable and NameIndex for hashing of directory and
+ * file names.
+ *
+ * @param data first character of the name
+ * @param size length of the name
+ * @return hash of the name
+ */
+inline std::uint64_t hashName(const char *data, std::size_t size) {
+  std::uint64_t hash = 14695981039346656037ULL;
+  for (std::size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+/**
+ * Implementation of the Name class.
+ *
+ * Name is 16 byte handle of directory or file name. Names of up to 15
+ * characters are stored inline, padded with zeros, and the last byte holds
+ * their size. Longer names are interned in NameTable, handle holds ptr to
+ * the only copy of the name and counts as one reference of it. Equal names
+ * have equal handles, so names are compared as two integers, without
+ * comparing characters.
+ *
+ */
+class Name {
+  friend class NameTable;
+
+public:
+  /// Number of characters that are stored inline
+  static constexpr std::size_t inlineCapacity = 15;
+
+  /**
+   * Constructor of Name
+   *
+   * Empty name, it is not equal to any name of directory or file.
+   */
+  Name() = default;
+
+  /**
+   * Constructor of Name
+   *
+   * Reference of interned name is taken.
+   *
+   * @param rhs copied name
+   */
+  Name(const Name &rhs) : words(rhs.words) { retain(); }
+
+  /**
+   * Constructor of Name
+   *
+   * @param rhs moved name, it is empty after move
+   */
+  Name(Name &&rhs) noexcept : words(rhs.words) { rhs.words = {}; }
+
+  /**
+   * Destructor of Name
+   *
+   * Reference of interned name is released.
+   */
+  ~Name() { release(); }
+
+  /// Copy assignment, reference of interned name is taken
+  Name &operator=(const Name &rhs) {
+    Name copy(rhs);
+    std::swap(words, copy.words);
+    return *this;
+  }
+
+  /// Move assignment, rhs is empty after move
+  Name &operator=(Name &&rhs) noexcept {
+    std::swap(words, rhs.words);
+    return *this;
+  }
+
+  /// First character of the name
+  const char *data() const {
+    return isInline() ? bytes() : entry()->characters();
+  }
+
+  /// Number of characters
+  std::size_t size() const {
+    return isInline() ? static_cast<std::size_t>(tag()) : entry()->size;
+  }
+
+  /// true if name has no characters
+  bool empty() const { return words[0] == 0 && words[1] == 0; }
+
+  /// Copy of the name
+  std::string str() const { return std::string(data(), size()); }
+
+  /// Hash of the name, equal names have equal hashes, see hashOf
+  std::uint64_t hash() const {
+    return isInline() ? mix(words) : entry()->hash;
+  }
+
+  /**
+   * Hash of the name with the characters, equal to hash of that name
+   *
+   * Name is neither built nor interned, so hash is found without lock.
+   *
+   * @param data first character
+   * @param size number of characters
+   * @return hash
+   */
+  static std::uint64_t hashOf(const char *data, std::size_t size) {
+    return size <= inlineCapacity ? mix(inlineWords(data, size))
+                                  : hashName(data, size);
+  }
+
+  /**
+   * Check if name has the characters, without interning them
+   *
+   * @param other first character
+   * @param otherSize number of characters
+   * @return true if characters of the name are equal
+   */
+  bool equals(const char *other, std::size_t otherSize) const {
+    if (otherSize <= inlineCapacity)
+      return words == inlineWords(other, otherSize);
+    return !isInline() && entry()->size == otherSize &&
+           std::memcmp(entry()->characters(), other, otherSize) == 0;
+  }
+
+  /**
+   * Compare with characters, like std::string::compare
+   *
+   * @param other first character
+   * @param otherSize number of characters
+   * @return negative if name is before characters, 0 if they are equal,
+   * positive otherwise
+   */
+  int compare(const char *other, std::size_t otherSize) const {
+    const std::size_t length = size();
+    const int result =
+        std::memcmp(data(), other, length < otherSize ? length : otherSize);
+    if (result != 0)
+      return result;
+    return length < otherSize ? -1 : (length > otherSize ? 1 : 0);
+  }
+
+  /// Names are equal if their handles are equal
+  bool operator==(const Name &rhs) const { return words == rhs.words; }
+
+  /// @see operator==
+  bool operator!=(const Name &rhs) const { return words != rhs.words; }
+
+  /// Names are ordered by their characters
+  bool operator<(const Name &rhs) const {
+    return compare(rhs.data(), rhs.size()) < 0;
+  }
+
+  /// Compare characters with string
+  bool operator==(const std::string &rhs) const {
+    return compare(rhs.data(), rhs.size()) == 0;
+  }
+
+  /// @see operator==
+  bool operator!=(const std::string &rhs) const { return !(*this == rhs); }
+
+  /// Compare characters with string
+  bool operator==(const char *rhs) const {
+    return compare(rhs, std::strlen(rhs)) == 0;
+  }
+
+private:
+  /**
+   * Interned name
+   *
+   * @param table table that owns the name
+   * @param references number of handles of the name
+   * @param hash hash of the characters
+   * @param size number of characters, they are allocated after the entry
+   */
+  struct Entry {
+    NameTable *table;
+    std::atomic<std::size_t> references;
+    std::uint64_t hash;
+    std::size_t size;
+
+    /// Characters, allocated after the entry
+    const char *characters() const {
+      return reinterpret_cast<const char *>(this + 1);
+    }
+  };
+
+  /// Last byte of interned name
+  static constexpr unsigned char internedTag = 0xFF;
+
+  /// Inline characters and size, or ptr to entry and internedTag
+  std::array<std::uint64_t, 2> words{};
+
+  /**
+   * Handle of inline name
+   *
+   * @param data first character
+   * @param size number of characters, at most inlineCapacity
+   * @return characters padded with zeros, and size in the last byte
+   */
+  static std::array<std::uint64_t, 2> inlineWords(const char *data,
+                                                  std::size_t size) {
+    std::array<std::uint64_t, 2> inlined{};
+    char *bytes = reinterpret_cast<char *>(&inlined);
+    std::memcpy(bytes, data, size);
+    bytes[inlineCapacity] = static_cast<char>(size);
+    return inlined;
+  }
+
+  /// Hash of inline handle
+  static std::uint64_t mix(const std::array<std::uint64_t, 2> &inlined) {
+    std::uint64_t hash = inlined[0] * 0x9E3779B97F4A7C15ull + inlined[1];
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    return hash;
+  }
+
+  /// Bytes of the handle
+  const char *bytes() const { return reinterpret_cast<const char *>(&words); }
+
+  /// Last byte of the handle
+  unsigned char tag() const {
+    return static_cast<unsigned char>(bytes()[inlineCapacity]);
+  }
+
+  /// true if characters are in the handle
+  bool isInline() const { return tag() != internedTag; }
+
+  /// Interned name, only if name is not inline
+  Entry *entry() const {
+    return reinterpret_cast<Entry *>(static_cast<std::uintptr_t>(words[0]));
+  }
+
+  /// Take reference of interned name
+  void retain() const {
+    if (!isInline())
+      entry()->references.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /// Release reference of interned name
+  void release();
+};
+
+/// Write characters of the name
+inline std::ostream &operator<<(std::ostream &out, const Name &name) {
+  return out.write(name.data(), static_cast<std::streamsize>(name.size()));
+}
+
+/**
+ * Implementation of the NameTable class.
+ *
+ * NameTable interns names longer than Name::inlineCapacity, so every
+ * distinct name is stored once, however many directories and files have
+ * it. Names are counted with references of their handles, and name is
+ * released with its last handle. Table is split in shards, by hash of the
+ * name, so sessions that intern names rarely wait for each other.
+ *
+ * Shorter names are not in the table, they are built without lock.
+ * NameTable must outlive all names it interned. Names are allocated from
+ * BlockArena, so clear releases all of them at once.
+ *
+ */
+class NameTable {
+  friend class Name;
+
+public:
+  /**
+   * Constructor of NameTable
+   *
+   * Empty table.
+   */
+  NameTable() = default;
+
+  /**
+   * Destructor of NameTable
+   *
+   * Names that are still interned are released with the arena.
+   */
+  ~NameTable() = default;
+
+  /// Disabling construction of NameTable object using copy constructor
+  NameTable(const NameTable &rhs) = delete;
+
+  /// Disabling construction of NameTable object using copy assignment
+  NameTable &operator=(const NameTable &rhs) = delete;
+
+  /**
+   * Name with the characters, interned if it is long
+   *
+   * @param data first character
+   * @param size number of characters
+   * @return name
+   */
+  Name intern(const char *data, std::size_t size);
+
+  /// @see intern
+  Name intern(const std::string &name) {
+    return intern(name.data(), name.size());
+  }
+
+  /**
+   * Name with the characters, only if it can be equal to some name
+   *
+   * Long name that is not interned is not name of any directory or file,
+   * so it is not interned for lookup.
+   *
+   * @param data first character
+   * @param size number of characters
+   * @return name, empty if long name is not interned
+   */
+  Name find(const char *data, std::size_t size);
+
+  /**
+   * Release all names at once
+   *
+   * Called when no handle of interned name is alive or used, ex. when all
+   * nodes that have the names are dropped.
+   */
+  void clear();
+
+  /**
+   * Number of interned names
+   *
+   * @return number of distinct long names
+   */
+  std::size_t size() const;
+
+  /**
+   * Memory of interned names
+   *
+   * @return bytes of entries and their characters
+   */
+  std::size_t bytes() const;
+
+private:
+  /// Number of shards
+  static constexpr std::size_t shardCount = 64;
+
+  /**
+   * Part of the table
+   *
+   * @param mutex guards entries, and release of the last reference
+   * @param entries interned names by hash of their characters
+   */
+  struct Shard {
+    mutable std::mutex mutex{};
+    std::unordered_multimap<std::uint64_t, Name::Entry *> entries{};
+  };
+
+  /// Shards, by highest bits of the hash
+  std::array<Shard, shardCount> shards{};
+
+  /// Arena where interned names are allocated
+  BlockArena memory{};
+
+  /**
+   * Name with the characters
+   *
+   * @param data first character
+   * @param size number of characters
+   * @param insert true if name is interned when it is not in the table
+   * @return name, empty if it is not in the table and insert is false
+   */
+  Name lookup(const char *data, std::size_t size, bool insert);
+
+  /**
+   * Shard of the name
+   *
+   * @param hash hash of the characters
+   * @return shard
+   */
+  Shard &shardOf(std::uint64_t hash) { return shards[hash >> 58]; }
+
+  /**
+   * Release reference of interned name, name is released with the last one
+   *
+   * @param entry interned name
+   */
+  void release(Name::Entry *entry);
+};
+
+inline void Name::release() {
+  if (!isInline())
+    entry()->table->release(entry());
+  words = {};
+}
+} // namespace vfs
@@ -0,0 +1,312 @@
+#pragma once
+
+#include "blockArena.h"
+#include "epoch.h"
+#include "name.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+
+namespace vfs {
+
+/**
+ * Implementation of the NameIndex class.
+ *
+ * NameIndex is open addressing hash map, with linear probing, that maps name
+ * to the Value. Value is stored as pointer sized bits, Value::fromBits and
+ * toBits convert it, bits 0 and 1 are reserved for empty and erased slot.
+ * Names are not copied, name of the value is value.name(), names are Name
+ * handles, compared as integers. Names are hashed by their characters, so
+ * name is found by its characters too, without NameTable. Erased entries are
+ * marked as erased and reused by later inserts, table is rehashed when live
+ * and erased entries take more than 3/4 of the slots.
+ *
+ * find doesn't lock, it can run concurrently with one writer, that calls
+ * insert and erase. Slots are written atomically and table replaced by rehash
+ * is retired to EpochManager, so readers must be in epoch. Tables are
+ * allocated from BlockArena, that owns memory of the directory.
+ *
+ * @tparam Value type of the value mapped to the name
+ */
+template <typename Value> class NameIndex {
+public:
+  /**
+   * Constructor of NameIndex
+   *
+   * Empty index, table is allocated on first insert.
+   *
+   * @param memory arena where tables are allocated
+   */
+  explicit NameIndex(BlockArena &memory) : memory(&memory) {}
+
+  /**
+   * Destructor of NameIndex
+   *
+   * Table is released.
+   */
+  ~NameIndex() { releaseTable(*memory, table.load()); }
+
+  /// Disabling construction of NameIndex object using copy constructor
+  NameIndex(const NameIndex &rhs) = delete;
+
+  /// Disabling construction of NameIndex object using copy assignment
+  NameIndex &operator=(const NameIndex &rhs) = delete;
+
+  /**
+   * Find value with the name
+   *
+   * @param name name of the directory/file
+   * @return value, Value() if name is not in the index
+   */
+  Value find(const Name &name) const {
+    return find(name.hash(),
+                [&name](const Name &candidate) { return candidate == name; });
+  }
+
+  /**
+   * Find value with the name, given by its characters
+   *
+   * Characters are hashed as Name::hash of the name would be, so long name
+   * is found without lookup in NameTable.
+   *
+   * @param data first character of the name
+   * @param size length of the name
+   * @return value, Value() if name is not in the index
+   */
+  Value find(const char *data, std::size_t size) const {
+    return find(Name::hashOf(data, size), [data, size](const Name &candidate) {
+      return candidate.equals(data, size);
+    });
+  }
+
+  /**
+   * Insert value
+   *
+   * @param value value that is mapped to value.name()
+   * @param epochs epoch manager, where replaced table is retired
+   * @return false if name is already in the index, true otherwise
+   */
+  bool insert(Value value, EpochManager &epochs) {
+    Table *current = table.load(std::memory_order_relaxed);
+    if (current == nullptr || (used + 1) * 4 > current->capacity * 3)
+      current = rehash(count.load(std::memory_order_relaxed) + 1, epochs);
+    const Name &name = value.name();
+    const std::uint64_t hash = name.hash();
+    const std::size_t mask = current->capacity - 1;
+    Slot *reuse = nullptr;
+    for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+      Slot &slot = current->slots[i];
+      const std::uintptr_t bits = slot.bits.load(std::memory_order_relaxed);
+      if (bits == empty) {
+        if (reuse == nullptr) {
+          reuse = &slot;
+          ++used;
+        }
+        break;
+      }
+      if (bits == erased) {
+        if (reuse == nullptr)
+          reuse = &slot;
+      } else if (slot.hash.load(std::memory_order_relaxed) == hash &&
+                 Value::fromBits(bits).name() == name) {
+        return false;
+      }
+    }
+    reuse->hash.store(hash, std::memory_order_relaxed);
+    reuse->bits.store(value.toBits(), std::memory_order_release);
+    count.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  /**
+   * Erase value with the name
+   *
+   * @param name name of the directory/file
+   * @return false if name is not in the index, true otherwise
+   */
+  bool erase(const Name &name) {
+    Table *current = table.load(std::memory_order_relaxed);
+    if (current == nullptr)
+      return false;
+    const std::uint64_t hash = name.hash();
+    const std::size_t mask = current->capacity - 1;
+    for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+      Slot &slot = current->slots[i];
+      const std::uintptr_t bits = slot.bits.load(std::memory_order_relaxed);
+      if (bits == empty)
+        return false;
+      if (bits != erased && slot.hash.load(std::memory_order_relaxed) == hash &&
+          Value::fromBits(bits).name() == name) {
+        slot.bits.store(erased, std::memory_order_release);
+        count.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+  }
+
+  /**
+   * Number of names in the index
+   *
+   * @return number of names
+   */
+  std::size_t size() const { return count.load(std::memory_order_relaxed); }
+
+private:
+  /// Bits of empty slot
+  static constexpr std::uintptr_t empty = 0;
+
+  /// Bits of erased slot
+  static constexpr std::uintptr_t erased = 1;
+
+  /**
+   * Slot of the hash table
+   *
+   * @param hash hash of the name
+   * @param bits value stored as bits, empty or erased
+   */
+  struct Slot {
+    std::atomic<std::uint64_t> hash{0};
+    std::atomic<std::uintptr_t> bits{empty};
+  };
+
+  /**
+   * Hash table
+   *
+   * @param capacity number of slots, power of two
+   * @param slots slots of the table, allocated after the table
+   */
+  struct Table {
+    std::size_t capacity;
+    Slot *slots;
+  };
+
+  /// Arena where tables are allocated
+  BlockArena *memory;
+
+  /// Current table, nullptr before first insert
+  std::atomic<Table *> table{nullptr};
+
+  /// Number of names in the index
+  std::atomic<std::size_t> count{0};
+
+  /// Number of slots that are not empty, full and erased ones
+  std::size_t used = 0;
+
+  /**
+   * Find value whose name matches
+   *
+   * @param hash hash of the name
+   * @param matches predicate that checks name of the value with the hash
+   * @return value, Value() if no name matches
+   */
+  template <typename Matches>
+  Value find(std::uint64_t hash, Matches matches) const {
+    const Table *current = table.load(std::memory_order_acquire);
+    if (current == nullptr)
+      return Value();
+    const std::size_t mask = current->capacity - 1;
+    for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+      const Slot &slot = current->slots[i];
+      const std::uintptr_t bits = slot.bits.load(std::memory_order_acquire);
+      if (bits == empty)
+        return Value();
+      if (bits == erased ||
+          slot.hash.load(std::memory_order_relaxed) != hash)
+        continue;
+      const Value value = Value::fromBits(bits);
+      if (matches(value.name()))
+        return value;
+    }
+  }
+
+  /**
+   * Allocate table
+   *
+   * @param capacity number of slots
+   * @return ptr to table with empty slots
+   */
+  Table *allocateTable(std::size_t capacity) {
+    Table *created =
+        new (memory->allocate(bytesOf(capacity))) Table{capacity, nullptr};
+    created->slots = reinterpret_cast<Slot *>(created + 1);
+    for (std::size_t i = 0; i < capacity; ++i)
+      new (&created->slots[i]) Slot();
+    return created;
+  }
+
+  /**
+   * Release table
+   *
+   * @param memory arena where table was allocated
+   * @param released table created by allocateTable, can be nullptr
+   */
+  static void releaseTable(BlockArena &memory, Table *released) {
+    if (released == nullptr)
+      return;
+    const std::size_t bytes = bytesOf(released->capacity);
+    released->~Table();
+    memory.deallocate(released, bytes);
+  }
+
+  /**
+   * Size of the table
+   *
+   * @param capacity number of slots
+   * @return bytes of the table with its slots
+   */
+  static std::size_t bytesOf(std::size_t capacity) {
+    return sizeof(Table) + capacity * sizeof(Slot);
+  }
+
+  /**
+   * Rehash table
+   *
+   * Allocates table big enough for minimum names, drops erased slots, inserts
+   * all names in the new table and publishes it. Old table is retired.
+   *
+   * @param minimum number of names that table must hold
+   * @param epochs epoch manager, where old table is retired
+   * @return new table
+   */
+  Table *rehash(std::size_t minimum, EpochManager &epochs) {
+    std::size_t capacity = 8;
+    while (capacity * 3 < minimum * 4 * 2)
+      capacity *= 2;
+    Table *created = allocateTable(capacity);
+    Table *old = table.load(std::memory_order_relaxed);
+    const std::size_t mask = capacity - 1;
+    if (old != nullptr) {
+      for (std::size_t j = 0; j < old->capacity; ++j) {
+        const std::uintptr_t bits =
+            old->slots[j].bits.load(std::memory_order_relaxed);
+        if (bits == empty || bits == erased)
+          continue;
+        const std::uint64_t hash =
+            old->slots[j].hash.load(std::memory_order_relaxed);
+        std::size_t i = hash & mask;
+        while (created->slots[i].bits.load(std::memory_order_relaxed) != empty)
+          i = (i + 1) & mask;
+        created->slots[i].hash.store(hash, std::memory_order_relaxed);
+        created->slots[i].bits.store(bits, std::memory_order_relaxed);
+      }
+    }
+    used = count.load(std::memory_order_relaxed);
+    table.store(created, std::memory_order_release);
+    if (old != nullptr)
+      epochs.retire(
+          old,
+          [](void *memory, void *pointer) {
+            releaseTable(*static_cast<BlockArena *>(memory),
+                         static_cast<Table *>(pointer));
+          },
+          memory);
+    return created;
+  }
+};
+
+template <typename Value> constexpr std::uintptr_t NameIndex<Value>::empty;
+template <typename Value> constexpr std::uintptr_t NameIndex<Value>::erased;
+} // namespace vfs
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace vfs {
+
+/**
+ * Implementation of the NodePool class.
+ *
+ * NodePool is slab allocator for directory and file nodes. Nodes are
+ * constructed in slots of big slabs, that are allocated with one allocation
+ * for SlabSize nodes. Slots of destroyed nodes are kept in freelist and reused
+ * by next created node. Slabs are released only when pool is cleared or
+ * released, so the directory structure is not walked. release drops slabs as
+ * a whole, without visiting nodes, when all memory that nodes own is in
+ * BlockArena, that is released with them.
+ *
+ * @tparam T type of the node
+ * @tparam SlabSize number of nodes in one slab
+ */
+template <typename T, std::size_t SlabSize = 1024> class NodePool {
+public:
+  /**
+   * Constructor of NodePool
+   *
+   * Empty pool, first slab is allocated on first create.
+   */
+  NodePool() = default;
+
+  /**
+   * Destructor of NodePool
+   *
+   * All nodes that are still in the pool are destroyed, calling clear.
+   */
+  ~NodePool() { clear(); }
+
+  /// Disabling construction of NodePool object using copy constructor
+  NodePool(const NodePool &rhs) = delete;
+
+  /// Disabling construction of NodePool object using copy assignment
+  NodePool &operator=(const NodePool &rhs) = delete;
+
+  /**
+   * Creates node
+   *
+   * Node is constructed in slot from freelist, if freelist is empty, in next
+   * slot of the last slab.
+   *
+   * @param args arguments forwarded to the constructor of the node
+   * @return ptr to created node
+   */
+  template <typename... Args> T *create(Args &&... args) {
+    Slot *slot = freeList;
+    if (slot != nullptr) {
+      freeList = slot->next;
+    } else {
+      if (slabs.empty() || used == SlabSize) {
+        slabs.push_back(new Slot[SlabSize]);
+        used = 0;
+      }
+      slot = &slabs.back()[used++];
+    }
+    T *node = new (&slot->storage) T(std::forward<Args>(args)...);
+    slot->live = true;
+    ++count;
+    return node;
+  }
+
+  /**
+   * Destroys node
+   *
+   * Node is destructed and its slot is put in freelist.
+   *
+   * @param node ptr to node created by this pool
+   */
+  void destroy(T *node) {
+    if (node == nullptr)
+      return;
+    // storage is first member of the slot, so slot has the address of node
+    Slot *slot = reinterpret_cast<Slot *>(node);
+    node->~T();
+    slot->live = false;
+    slot->next = freeList;
+    freeList = slot;
+    --count;
+  }
+
+  /**
+   * Destroys all nodes and releases all slabs
+   *
+   * If T is trivially destructible, slabs are released without visiting
+   * nodes, otherwise destructor of every live node is called, going through
+   * slab memory in order.
+   */
+  void clear() {
+    if (!std::is_trivially_destructible<T>::value) {
+      for (auto slab : slabs) {
+        for (std::size_t i = 0; i < SlabSize; ++i) {
+          if (slab[i].live)
+            reinterpret_cast<T *>(&slab[i].storage)->~T();
+        }
+      }
+    }
+    release();
+  }
+
+  /**
+   * Releases all slabs without destroying nodes
+   *
+   * Nodes are not visited, so they must not own anything that is not
+   * released with them, ex. their memory is in BlockArena that is released
+   * after the pool.
+   */
+  void release() {
+    for (auto slab : slabs)
+      delete[] slab;
+    slabs.clear();
+    freeList = nullptr;
+    used = 0;
+    count = 0;
+  }
+
+  /**
+   * Visit all live nodes, going through slab memory in order
+   *
+   * @param visit called with every node
+   */
+  template <typename Visitor> void forEach(Visitor visit) {
+    for (auto slab : slabs) {
+      for (std::size_t i = 0; i < SlabSize; ++i) {
+        if (slab[i].live)
+          visit(*reinterpret_cast<T *>(&slab[i].storage));
+      }
+    }
+  }
+
+  /**
+   * Number of live nodes in the pool
+   *
+   * @return number of nodes
+   */
+  std::size_t size() const { return count; }
+
+  /**
+   * Number of allocated slabs
+   *
+   * @return number of slabs
+   */
+  std::size_t slabCount() const { return slabs.size(); }
+
+private:
+  /**
+   * Slot of the slab
+   *
+   * @param storage memory of the node
+   * @param next next free slot, when slot is in freelist
+   * @param live true if node is constructed in the slot
+   */
+  struct Slot {
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    Slot *next = nullptr;
+    bool live = false;
+  };
+
+  /// Allocated slabs, every slab has SlabSize slots
+  std::vector<Slot *> slabs{};
+
+  /// First free slot
+  Slot *freeList = nullptr;
+
+  /// Number of used slots in last slab
+  std::size_t used = 0;
+
+  /// Number of live nodes
+  std::size_t count = 0;
+};
+} // namespace vfs
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <streambuf>
+#include <vector>
+
+namespace vfs {
+
+/**
+ * Implementation of the OutputBuffer class.
+ *
+ * OutputBuffer is stream buffer that collects output in one big buffer and
+ * writes it to the file descriptor only when buffer is full, when it is
+ * flushed or destroyed. It is used in batch mode, where std::cout writes to
+ * OutputBuffer, so output of many commands is written with one write call.
+ *
+ */
+class OutputBuffer : public std::streambuf {
+public:
+  /**
+   * Constructor of OutputBuffer
+   *
+   * @param fileDescriptor file descriptor where output is written
+   * @param threshold size of the buffer, when it is reached buffer is written
+   */
+  explicit OutputBuffer(int fileDescriptor = 1,
+                        std::size_t threshold = 1 << 20);
+
+  /**
+   * Destructor of OutputBuffer
+   *
+   * Writes rest of the buffer, calling flush.
+   */
+  ~OutputBuffer() override;
+
+  /// Disabling construction of OutputBuffer object using copy constructor
+  OutputBuffer(const OutputBuffer &rhs) = delete;
+
+  /// Disabling construction of OutputBuffer object using copy assignment
+  OutputBuffer &operator=(const OutputBuffer &rhs) = delete;
+
+  /**
+   * Writes buffer to the file descriptor
+   *
+   * @return false if write failed, true otherwise
+   */
+  bool flush();
+
+protected:
+  /**
+   * Writes full buffer and puts character in empty buffer
+   *
+   * @param character character that didn't fit in buffer
+   * @return character, or eof if write failed
+   */
+  int_type overflow(int_type character) override;
+
+  /**
+   * Puts characters in buffer, writes directly if they don't fit in buffer
+   *
+   * @param data first character
+   * @param size number of characters
+   * @return number of written characters
+   */
+  std::streamsize xsputn(const char *data, std::streamsize size) override;
+
+  /**
+   * Does nothing, buffer is written only when it is full or flushed, so
+   * std::endl and std::flush don't cause write
+   *
+   * @return 0
+   */
+  int sync() override;
+
+private:
+  /// File descriptor where output is written
+  int fd;
+
+  /// Buffered output
+  std::vector<char> buffer;
+
+  /**
+   * Writes all characters to the file descriptor
+   *
+   * @param data first character
+   * @param size number of characters
+   * @return false if write failed, true otherwise
+   */
+  bool writeAll(const char *data, std::size_t size);
+};
+} // namespace vfs
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace vfs {
+
+/// Printed when directory in the path doesn't exist
+constexpr const char *noSuchDirectory = "No such directory\n";
+
+/// Printed when name of the new directory/file is not valid
+constexpr const char *invalidCommand = "Invalid command\n";
+
+/// Printed when directory/file with the name already exists
+constexpr const char *alreadyExists = "Directory or file already exists\n";
+
+/// Printed when listed directory has no children
+constexpr const char *emptyDirectory = "Empty directory \n";
+
+/**
+ * Check name of the new directory/file
+ *
+ * Name can't be empty, . or ..
+ *
+ * @param name first character of the name
+ * @param size length of the name
+ * @return true if directory/file can have the name
+ */
+inline bool isValidName(const char *name, std::size_t size) {
+  return !(size == 0 || (size == 1 && name[0] == '.') ||
+           (size == 2 && name[0] == '.' && name[1] == '.'));
+}
+
+/**
+ * Check if component of the path is ., that stays in directory
+ *
+ * @param name first character of the component
+ * @param size length of the component
+ * @return true for .
+ */
+inline bool isCurrentDirectory(const char *name, std::size_t size) {
+  return size == 1 && name[0] == '.';
+}
+
+/**
+ * Check if component of the path is .., that goes to parent directory
+ *
+ * @param name first character of the component
+ * @param size length of the component
+ * @return true for ..
+ */
+inline bool isParentDirectory(const char *name, std::size_t size) {
+  return size == 2 && name[0] == '.' && name[1] == '.';
+}
+
+/**
+ * Next component of the path, repeated / are skipped
+ *
+ * @param path first character of the path
+ * @param size length of the path
+ * @param position position after the previous component, moved after the
+ * next one
+ * @param name first character of the next component
+ * @param length length of the next component
+ * @return false if there are no more components
+ */
+inline bool nextComponent(const char *path, std::size_t size,
+                          std::size_t &position, const char *&name,
+                          std::size_t &length) {
+  while (position < size && path[position] == '/')
+    ++position;
+  const std::size_t start = position;
+  while (position < size && path[position] != '/')
+    ++position;
+  name = path + start;
+  length = position - start;
+  return length != 0;
+}
+
+/**
+ * Split path to parent path and the last component, leaf
+ *
+ * Trailing / are not part of the leaf. Absolute path starts above head, so
+ * parent of /name is above head.
+ *
+ * @param path path of the directory/file
+ * @param leafStart position of the last component in path
+ * @param leafSize length of the last component
+ * @return length of the parent path, std::string::npos if path has no
+ * parent path and leaf is in current directory, 0 if parent is above head
+ */
+inline std::size_t splitPath(const std::string &path, std::size_t &leafStart,
+                             std::size_t &leafSize) {
+  std::size_t end = path.size();
+  while (end > 1 && path[end - 1] == '/')
+    --end;
+  const std::size_t slash =
+      end == 0 ? std::string::npos : path.rfind('/', end - 1);
+  if (slash == std::string::npos) { // name in current directory
+    leafStart = 0;
+    leafSize = end;
+    return std::string::npos;
+  }
+  leafStart = slash + 1;
+  leafSize = end - leafStart;
+  if (path.find_first_not_of('/') >= slash) // parent is above head
+    return 0;
+  return slash;
+}
+} // namespace vfs
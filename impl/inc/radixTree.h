@@ -0,0 +1,311 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vfs {
+
+/**
+ * Implementation of the RadixTree class.
+ *
+ * RadixTree is compressed trie of names, that maps every name to values of
+ * all nodes with the name. Edges are labeled with strings, node with one
+ * child and without values is merged with its child, so tree has at most two
+ * nodes for every distinct name. Children are sorted by the first character
+ * of their labels, so names with the prefix are visited in sorted order,
+ * from the node where prefix ends, without looking at other names.
+ *
+ * Name that many nodes have, like index.html, keeps positions of its values
+ * in hash map, so value is erased in O(1), however many values name has.
+ *
+ * RadixTree doesn't lock, it is guarded by its owner.
+ *
+ * @tparam Value type of the value, compared with operator== when it is
+ * erased
+ * @tparam Hash hash of the value, equal values have equal hashes
+ */
+template <typename Value, typename Hash = std::hash<Value>> class RadixTree {
+public:
+  /**
+   * Constructor of RadixTree
+   *
+   * Empty tree.
+   */
+  RadixTree() = default;
+
+  /// Disabling construction of RadixTree object using copy constructor
+  RadixTree(const RadixTree &rhs) = delete;
+
+  /// Disabling construction of RadixTree object using copy assignment
+  RadixTree &operator=(const RadixTree &rhs) = delete;
+
+  /**
+   * Add value of the name
+   *
+   * @param name first character of the name
+   * @param size length of the name
+   * @param value value that is added, name can have many values
+   */
+  void insert(const char *name, std::size_t size, const Value &value) {
+    Node *node = &root;
+    std::size_t position = 0;
+    while (position < size) {
+      auto child = findChild(node, name[position]);
+      if (child == node->children.end() ||
+          (*child)->label[0] != name[position]) {
+        std::unique_ptr<Node> leaf(new Node());
+        leaf->label.assign(name + position, size - position);
+        node = node->children.insert(child, std::move(leaf))->get();
+        break;
+      }
+      const std::string &label = (*child)->label;
+      std::size_t common = 0;
+      while (common < label.size() && position + common < size &&
+             label[common] == name[position + common])
+        ++common;
+      if (common < label.size()) { // label is split where name leaves it
+        std::unique_ptr<Node> middle(new Node());
+        middle->label = label.substr(0, common);
+        (*child)->label.erase(0, common);
+        middle->children.push_back(std::move(*child));
+        *child = std::move(middle);
+      }
+      node = child->get();
+      position += common;
+    }
+    node->values.push_back(value);
+    if (node->positions != nullptr)
+      node->positions->emplace(value, node->values.size() - 1);
+    else if (node->values.size() > indexedValues)
+      index(node);
+    if (node->values.size() == 1)
+      ++names;
+  }
+
+  /**
+   * Erase value of the name
+   *
+   * @param name first character of the name
+   * @param size length of the name
+   * @param value value that is erased
+   * @return false if name doesn't have the value, true otherwise
+   */
+  bool erase(const char *name, std::size_t size, const Value &value) {
+    // path from the root to the node of the name
+    std::vector<Node *> path{&root};
+    std::size_t position = 0;
+    while (position < size) {
+      Node *node = path.back();
+      auto child = findChild(node, name[position]);
+      if (child == node->children.end())
+        return false;
+      const std::string &label = (*child)->label;
+      if (label.size() > size - position ||
+          std::memcmp(label.data(), name + position, label.size()) != 0)
+        return false;
+      path.push_back(child->get());
+      position += label.size();
+    }
+    if (!eraseValue(path.back(), value))
+      return false;
+    if (!path.back()->values.empty())
+      return true;
+    --names;
+
+    // node without values is removed if it has no children, and merged with
+    // its only child, so tree stays compressed
+    while (path.size() > 1) {
+      Node *node = path.back();
+      Node *parent = path[path.size() - 2];
+      if (!node->values.empty())
+        break;
+      if (node->children.empty()) {
+        parent->children.erase(findChild(parent, node->label[0]));
+        path.pop_back();
+        continue;
+      }
+      if (node->children.size() == 1) {
+        std::unique_ptr<Node> child = std::move(node->children.front());
+        node->label += child->label;
+        node->values = std::move(child->values);
+        node->positions = std::move(child->positions);
+        node->children = std::move(child->children);
+      }
+      break;
+    }
+    return true;
+  }
+
+  /**
+   * Visit names with the prefix, in sorted order
+   *
+   * @param prefix first character of the prefix
+   * @param size length of the prefix
+   * @param visit called with name and its values, returns false to stop
+   * @return false if visit stopped, true otherwise
+   */
+  template <typename Visitor>
+  bool visit(const char *prefix, std::size_t size, Visitor visit) const {
+    const Node *node = &root;
+    std::string name;
+    std::size_t position = 0;
+    while (position < size) {
+      auto child = findChild(node, prefix[position]);
+      if (child == node->children.end())
+        return true;
+      const std::string &label = (*child)->label;
+      const std::size_t compared = std::min(label.size(), size - position);
+      if (std::memcmp(label.data(), prefix + position, compared) != 0)
+        return true;
+      name += label;
+      node = child->get();
+      position += compared;
+    }
+
+    // depth first, children are pushed in reverse, so names are sorted and
+    // every name is visited before longer names that start with it
+    std::vector<std::pair<const Node *, std::size_t>> stack{
+        {node, name.size() - node->label.size()}};
+    while (!stack.empty()) {
+      const auto current = stack.back();
+      stack.pop_back();
+      name.resize(current.second);
+      name += current.first->label;
+      if (!current.first->values.empty() &&
+          !visit(name, current.first->values))
+        return false;
+      const auto &children = current.first->children;
+      for (auto child = children.rbegin(); child != children.rend(); ++child)
+        stack.emplace_back(child->get(), name.size());
+    }
+    return true;
+  }
+
+  /**
+   * Number of names
+   *
+   * @return number of distinct names with values
+   */
+  std::size_t size() const { return names; }
+
+  /**
+   * Erase all names
+   */
+  void clear() {
+    root.children.clear();
+    root.values.clear();
+    root.positions.reset();
+    names = 0;
+  }
+
+private:
+  /// Positions of values, by value
+  using Positions = std::unordered_map<Value, std::size_t, Hash>;
+
+  /// Values that name has before their positions are kept
+  static constexpr std::size_t indexedValues = 8;
+
+  /**
+   * Node of the tree
+   *
+   * @param label characters of the edge from parent
+   * @param children children sorted by the first character of their labels
+   * @param values values of the name that ends in node
+   * @param positions positions of values, only if name has more than
+   * indexedValues of them
+   */
+  struct Node {
+    std::string label{};
+    std::vector<std::unique_ptr<Node>> children{};
+    std::vector<Value> values{};
+    std::unique_ptr<Positions> positions{};
+  };
+
+  /// Root, with empty label
+  Node root{};
+
+  /// Number of distinct names with values
+  std::size_t names = 0;
+
+  /**
+   * Keep positions of all values of the node
+   *
+   * @param node node whose name has more than indexedValues values
+   */
+  static void index(Node *node) {
+    node->positions.reset(new Positions());
+    node->positions->reserve(node->values.size() * 2);
+    for (std::size_t i = 0; i < node->values.size(); ++i)
+      node->positions->emplace(node->values[i], i);
+  }
+
+  /**
+   * Erase value of the node, the last value takes its position
+   *
+   * @param node node of the name
+   * @param value value that is erased
+   * @return false if node doesn't have the value, true otherwise
+   */
+  static bool eraseValue(Node *node, const Value &value) {
+    std::vector<Value> &values = node->values;
+    std::size_t position = 0;
+    if (node->positions != nullptr) {
+      const auto found = node->positions->find(value);
+      if (found == node->positions->end())
+        return false;
+      position = found->second;
+      node->positions->erase(found);
+      if (position + 1 != values.size())
+        (*node->positions)[values.back()] = position;
+    } else {
+      position = static_cast<std::size_t>(
+          std::find(values.begin(), values.end(), value) - values.begin());
+      if (position == values.size())
+        return false;
+    }
+    values[position] = values.back();
+    values.pop_back();
+    if (values.empty())
+      node->positions.reset();
+    return true;
+  }
+
+  /**
+   * Child whose label starts with character
+   *
+   * @param node parent
+   * @param first the first character of the label
+   * @return child, or position where such child would be inserted
+   */
+  static typename std::vector<std::unique_ptr<Node>>::iterator
+  findChild(Node *node, char first) {
+    return std::lower_bound(node->children.begin(), node->children.end(),
+                            first, compareFirst);
+  }
+
+  /// @see findChild
+  static typename std::vector<std::unique_ptr<Node>>::const_iterator
+  findChild(const Node *node, char first) {
+    auto child = std::lower_bound(node->children.begin(),
+                                  node->children.end(), first, compareFirst);
+    if (child != node->children.end() && (*child)->label[0] != first)
+      return node->children.end();
+    return child;
+  }
+
+  /// Order of children, by the first character of the label
+  static bool compareFirst(const std::unique_ptr<Node> &child, char first) {
+    return static_cast<unsigned char>(child->label[0]) <
+           static_cast<unsigned char>(first);
+  }
+};
+
+template <typename Value, typename Hash>
+constexpr std::size_t RadixTree<Value, Hash>::indexedValues;
+} // namespace vfs
@@ -0,0 +1,235 @@
+#pragma once
+
+#include "vfs.h"
+
+namespace vfs {
+
+/**
+ * Implementation of the Session class.
+ *
+ * Session has its own current directory in shared VirtualFileSystem, so many
+ * sessions, each used by its own thread, can work with the same vfs
+ * structure. Session itself is used by one thread at a time.
+ *
+ */
+class Session {
+public:
+  /**
+   * Constructor of Session
+   *
+   * Current directory of the session is head of fileSystem, session is
+   * registered in fileSystem, so its current directory is moved out of
+   * directory that is removed.
+   *
+   * @param fileSystem vfs structure that session works with
+   * @param output stream where session lists directories and writes errors
+   */
+  explicit Session(VirtualFileSystem &fileSystem,
+                   std::ostream &output = std::cout);
+
+  /**
+   * Destructor of Session
+   *
+   * Session is unregistered from fileSystem.
+   */
+  ~Session();
+
+  /// Disabling construction of Session object using copy constructor
+  Session(const Session &rhs) = delete;
+
+  /// Disabling construction of Session object using copy assignment
+  Session &operator=(const Session &rhs) = delete;
+
+  /**
+   * Creates directory, see VirtualFileSystem::makeDirectory
+   *
+   * @param nameDirectory name or path of the directory
+   */
+  void makeDirectory(const std::string &nameDirectory);
+
+  /**
+   * Change directory, see VirtualFileSystem::changeDirectory
+   *
+   * @param nameDirectory name or path of the directory
+   */
+  void changeDirectory(const std::string &nameDirectory);
+
+  /**
+   * List in current directory, see VirtualFileSystem::list
+   */
+  void list() const;
+
+  /**
+   * List in directory, see VirtualFileSystem::list
+   *
+   * @param path name or path of the directory
+   */
+  void list(const std::string &path) const;
+
+  /**
+   * Ordered and paginated list in directory, see VirtualFileSystem::list
+   *
+   * @param path name or path of the directory, current directory if empty
+   * @param options order, limit and cursor of the listing
+   */
+  void list(const std::string &path,
+            const VirtualFileSystem::ListOptions &options) const;
+
+  /**
+   * Visits children of directory, see VirtualFileSystem::forEach
+   *
+   * @param path name or path of the directory, current directory if empty
+   * @param options order, limit and cursor of the listing
+   * @param visit function that visits listed children, returns false to stop
+   * @return false if directory can't be listed
+   */
+  bool forEach(const std::string &path,
+               const VirtualFileSystem::ListOptions &options,
+               const VirtualFileSystem::ListVisitor &visit) const;
+
+  /**
+   * Remove in directory, see VirtualFileSystem::remove
+   *
+   * @param name name or path of the directory/file that is to be erased
+   */
+  void remove(const std::string &name);
+
+  /**
+   * Creates file, see VirtualFileSystem::makeFile
+   *
+   * @param nameFile name or path of the file
+   */
+  void makeFile(const std::string &nameFile);
+
+  /**
+   * Copies directory or file, see VirtualFileSystem::copy
+   *
+   * @param source name or path of the directory/file that is copied
+   * @param destination name or path of the copy
+   */
+  void copy(const std::string &source, const std::string &destination);
+
+  /**
+   * Disk usage of directory, see VirtualFileSystem::diskUsage
+   *
+   * @param path name or path of the directory, current directory if empty
+   */
+  void diskUsage(const std::string &path = std::string()) const;
+
+  /**
+   * Find directories and files by name, see VirtualFileSystem::find
+   *
+   * @param path name or path of the directory, current directory if empty
+   * @param name name of the directories/files that are found
+   */
+  void find(const std::string &path, const std::string &name) const;
+
+  /**
+   * Write data to file, see VirtualFileSystem::write
+   *
+   * @param path name or path of the file
+   * @param offset offset of the first written byte
+   * @param data written bytes
+   * @param size number of written bytes
+   * @return false if there is no such file, or its data can't be read
+   */
+  bool write(const std::string &path, std::uint64_t offset, const char *data,
+             std::size_t size);
+
+  /**
+   * Append data to file, see VirtualFileSystem::append
+   *
+   * @param path name or path of the file
+   * @param data written bytes
+   * @param size number of written bytes
+   * @return false if there is no such file, or its data can't be read
+   */
+  bool append(const std::string &path, const char *data, std::size_t size);
+
+  /**
+   * Truncate file, see VirtualFileSystem::truncate
+   *
+   * @param path name or path of the file
+   * @param size new size of the file
+   * @return false if there is no such file, or its data can't be read
+   */
+  bool truncate(const std::string &path, std::uint64_t size);
+
+  /**
+   * Read data of file, see VirtualFileSystem::read
+   *
+   * @param path name or path of the file
+   * @param offset offset of the first read byte
+   * @param size maximal number of read bytes
+   * @param visit function that visits read data, returns false to stop
+   * @return false if there is no such file, or its data can't be read
+   */
+  bool read(const std::string &path, std::uint64_t offset, std::uint64_t size,
+            const VirtualFileSystem::ReadVisitor &visit) const;
+
+  /**
+   * Complete name, see VirtualFileSystem::complete
+   *
+   * @param prefix beginning of the names
+   * @param limit maximal number of printed names
+   */
+  void complete(const std::string &prefix,
+                std::size_t limit = VirtualFileSystem::completeLimit) const;
+
+  /**
+   * Locate directories and files by prefix of the name, see
+   * VirtualFileSystem::locate
+   *
+   * @param prefix beginning of the names
+   * @param limit maximal number of printed paths
+   */
+  void locate(const std::string &prefix,
+              std::size_t limit = VirtualFileSystem::locateLimit) const;
+
+  /**
+   * Find lines of files that have pattern, see VirtualFileSystem::grep
+   *
+   * @param pattern string that is found in lines of files
+   * @param path name or path of the directory or file, current directory if
+   * empty
+   * @param visit function that visits lines with pattern
+   * @return false if there is no such directory or file, or data can't be
+   * read
+   */
+  bool grep(const std::string &pattern, const std::string &path,
+            const VirtualFileSystem::GrepVisitor &visit) const;
+
+  /**
+   * Name of the current directory
+   *
+   * @return name of the current directory
+   */
+  std::string currentDirectoryName() const;
+
+private:
+  /// Shared vfs structure
+  VirtualFileSystem &fileSystem;
+
+  /// Stream where session lists directories and writes errors
+  std::ostream &out;
+
+  /// Participant of the session in epoch based reclamation of fileSystem
+  EpochManager::Participant *participant;
+
+  /// Statistics of the session, merged into statistics of fileSystem
+  Stats::Shard *shard;
+
+  /// Current directory of the session
+  VirtualFileSystem::DirectoryPointer currentDirectory{};
+
+  /// Cache of resolved multi component paths, used with currentDirectory
+  mutable DentryCache<VirtualFileSystem::Directory> dentries{};
+
+  /**
+   * Context of commands of the session
+   *
+   * @return context with currentDirectory of the session
+   */
+  VirtualFileSystem::Context context() const;
+};
+} // namespace vfs
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "epoch.h"
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace vfs {
+
+class VirtualFileSystem;
+
+/**
+ * Implementation of the Snapshot class.
+ *
+ * Snapshot is read only, point in time, view of vfs structure, created by
+ * VirtualFileSystem::snapshot. It shares directories and files with live vfs
+ * structure, while mutations, done after snapshot was taken, keep copy of
+ * children of the directory they change. Snapshot is used by one thread at a
+ * time and must not outlive its VirtualFileSystem.
+ *
+ */
+class Snapshot {
+  friend class VirtualFileSystem;
+
+public:
+  /**
+   * Destructor of Snapshot
+   *
+   * Snapshot is released, copies that only it can see are released.
+   */
+  ~Snapshot();
+
+  /// Disabling construction of Snapshot object using copy constructor
+  Snapshot(const Snapshot &rhs) = delete;
+
+  /// Disabling construction of Snapshot object using copy assignment
+  Snapshot &operator=(const Snapshot &rhs) = delete;
+
+  /**
+   * Move constructor of Snapshot
+   *
+   * @param rhs snapshot that is moved, it is empty after that
+   */
+  Snapshot(Snapshot &&rhs) noexcept;
+
+  /**
+   * Move assignment of Snapshot
+   *
+   * @param rhs snapshot that is moved, it is empty after that
+   * @return this snapshot
+   */
+  Snapshot &operator=(Snapshot &&rhs) noexcept;
+
+  /**
+   * List in directory, as it was when snapshot was taken
+   *
+   * Path is resolved from head, if no such directory exist, "No such
+   * directory" is printed.
+   *
+   * @param path name or path of the directory, head if empty
+   */
+  void list(const std::string &path = std::string()) const;
+
+  /**
+   * List directory and all directories below it, as they were when snapshot
+   * was taken
+   *
+   * Every directory is listed as its absolute path followed by ':', its
+   * listing and empty line, like ls -R. Directories are visited depth first,
+   * with explicit stack.
+   *
+   * @param path name or path of the directory, head if empty
+   */
+  void listRecursive(const std::string &path = std::string()) const;
+
+  /**
+   * Version of vfs structure that snapshot sees
+   *
+   * @return version, 0 for empty snapshot
+   */
+  std::uint64_t version() const { return id; }
+
+private:
+  /// Vfs structure, nullptr for empty snapshot
+  VirtualFileSystem *fileSystem;
+
+  /// Version of vfs structure that snapshot sees
+  std::uint64_t id;
+
+  /// Stream where snapshot lists directories and writes errors
+  std::ostream *out;
+
+  /// Participant of the snapshot in epoch based reclamation of fileSystem
+  EpochManager::Participant *participant;
+
+  /**
+   * Constructor of Snapshot, called by VirtualFileSystem::snapshot
+   *
+   * @param fileSystem vfs structure
+   * @param id version of vfs structure that snapshot sees
+   * @param output stream where snapshot lists directories and writes errors
+   */
+  Snapshot(VirtualFileSystem &fileSystem, std::uint64_t id,
+           std::ostream &output);
+
+  /**
+   * Releases snapshot, it is empty after that
+   */
+  void release();
+};
+} // namespace vfs
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace vfs {
+
+/**
+ * Implementation of the SpillFile class.
+ *
+ * SpillFile is backing file of data that doesn't fit in memory, like swap
+ * file. File is split in slots of slotSize bytes, data is written to free
+ * slot with pwrite and read back with pread, so many threads read and write
+ * slots at once. Released slots are reused, file grows only when no slot is
+ * free. File is removed as soon as it is created, its space is released when
+ * it is closed.
+ *
+ */
+class SpillFile {
+public:
+  /**
+   * Constructor of SpillFile
+   *
+   * Closed file, slots can't be written until it is opened.
+   *
+   * @param slotSize size of one slot
+   */
+  explicit SpillFile(std::size_t slotSize) : slotSize(slotSize) {}
+
+  /**
+   * Destructor of SpillFile
+   *
+   * File is closed, calling close.
+   */
+  ~SpillFile() { close(); }
+
+  /// Disabling construction of SpillFile object using copy constructor
+  SpillFile(const SpillFile &rhs) = delete;
+
+  /// Disabling construction of SpillFile object using copy assignment
+  SpillFile &operator=(const SpillFile &rhs) = delete;
+
+  /**
+   * Create file, and remove it from its directory
+   *
+   * @param path path of the file
+   * @return false if file can't be created
+   */
+  bool open(const std::string &path);
+
+  /**
+   * Close file, all slots are released
+   */
+  void close();
+
+  /**
+   * Is file open
+   *
+   * @return true if file is open
+   */
+  bool isOpen() const { return fd >= 0; }
+
+  /**
+   * Take free slot
+   *
+   * @return index of the slot
+   */
+  std::uint64_t allocate();
+
+  /**
+   * Release slot, so it is reused
+   *
+   * @param slot index of the slot
+   */
+  void release(std::uint64_t slot);
+
+  /**
+   * Release all slots, file is truncated
+   */
+  void clear();
+
+  /**
+   * Write data to slot
+   *
+   * @param slot index of the slot
+   * @param data first byte of the data
+   * @param size number of bytes, at most slotSize
+   * @return false if data can't be written
+   */
+  bool write(std::uint64_t slot, const char *data, std::size_t size);
+
+  /**
+   * Read data from slot
+   *
+   * @param slot index of the slot
+   * @param data where data is read
+   * @param size number of bytes, that were written to slot
+   * @return false if data can't be read
+   */
+  bool read(std::uint64_t slot, char *data, std::size_t size) const;
+
+  /**
+   * Number of slots that are taken
+   *
+   * @return number of slots
+   */
+  std::size_t slots() const;
+
+private:
+  /// Size of one slot
+  const std::size_t slotSize;
+
+  /// File descriptor, -1 if file is closed
+  int fd = -1;
+
+  /// Number of slots in file
+  std::uint64_t slotCount = 0;
+
+  /// Released slots, that are reused
+  std::vector<std::uint64_t> freeSlots{};
+
+  /// Guards slotCount and freeSlots
+  mutable std::mutex mutex{};
+};
+} // namespace vfs
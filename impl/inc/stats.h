@@ -0,0 +1,363 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+/// Statistics are compiled out, if VFS_STATS is defined as 0
+#ifndef VFS_STATS
+#define VFS_STATS 1
+#endif
+
+namespace vfs {
+
+/**
+ * Implementation of the Stats class.
+ *
+ * Stats counts operations of VirtualFileSystem and keeps histograms of their
+ * latencies. Every thread, VirtualFileSystem itself and every Session, joins
+ * and gets its own Shard, that only it writes, without locks and without
+ * sharing cache lines with other threads. Shards are merged only when
+ * snapshot is taken. Shard of the thread that leaves is kept and reused, so
+ * its counts stay in snapshot.
+ *
+ * Histograms are log bucketed, like HDR histograms, every power of two is
+ * split in 4 buckets, so latency is known within 25% from 1 ns to hours, in
+ * 252 buckets.
+ *
+ * If VFS_STATS is 0, Timer and Shard do nothing and compiler removes them,
+ * snapshot has only zeros.
+ *
+ */
+class Stats {
+public:
+  /// Timed operations, Decompress is decompression of chunk by read, PageIn
+  /// is read of chunk from backing file
+  enum class Operation {
+    MakeDirectory,
+    ChangeDirectory,
+    List,
+    Remove,
+    MakeFile,
+    Copy,
+    DiskUsage,
+    Find,
+    Read,
+    Write,
+    Decompress,
+    PageIn,
+    Grep
+  };
+
+  /// Number of timed operations
+  static constexpr std::size_t operationCount = 13;
+
+  /// Counted events, Lookups are names looked up in directories, while path
+  /// is resolved, DentryHits are paths resolved from dentry cache
+  enum class Counter { Lookups, DentryHits };
+
+  /// Number of counted events
+  static constexpr std::size_t counterCount = 2;
+
+  /// Number of buckets of the histogram
+  static constexpr std::size_t bucketCount = 252;
+
+  /**
+   * Histogram of latencies of one operation
+   *
+   * @param buckets number of latencies in every bucket
+   * @param count number of latencies
+   * @param total sum of latencies, in nanoseconds
+   * @param max the longest latency, in nanoseconds
+   */
+  struct Histogram {
+    std::array<std::uint64_t, bucketCount> buckets{};
+    std::uint64_t count = 0;
+    std::uint64_t total = 0;
+    std::uint64_t max = 0;
+
+    /**
+     * Latency at percentile
+     *
+     * @param percentile from 0 to 100
+     * @return upper bound of the bucket with percentile, in nanoseconds, 0 if
+     * histogram is empty
+     */
+    std::uint64_t percentile(double percentile) const;
+  };
+
+  /**
+   * Merged statistics
+   *
+   * @param operations histograms of operations, indexed by Operation
+   * @param counters counted events, indexed by Counter
+   * @param nodes directories and files that are allocated
+   * @param largestFanOut the most children any directory had
+   * @param compressedChunks chunks of file data that are compressed
+   * @param savedBytes memory that compression of chunks saves, compressed
+   * chunks that are decompressed in LRU are counted with both sizes
+   * @param spilledChunks chunks of file data that are in backing file
+   * @param evictions chunks that were written to backing file, since
+   * construction
+   */
+  struct Snapshot {
+    std::array<Histogram, operationCount> operations{};
+    std::array<std::uint64_t, counterCount> counters{};
+    std::uint64_t nodes = 0;
+    std::uint64_t largestFanOut = 0;
+    std::uint64_t compressedChunks = 0;
+    std::uint64_t savedBytes = 0;
+    std::uint64_t spilledChunks = 0;
+    std::uint64_t evictions = 0;
+
+    /// Histogram of operation
+    const Histogram &operator[](Operation operation) const {
+      return operations[static_cast<std::size_t>(operation)];
+    }
+
+    /// Value of counter
+    std::uint64_t operator[](Counter counter) const {
+      return counters[static_cast<std::size_t>(counter)];
+    }
+  };
+
+  /**
+   * Implementation of the Shard class.
+   *
+   * Statistics of one thread. Only that thread writes them, so they are
+   * relaxed atomics, read while snapshot is taken.
+   *
+   */
+  class Shard {
+    friend class Stats;
+
+  public:
+    /**
+     * Record latency of operation
+     *
+     * @param operation timed operation
+     * @param nanoseconds latency
+     */
+    void record(Operation operation, std::uint64_t nanoseconds) {
+#if VFS_STATS
+      Latencies &latencies = operations[static_cast<std::size_t>(operation)];
+      increment(latencies.buckets[bucketOf(nanoseconds)], 1);
+      increment(latencies.count, 1);
+      increment(latencies.total, nanoseconds);
+      if (nanoseconds > latencies.max.load(std::memory_order_relaxed))
+        latencies.max.store(nanoseconds, std::memory_order_relaxed);
+#else
+      (void)operation;
+      (void)nanoseconds;
+#endif
+    }
+
+    /**
+     * Count event
+     *
+     * @param counter counted event
+     * @param events number of events
+     */
+    void count(Counter counter, std::uint64_t events = 1) {
+#if VFS_STATS
+      increment(counters[static_cast<std::size_t>(counter)], events);
+#else
+      (void)counter;
+      (void)events;
+#endif
+    }
+
+  private:
+    /**
+     * Latencies of one operation
+     *
+     * @param buckets number of latencies in every bucket
+     * @param count number of latencies
+     * @param total sum of latencies, in nanoseconds
+     * @param max the longest latency, in nanoseconds
+     */
+    struct Latencies {
+      std::array<std::atomic<std::uint64_t>, bucketCount> buckets{};
+      std::atomic<std::uint64_t> count{0};
+      std::atomic<std::uint64_t> total{0};
+      std::atomic<std::uint64_t> max{0};
+    };
+
+    /// Latencies of operations, indexed by Operation
+    std::array<Latencies, operationCount> operations{};
+
+    /// Counted events, indexed by Counter
+    std::array<std::atomic<std::uint64_t>, counterCount> counters{};
+
+    /// Increment, only owner writes, so there is no read-modify-write
+    static void increment(std::atomic<std::uint64_t> &value,
+                          std::uint64_t added) {
+      value.store(value.load(std::memory_order_relaxed) + added,
+                  std::memory_order_relaxed);
+    }
+  };
+
+  /**
+   * Implementation of the Timer class.
+   *
+   * Timer measures latency of operation, from constructor to destructor, and
+   * records it in shard.
+   *
+   */
+  class Timer {
+  public:
+#if VFS_STATS
+    /**
+     * Constructor of Timer
+     *
+     * @param shard shard of the thread that runs operation
+     * @param operation timed operation
+     */
+    Timer(Shard &shard, Operation operation)
+        : shard(shard), operation(operation), start(Clock::now()) {}
+
+    /**
+     * Destructor of Timer
+     *
+     * Latency is recorded.
+     */
+    ~Timer() {
+      shard.record(operation,
+                   static_cast<std::uint64_t>(
+                       std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           Clock::now() - start)
+                           .count()));
+    }
+#else
+    Timer(Shard &, Operation) {}
+#endif
+
+    /// Disabling construction of Timer object using copy constructor
+    Timer(const Timer &rhs) = delete;
+
+    /// Disabling construction of Timer object using copy assignment
+    Timer &operator=(const Timer &rhs) = delete;
+
+#if VFS_STATS
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    /// Shard where latency is recorded
+    Shard &shard;
+
+    /// Timed operation
+    Operation operation;
+
+    /// Start of the operation
+    Clock::time_point start;
+#endif
+  };
+
+  /**
+   * Constructor of Stats
+   *
+   * No shards, they are created when threads join.
+   */
+  Stats() = default;
+
+  /// Disabling construction of Stats object using copy constructor
+  Stats(const Stats &rhs) = delete;
+
+  /// Disabling construction of Stats object using copy assignment
+  Stats &operator=(const Stats &rhs) = delete;
+
+  /**
+   * Join thread
+   *
+   * @return shard of the thread, valid until leave
+   */
+  Shard *join();
+
+  /**
+   * Leave thread
+   *
+   * Shard is kept, with its statistics, and reused by thread that joins.
+   *
+   * @param shard shard returned by join
+   */
+  void leave(Shard *shard);
+
+  /**
+   * Record number of children of directory
+   *
+   * @param children number of children, after directory was changed
+   */
+  void fanOut(std::size_t children) {
+#if VFS_STATS
+    std::uint64_t largest = largestFanOut.load(std::memory_order_relaxed);
+    while (children > largest &&
+           !largestFanOut.compare_exchange_weak(largest, children,
+                                                std::memory_order_relaxed))
+      ;
+#else
+    (void)children;
+#endif
+  }
+
+  /**
+   * Merge shards of all threads
+   *
+   * @return merged statistics, without nodes
+   */
+  Snapshot snapshot() const;
+
+  /**
+   * Name of operation, as shell command
+   *
+   * @param operation operation
+   * @return name of the command
+   */
+  static const char *name(Operation operation);
+
+  /**
+   * Bucket of the latency
+   *
+   * Latencies below 4 ns have their own buckets, every next power of two has
+   * 4 buckets.
+   *
+   * @param value latency, in nanoseconds
+   * @return index of the bucket
+   */
+  static std::size_t bucketOf(std::uint64_t value) {
+    if (value < 4)
+      return static_cast<std::size_t>(value);
+    std::size_t exponent = 0; // highest bit of value
+    for (std::size_t shift = 32; shift != 0; shift /= 2) {
+      if ((value >> exponent >> shift) != 0)
+        exponent += shift;
+    }
+    return (exponent - 1) * 4 + ((value >> (exponent - 2)) & 3);
+  }
+
+  /**
+   * The longest latency in bucket
+   *
+   * @param bucket index of the bucket
+   * @return upper bound of the bucket, in nanoseconds
+   */
+  static std::uint64_t bucketLimit(std::size_t bucket);
+
+private:
+  /// Shards of all threads that joined, they are never moved
+  std::deque<Shard> shards{};
+
+  /// Shards of threads that left
+  std::vector<Shard *> unused{};
+
+  /// Guards shards and unused
+  mutable std::mutex mutex{};
+
+  /// The most children any directory had
+  std::atomic<std::uint64_t> largestFanOut{0};
+};
+} // namespace vfs
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+
+namespace vfs {
+
+/**
+ * Implementation of the Substring class.
+ *
+ * Substring is fixed string, that is found in many texts, ex. in chunks of
+ * file data by grep. With SSE2, 16 positions of the text are checked at
+ * once, by comparing their bytes with the first byte of the string, and
+ * bytes at string length - 1 after them with its last byte. Only positions
+ * where both bytes match are compared with memcmp, so random text is
+ * skipped 16 bytes at a time, even when the first byte is common. Without
+ * SSE2, and at the end of the text, the first byte is found with memchr.
+ *
+ */
+class Substring {
+public:
+  /**
+   * Constructor of Substring
+   *
+   * @param pattern string that is found
+   */
+  explicit Substring(std::string pattern) : needle(std::move(pattern)) {}
+
+  /**
+   * Find the first occurrence in the text
+   *
+   * @param text first character of the text
+   * @param size number of characters in the text
+   * @return first character of the occurrence, nullptr if there is none,
+   * text if string is empty
+   */
+  const char *find(const char *text, std::size_t size) const;
+
+  /**
+   * Length of the string
+   *
+   * @return number of characters
+   */
+  std::size_t size() const { return needle.size(); }
+
+  /**
+   * String that is found
+   *
+   * @return the string
+   */
+  const std::string &pattern() const { return needle; }
+
+private:
+  /// String that is found
+  std::string needle;
+};
+} // namespace vfs
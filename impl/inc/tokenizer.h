@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace vfs {
+
+/**
+ * Token of the command line
+ *
+ * Token doesn't own characters, it points in the line that is split.
+ *
+ * @param data first character of the token
+ * @param size number of characters in the token
+ */
+struct Token {
+  const char *data = nullptr;
+  std::size_t size = 0;
+
+  /**
+   * Compare token with string literal
+   *
+   * @param literal string literal
+   * @return true if token has the same characters as literal
+   */
+  template <std::size_t N> bool operator==(const char (&literal)[N]) const {
+    return size == N - 1 && std::memcmp(data, literal, N - 1) == 0;
+  }
+};
+
+/**
+ * Implementation of the Tokenizer class.
+ *
+ * Tokenizer splits line on spaces and tabs, without copying characters or
+ * allocating memory. Tokens are taken one by one with next, so there is no
+ * limit on number of tokens in the line.
+ *
+ */
+class Tokenizer {
+public:
+  /**
+   * Constructor of Tokenizer
+   *
+   * @param line line that is split, must outlive Tokenizer and its tokens
+   */
+  explicit Tokenizer(const std::string &line)
+      : position(line.data()), end(line.data() + line.size()) {}
+
+  /**
+   * Next token in the line
+   *
+   * @param token set to next token
+   * @return false if there are no more tokens, true otherwise
+   */
+  bool next(Token &token) {
+    while (position != end && isSeparator(*position))
+      ++position;
+    if (position == end)
+      return false;
+    token.data = position;
+    while (position != end && !isSeparator(*position))
+      ++position;
+    token.size = static_cast<std::size_t>(position - token.data);
+    return true;
+  }
+
+  /**
+   * Rest of the line, after separators that follow the last token
+   *
+   * Separators inside the rest are kept, ex. text of write command.
+   *
+   * @param token set to the rest of the line
+   * @return false if the rest of the line is empty, true otherwise
+   */
+  bool rest(Token &token) {
+    while (position != end && isSeparator(*position))
+      ++position;
+    if (position == end)
+      return false;
+    token.data = position;
+    token.size = static_cast<std::size_t>(end - position);
+    position = end;
+    return true;
+  }
+
+private:
+  /// Position of the next character
+  const char *position;
+
+  /// End of the line
+  const char *end;
+
+  /// Tokens are separated by spaces, tabs and carriage return
+  static bool isSeparator(char character) {
+    return character == ' ' || character == '\t' || character == '\r';
+  }
+};
+} // namespace vfs
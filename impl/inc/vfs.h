@@ -1,14 +1,65 @@
 #pragma once
 
+#include "blockArena.h"
+#include "childList.h"
+#include "dentryCache.h"
+#include "epoch.h"
+#include "glob.h"
+#include "image.h"
+#include "journal.h"
+#include "name.h"
+#include "nameIndex.h"
+#include "nodePool.h"
+#include "radixTree.h"
+#include "snapshot.h"
+#include "spillFile.h"
+#include "stats.h"
+#include "substring.h"
+#include "workStealingPool.h"
+#include "xxHash.h"
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
 #include <ctime>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace vfs {
 
+/// Length of formatted time and date, as written by list
+constexpr std::size_t timeFormatLength = 30;
+
+/**
+ * Returns current time, that is stored when file or directory is created
+ *
+ * @return seconds since epoch
+ */
+std::int64_t return_current_time();
+
+/**
+ * Formats time and date when file or directory was created
+ *
+ * Time and date is written as "%Y-%m-%d %H:%M:%S" in local time, rest of the
+ * buffer is filled with '\0'.
+ *
+ * @param time seconds since epoch
+ * @param buffer buffer of timeFormatLength characters
+ */
+void format_time_and_date(std::int64_t time, char *buffer);
+
 /**
  * Returns time and date when file or directory was created
  *
@@ -16,6 +67,8 @@ namespace vfs {
  */
 std::string return_current_time_and_date();
 
+class Session;
+
 /**
  * Implementation of the VirtualFileSystem class.
  *
@@ -23,26 +76,385 @@ std::string return_current_time_and_date();
  * with basic implemented commands, class Commands. Once the program is
  * terminated, there is no saved file or directory, hence virtual in class name.
  *
+ * Commands of VirtualFileSystem work with its currentDirectory. Many Session
+ * objects, each with its own current directory, can share one
+ * VirtualFileSystem and use it from different threads. Lookups, cd and ls
+ * don't lock, they run in epoch of EpochManager and read name indexes and
+ * child lists that writers change atomically. mkdir, mkfile and rm lock only
+ * directories they change, erased directories and files are retired and
+ * released when no reader can see them. Current directories that are in
+ * erased directory are moved to its parent.
+ *
+ * Recursive commands, cp, du and find, and release of erased directory with
+ * all its subdirectories and files, visit subtree with WorkStealingPool, so
+ * wide subtrees are split between threads and deep subtrees don't recurse.
+ * rm only unlinks directory, erased subtree is released by background
+ * reclaimer thread of EpochManager.
+ *
+ * Snapshot is taken in O(1), it only gets new version of vfs structure.
+ * Mutation, that is the first change of directory since the last snapshot,
+ * keeps copy of children of that directory for snapshots, and erased
+ * directories and files are kept while some snapshot can see them, so memory
+ * used by snapshots depends only on the changes made after they were taken.
+ *
  */
 class VirtualFileSystem {
+  friend class Session;
+  friend class Snapshot;
+
+public:
+  /// Order in which children of directory are listed, Insertion lists
+  /// subdirectories and then files in order of creation, Time by creation
+  /// time and then by name
+  enum class Order { Insertion, Name, Time };
+
+  /**
+   * Options of ordered and paginated listing
+   *
+   * Listing with limit or cursor is sorted, by name if order is Insertion.
+   *
+   * @param order order in which children are listed
+   * @param limit maximal number of listed children, 0 for all
+   * @param after cursor, children up to and including it are skipped, name
+   * for Name order, time/name for Time order
+   */
+  struct ListOptions {
+    Order order = Order::Insertion;
+    std::size_t limit = 0;
+    std::string after{};
+  };
+
+  /**
+   * Listed child of the directory, valid only while it is visited
+   *
+   * @param directory true for subdirectory, false for file
+   * @param name name of the subdirectory/file, in buffer that is reused for
+   * the next child
+   * @param timeCreated time when subdirectory/file was created
+   */
+  struct Entry {
+    bool directory;
+    const std::string &name;
+    std::int64_t timeCreated;
+  };
+
+  /// Function that visits listed child, returns false to stop listing
+  using ListVisitor = std::function<bool(const Entry &entry)>;
+
+  /// Function that visits read data, part of one chunk, valid only while it
+  /// is visited, returns false to stop reading
+  using ReadVisitor = std::function<bool(const char *data, std::size_t size)>;
+
+  /// Function that visits line found by grep, with absolute path of the
+  /// file and number of the line, from 1, returns false to stop search
+  using GrepVisitor = std::function<bool(
+      const std::string &path, std::uint64_t line, const std::string &text)>;
+
+  /// Size of the chunk of file data
+  static constexpr std::size_t chunkSize = 4096;
 
 private:
+  /**
+   * Bytes of the chunk, allocated from pagePool
+   *
+   * @param bytes chunkSize bytes of the file, from offset that is multiple of
+   * chunkSize
+   */
+  struct Page {
+    char bytes[chunkSize];
+  };
+
+  /**
+   * Compressed bytes of the chunk
+   *
+   * @param length number of bytes that are compressed
+   * @param size number of compressed bytes
+   * @param bytes compressed bytes
+   */
+  struct Packed {
+    std::size_t length;
+    std::size_t size;
+    std::unique_ptr<char[]> bytes;
+
+    /**
+     * Constructor of Packed
+     *
+     * @param length number of bytes that are compressed
+     * @param compressed compressed bytes
+     * @param size number of compressed bytes
+     */
+    Packed(std::size_t length, const char *compressed, std::size_t size)
+        : length(length), size(size), bytes(new char[size]) {
+      std::memcpy(bytes.get(), compressed, size);
+    }
+  };
+
+  /**
+   * Chunk of file data, allocated from chunkPool
+   *
+   * Chunks with the same bytes are shared by files, chunk is found in
+   * dedupIndex by hash of its bytes. Chunk is written in place only while it
+   * has one reference and is not in dedupIndex, otherwise it is copied
+   * first. Chunk is hashed when it is written, appendedHash keeps lanes of
+   * its bytes, so appends hash only the bytes they add. References, length,
+   * hash and queue fields are guarded by chunkMutex.
+   *
+   * Bytes are in page, chunk in dedupIndex, that was not used for
+   * compressAfter, is compressed by compressIdle, then page is released.
+   * Chunks that can be compressed wait in compressQueue, in order in which
+   * they were queued, so compressIdle takes only the idle ones, other chunks
+   * in dedupIndex, that are not spilled, wait in residentQueue. When chunks
+   * take more than memoryLimit, the least recently used chunks, from fronts
+   * of both queues, are written to spillFile, then their page or compressed
+   * bytes are released. Compressed or spilled chunk is never written, reader
+   * decompresses it, or reads it, to new page, that is kept while chunk is in
+   * hotChunks. Chunk that is compressed or spilled is referenced and busy, so
+   * it is not released and not taken by other pass.
+   *
+   * @param references number of files whose tables have the chunk, and of
+   * retired tables that still release it
+   * @param length number of bytes that are in dedupIndex, 0 if chunk is not
+   * in it
+   * @param hash xxHash64 of length bytes
+   * @param appendedHash hash of bytes of the chunk, that grow while it is
+   * appended, written only by writer of the file that owns the chunk
+   * @param queue compressQueue or residentQueue, that has the chunk, nullptr
+   * if chunk is in none
+   * @param queuedSince time when chunk was put to the end of its queue
+   * @param queueEntry position in queue
+   * @param incompressible true if bytes in dedupIndex don't compress
+   * @param busy true while chunk is compressed or spilled
+   * @param hot true if chunk is in hotChunks, guarded by hotMutex
+   * @param hotSince time when chunk was put to front of hotChunks, guarded by
+   * hotMutex
+   * @param hotEntry position in hotChunks, guarded by hotMutex
+   * @param used time when chunk was last read or written, in milliseconds
+   * @param page bytes, nullptr while chunk is compressed and not hot
+   * @param packed compressed bytes, nullptr if chunk is not compressed
+   * @param spillLength number of bytes that are spilled
+   * @param spillSize number of bytes in slot
+   * @param spillPacked true if bytes in slot are compressed
+   * @param spill slot of spillFile plus one, 0 if chunk is not spilled
+   */
+  struct Chunk {
+    std::uint32_t references = 1;
+    std::uint32_t length = 0;
+    std::uint64_t hash = 0;
+    AppendedHash appendedHash{};
+    std::list<Chunk *> *queue = nullptr;
+    std::int64_t queuedSince = 0;
+    std::list<Chunk *>::iterator queueEntry{};
+    bool incompressible = false;
+    bool busy = false;
+    bool hot = false;
+    std::int64_t hotSince = 0;
+    std::list<Chunk *>::iterator hotEntry{};
+    std::atomic<std::int64_t> used{0};
+    std::atomic<Page *> page{nullptr};
+    std::atomic<Packed *> packed{nullptr};
+    std::uint32_t spillLength = 0;
+    std::uint32_t spillSize = 0;
+    bool spillPacked = false;
+    std::atomic<std::uint64_t> spill{0};
+
+    /**
+     * Destructor of Chunk
+     *
+     * Compressed bytes are released, page is released with pagePool.
+     */
+    ~Chunk() { delete packed.load(); }
+  };
+
+  /**
+   * Data of the file, size and table of chunks
+   *
+   * Readers load the table once, and read at most its size bytes from its
+   * chunks. Bytes below size are not changed in place, chunk is copied
+   * before it is overwritten, while bytes after size are written in place
+   * and then size is increased. Table is replaced when it is full and when
+   * file is truncated, so reader of older table, that can have bigger size,
+   * never sees bytes that are changed. Table is allocated from nodeMemory,
+   * with createData.
+   *
+   * @param size number of bytes of the file
+   * @param capacity number of chunks that table can hold
+   * @param chunks chunks of the file, allocated after the table, chunk of
+   * every chunkSize bytes below size, nullptr after them
+   */
+  struct FileData {
+    std::atomic<std::uint64_t> size{0};
+    std::size_t capacity;
+    std::atomic<Chunk *> *chunks;
+
+    /**
+     * Constructor of FileData
+     *
+     * @param capacity number of chunks that table can hold
+     */
+    explicit FileData(std::size_t capacity)
+        : capacity(capacity),
+          chunks(reinterpret_cast<std::atomic<Chunk *> *>(this + 1)) {
+      for (std::size_t i = 0; i < capacity; ++i)
+        new (chunks + i) std::atomic<Chunk *>(nullptr);
+    }
+  };
+
   /**
    * Implementation of the File class.
    *
    * @param fileName name of the file
-   * @param timeCreated current time and date when the file was created
+   * @param timeCreated current time when the file was created, formatted only
+   * when it is listed
+   * @param data data of the file, nullptr until it is written, released by
+   * releaseData before file is destroyed
+   * @param listSlot index of the file in files of parent, set by ChildList
    */
   struct File {
-    std::string fileName;
-    std::string timeCreated = return_current_time_and_date();
+    Name fileName;
+    std::int64_t timeCreated = return_current_time();
+    std::atomic<FileData *> data{nullptr};
+    std::size_t listSlot = 0;
 
     /**
      * Constructor of File
      *
      * @param name name of the file
      */
-    File(std::string name) : fileName(std::move(name)) {}
+    File(Name name) : fileName(std::move(name)) {}
+  };
+
+  struct Directory;
+  struct Frozen;
+
+  /**
+   * Child of the directory, value of the Directory name index.
+   *
+   * Child is ptr to subdirectory or file, stored as bits, where bit 1 is set
+   * for file. Empty child has no directory and no file.
+   *
+   */
+  class Child {
+  public:
+    /// Empty child
+    Child() = default;
+
+    /// Child that is subdirectory
+    explicit Child(Directory *directory)
+        : bits(reinterpret_cast<std::uintptr_t>(directory)) {}
+
+    /// Child that is file
+    explicit Child(File *file)
+        : bits(reinterpret_cast<std::uintptr_t>(file) | fileBit) {}
+
+    /// Subdirectory, nullptr if child is file or empty
+    Directory *directory() const {
+      return (bits & fileBit) != 0 ? nullptr
+                                   : reinterpret_cast<Directory *>(bits);
+    }
+
+    /// File, nullptr if child is subdirectory or empty
+    File *file() const {
+      return (bits & fileBit) == 0 ? nullptr
+                                   : reinterpret_cast<File *>(bits & ~fileBit);
+    }
+
+    /// true if child is not empty
+    explicit operator bool() const { return bits != 0; }
+
+    /// Name of the subdirectory or file
+    const Name &name() const;
+
+    /// Time when subdirectory or file was created
+    std::int64_t timeCreated() const;
+
+    /// Child stored as bits, used by NameIndex
+    std::uintptr_t toBits() const { return bits; }
+
+    /// Child from bits, used by NameIndex
+    static Child fromBits(std::uintptr_t bits) {
+      Child child;
+      child.bits = bits;
+      return child;
+    }
+
+  private:
+    /// Bit that is set for file
+    static constexpr std::uintptr_t fileBit = 2;
+
+    /// ptr to subdirectory or file
+    std::uintptr_t bits = 0;
+  };
+
+  /**
+   * Children of the directory, sorted by name or by creation time
+   *
+   * Built by the first ordered listing after directory was changed, and
+   * shared by all ordered listings until the next change. Allocated from
+   * nodeMemory, with createSorted.
+   *
+   * @param changes changes of the directory when children were sorted
+   * @param size number of children
+   * @param children subdirectories and files, allocated after it, sorted
+   */
+  struct Sorted {
+    std::uint64_t changes;
+    std::size_t size;
+    Child *children;
+
+    /**
+     * Constructor of Sorted
+     *
+     * @param changes changes of the directory when children are sorted
+     * @param size number of children
+     */
+    Sorted(std::uint64_t changes, std::size_t size)
+        : changes(changes), size(size),
+          children(reinterpret_cast<Child *>(this + 1)) {
+      for (std::size_t i = 0; i < size; ++i)
+        new (children + i) Child();
+    }
+
+    /// First child
+    Child *begin() const { return children; }
+
+    /// Past the last child
+    Child *end() const { return children + size; }
+  };
+
+  /**
+   * Child that was added to the directory or removed from it
+   *
+   * @param changes changes of the directory after the change
+   * @param child added or removed child
+   * @param added true if child was added, false if it was removed
+   */
+  struct Change {
+    std::uint64_t changes;
+    Child child;
+    bool added;
+  };
+
+  /**
+   * Recent changes of the directory, oldest first
+   *
+   * Changes that were made after children were sorted are merged into sorted
+   * children, so they are not sorted again. Ring allocated from nodeMemory,
+   * with logChange.
+   *
+   * @param capacity number of changes that log can hold, power of two
+   * @param first index of the oldest change
+   * @param size number of changes
+   */
+  struct ChangeLog {
+    std::size_t capacity;
+    std::size_t first;
+    std::size_t size;
+
+    /// Change at index, 0 for the oldest one
+    Change &at(std::size_t index) {
+      return reinterpret_cast<Change *>(this + 1)[(first + index) &
+                                                 (capacity - 1)];
+    }
   };
 
   /**
@@ -51,131 +463,1925 @@ private:
    * Directoy can contain sub directories and files.
    *
    * @param directoryName name of the directory
-   * @param timeCreated current time and date when the directory was created
+   * @param timeCreated current time when the directory was created, formatted
+   * only when it is listed
    * @param subDirectories directory can contain subdirectories
    * @param parentDirectory pointer to directory above current directory, in vfs
    * structure
-   * @param files vector of files that are part of current directory
+   * @param files list of files that are part of current directory
+   * @param children name index of subDirectories and files, names are unique
+   * in directory
+   * @param mutex lock of writers, that change subDirectories, files and
+   * children
+   * @param removed set when directory is erased, nothing can be created in
+   * it after that
+   * @param image node of the directory in mapped image, while its children
+   * are not yet copied from image, nullptr otherwise
+   * @param frozen changes of children, kept for snapshots, newest first
+   * @param changes incremented when subDirectories and files are changed
+   * @param byName children sorted by name, nullptr until they are listed
+   * @param byTime children sorted by creation time, nullptr until they are
+   * listed
+   * @param listSlot index of the directory in subDirectories of parent, set
+   * by ChildList
+   * @param recent changes after recentSince, nullptr before the first one,
+   * guarded by mutex
+   * @param recentSince changes of the directory before the oldest recent
+   * change, sorted children older than it are sorted again, guarded by mutex
+   * @param memory arena of subDirectories, files, children, sorted children
+   * and recent changes
    */
   struct Directory {
-    std::string directoryName;
-    std::string timeCreated = return_current_time_and_date();
-    std::vector<Directory *> subDirectories{};
+    Name directoryName;
+    std::int64_t timeCreated = return_current_time();
+    ChildList<Directory> subDirectories;
     Directory *parentDirectory = nullptr;
-    std::vector<File *> files{};
+    ChildList<File> files;
+    NameIndex<Child> children;
+    std::mutex mutex{};
+    std::atomic<bool> removed{false};
+    std::atomic<const ImageNode *> image{nullptr};
+    std::atomic<Frozen *> frozen{nullptr};
+    std::atomic<std::uint64_t> changes{0};
+    std::atomic<Sorted *> byName{nullptr};
+    std::atomic<Sorted *> byTime{nullptr};
+    std::size_t listSlot = 0;
+    ChangeLog *recent = nullptr;
+    std::uint64_t recentSince = 0;
+    BlockArena &memory;
 
     /**
      * Constructor of Directory
      *
-     * Name of the directory is set, while pointers to vector of subDirectories
-     * and files is set to nullptr, as well as parentDirectory
+     * Name of the directory is set, while lists of subDirectories and files
+     * are empty and parentDirectory is nullptr
      *
      * @param name name of the directory
+     * @param memory arena of the children
+     */
+    Directory(Name name, BlockArena &memory)
+        : directoryName(std::move(name)), subDirectories(memory),
+          parentDirectory(nullptr), files(memory), children(memory),
+          memory(memory) {}
+
+    /**
+     * Destructor of Directory
+     *
+     * Sorted children and recent changes are released.
      */
-    Directory(std::string name)
-        : directoryName(std::move(name)), subDirectories(0, nullptr),
-          parentDirectory(nullptr), files(0, nullptr) {}
+    ~Directory() {
+      destroySorted(memory, byName.load());
+      destroySorted(memory, byTime.load());
+      destroyLog(memory, recent);
+    }
   };
 
   /**
-   * Delete all directories
+   * Child that was added to the directory or removed from it for snapshots
    *
-   * Function that recursivly calls itself and deletes all directories in vfs
-   * structure.
+   * @param child added or removed child
+   * @param slot index of removed child in subDirectories or files of the
+   * directory, 0 for added child
+   * @param added true if child was added, false if it was removed
+   */
+  struct FrozenChange {
+    Child child;
+    std::size_t slot;
+    bool added;
+  };
+
+  /**
+   * Changes of the directory at version
    *
-   * @param directory ptr to directory
+   * Snapshots older than version see children of the directory without
+   * these changes and changes of newer versions. Only changed children are
+   * kept, so snapshots take memory proportional to changes, not to size of
+   * directories. Slots of children are pinned while directory has changes,
+   * so removed child is put back to its place.
+   *
+   * @param version version of vfs structure when directory was changed
+   * @param changes added and removed children, oldest first, guarded by
+   * mutex of the directory
+   * @param next older changes, nullptr if there are none
    */
-  void deleteDirectory(Directory *directory);
+  struct Frozen {
+    std::uint64_t version;
+    std::vector<FrozenChange> changes{};
+    std::atomic<Frozen *> next;
+
+    /**
+     * Constructor of Frozen
+     *
+     * @param version version of vfs structure when directory is changed
+     * @param directory directory that is changed, locked
+     */
+    Frozen(std::uint64_t version, const Directory *directory)
+        : version(version),
+          next(directory->frozen.load(std::memory_order_relaxed)) {}
+  };
 
-public:
   /**
-   * Constructor of VirtualFileSystem
+   * Subdirectories and files of the directory, as they are listed
    *
-   * Directory home is created, that represents top of the directory in vfs
+   * @param subDirectories subdirectories of the directory
+   * @param files files of the directory
    */
-  VirtualFileSystem();
+  struct Listing {
+    std::vector<Directory *> subDirectories;
+    std::vector<File *> files;
+  };
 
   /**
-   * Destructor of VirtualFileSystem
+   * Memory kept for snapshots, released when no snapshot can see it
    *
-   * All files and subdirectories are removed from vfs, calling deleteDirectory
-   * function
+   * @param version version of vfs structure when memory was kept, snapshots
+   * older than version can see it
+   * @param kind copy of children, erased directory or erased file
+   * @param pointer ptr to Frozen, Directory or File
+   * @param owner directory that has the copy of children, nullptr otherwise
    */
-  ~VirtualFileSystem();
+  struct Retained {
+    enum class Kind { Frozen, Directory, File };
+    std::uint64_t version;
+    Kind kind;
+    void *pointer;
+    Directory *owner;
+  };
 
-  /// Disabling construction of VirtualFileSystem object using copy constructor
-  VirtualFileSystem(const VirtualFileSystem &rhs) = delete;
+  /**
+   * Implementation of the DirectoryPointer class.
+   *
+   * Atomic ptr to current directory, current directory of session can be
+   * moved by other session, that erases directory.
+   *
+   */
+  class DirectoryPointer {
+  public:
+    /// ptr to directory
+    Directory *operator->() const { return pointer.load(); }
 
-  /// Disabling construction of VirtualFileSystem object using copy assignment
-  VirtualFileSystem &operator=(const VirtualFileSystem &rhs) = delete;
+    /// ptr to directory
+    operator Directory *() const { return pointer.load(); }
+
+    /// Set ptr to directory
+    void store(Directory *directory) const { pointer.store(directory); }
+
+    /// Set ptr to desired, if it is still expected
+    bool compareExchange(Directory *&expected, Directory *desired) const {
+      return pointer.compare_exchange_strong(expected, desired);
+    }
+
+  private:
+    /// ptr to directory
+    mutable std::atomic<Directory *> pointer{nullptr};
+  };
 
   /**
-   * Ptr to directory that tracks directory above current directory.
+   * State of VirtualFileSystem or Session, that commands use
+   *
+   * @param participant participant of epoch based reclamation
+   * @param currentDirectory current directory
+   * @param dentries cache of resolved paths
+   * @param shard statistics of the thread that runs commands
+   * @param out stream where directories are listed and errors are written
    */
-  Directory *head = nullptr;
+  struct Context {
+    EpochManager::Participant &participant;
+    const DirectoryPointer &currentDirectory;
+    DentryCache<Directory> &dentries;
+    Stats::Shard &shard;
+    std::ostream &out;
+  };
+
+  /// Names of directories and files, outlives nodes in the pools
+  mutable NameTable names{};
+
+  /// Memory that directories and files own, released with their pools
+  mutable BlockArena nodeMemory{};
+
+  /// Pool of all directories in vfs structure
+  mutable NodePool<Directory> directoryPool{};
+
+  /// Pool of all files in vfs structure
+  mutable NodePool<File> filePool{};
+
+  /// Guards directoryPool and filePool, readers create directories and files
+  /// too, when they are copied from image
+  mutable std::mutex poolMutex{};
+
+  /// Pool of chunks of file data
+  mutable NodePool<Chunk> chunkPool{};
+
+  /// Pool of bytes of chunks
+  mutable NodePool<Page, 256> pagePool{};
+
+  /// Guards chunkPool, pagePool, dedupIndex, compressQueue, residentQueue,
+  /// packedChunks and packedBytes
+  mutable std::mutex chunkMutex{};
+
+  /// Number of compressed chunks
+  mutable std::size_t packedChunks = 0;
+
+  /// Number of compressed bytes of all chunks
+  mutable std::uint64_t packedBytes = 0;
+
+  /// Pages that are retired, they are not counted in memory of chunks
+  mutable std::atomic<std::size_t> retiredPages{0};
+
+  /// Memory of chunks, over which chunks are spilled, 0 for no limit
+  std::atomic<std::uint64_t> memoryLimit{0};
+
+  /// Backing file of spilled chunks, slot for every chunk
+  mutable SpillFile spillFile{chunkSize};
+
+  /// Runs one spill at a time, writers that need memory wait for it
+  mutable std::mutex spillMutex{};
+
+  /// Number of chunks that were spilled
+  mutable std::atomic<std::uint64_t> evictions{0};
+
+  /// Chunks that are not used for compressAfter milliseconds are compressed,
+  /// 0 if chunks are not compressed
+  std::atomic<std::int64_t> compressAfter{0};
+
+  /// Compressed chunks that were decompressed by readers, and keep their
+  /// pages, the most recently decompressed first
+  mutable std::list<Chunk *> hotChunks{};
+
+  /// Maximum number of hotChunks
+  std::atomic<std::size_t> hotLimit{64};
+
+  /// Guards hotChunks
+  mutable std::mutex hotMutex{};
+
+  /// Compressor thread, not joinable if compression was never enabled
+  std::thread compressor{};
+
+  /// Set when compressor should stop
+  bool compressorStopping = false;
+
+  /// Guards compressor and compressorStopping, and runs one compressIdle at
+  /// a time
+  std::mutex compressorMutex{};
+
+  /// Wakes compressor, when it stops or compressAfter is changed
+  std::condition_variable compressorCondition{};
+
+  /// Chunks by hash of their bytes, so chunk with the same bytes is shared
+  mutable std::unordered_multimap<std::uint64_t, Chunk *> dedupIndex{};
+
+  /// Chunks in dedupIndex, that are not compressed, spilled or busy, and
+  /// that may compress, the least recently queued first
+  mutable std::list<Chunk *> compressQueue{};
+
+  /// Chunks in dedupIndex, that are compressed or don't compress, and are
+  /// not spilled or busy, the least recently queued first
+  mutable std::list<Chunk *> residentQueue{};
+
+  /// Sum of sizes of all files
+  mutable std::atomic<std::uint64_t> logicalBytes{0};
+
+  /// Image loaded by load, directories are copied from it when they are
+  /// first visited
+  Image mappedImage{};
+
+  /// Epoch based reclamation of erased directories, files, and replaced
+  /// name index tables and child arrays
+  mutable EpochManager epochs{};
+
+  /// Participant for commands of VirtualFileSystem
+  EpochManager::Participant *participant = nullptr;
+
+  /// Operation counters and latencies of all threads
+  mutable Stats statistics{};
+
+  /// Statistics of commands of VirtualFileSystem
+  Stats::Shard *shard = nullptr;
+
+  /// Generation of vfs structure, incremented when directory is removed
+  std::atomic<std::uint64_t> generation{0};
+
+  /// Current directories of VirtualFileSystem and of all sessions
+  std::vector<const DirectoryPointer *> workingDirectories{};
+
+  /// Guards workingDirectories
+  std::mutex sessionMutex{};
+
+  /// Cache of resolved multi component paths, used with currentDirectory
+  mutable DentryCache<Directory> dentries{};
+
+  /// Journal of mutations, when it is open
+  Journal journal{};
+
+  /// Mutations hold it shared, checkpoint and snapshot exclusive
+  mutable std::shared_timed_mutex mutationMutex{};
+
+  /// Version of vfs structure, incremented when snapshot is taken, guarded
+  /// by mutationMutex
+  std::uint64_t version = 1;
+
+  /// Versions of snapshots that are not released
+  std::set<std::uint64_t> liveSnapshots{};
+
+  /// Memory kept for snapshots, in order of version
+  std::deque<Retained> retained{};
+
+  /// Guards liveSnapshots and retained
+  std::mutex snapshotMutex{};
+
+  /// Threads that visit subtrees of recursive commands
+  mutable WorkStealingPool workers;
+
+  /// Number of directories released since construction
+  std::atomic<std::uint64_t> releasedDirectories{0};
+
+  /// Number of files released since construction
+  std::atomic<std::uint64_t> releasedFiles{0};
 
   /**
-   * Ptr to directory that tracks current directory.
+   * Directory or file in nameTree
+   *
+   * @param parent parent of the directory/file, nullptr for head
+   * @param child the directory/file
+   */
+  struct Located {
+    Directory *parent;
+    Child child;
+
+    /// Values of the name are the same node if they have the same child
+    bool operator==(const Located &rhs) const {
+      return child.toBits() == rhs.child.toBits();
+    }
+  };
+
+  /// Hash of Located, by its child, so equal values have equal hashes
+  struct LocatedHash {
+    std::size_t operator()(const Located &located) const {
+      return std::hash<std::uintptr_t>()(located.child.toBits());
+    }
+  };
+
+  /// Names of all directories and files, built by the first complete or
+  /// locate, and then changed by every mutation
+  mutable RadixTree<Located, LocatedHash> nameTree{};
+
+  /// Guards nameTree, mutations hold it exclusive, complete and locate
+  /// shared
+  mutable std::shared_timed_mutex nameTreeMutex{};
+
+  /// Set when nameTree is built, mutations change it only after that
+  mutable std::atomic<bool> nameTreeBuilt{false};
+
+  /**
+   * Context of commands of VirtualFileSystem
+   *
+   * @return context with currentDirectory
    */
-  Directory *currentDirectory = nullptr;
+  Context context() const;
 
   /**
-   * Creates directory
+   * Find child directory
    *
-   * Creates directory with nameDirectory name and sets it parentDirectory to
-   * currentDirectory, while currentDirectory is pointing to subDirectoris that
-   * has newly created directory
+   * Looks up the name in children of directory, without lock.
    *
-   * @param nameDirectory name of the directory
+   * @param directory directory in which name is looked up
+   * @param name first character of the name
+   * @param size length of the name
+   * @return ptr to directory, nullptr if there is no such subdirectory
    */
-  void makeDirectory(const std::string &nameDirectory);
+  Directory *findChild(Directory *directory, const char *name,
+                       std::size_t size) const;
 
   /**
-   * Change directory
+   * Find directory
    *
-   * Change directory, which moves pointer to currentDirectory. If no
-   * nameDirectory is given, currentDirectory points to head directory, which is
-   * Home directory. If nameDirectory is .. , currentDirectory points to
-   * parentDirectory. If other name is given, directory is checked for
-   * subdirectoris and if nameDirectory matches the name of one of the
-   * subDirectoris, currentDirectory is set to that subdirectory, if no such
-   * subdirectory exist, "No such directory" is printed. One other option is if
-   * nameDirectory is .., when currentDirectory is head, that is Home directory,
-   * that has no parentDirectory, then "No parent directory" is printed. If
-   * nameDirectory is not defined in above discription, "Invalid command" is
-   * printed.
+   * Resolves path, that can have multiple components separated by /, to the
+   * directory. Absolute path starts with /home, where home is the name of
+   * head, relative path is resolved from currentDirectory. Component . is
+   * skipped and .. goes to parentDirectory, or stays in head. Paths with
+   * multiple components are cached in cache.
    *
-   * @param nameDirectory name of the directory
+   * @param currentDirectory directory from which relative path is resolved
+   * @param cache cache of resolved paths
+   * @param shard statistics of the thread, lookups are counted
+   * @param path first character of the path
+   * @param size length of the path
+   * @return ptr to directory, nullptr if there is no such directory
    */
-  void changeDirectory(const std::string &nameDirectory);
+  Directory *findDirectory(Directory *currentDirectory,
+                           DentryCache<Directory> &cache, Stats::Shard &shard,
+                           const char *path, std::size_t size) const;
 
   /**
-   * List in directory
+   * Find parent directory
    *
-   * List all subdirectoris and files in currentDirectory. Subdirectoris have
-   * d------ extension, while files f------, after which timeCreated and
-   * names of direcories and files are written.
+   * Splits path to parent path and last component, leaf, and resolves parent
+   * path with findDirectory. Path without / has currentDirectory as parent.
    *
+   * @param currentDirectory directory from which relative path is resolved
+   * @param cache cache of resolved paths
+   * @param shard statistics of the thread, lookups are counted
+   * @param path path of the directory/file
+   * @param leafStart position of the last component in path
+   * @param leafSize length of the last component
+   * @return ptr to parent directory, nullptr if there is no such directory
    */
-  void list() const;
+  Directory *findParent(Directory *currentDirectory,
+                        DentryCache<Directory> &cache, Stats::Shard &shard,
+                        const std::string &path, std::size_t &leafStart,
+                        std::size_t &leafSize) const;
 
   /**
-   * Remove in directory
+   * List directory
    *
-   * Checks if the name is the same as some subdirectory or file, if yes,
-   * then this subdirectory or file is erased.
+   * @param directory directory that is listed
+   * @param out stream where directory is listed
+   */
+  void listDirectory(const Directory *directory, std::ostream &out) const;
+
+  /**
+   * List subdirectories and files
    *
-   * @param name name of the directory/file that is to be erased
+   * @param subDirectories subdirectories that are listed, snapshot of
+   * ChildList or vector
+   * @param files files that are listed, snapshot of ChildList or vector
+   * @param out stream where they are listed
    */
-  void remove(const std::string &name);
+  template <typename Directories, typename Files>
+  void listChildren(const Directories &subDirectories, const Files &files,
+                    std::ostream &out) const;
 
   /**
-   * Creates file
+   * List directory that is in image
    *
-   * Creates file with nameFile name and sets it currentDirectory.
+   * @param node node of the directory in image
+   * @param out stream where directory is listed
+   */
+  void listImage(const ImageNode *node, std::ostream &out) const;
+
+  /**
+   * Copy children of directory from image
+   *
+   * If directory is still in image, its subdirectories and files are created
+   * in memory, subdirectories stay in image until they are visited. Called
+   * before children of directory are read or changed.
    *
-   * @param nameFile name of the file
+   * @param directory directory that is visited
    */
-  void makeFile(const std::string &nameFile);
+  void materialize(Directory *directory) const;
+
+  /**
+   * Move current directory out of erased directories
+   *
+   * If current directory, or some directory above it, is erased, current
+   * directory is moved to parent of erased directory.
+   *
+   * @param currentDirectory current directory
+   */
+  void leaveRemoved(const DirectoryPointer &currentDirectory) const;
+
+  /**
+   * Move all current directories out of erased directories
+   */
+  void leaveRemovedAll();
+
+  /**
+   * Erase directory
+   *
+   * Directory is marked as removed and unlinked from parent, that is locked.
+   * Current directories, that are in erased directory, are moved to parent.
+   * Directory and its files are retired.
+   *
+   * @param parent parent of erased directory, locked
+   * @param directory erased directory
+   */
+  void eraseDirectory(Directory *parent, Directory *directory);
+
+  /**
+   * Keep changed children of directory for snapshots
+   *
+   * Called before directory is changed, while it is locked. Changes are kept
+   * only if some snapshot is not released, the first change since the last
+   * snapshot starts new Frozen, and pins slots of children.
+   *
+   * @param directory directory that is changed, locked
+   * @param children children that are added or removed
+   * @param count number of children
+   * @param added true if children are added, false if they are removed
+   */
+  void freeze(Directory *directory, const Child *children, std::size_t count,
+              bool added);
+
+  /**
+   * Retire erased directory or file
+   *
+   * If some snapshot is not released, directory/file is kept until no
+   * snapshot can see it, otherwise it is retired to EpochManager.
+   *
+   * @param kind Directory or File
+   * @param pointer erased directory/file
+   */
+  void retain(Retained::Kind kind, void *pointer);
+
+  /**
+   * Retire erased subdirectories and files
+   *
+   * Like retain, but if no snapshot is live, children are retired as one
+   * batch.
+   *
+   * @param children removed subdirectories and files
+   */
+  void retain(std::vector<Child> &&children);
+
+  /**
+   * Copy of children that snapshot sees
+   *
+   * @param directory directory of the copies
+   * @param version version of the snapshot
+   * @return the oldest changes newer than version, nullptr if directory
+   * wasn't changed after snapshot was taken
+   */
+  static const Frozen *frozenAt(const Directory *directory,
+                                std::uint64_t version);
+
+  /**
+   * Children of directory, as they were when snapshot was taken
+   *
+   * Directory that was changed after snapshot was taken is locked, while
+   * its changes are undone over its children.
+   *
+   * @param directory directory that is read
+   * @param version version of the snapshot
+   * @return subdirectories and files that snapshot sees
+   */
+  Listing snapshotChildren(Directory *directory, std::uint64_t version) const;
+
+  /**
+   * Subdirectories or files of changed directory, as snapshot sees them
+   *
+   * @param live subDirectories or files of the directory, that is locked
+   * @param removed children that were removed after the snapshot, with their
+   * slots
+   * @param added bits of children that were added after the snapshot, sorted
+   * @param children children that snapshot sees, in order of slots
+   */
+  template <typename T>
+  static void thawChildren(const ChildList<T> &live,
+                           std::vector<std::pair<std::size_t, T *>> &removed,
+                           const std::vector<std::uintptr_t> &added,
+                           std::vector<T *> &children);
+
+  /**
+   * Find directory in snapshot
+   *
+   * Path is resolved like in findDirectory, relative path from head, while
+   * children are searched in snapshotChildren.
+   *
+   * @param version version of the snapshot
+   * @param path name or path of the directory, head if empty
+   * @return ptr to directory, nullptr if there is no such directory
+   */
+  Directory *findSnapshot(std::uint64_t version, const std::string &path) const;
+
+  /**
+   * Implementation of Snapshot::list and Snapshot::listRecursive
+   *
+   * @param version version of the snapshot
+   * @param participant participant of the snapshot
+   * @param path name or path of the directory, head if empty
+   * @param recursive true if directories below directory are listed too
+   * @param out stream where directories are listed
+   */
+  void listSnapshot(std::uint64_t version,
+                    EpochManager::Participant &participant,
+                    const std::string &path, bool recursive,
+                    std::ostream &out) const;
+
+  /**
+   * Release snapshot
+   *
+   * Memory that only released snapshot could see is retired.
+   *
+   * @param version version of the snapshot
+   * @param participant participant of the snapshot
+   */
+  void releaseSnapshot(std::uint64_t version,
+                       EpochManager::Participant &participant);
+
+  /**
+   * Journal mutation
+   *
+   * Called while parent is locked, so mutations of the same directory are
+   * journaled in the order in which they are done.
+   *
+   * @param operation mutation of vfs structure or of data of the file
+   * @param parent directory that is changed, or parent of the file
+   * @param name name of the directory/file that is created, removed or
+   * written
+   * @param timeCreated time when directory/file was created, 0 for other
+   * operations
+   * @param offset offset of written data for write, new size of the file
+   * for truncate
+   * @param bytes written data for write
+   * @param size number of written bytes
+   * @return sequence number of the record, 0 if journal is not open
+   */
+  std::uint64_t record(Journal::Operation operation, const Directory *parent,
+                       const Name &name, std::int64_t timeCreated,
+                       std::uint64_t offset = 0, const char *bytes = nullptr,
+                       std::size_t size = 0);
+
+  /**
+   * Journal data of the file, that is created with it, as writes of its
+   * chunks
+   *
+   * @param parent parent of the file, it is locked
+   * @param file file that is created, not yet written by others
+   * @param sequence sequence number of the last record
+   * @param out output of the command, "Can't read file data" is printed if
+   * data can't be read from backing file
+   * @return sequence number of the last record
+   */
+  std::uint64_t recordData(const Directory *parent, const File *file,
+                           std::uint64_t sequence, std::ostream &out);
+
+  /**
+   * Journal directory with all its subdirectories and files
+   *
+   * Directories are journaled before their children, called while parent of
+   * directory is locked.
+   *
+   * @param directory directory that is created
+   * @param out output of the command, where data that can't be read is
+   * reported
+   * @return sequence number of the last record, 0 if journal is not open
+   */
+  std::uint64_t recordTree(const Directory *directory, std::ostream &out);
+
+  /**
+   * Absolute path of the directory/file
+   *
+   * @param parent parent of the directory/file
+   * @param name name of the directory/file
+   * @return absolute path, like /home/a/b
+   */
+  static std::string pathOf(const Directory *parent, const Name &name);
+
+  /**
+   * Build nameTree, if it is not built
+   *
+   * Mutations wait while all directories, and directories that are still in
+   * image, are visited and their names are added.
+   *
+   * @param participant participant of the command that builds it
+   */
+  void buildNameTree(EpochManager::Participant &participant) const;
+
+  /**
+   * Add directories and files to nameTree, if it is built
+   *
+   * Called while parent is locked, before directory with subtree is
+   * published, so nodes created in it later are added only once.
+   *
+   * @param parent parent of the child, locked
+   * @param child directory, with all its subdirectories and files, or file
+   */
+  void indexTree(Directory *parent, Child child);
+
+  /**
+   * Erase file from nameTree, if it is built
+   *
+   * Erased directories stay in nameTree until they are released, complete
+   * and locate skip them, see isLocated.
+   *
+   * @param parent parent of the file, locked
+   * @param file erased file
+   */
+  void unindexFile(Directory *parent, File *file);
+
+  /**
+   * Check if directory/file from nameTree is in vfs structure
+   *
+   * @param located directory/file, valid while nameTreeMutex is held
+   * @return false if it, or some directory above it, is erased
+   */
+  static bool isLocated(const Located &located);
+
+  /**
+   * Find file
+   *
+   * If there is no such file, "No such file" is printed, or "No such
+   * directory" if parent path doesn't lead to directory.
+   *
+   * @param context current directory, cache and output of command
+   * @param path name or path of the file
+   * @param parent parent directory of the file, set if file is found
+   * @return ptr to file, nullptr if there is no such file
+   */
+  File *findFile(const Context &context, const std::string &path,
+                 Directory *&parent) const;
+
+  /**
+   * Allocate chunk from chunkPool, with page from pagePool
+   *
+   * @return chunk, its bytes are not initialized
+   */
+  Chunk *allocateChunk() const;
+
+  /**
+   * Bytes of the chunk, decompressed if the chunk is compressed
+   *
+   * @param chunk chunk that reader can see
+   * @param buffer chunkSize bytes, where compressed chunk is decompressed, or
+   * spilled chunk is read
+   * @return bytes of page, or buffer, nullptr if backing file can't be read
+   */
+  const char *chunkBytes(const Chunk *chunk, char *buffer) const;
+
+  /**
+   * Decompress or read back chunk to new page, that is kept in hotChunks
+   *
+   * @param chunk compressed or spilled chunk that reader can see
+   * @return page of the chunk, installed by this or other reader, nullptr
+   * if backing file can't be read
+   */
+  const Page *restoreChunk(Chunk *chunk) const;
+
+  /**
+   * Read spilled chunk from spillFile, and decompress it if it is compressed
+   *
+   * @param chunk spilled chunk that reader can see
+   * @param destination chunkSize bytes where chunk is read
+   * @return false if backing file can't be read
+   */
+  bool readSpilled(const Chunk *chunk, char *destination) const;
+
+  /**
+   * Memory of chunks, pages that are not retired and compressed bytes
+   *
+   * @return number of bytes, chunkMutex is locked
+   */
+  std::uint64_t residentBytes() const;
+
+  /**
+   * Spill the least recently used chunks, until chunks take 7/8 of
+   * memoryLimit
+   *
+   * Chunks are taken from fronts of compressQueue and residentQueue, the
+   * older one first, so time the lock is held doesn't depend on number of
+   * chunks. Chunk that was read since it was queued, or is in hotChunks, is
+   * moved to the back once, like in hotChunks. Chunks are referenced while
+   * they are written to spillFile.
+   */
+  void spillChunks() const;
+
+  /**
+   * Put decompressed chunk to hotChunks, chunks that were not read since they
+   * were put to front, are released from back while there are more than
+   * hotLimit
+   *
+   * @param chunk compressed chunk with page
+   */
+  void addHot(Chunk *chunk) const;
+
+  /**
+   * Release pages when no reader can see them
+   *
+   * @param pages pages that are not in any chunk
+   */
+  void retirePages(std::vector<Page *> &&pages) const;
+
+  /**
+   * Release retired pages, called by EpochManager
+   *
+   * @param fileSystem VirtualFileSystem that owns pages
+   * @param pages vector of retired pages
+   */
+  static void releasePages(void *fileSystem, void *pages);
+
+  /**
+   * Thread of the compressor, calls compressIdle every half of compressAfter
+   */
+  void compress();
+
+  /**
+   * Write bytes to file
+   *
+   * Chunks are allocated up to the end of written bytes, chunks with bytes
+   * that readers can see are copied before they are changed.
+   *
+   * @param file file that is written, its parent is locked
+   * @param offset offset of the first written byte, at most size of file
+   * @param bytes written bytes, nullptr for zeros
+   * @param size number of written bytes
+   * @return false if chunk that is copied can't be read from backing file,
+   * chunks before it are written
+   */
+  bool writeData(File *file, std::uint64_t offset, const char *bytes,
+                 std::size_t size) const;
+
+  /**
+   * Change size of the file
+   *
+   * File that is shorter is extended with zeros. Otherwise new table is
+   * published without chunks after size, and with copy of the last chunk,
+   * if size is not multiple of chunkSize.
+   *
+   * @param file file that is truncated, its parent is locked
+   * @param size new size of the file
+   * @return false if the last chunk can't be read from backing file, file is
+   * not changed
+   */
+  bool truncateData(File *file, std::uint64_t size);
+
+  /**
+   * Copy data of the file, as it is when it is read
+   *
+   * @param source file that is copied, read in epoch
+   * @param copy copy of the file, not yet published
+   */
+  void copyData(const File *source, File *copy) const;
+
+  /**
+   * Visit data of the file, chunk by chunk, without restoring chunks to
+   * pages
+   *
+   * @param file file that is read in epoch
+   * @param visit called with bytes of every chunk, returns false to stop
+   * @return false if visit stopped, or chunk can't be read from backing
+   * file
+   */
+  bool visitData(const File *file, const ReadVisitor &visit) const;
+
+  /**
+   * Take chunk for write in place
+   *
+   * Chunk that is shared by other files is not written in place, chunk that
+   * is not shared is taken out of dedupIndex, so no file starts to share it
+   * while it is written.
+   *
+   * @param chunk chunk of the file, its parent is locked
+   * @return false if chunk is shared, and must be copied
+   */
+  bool ownChunk(Chunk *chunk) const;
+
+  /**
+   * Share chunk of the file with the same chunk of other file
+   *
+   * Hash of the chunk is looked up in dedupIndex, if chunk with the same
+   * bytes is found, it replaces chunk in the table, otherwise chunk is
+   * added to dedupIndex. Only bytes that were added since the chunk was
+   * hashed last time are hashed. Chunks with the same hash are referenced
+   * while their bytes are compared, without chunkMutex.
+   *
+   * @param data table of the file, its parent is locked
+   * @param index index of the chunk in table, chunk is owned by the file
+   * @param length number of bytes of the chunk below size of the file
+   * @param replaced chunk of the file is added, if it is replaced
+   */
+  void deduplicate(FileData *data, std::size_t index, std::size_t length,
+                   std::vector<Chunk *> &replaced) const;
+
+  /**
+   * Put chunk to the end of the queue
+   *
+   * @param chunk chunk that is in no queue, chunkMutex is locked
+   * @param queue compressQueue or residentQueue
+   * @param since time when chunk was written or was idle from
+   */
+  void queueChunk(Chunk *chunk, std::list<Chunk *> &queue,
+                  std::int64_t since) const;
+
+  /**
+   * Take chunk out of its queue, if it is in one
+   *
+   * @param chunk chunk, chunkMutex is locked
+   */
+  void dequeueChunk(Chunk *chunk) const;
+
+  /**
+   * Add chunk to dedupIndex, and to the end of compressQueue
+   *
+   * @param chunk chunk that is not shared, chunkMutex is locked
+   * @param length number of bytes of the chunk below size of the file
+   * @param hash xxHash64 of length bytes
+   * @param now time when the chunk was written
+   */
+  void indexChunk(Chunk *chunk, std::size_t length, std::uint64_t hash,
+                  std::int64_t now) const;
+
+  /**
+   * Take chunk out of dedupIndex, and out of its queue
+   *
+   * @param chunk chunk, chunkMutex is locked
+   */
+  void unindexChunk(Chunk *chunk) const;
+
+  /**
+   * Release reference of the chunk, chunk is released with the last one
+   *
+   * @param chunk chunk, chunkMutex is locked
+   */
+  void releaseChunk(Chunk *chunk) const;
+
+  /**
+   * Release data of the file, when no reader can see it
+   *
+   * @param file erased file
+   */
+  void releaseData(File *file);
+
+  /**
+   * Create table of chunks, allocated from nodeMemory
+   *
+   * @param capacity number of chunks that table can hold
+   * @return table without chunks
+   */
+  FileData *createData(std::size_t capacity) const;
+
+  /**
+   * Release table of chunks, chunks are not released
+   *
+   * @param memory arena where table was allocated
+   * @param data table created by createData, can be nullptr
+   */
+  static void destroyData(BlockArena &memory, FileData *data);
+
+  /**
+   * Retire table of chunks, it is released when no reader can see it
+   *
+   * @param data replaced table
+   */
+  void retireData(FileData *data) const;
+
+  /**
+   * Create sorted children, allocated from nodeMemory
+   *
+   * @param changes changes of the directory when children are sorted
+   * @param size number of children
+   * @return sorted children, with empty children
+   */
+  Sorted *createSorted(std::uint64_t changes, std::size_t size) const;
+
+  /**
+   * Release sorted children
+   *
+   * @param memory arena where sorted children were allocated
+   * @param sorted children created by createSorted, can be nullptr
+   */
+  static void destroySorted(BlockArena &memory, Sorted *sorted);
+
+  /**
+   * Retire sorted children, they are released when no reader can see them
+   *
+   * @param sorted replaced sorted children
+   */
+  void retireSorted(Sorted *sorted) const;
+
+  /**
+   * Retire chunks that were replaced or cut off, their references are
+   * released when no reader can see them
+   *
+   * @param chunks replaced chunks
+   */
+  void retireChunks(std::vector<Chunk *> &&chunks) const;
+
+  /**
+   * Release retired chunks, called by EpochManager
+   *
+   * @param fileSystem VirtualFileSystem that owns chunks
+   * @param chunks vector of retired chunks
+   */
+  static void releaseChunks(void *fileSystem, void *chunks);
+
+  /**
+   * Copy subdirectories and files of the directory, with workers
+   *
+   * @param source directory that is copied
+   * @param copy copy of the directory, not yet published
+   */
+  void copyTree(Directory *source, Directory *copy);
+
+  /**
+   * Wait until mutation is durable
+   *
+   * If journal can't be written, "Can't write journal" is printed.
+   *
+   * @param sequence sequence number of the record, 0 if it is not journaled
+   * @param out stream where error is written
+   */
+  void waitDurable(std::uint64_t sequence, std::ostream &out);
+
+  /**
+   * Release all directories and files at once
+   *
+   * Slabs of the pools, nodeMemory and interned names are released without
+   * visiting nodes, called when no command runs and nothing is retired.
+   */
+  void releaseNodes();
+
+  /**
+   * Release erased directory with all its subdirectories and files, called
+   * by EpochManager
+   *
+   * No reader can see the subtree, so it is visited without locks, by
+   * workers. Nodes are destroyed in bounded batches, lock of the pools is
+   * released between batches.
+   *
+   * @param fileSystem VirtualFileSystem that owns directory
+   * @param directory erased directory
+   */
+  static void releaseDirectory(void *fileSystem, void *directory);
+
+  /**
+   * Release erased file, called by EpochManager
+   *
+   * @param fileSystem VirtualFileSystem that owns file
+   * @param file erased file
+   */
+  static void releaseFile(void *fileSystem, void *file);
+
+  /**
+   * Release erased children, retired as one batch, called by EpochManager
+   *
+   * @param fileSystem VirtualFileSystem that owns children
+   * @param children vector of erased subdirectories and files
+   */
+  static void releaseChildren(void *fileSystem, void *children);
+
+  /**
+   * Implementation of makeDirectory, for current directory of VirtualFileSystem
+   * or of Session
+   *
+   * @param context current directory, cache and output of command
+   * @param nameDirectory name or path of the directory
+   * @param timeCreated time when directory was created, 0 for current time
+   */
+  void makeDirectory(const Context &context, const std::string &nameDirectory,
+                     std::int64_t timeCreated = 0);
+
+  /**
+   * Implementation of changeDirectory, for current directory of
+   * VirtualFileSystem or of Session
+   *
+   * @param context current directory, cache and output of command
+   * @param nameDirectory name or path of the directory
+   */
+  void changeDirectory(const Context &context,
+                       const std::string &nameDirectory);
+
+  /**
+   * Implementation of list, for current directory of VirtualFileSystem or of
+   * Session
+   *
+   * @param context current directory, cache and output of command
+   * @param path name or path of the directory, current directory if empty
+   */
+  void list(const Context &context, const std::string &path) const;
+
+  /**
+   * Implementation of ordered list, for current directory of
+   * VirtualFileSystem or of Session
+   *
+   * @param context current directory, cache and output of command
+   * @param path name or path of the directory, current directory if empty
+   * @param options order, limit and cursor of the listing
+   */
+  void list(const Context &context, const std::string &path,
+            const ListOptions &options) const;
+
+  /**
+   * Implementation of forEach, for current directory of VirtualFileSystem or
+   * of Session
+   *
+   * @param context current directory, cache and output of command
+   * @param path name or path of the directory, current directory if empty
+   * @param options order, limit and cursor of the listing
+   * @param visit function that visits listed children
+   * @return false if directory can't be listed
+   */
+  bool forEach(const Context &context, const std::string &path,
+               const ListOptions &options, const ListVisitor &visit) const;
+
+  /**
+   * Sorted children of directory
+   *
+   * Pages of unchanged directory share one sort. When directory is changed,
+   * its recent changes are sorted and merged with children that were sorted
+   * before, all children are sorted again only if changes are not logged.
+   *
+   * @param directory directory that is listed
+   * @param order Name or Time
+   * @return sorted children, valid while reader is in epoch
+   */
+  const Sorted *sortedChildren(Directory *directory, Order order) const;
+
+  /**
+   * Merge changes into sorted children
+   *
+   * Children that changes mention are dropped from sorted children, and
+   * children that the last change of them added are sorted and merged in.
+   *
+   * @param current children sorted before the changes
+   * @param order Name or Time
+   * @param changes changes after current, oldest first
+   * @param version changes of the directory after the last change
+   * @return new sorted children
+   */
+  Sorted *mergeSorted(const Sorted *current, Order order,
+                      std::vector<Change> &changes,
+                      std::uint64_t version) const;
+
+  /**
+   * Compare children in order
+   *
+   * @param lhs first child
+   * @param rhs second child
+   * @param order Name, or Time with name for equal times
+   * @return true if lhs is before rhs
+   */
+  static bool before(const Child &lhs, const Child &rhs, Order order);
+
+  /**
+   * Count change of the directory, and log added or removed children
+   *
+   * Children are logged only while directory has sorted children, that they
+   * can be merged into.
+   *
+   * @param directory changed directory, locked
+   * @param children first added or removed child
+   * @param count number of children
+   * @param added true if children were added, false if they were removed
+   */
+  void changed(Directory *directory, const Child *children, std::size_t count,
+               bool added);
+
+  /**
+   * Append change to recent changes of the directory, log grows when full
+   *
+   * @param directory changed directory, locked
+   * @param change appended change
+   */
+  void logChange(Directory *directory, const Change &change);
+
+  /**
+   * Release recent changes
+   *
+   * @param memory arena where log was allocated
+   * @param log changes created by logChange, can be nullptr
+   */
+  static void destroyLog(BlockArena &memory, ChangeLog *log);
+
+  /**
+   * Children of directory whose names match glob
+   *
+   * If glob starts with literal prefix, and directory has children sorted by
+   * name, or sorted is set, only children with the prefix are compared.
+   * Otherwise all children are compared.
+   *
+   * @param directory directory whose children are matched
+   * @param glob compiled pattern
+   * @param sorted if set, matches are sorted by name
+   * @param matches children that match, valid while reader is in epoch
+   */
+  void matchChildren(Directory *directory, const Glob &glob, bool sorted,
+                     std::vector<Child> &matches) const;
+
+  /**
+   * Remove all children of directory whose names match glob
+   *
+   * Children are unlinked from parent, that is locked, at once, every
+   * removed child is journaled.
+   *
+   * @param parent directory whose children are removed, locked
+   * @param glob compiled pattern
+   * @return sequence of the last journal record, 0 if nothing was journaled
+   */
+  std::uint64_t removeMatching(Directory *parent, const Glob &glob);
+
+  /**
+   * Implementation of remove, for current directory of VirtualFileSystem or of
+   * Session
+   *
+   * @param context current directory, cache and output of command
+   * @param name name or path of the directory/file that is to be erased
+   * @param expand if set, name with wildcards is matched as glob, journal is
+   * replayed without it
+   */
+  void remove(const Context &context, const std::string &name,
+              bool expand = true);
+
+  /**
+   * Implementation of makeFile, for current directory of VirtualFileSystem or
+   * of Session
+   *
+   * @param context current directory, cache and output of command
+   * @param nameFile name or path of the file
+   * @param timeCreated time when file was created, 0 for current time
+   */
+  void makeFile(const Context &context, const std::string &nameFile,
+                std::int64_t timeCreated = 0);
+
+  /**
+   * Implementation of copy, for current directory of VirtualFileSystem or of
+   * Session
+   *
+   * @param context current directory, cache and output of command
+   * @param source name or path of the directory/file that is copied
+   * @param destination name or path of the copy
+   */
+  void copy(const Context &context, const std::string &source,
+            const std::string &destination);
+
+  /**
+   * Implementation of diskUsage, for current directory of VirtualFileSystem
+   * or of Session
+   *
+   * @param context current directory, cache and output of command
+   * @param path name or path of the directory, current directory if empty
+   */
+  void diskUsage(const Context &context, const std::string &path) const;
+
+  /**
+   * Implementation of find, for current directory of VirtualFileSystem or of
+   * Session
+   *
+   * @param context current directory, cache and output of command
+   * @param path name or path of the directory, current directory if empty
+   * @param name name of the directories/files that are found
+   */
+  void find(const Context &context, const std::string &path,
+            const std::string &name) const;
+
+  /**
+   * Implementation of grep, for current directory of VirtualFileSystem or of
+   * Session
+   *
+   * @param context current directory, cache and output of command
+   * @param pattern string that is found in lines of files
+   * @param path name or path of the directory or file, current directory if
+   * empty
+   * @param visit function that visits lines with pattern
+   * @return false if there is no such directory or file, or data can't be
+   * read
+   */
+  bool grep(const Context &context, const std::string &pattern,
+            const std::string &path, const GrepVisitor &visit) const;
+
+  /**
+   * Find lines of the file that have pattern
+   *
+   * Chunks are scanned in place, in order of offsets. Pattern is found in
+   * every chunk with substring, and in bytes at the end of the previous
+   * chunk together with bytes at the start of the chunk, so occurrences
+   * that cross chunk boundary are found too. Newlines are counted only
+   * between occurrences. Line is visited when its end is scanned, once,
+   * with at most grepLineLimit of its first bytes.
+   *
+   * @param file file that is searched
+   * @param path absolute path of the file
+   * @param substring pattern that is found, without newline
+   * @param visit function that visits lines with pattern
+   * @param unreadable set if data of the file can't be read from backing
+   * file
+   * @return false if visit stopped search, or data can't be read
+   */
+  bool grepFile(const File *file, const std::string &path,
+                const Substring &substring, const GrepVisitor &visit,
+                std::atomic<bool> &unreadable) const;
+
+  /**
+   * Implementation of complete, for current directory of VirtualFileSystem
+   * or of Session
+   *
+   * @param context current directory, cache and output of command
+   * @param prefix beginning of the names
+   * @param limit maximal number of printed names
+   */
+  void complete(const Context &context, const std::string &prefix,
+                std::size_t limit) const;
+
+  /**
+   * Implementation of locate, for current directory of VirtualFileSystem or
+   * of Session
+   *
+   * @param context current directory, cache and output of command
+   * @param prefix beginning of the names
+   * @param limit maximal number of printed paths
+   */
+  void locate(const Context &context, const std::string &prefix,
+              std::size_t limit) const;
+
+  /**
+   * Implementation of write and append, for current directory of
+   * VirtualFileSystem or of Session
+   *
+   * @param context current directory, cache and output of command
+   * @param path name or path of the file
+   * @param offset offset of the first written byte
+   * @param data written bytes
+   * @param size number of written bytes
+   * @param append if set, bytes are written at the end of the file
+   * @return false if there is no such file, or its data can't be read
+   */
+  bool write(const Context &context, const std::string &path,
+             std::uint64_t offset, const char *data, std::size_t size,
+             bool append);
+
+  /**
+   * Implementation of truncate, for current directory of VirtualFileSystem
+   * or of Session
+   *
+   * @param context current directory, cache and output of command
+   * @param path name or path of the file
+   * @param size new size of the file
+   * @return false if there is no such file, or its data can't be read
+   */
+  bool truncate(const Context &context, const std::string &path,
+                std::uint64_t size);
+
+  /**
+   * Implementation of read, for current directory of VirtualFileSystem or
+   * of Session
+   *
+   * @param context current directory, cache and output of command
+   * @param path name or path of the file
+   * @param offset offset of the first read byte
+   * @param size maximal number of read bytes
+   * @param visit function that visits read data
+   * @return false if there is no such file, or its data can't be read
+   */
+  bool read(const Context &context, const std::string &path,
+            std::uint64_t offset, std::uint64_t size,
+            const ReadVisitor &visit) const;
+
+public:
+  /// Number of names that complete prints, if limit is not given
+  static constexpr std::size_t completeLimit = 32;
+
+  /// Number of paths that locate prints, if limit is not given
+  static constexpr std::size_t locateLimit = 100;
+
+  /// Number of the first bytes of the line that grep visits
+  static constexpr std::size_t grepLineLimit = 256;
+
+  /**
+   * Sizes of file data
+   *
+   * @param logicalBytes sum of sizes of all files
+   * @param physicalBytes memory of chunks, chunk that is shared by many
+   * files is counted once, compressed chunk is counted with its compressed
+   * size, spilled chunk is not counted
+   * @param chunks number of chunks
+   */
+  struct DedupStats {
+    std::uint64_t logicalBytes;
+    std::uint64_t physicalBytes;
+    std::size_t chunks;
+  };
+
+  /**
+   * Counters of deferred reclamation
+   *
+   * @param pending retired directories, files, name index tables and child
+   * arrays, that are not yet released
+   * @param releasedDirectories directories released since construction
+   * @param releasedFiles files released since construction
+   */
+  struct ReclaimCounters {
+    std::size_t pending;
+    std::uint64_t releasedDirectories;
+    std::uint64_t releasedFiles;
+  };
+
+  /**
+   * Constructor of VirtualFileSystem
+   *
+   * Directory home is created, that represents top of the directory in vfs,
+   * and background reclaimer is started.
+   *
+   * @param threads number of threads that visit subtrees of recursive
+   * commands, 0 for number of hardware threads
+   */
+  explicit VirtualFileSystem(std::size_t threads = 0);
+
+  /**
+   * Destructor of VirtualFileSystem
+   *
+   * All files and subdirectories are removed from vfs, when directoryPool and
+   * filePool release their slabs, without walking the vfs structure
+   */
+  ~VirtualFileSystem();
+
+  /// Disabling construction of VirtualFileSystem object using copy constructor
+  VirtualFileSystem(const VirtualFileSystem &rhs) = delete;
+
+  /// Disabling construction of VirtualFileSystem object using copy assignment
+  VirtualFileSystem &operator=(const VirtualFileSystem &rhs) = delete;
+
+  /**
+   * Ptr to directory that tracks directory above current directory.
+   */
+  Directory *head = nullptr;
+
+  /**
+   * Ptr to directory that tracks current directory.
+   */
+  DirectoryPointer currentDirectory{};
+
+  /**
+   * Creates directory
+   *
+   * Creates directory with nameDirectory name and sets it parentDirectory to
+   * currentDirectory, while currentDirectory is pointing to subDirectoris that
+   * has newly created directory. If nameDirectory is a path, like a/b or
+   * /home/a/b, directory is created in directory that path leads to, if no
+   * such directory exist, "No such directory" is printed. If directory or file
+   * with the same name already exists, "Directory or file already exists" is
+   * printed.
+   *
+   * @param nameDirectory name or path of the directory
+   */
+  void makeDirectory(const std::string &nameDirectory);
+
+  /**
+   * Change directory
+   *
+   * Change directory, which moves pointer to currentDirectory. If no
+   * nameDirectory is given, currentDirectory points to head directory, which is
+   * Home directory. If nameDirectory is .. , currentDirectory points to
+   * parentDirectory, or stays in head, that has no parentDirectory. If other
+   * name is given, directory is checked for subdirectoris and if nameDirectory
+   * matches the name of one of the subDirectoris, currentDirectory is set to
+   * that subdirectory. Paths with multiple components, absolute like /home/a/b
+   * or relative like ../a/b, are resolved component by component. If no such
+   * directory exist, "No such directory" is printed.
+   *
+   * @param nameDirectory name or path of the directory
+   */
+  void changeDirectory(const std::string &nameDirectory);
+
+  /**
+   * List in directory
+   *
+   * List all subdirectoris and files in currentDirectory. Subdirectoris have
+   * d------ extension, while files f------, after which timeCreated and
+   * names of direcories and files are written.
+   *
+   */
+  void list() const;
+
+  /**
+   * List in directory
+   *
+   * List all subdirectoris and files in directory that path leads to, if no
+   * such directory exist, "No such directory" is printed. If the last name
+   * of the path has wildcards, *, ? or [...], subdirectories and files whose
+   * names match it are listed sorted by name, if none matches, "No such
+   * directory or file" is printed.
+   *
+   * @param path name or path of the directory, or glob
+   */
+  void list(const std::string &path) const;
+
+  /**
+   * Ordered and paginated list in directory
+   *
+   * Children are listed in order of options, at most limit of them, after
+   * the cursor. Sorted children are kept until directory is changed, so page
+   * is found with binary search, in O(log n + limit). If there are more
+   * children after the page, "Next page: --after cursor" is printed. If no
+   * such directory exist, "No such directory" is printed, if cursor is not
+   * valid, "Invalid cursor".
+   *
+   * @param path name or path of the directory, current directory if empty
+   * @param options order, limit and cursor of the listing
+   */
+  void list(const std::string &path, const ListOptions &options) const;
+
+  /**
+   * Visits children of directory
+   *
+   * Children are visited like they are listed with options, names are not
+   * copied, visit is called while command runs in epoch. If no such
+   * directory exist, "No such directory" is printed, if cursor is not valid,
+   * "Invalid cursor".
+   *
+   * @param path name or path of the directory, current directory if empty
+   * @param options order, limit and cursor of the listing
+   * @param visit function that visits listed children, returns false to stop
+   * @return false if directory can't be listed
+   */
+  bool forEach(const std::string &path, const ListOptions &options,
+               const ListVisitor &visit) const;
+
+  /**
+   * Remove in directory
+   *
+   * Checks if the name is the same as some subdirectory or file, if yes,
+   * then this subdirectory or file is erased. Name is looked up in the name
+   * index of currentDirectory, so there is no scan of subdirectories and
+   * files. If name is a path, directory/file is erased from directory that
+   * path leads to. Directory is erased with all its subdirectories and
+   * files, like rm -r, remove only unlinks it and the subtree is released by
+   * background reclaimer. If currentDirectory is inside erased directory,
+   * currentDirectory is moved to parent of erased directory. If the last
+   * name of the path has wildcards, all subdirectories and files whose names
+   * match it are erased at once, see Glob.
+   *
+   * @param name name or path of the directory/file that is to be erased, or
+   * glob
+   */
+  void remove(const std::string &name);
+
+  /**
+   * Creates file
+   *
+   * Creates file with nameFile name and sets it currentDirectory. If nameFile
+   * is a path, file is created in directory that path leads to, if no such
+   * directory exist, "No such directory" is printed. If directory or file
+   * with the same name already exists, "Directory or file already exists" is
+   * printed.
+   *
+   * @param nameFile name or path of the file
+   */
+  void makeFile(const std::string &nameFile);
+
+  /**
+   * Copies directory or file
+   *
+   * Directory is copied with all its subdirectories and files, like cp -r,
+   * copy is built by workers and then added to parent of destination, so
+   * nobody sees partial copy. Copy can be made inside the source directory.
+   * If there is no such source, "No such directory or file" is printed. If
+   * parent of destination doesn't exist, "No such directory" is printed, if
+   * destination already exists, "Directory or file already exists".
+   *
+   * @param source name or path of the directory/file that is copied
+   * @param destination name or path of the copy
+   */
+  void copy(const std::string &source, const std::string &destination);
+
+  /**
+   * Disk usage of directory
+   *
+   * Counts all directories and files below directory, with workers, and
+   * prints "N directories, M files". If no such directory exist, "No such
+   * directory" is printed.
+   *
+   * @param path name or path of the directory, current directory if empty
+   */
+  void diskUsage(const std::string &path = std::string()) const;
+
+  /**
+   * Find directories and files by name
+   *
+   * Directories and files below directory, that have the name, are found by
+   * workers and their absolute paths are printed in sorted order, one per
+   * line. Name can have wildcards, it is compiled once and matched with
+   * every name below directory. If no such directory exist, "No such
+   * directory" is printed.
+   *
+   * @param path name or path of the directory, current directory if empty
+   * @param name name, or glob, of the directories/files that are found
+   */
+  void find(const std::string &path, const std::string &name) const;
+
+  /**
+   * Find lines of files that have pattern
+   *
+   * Files below directory are searched by workers, that split its subtree
+   * between them, and lines are visited as soon as they are found, so the
+   * first lines are visited before search ends. Lines of one file are
+   * visited in order, lines of different files in any order. Pattern is
+   * plain string, lines that have it are visited, once, with at most
+   * grepLineLimit of their first bytes. Pattern with newline matches no
+   * line. Path can be a file too, then only the file is searched. If no
+   * such directory or file exist, "No such directory or file" is printed,
+   * if data can't be read from backing file, "Can't read file data", once,
+   * and search stops.
+   *
+   * @param pattern string that is found in lines of files
+   * @param path name or path of the directory or file, current directory if
+   * empty
+   * @param visit function that visits lines with pattern, called from
+   * workers, one at a time
+   * @return false if there is no such directory or file, or data can't be
+   * read
+   */
+  bool grep(const std::string &pattern, const std::string &path,
+            const GrepVisitor &visit) const;
+
+  /**
+   * Print lines of files that have pattern
+   *
+   * Lines are found like in grep with visitor, and printed as path:line:text
+   * as soon as they are found.
+   *
+   * @param pattern string that is found in lines of files
+   * @param path name or path of the directory or file, current directory if
+   * empty
+   */
+  void grep(const std::string &pattern,
+            const std::string &path = std::string()) const;
+
+  /**
+   * Complete name
+   *
+   * Distinct names of directories and files, anywhere in vfs, that start
+   * with prefix are printed in sorted order, one per line. If there are
+   * more than limit of them, "..." is printed after the first limit names.
+   * Names are found in radix tree of all names, that is built by the first
+   * complete or locate and then kept up to date by mutations, so names are
+   * printed in time that depends on their number, not on size of vfs.
+   *
+   * @param prefix beginning of the names
+   * @param limit maximal number of printed names
+   */
+  void complete(const std::string &prefix,
+                std::size_t limit = completeLimit) const;
+
+  /**
+   * Locate directories and files by prefix of the name
+   *
+   * Absolute paths of directories and files, anywhere in vfs, whose names
+   * start with prefix are printed, ordered by name, one per line. If there
+   * are more than limit of them, "..." is printed after the first limit
+   * paths, if there is none, "No such directory or file". Names are found
+   * like in complete.
+   *
+   * @param prefix beginning of the names
+   * @param limit maximal number of printed paths
+   */
+  void locate(const std::string &prefix,
+              std::size_t limit = locateLimit) const;
+
+  /**
+   * Write data to file
+   *
+   * Bytes are written at offset, file is extended if they end after it, and
+   * if offset is after the end of file, gap is filled with zeros. Data is
+   * stored in chunks of chunkSize bytes from pool, so write changes only
+   * chunks it writes, chunks that readers can see are copied first, and
+   * readers see either old or new bytes of every chunk. If there is no such
+   * file, "No such file" is printed, if chunk that is copied can't be read
+   * from backing file, "Can't read file data".
+   *
+   * @param path name or path of the file
+   * @param offset offset of the first written byte
+   * @param data written bytes
+   * @param size number of written bytes
+   * @return false if there is no such file, or its data can't be read
+   */
+  bool write(const std::string &path, std::uint64_t offset, const char *data,
+             std::size_t size);
+
+  /**
+   * Append data to file
+   *
+   * Like write, at the end of the file. Bytes after the end are not visible
+   * to readers, so they are written in place, without copying chunks.
+   *
+   * @param path name or path of the file
+   * @param data written bytes
+   * @param size number of written bytes
+   * @return false if there is no such file, or its data can't be read
+   */
+  bool append(const std::string &path, const char *data, std::size_t size);
+
+  /**
+   * Truncate file
+   *
+   * File is cut to size, or extended with zeros. Chunks after size are
+   * released when no reader can see them. If there is no such file, "No
+   * such file" is printed, if the last chunk can't be read from backing
+   * file, "Can't read file data".
+   *
+   * @param path name or path of the file
+   * @param size new size of the file
+   * @return false if there is no such file, or its data can't be read
+   */
+  bool truncate(const std::string &path, std::uint64_t size);
+
+  /**
+   * Read data of file
+   *
+   * At most size bytes from offset are visited, in parts that are views of
+   * chunks, without copying them. Part is valid only while it is visited,
+   * visit is called while command runs in epoch. Every part is found in
+   * O(1), by its offset. If there is no such file, "No such file" is
+   * printed, if chunk can't be read from backing file, "Can't read file
+   * data" and read stops.
+   *
+   * @param path name or path of the file
+   * @param offset offset of the first read byte
+   * @param size maximal number of read bytes
+   * @param visit function that visits read data, returns false to stop
+   * @return false if there is no such file, or its data can't be read
+   */
+  bool read(const std::string &path, std::uint64_t offset, std::uint64_t size,
+            const ReadVisitor &visit) const;
+
+  /**
+   * Print data of file
+   *
+   * @param path name or path of the file
+   */
+  void cat(const std::string &path) const;
+
+  /**
+   * Sizes of file data
+   *
+   * Chunks are released first, calling drain, so they are not counted, if
+   * no command runs. Ratio of logical and physical size is saving of
+   * deduplication.
+   *
+   * @return logical and physical size of file data
+   */
+  DedupStats dedupStats() const;
+
+  /**
+   * Compress chunks of file data that are not used
+   *
+   * Background thread compresses chunks that were not read or written for
+   * idle, with lzCompress, and releases their uncompressed bytes. Reader of
+   * compressed chunk decompresses it and keeps it decompressed in LRU of
+   * hotChunks chunks, so chunks that are used are not decompressed again.
+   * Chunks that are used are never compressed, so reads of them are as fast
+   * as without compression.
+   *
+   * @param idle time after which chunk is compressed, 0 stops compression
+   * @param hotChunks number of decompressed chunks that are kept
+   */
+  void setCompression(std::chrono::milliseconds idle,
+                      std::size_t hotChunks = 64);
+
+  /**
+   * Compress chunks that were not used for idle time, set by setCompression
+   *
+   * Called by background thread, ex. tests call it to compress at once.
+   * Decompressed chunks that were not used for idle time are released from
+   * LRU too.
+   *
+   * @return number of compressed chunks
+   */
+  std::size_t compressIdle();
+
+  /**
+   * Limit memory of file data
+   *
+   * When chunks of file data take more than limit, the least recently used
+   * chunks are written to backing file with pwrite, and their memory is
+   * released, until they take 7/8 of limit. Writer that allocates chunk over
+   * limit spills them, so memory stays within limit while data is written.
+   * Reader of spilled chunk reads it back with pread, and keeps it in LRU of
+   * decompressed chunks, set by setCompression, that holds at most quarter
+   * of limit. Directories, files and tables of chunks always stay in memory.
+   *
+   * @param limit memory of chunks, in bytes, 0 for no limit
+   * @param backingPath path of backing file, that is created when limit is
+   * set for the first time, and removed at once, so only VirtualFileSystem
+   * sees it
+   * @return false if backing file can't be created
+   */
+  bool setMemoryLimit(std::uint64_t limit, const std::string &backingPath);
+
+  /**
+   * Number of chunks of file data
+   *
+   * Erased files and replaced chunks are released first, calling drain, so
+   * they are not counted, if no command runs.
+   *
+   * @return number of chunks in memory
+   */
+  std::size_t dataChunks() const;
+
+  /**
+   * Waits until erased directories and files are released
+   *
+   * Called when no command runs, ex. in tests and before shutdown, commands
+   * that run delay it.
+   */
+  void drain() const;
+
+  /**
+   * Counters of deferred reclamation
+   *
+   * @return pending and released counters
+   */
+  ReclaimCounters reclaimCounters() const;
+
+  /**
+   * Statistics of operations
+   *
+   * Counters and latency histograms of all sessions are merged, nodes and
+   * the largest number of children of directory are added. Empty if
+   * statistics are compiled out with VFS_STATS 0.
+   *
+   * @return merged statistics
+   */
+  Stats::Snapshot stats() const;
+
+  /**
+   * Number of directories and files in memory
+   *
+   * Erased directories and files are released first, calling drain, so they
+   * are not counted, if no command runs.
+   *
+   * @return number of directories and files
+   */
+  std::size_t nodeCount() const;
+
+  /**
+   * Number of interned names, names longer than Name::inlineCapacity
+   *
+   * Names are released with the last directory/file that has them, so
+   * erased ones are released first, calling drain, if no command runs.
+   *
+   * @return number of distinct long names
+   */
+  std::size_t internedNames() const;
+
+  /**
+   * Saves vfs structure to image
+   *
+   * Image is node table, in breadth first order, and string heap with names
+   * and data of files, that load maps without reading it. Directories that
+   * are still in image are copied from image, without copying them in
+   * memory. If image can't be written, "Can't save image" is printed.
+   *
+   * @param path path of the image file
+   * @return false if image can't be written
+   */
+  bool save(const std::string &path) const;
+
+  /**
+   * Loads vfs structure from image
+   *
+   * Image is mapped read only and current vfs structure is released, head is
+   * root of the image, while directories, with data of their files, are
+   * copied in memory only when they are visited by command, so load doesn't
+   * depend on the size of the image.
+   * No command, of VirtualFileSystem or of Session, can run and no snapshot
+   * can exist while image is loaded. If image can't be mapped, "Can't load
+   * image" is printed and vfs structure is not changed.
+   *
+   * @param path path of the image file
+   * @return false if image can't be mapped
+   */
+  bool load(const std::string &path);
+
+  /**
+   * Recovers vfs structure and opens journal
+   *
+   * Image is loaded, if it exists, and journal records, that are not in
+   * image, are replayed over it. Journal is then opened, so every
+   * makeDirectory, makeFile, remove, copy, write, append and truncate, is
+   * durable when it returns. Copied files are journaled with their data.
+   * Mutations that are synced together, group commit, share one fdatasync.
+   * No command can run while vfs structure is recovered. If image can't be
+   * loaded, "Can't load image" is printed, if journal can't be opened,
+   * "Can't open journal".
+   *
+   * @param imagePath path of the image file, last checkpoint
+   * @param journalPath path of the journal file
+   * @param commitDelay time that journal waits for more mutations before it
+   * syncs them, longer delay syncs more mutations at once
+   * @return false if vfs structure can't be recovered
+   */
+  bool recover(const std::string &imagePath, const std::string &journalPath,
+               std::chrono::microseconds commitDelay =
+                   std::chrono::microseconds(0));
+
+  /**
+   * Folds journal in new checkpoint
+   *
+   * Mutations wait while vfs structure is saved to image, then journal is
+   * emptied. Records that are in image are skipped by recover, so crash
+   * between saving the image and emptying the journal doesn't replay them
+   * twice. If there is no journal, "No journal" is printed.
+   *
+   * @param imagePath path of the image file
+   * @return false if checkpoint can't be written
+   */
+  bool checkpoint(const std::string &imagePath);
+
+  /**
+   * Syncs journal and closes it, mutations are not journaled after that
+   */
+  void closeJournal();
+
+  /**
+   * Takes snapshot of vfs structure
+   *
+   * Snapshot is taken between mutations, in O(1), nothing is copied. Later
+   * makeDirectory, makeFile and remove keep copy of children of directory
+   * they change, and erased directories and files, while snapshot can see
+   * them.
+   *
+   * @param out stream where snapshot lists directories and writes errors
+   * @return snapshot, it is released when it is destroyed
+   */
+  Snapshot snapshot(std::ostream &out = std::cout);
 };
 } // namespace vfs
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vfs {
+
+/**
+ * Implementation of the WorkStealingPool class.
+ *
+ * WorkStealingPool visits tree of items, like subtree of directories, with
+ * many threads, without recursion. Every worker has its own deque of items,
+ * children of visited item are pushed to deque of the worker that visited it
+ * and worker takes the last pushed item, so it goes depth first and deque is
+ * explicit stack. Worker without items steals the first item of other
+ * worker, that is the biggest subtree it has not yet visited, so work of
+ * wide trees is split between workers.
+ *
+ * Thread that calls run is worker too, other threads are started on first
+ * run. One tree is visited at a time, run that is called while pool visits
+ * other tree visits its tree in calling thread.
+ *
+ */
+class WorkStealingPool {
+public:
+  /**
+   * Function that visits item
+   *
+   * @param item visited item
+   * @param worker index of the worker, less than size
+   * @param children children of item that are visited after it
+   */
+  using Visit = std::function<void(void *item, std::size_t worker,
+                                   std::vector<void *> &children)>;
+
+  /**
+   * Constructor of WorkStealingPool
+   *
+   * @param workers number of workers, with thread that calls run, 0 for
+   * number of hardware threads
+   */
+  explicit WorkStealingPool(std::size_t workers = 0);
+
+  /**
+   * Destructor of WorkStealingPool
+   *
+   * Threads are stopped.
+   */
+  ~WorkStealingPool();
+
+  /// Disabling construction of WorkStealingPool object using copy constructor
+  WorkStealingPool(const WorkStealingPool &rhs) = delete;
+
+  /// Disabling construction of WorkStealingPool object using copy assignment
+  WorkStealingPool &operator=(const WorkStealingPool &rhs) = delete;
+
+  /**
+   * Number of workers
+   *
+   * @return number of workers, with thread that calls run
+   */
+  std::size_t size() const { return count; }
+
+  /**
+   * Visits root and all its descendants
+   *
+   * Returns when all items are visited.
+   *
+   * @param root first visited item
+   * @param visit function that visits item, called from many threads
+   */
+  void run(void *root, const Visit &visit);
+
+private:
+  /**
+   * Deque of items of the worker
+   *
+   * @param items items that are not yet visited
+   * @param mutex guards items, worker takes from back, thieves from front
+   */
+  struct Worker {
+    std::deque<void *> items{};
+    std::mutex mutex{};
+  };
+
+  /// Number of workers
+  std::size_t count;
+
+  /// Deques of workers, worker 0 is thread that calls run
+  std::vector<std::unique_ptr<Worker>> workers{};
+
+  /// Threads of workers 1 to count - 1, started on first run
+  std::vector<std::thread> threads{};
+
+  /// Function that visits items of current tree
+  const Visit *visit = nullptr;
+
+  /// Items that are pushed and not yet visited
+  std::atomic<std::size_t> pending{0};
+
+  /// Incremented when tree is visited, threads wait for the next one
+  std::uint64_t job = 0;
+
+  /// Threads that work on current tree
+  std::size_t active = 0;
+
+  /// Set when threads should stop
+  bool stopping = false;
+
+  /// Guards visit, job, active and stopping
+  std::mutex mutex{};
+
+  /// Wakes threads, when tree is visited
+  std::condition_variable wake{};
+
+  /// Wakes run, when threads leave the tree
+  std::condition_variable done{};
+
+  /// Only one tree is visited at a time
+  std::mutex runMutex{};
+
+  /**
+   * Visits items until all items of tree are visited
+   *
+   * @param index index of the worker
+   * @param function function that visits item
+   */
+  void work(std::size_t index, const Visit &function);
+
+  /**
+   * Thread of the worker
+   *
+   * @param index index of the worker
+   */
+  void loop(std::size_t index);
+};
+} // namespace vfs
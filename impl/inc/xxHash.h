@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vfs {
+
+/**
+ * Returns xxHash64 of the data
+ *
+ * Fast non cryptographic hash, that reads 32 byte stripes in four
+ * independent lanes, so lanes are computed in parallel by CPU, and compiler
+ * can vectorize them. Data that is shorter than stripe is hashed by 8, 4 and
+ * then 1 byte. Hash is the same as hash of reference xxHash64 implementation,
+ * on little endian CPU.
+ *
+ * @param data first byte of the data
+ * @param size number of bytes
+ * @param seed seed of the hash
+ * @return hash of the data
+ */
+std::uint64_t xxHash64(const void *data, std::size_t size,
+                       std::uint64_t seed = 0);
+
+/**
+ * xxHash64 of data that grows at its end
+ *
+ * Lanes of the stripes that were hashed are kept, so hash of the grown data
+ * reads only the stripes that were appended since, and the bytes after the
+ * last stripe. Bytes that were hashed must not change.
+ */
+class AppendedHash {
+public:
+  /**
+   * Constructor of AppendedHash
+   *
+   * @param seed seed of the hash
+   */
+  explicit AppendedHash(std::uint64_t seed = 0);
+
+  /**
+   * Returns xxHash64 of the data, the same as xxHash64(data, size, seed)
+   *
+   * @param data first byte of the data, it starts with the data that was
+   * hashed before
+   * @param size number of bytes, not less than size of the data that was
+   * hashed before
+   * @return hash of the data
+   */
+  std::uint64_t hash(const void *data, std::size_t size);
+
+private:
+  /// lanes of the hashed stripes, the third one is the seed before them
+  std::uint64_t lanes[4];
+  /// number of bytes in hashed stripes
+  std::size_t hashed = 0;
+};
+} // namespace vfs
@@ -0,0 +1,101 @@
+#include "blockArena.h"
+#include <new>
+
+namespace vfs {
+
+constexpr std::size_t BlockArena::alignment;
+constexpr std::size_t BlockArena::regionSize;
+constexpr std::size_t BlockArena::largeSize;
+constexpr std::size_t BlockArena::classCount;
+
+void *BlockArena::allocate(std::size_t size) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (size > largeSize) {
+    void *memory = ::operator new(sizeof(Large) + size);
+    Large *block = new (memory) Large{nullptr, large, size};
+    if (large != nullptr)
+      large->previous = block;
+    large = block;
+    reserved += sizeof(Large) + size;
+    return block + 1;
+  }
+
+  const std::size_t sizeClass = classOf(size);
+  FreeBlock *free = freeLists[sizeClass];
+  if (free != nullptr) {
+    freeLists[sizeClass] = free->next;
+    return free;
+  }
+  const std::size_t bytes = classSize(sizeClass);
+  if (cursor == nullptr || static_cast<std::size_t>(limit - cursor) < bytes) {
+    // rest of the region is left unused, it is smaller than the block
+    cursor = static_cast<char *>(::operator new(regionSize));
+    limit = cursor + regionSize;
+    regions.push_back(cursor);
+    reserved += regionSize;
+  }
+  void *block = cursor;
+  cursor += bytes;
+  return block;
+}
+
+void BlockArena::deallocate(void *block, std::size_t size) {
+  if (block == nullptr)
+    return;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (size > largeSize) {
+    Large *header = static_cast<Large *>(block) - 1;
+    if (header->previous != nullptr)
+      header->previous->next = header->next;
+    else
+      large = header->next;
+    if (header->next != nullptr)
+      header->next->previous = header->previous;
+    reserved -= sizeof(Large) + header->size;
+    ::operator delete(header);
+    return;
+  }
+  const std::size_t sizeClass = classOf(size);
+  freeLists[sizeClass] = new (block) FreeBlock{freeLists[sizeClass]};
+}
+
+void BlockArena::release() {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto region : regions)
+    ::operator delete(region);
+  regions.clear();
+  while (large != nullptr) {
+    Large *next = large->next;
+    ::operator delete(large);
+    large = next;
+  }
+  freeLists.fill(nullptr);
+  cursor = nullptr;
+  limit = nullptr;
+  reserved = 0;
+}
+
+std::size_t BlockArena::bytes() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return reserved;
+}
+
+std::size_t BlockArena::classOf(std::size_t size) {
+  if (size <= 128)
+    return size == 0 ? 0 : (size - 1) / 16;
+  // size is in (2^power, 2^(power + 1)], split in 4 classes
+  std::size_t power = 7;
+  while ((std::size_t(2) << power) < size)
+    ++power;
+  return 8 + (power - 7) * 4 +
+         ((size - 1 - (std::size_t(1) << power)) >> (power - 2));
+}
+
+std::size_t BlockArena::classSize(std::size_t sizeClass) {
+  if (sizeClass < 8)
+    return (sizeClass + 1) * 16;
+  const std::size_t power = 7 + (sizeClass - 8) / 4;
+  const std::size_t step = (sizeClass - 8) % 4 + 1;
+  return (std::size_t(1) << power) + step * (std::size_t(1) << (power - 2));
+}
+} // namespace vfs
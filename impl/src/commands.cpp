@@ -1,9 +1,13 @@
 #include "commands.h"
-#include <sstream>
+#include <chrono>
+#include <cstdlib>
 
 namespace vfs {
 
-Commands::Commands() : vfs() {}
+Commands::Commands(Storage storage) : vfs() {
+  if (storage == Storage::Compact)
+    compact.reset(new CompactFileSystem(std::cout));
+}
 
 void Commands::command() {
   std::string input{};
@@ -20,66 +24,467 @@ void Commands::command() {
   } while (input != "q" && input != "Q");
 }
 
+std::size_t Commands::batch(std::istream &input, std::streambuf *output) {
+  std::streambuf *coutBuffer = std::cout.rdbuf(output);
+  std::ostream *tied = input.tie(nullptr); // no flush before every read
+  const auto start = std::chrono::steady_clock::now();
+
+  std::size_t executed = 0;
+  std::string line{};
+  while (getline(input, line) && line != "q" && line != "Q") {
+    parseInput(line);
+    ++executed;
+  }
+
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cout.flush();
+  std::cout.rdbuf(coutBuffer);
+  input.tie(tied);
+
+  std::cerr << "Executed " << executed << " commands in " << elapsed.count()
+            << " s";
+  if (elapsed.count() > 0)
+    std::cerr << ", " << static_cast<std::size_t>(executed / elapsed.count())
+              << " commands/s";
+  std::cerr << std::endl;
+  return executed;
+}
+
 void Commands::parseInput(const std::string &inputCommand) {
-  if (inputCommand.find(shellCommands.at(0)) != std::string::npos) { // mkdir
-    std::string nameDirectory = splitString(inputCommand, ' ');
-    if (nameDirectory.empty()) {
-      std::cout << "Invalid command" << std::endl;
-    }
-    makeDirectory(nameDirectory);
-  } else if (inputCommand.find(shellCommands.at(1)) !=
-             std::string::npos) { // cd
-    std::string nameDirectory = splitString(inputCommand, ' ');
-    changeDirectory(nameDirectory);
-  } else if (inputCommand.find(shellCommands.at(2)) !=
-             std::string::npos) { // ls
-    if (inputCommand.length() < 3) {
+  Tokenizer tokenizer(inputCommand);
+  Token token;
+  if (!tokenizer.next(token)) // empty input
+    return;
+
+  const ShellCommand command = findCommand(token);
+  switch (command) {
+  case ShellCommand::Mkdir:
+    if (!tokenizer.next(token)) {
+      std::cout << "Invalid command\n";
+      break;
+    }
+    do {
+      makeDirectory(toArgument(token));
+    } while (tokenizer.next(token));
+    break;
+  case ShellCommand::Cd:
+    if (!tokenizer.next(token)) {
+      argument.clear(); // cd  - goes to home directory
+      changeDirectory(argument);
+    } else {
+      toArgument(token);
+      if (tokenizer.next(token)) {
+        std::cout << "Invalid command\n";
+      } else {
+        changeDirectory(argument);
+      }
+    }
+    break;
+  case ShellCommand::Ls: {
+    if (!tokenizer.next(token)) {
       list();
+      break;
+    }
+    // ls [--sort name|time] [--limit N] [--after cursor] [paths]
+    VirtualFileSystem::ListOptions options;
+    bool ordered = false;
+    bool valid = true;
+    bool more = true;
+    while (more && token.size > 2 && token.data[0] == '-' &&
+           token.data[1] == '-') {
+      const Token option = token;
+      if (!tokenizer.next(token)) {
+        valid = false;
+        break;
+      }
+      toArgument(token);
+      if (option == "--sort" && token == "name") {
+        options.order = VirtualFileSystem::Order::Name;
+      } else if (option == "--sort" && token == "time") {
+        options.order = VirtualFileSystem::Order::Time;
+      } else if (option == "--limit") {
+        char *end = nullptr;
+        options.limit = std::strtoul(argument.c_str(), &end, 10);
+        valid = options.limit != 0 && *end == '\0';
+      } else if (option == "--after") {
+        options.after = argument;
+      } else {
+        valid = false;
+      }
+      if (!valid)
+        break;
+      ordered = true;
+      more = tokenizer.next(token);
+    }
+    if (!valid) {
+      std::cout << "Invalid command\n";
+    } else if (!more) {
+      list(std::string(), options);
     } else {
-      std::cout << "Invalid command" << std::endl;
-    }
-  } else if (inputCommand.find(shellCommands.at(3)) !=
-             std::string::npos) { // rm
-    std::string nameDirectory = splitString(inputCommand, ' ');
-    if (nameDirectory.empty()) {
-      std::cout << "Invalid command" << std::endl;
-    }
-    remove(nameDirectory);
-  } else if (inputCommand.find(shellCommands.at(4)) !=
-             std::string::npos) { // mkfile
-    std::string nameFile = splitString(inputCommand, ' ');
-    if (nameFile.empty()) {
-      std::cout << "Invalid command" << std::endl;
-    }
-    makeFile(nameFile);
+      do {
+        if (ordered)
+          list(toArgument(token), options);
+        else
+          list(toArgument(token));
+      } while (tokenizer.next(token));
+    }
+    break;
+  }
+  case ShellCommand::Rm:
+    // directories are always removed recursively, -r is accepted
+    if (!tokenizer.next(token) || (token == "-r" && !tokenizer.next(token))) {
+      std::cout << "Invalid command\n";
+      break;
+    }
+    do {
+      remove(toArgument(token));
+    } while (tokenizer.next(token));
+    break;
+  case ShellCommand::Mkfile:
+    if (!tokenizer.next(token)) {
+      std::cout << "Invalid command\n";
+      break;
+    }
+    do {
+      makeFile(toArgument(token));
+    } while (tokenizer.next(token));
+    break;
+  case ShellCommand::Save:
+  case ShellCommand::Load:
+  case ShellCommand::Complete:
+  case ShellCommand::Locate:
+    if (!tokenizer.next(token)) {
+      std::cout << "Invalid command\n";
+      break;
+    }
+    toArgument(token);
+    if (tokenizer.next(token)) {
+      std::cout << "Invalid command\n";
+    } else if (command == ShellCommand::Save) {
+      save(argument);
+    } else if (command == ShellCommand::Load) {
+      load(argument);
+    } else if (command == ShellCommand::Complete) {
+      complete(argument);
+    } else {
+      locate(argument);
+    }
+    break;
+  case ShellCommand::Cp: {
+    // directories are always copied recursively, -r is accepted
+    if (!tokenizer.next(token) || (token == "-r" && !tokenizer.next(token))) {
+      std::cout << "Invalid command\n";
+      break;
+    }
+    secondArgument.assign(token.data, token.size);
+    if (!tokenizer.next(token)) {
+      std::cout << "Invalid command\n";
+      break;
+    }
+    toArgument(token);
+    if (tokenizer.next(token))
+      std::cout << "Invalid command\n";
+    else
+      copy(secondArgument, argument);
+    break;
+  }
+  case ShellCommand::Du:
+    if (!tokenizer.next(token)) {
+      argument.clear(); // du  - current directory
+      diskUsage(argument);
+      break;
+    }
+    do {
+      diskUsage(toArgument(token));
+    } while (tokenizer.next(token));
+    break;
+  case ShellCommand::Find:
+    // find [path] -name name
+    secondArgument.clear();
+    if (tokenizer.next(token) && !(token == "-name")) {
+      secondArgument.assign(token.data, token.size);
+      tokenizer.next(token);
+    }
+    if (!(token == "-name") || !tokenizer.next(token)) {
+      std::cout << "Invalid command\n";
+      break;
+    }
+    toArgument(token);
+    if (tokenizer.next(token))
+      std::cout << "Invalid command\n";
+    else
+      find(secondArgument, argument);
+    break;
+  case ShellCommand::Cat:
+    if (!tokenizer.next(token)) {
+      std::cout << "Invalid command\n";
+      break;
+    }
+    do {
+      cat(toArgument(token));
+    } while (tokenizer.next(token));
+    break;
+  case ShellCommand::Write: {
+    // write [-a] file text, text is the rest of the line
+    bool valid = tokenizer.next(token);
+    const bool append = valid && token == "-a";
+    if (append)
+      valid = tokenizer.next(token);
+    if (!valid) {
+      std::cout << "Invalid command\n";
+      break;
+    }
+    toArgument(token);
+    secondArgument.clear();
+    if (tokenizer.rest(token))
+      secondArgument.assign(token.data, token.size);
+    secondArgument += '\n';
+    write(argument, secondArgument, append);
+    break;
+  }
+  case ShellCommand::Grep:
+    // grep [-r] pattern [path], search is always recursive
+    if (!tokenizer.next(token) || (token == "-r" && !tokenizer.next(token))) {
+      std::cout << "Invalid command\n";
+      break;
+    }
+    secondArgument.assign(token.data, token.size);
+    argument.clear();
+    if (tokenizer.next(token))
+      toArgument(token);
+    if (tokenizer.next(token))
+      std::cout << "Invalid command\n";
+    else
+      grep(secondArgument, argument);
+    break;
+  case ShellCommand::Stats:
+    if (tokenizer.next(token))
+      std::cout << "Invalid command\n";
+    else
+      stats();
+    break;
+  case ShellCommand::DedupStats:
+    if (tokenizer.next(token))
+      std::cout << "Invalid command\n";
+    else
+      dedupStats();
+    break;
+  case ShellCommand::Unknown:
+    break;
+  }
+}
+
+Commands::ShellCommand Commands::findCommand(const Token &token) {
+  switch (token.size) {
+  case 2:
+    if (token == "cd")
+      return ShellCommand::Cd;
+    if (token == "ls")
+      return ShellCommand::Ls;
+    if (token == "rm")
+      return ShellCommand::Rm;
+    if (token == "cp")
+      return ShellCommand::Cp;
+    if (token == "du")
+      return ShellCommand::Du;
+    break;
+  case 3:
+    if (token == "cat")
+      return ShellCommand::Cat;
+    break;
+  case 4:
+    if (token == "save")
+      return ShellCommand::Save;
+    if (token == "load")
+      return ShellCommand::Load;
+    if (token == "find")
+      return ShellCommand::Find;
+    if (token == "grep")
+      return ShellCommand::Grep;
+    break;
+  case 5:
+    if (token == "mkdir")
+      return ShellCommand::Mkdir;
+    if (token == "stats")
+      return ShellCommand::Stats;
+    if (token == "write")
+      return ShellCommand::Write;
+    break;
+  case 6:
+    if (token == "mkfile")
+      return ShellCommand::Mkfile;
+    if (token == "locate")
+      return ShellCommand::Locate;
+    break;
+  case 8:
+    if (token == "complete")
+      return ShellCommand::Complete;
+    break;
+  case 10:
+    if (token == "dedupstats")
+      return ShellCommand::DedupStats;
+    break;
   }
+  return ShellCommand::Unknown;
+}
+
+const std::string &Commands::toArgument(const Token &token) {
+  argument.assign(token.data, token.size);
+  return argument;
+}
+
+bool Commands::treeStorage() const {
+  if (compact == nullptr)
+    return true;
+  std::cout << "Not supported by compact storage\n";
+  return false;
 }
 
 void Commands::makeDirectory(const std::string &nameDirectory) {
-  vfs.makeDirectory(nameDirectory);
+  if (compact != nullptr)
+    compact->makeDirectory(nameDirectory);
+  else
+    vfs.makeDirectory(nameDirectory);
 }
 
 void Commands::changeDirectory(const std::string &nameDirectory) {
-  vfs.changeDirectory(nameDirectory);
+  if (compact != nullptr)
+    compact->changeDirectory(nameDirectory);
+  else
+    vfs.changeDirectory(nameDirectory);
+}
+
+void Commands::list() {
+  if (compact != nullptr)
+    compact->list();
+  else
+    vfs.list();
+}
+
+void Commands::list(const std::string &path) {
+  if (compact != nullptr)
+    compact->list(path);
+  else
+    vfs.list(path);
+}
+
+void Commands::list(const std::string &path,
+                    const VirtualFileSystem::ListOptions &options) {
+  if (treeStorage())
+    vfs.list(path, options);
+}
+
+void Commands::remove(const std::string &name) {
+  if (compact != nullptr)
+    compact->remove(name);
+  else
+    vfs.remove(name);
+}
+
+void Commands::makeFile(const std::string &nameFile) {
+  if (compact != nullptr)
+    compact->makeFile(nameFile);
+  else
+    vfs.makeFile(nameFile);
+}
+
+void Commands::save(const std::string &path) {
+  if (treeStorage())
+    vfs.save(path);
 }
 
-void Commands::list() { vfs.list(); }
+void Commands::load(const std::string &path) {
+  if (treeStorage())
+    vfs.load(path);
+}
+
+void Commands::copy(const std::string &source, const std::string &destination) {
+  if (treeStorage())
+    vfs.copy(source, destination);
+}
+
+void Commands::diskUsage(const std::string &path) {
+  if (compact != nullptr)
+    compact->diskUsage(path);
+  else
+    vfs.diskUsage(path);
+}
+
+void Commands::find(const std::string &path, const std::string &name) {
+  if (compact != nullptr)
+    compact->find(path, name);
+  else
+    vfs.find(path, name);
+}
+
+void Commands::complete(const std::string &prefix) {
+  if (treeStorage())
+    vfs.complete(prefix);
+}
+
+void Commands::locate(const std::string &prefix) {
+  if (treeStorage())
+    vfs.locate(prefix);
+}
 
-void Commands::remove(const std::string &name) { vfs.remove(name); }
+void Commands::grep(const std::string &pattern, const std::string &path) {
+  if (treeStorage())
+    vfs.grep(pattern, path);
+}
 
-void Commands::makeFile(const std::string &nameFile) { vfs.makeFile(nameFile); }
+void Commands::cat(const std::string &path) {
+  if (treeStorage())
+    vfs.cat(path);
+}
 
-std::string Commands::splitString(const std::string &stringToSplit,
-                                  char delimiter) {
-  std::string item;
-  std::stringstream ss(stringToSplit);
-  std::vector<std::string> splitItems;
+void Commands::write(const std::string &path, const std::string &text,
+                     bool append) {
+  if (!treeStorage())
+    return;
+  if (append)
+    vfs.append(path, text.data(), text.size());
+  else if (vfs.truncate(path, 0))
+    vfs.write(path, 0, text.data(), text.size());
+}
 
-  while (getline(ss, item, delimiter)) {
-    splitItems.push_back(item);
+void Commands::stats() {
+  if (!treeStorage())
+    return;
+#if VFS_STATS
+  const Stats::Snapshot snapshot = vfs.stats();
+  for (std::size_t i = 0; i < Stats::operationCount; ++i) {
+    const auto operation = static_cast<Stats::Operation>(i);
+    const Stats::Histogram &histogram = snapshot[operation];
+    std::cout << Stats::name(operation) << " " << histogram.count
+              << " ops, p50 " << histogram.percentile(50) << " ns, p99 "
+              << histogram.percentile(99) << " ns, max " << histogram.max
+              << " ns\n";
   }
-  if (splitItems.size() == 1)
-    return std::string();  // no directory name after command
-  return splitItems.at(1); // return file or directory name
+  std::cout << "lookups " << snapshot[Stats::Counter::Lookups]
+            << ", dentry hits " << snapshot[Stats::Counter::DentryHits]
+            << "\nnodes " << snapshot.nodes << ", largest directory "
+            << snapshot.largestFanOut << " children\ncompressed "
+            << snapshot.compressedChunks << " chunks, saved "
+            << snapshot.savedBytes << " bytes\nspilled "
+            << snapshot.spilledChunks << " chunks, " << snapshot.evictions
+            << " evictions\n";
+#else
+  std::cout << "Stats are disabled\n";
+#endif
+}
+
+void Commands::dedupStats() {
+  if (!treeStorage())
+    return;
+  const VirtualFileSystem::DedupStats sizes = vfs.dedupStats();
+  std::cout << "logical " << sizes.logicalBytes << " bytes, physical "
+            << sizes.physicalBytes << " bytes in " << sizes.chunks
+            << " chunks, ratio "
+            << (sizes.physicalBytes == 0
+                    ? 1.0
+                    : static_cast<double>(sizes.logicalBytes) /
+                          static_cast<double>(sizes.physicalBytes))
+            << "\n";
 }
 } // namespace vfs
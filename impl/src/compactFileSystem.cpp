@@ -0,0 +1,411 @@
+#include "compactFileSystem.h"
+#include "glob.h"
+#include "nameIndex.h"
+#include "path.h"
+#include "vfs.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace vfs {
+
+constexpr CompactFileSystem::NodeId CompactFileSystem::none;
+constexpr CompactFileSystem::NodeId CompactFileSystem::erased;
+constexpr CompactFileSystem::NodeId CompactFileSystem::head;
+
+namespace {
+// smallest hash table
+constexpr std::size_t minimumSlots = 16;
+} // namespace
+
+CompactFileSystem::CompactFileSystem(std::ostream &output) : out(output) {
+  // creating home directory in ctor, it is not in hash table
+  parents.push_back(none);
+  firstChildren.push_back(none);
+  lastChildren.push_back(none);
+  nextSiblings.push_back(none);
+  previousSiblings.push_back(none);
+  nameOffsets.push_back(0);
+  nameSizes.push_back(4);
+  timesCreated.push_back(return_current_time());
+  types.push_back(Directory);
+  names = "home";
+  count = 1;
+  slots.assign(minimumSlots, none);
+}
+
+std::uint64_t CompactFileSystem::hashOf(NodeId parent, const char *name,
+                                        std::size_t size) {
+  return hashName(name, size) ^ (parent * 0x9E3779B97F4A7C15ull);
+}
+
+bool CompactFileSystem::hasName(NodeId node, const char *name,
+                                std::size_t size) const {
+  return nameSizes[node] == size &&
+         std::memcmp(names.data() + nameOffsets[node], name, size) == 0;
+}
+
+CompactFileSystem::NodeId CompactFileSystem::findChild(NodeId parent,
+                                                       const char *name,
+                                                       std::size_t size) const {
+  const std::size_t mask = slots.size() - 1;
+  for (std::size_t i = hashOf(parent, name, size) & mask;; i = (i + 1) & mask) {
+    const NodeId node = slots[i];
+    if (node == none)
+      return none;
+    if (node != erased && parents[node] == parent && hasName(node, name, size))
+      return node;
+  }
+}
+
+CompactFileSystem::NodeId
+CompactFileSystem::findDirectory(const char *path, std::size_t size) const {
+  // absolute path starts above head, its first component is name of head
+  NodeId directory = size > 0 && path[0] == '/' ? none : currentDirectory;
+  std::size_t position = 0, length = 0;
+  const char *name = nullptr;
+  while (nextComponent(path, size, position, name, length)) {
+    if (directory == none) {
+      if (!hasName(head, name, length))
+        return none;
+      directory = head;
+    } else if (isCurrentDirectory(name, length)) {
+      continue;
+    } else if (isParentDirectory(name, length)) {
+      if (parents[directory] != none)
+        directory = parents[directory];
+    } else {
+      directory = findChild(directory, name, length);
+      if (directory == none || types[directory] != Directory)
+        return none;
+    }
+  }
+  return directory == none ? head : directory; // path is only /
+}
+
+CompactFileSystem::NodeId
+CompactFileSystem::findParent(const std::string &path, std::size_t &leafStart,
+                              std::size_t &leafSize) const {
+  const std::size_t parentSize = splitPath(path, leafStart, leafSize);
+  if (parentSize == std::string::npos) // name in currentDirectory
+    return currentDirectory;
+  if (parentSize == 0) // parent is above head
+    return none;
+  return findDirectory(path.data(), parentSize);
+}
+
+void CompactFileSystem::makeDirectory(const std::string &nameDirectory) {
+  create(nameDirectory, Directory);
+}
+
+void CompactFileSystem::makeFile(const std::string &nameFile) {
+  create(nameFile, File);
+}
+
+void CompactFileSystem::create(const std::string &path, Type type) {
+  std::size_t leafStart = 0, leafSize = 0;
+  const NodeId parent = findParent(path, leafStart, leafSize);
+  if (parent == none) {
+    out << noSuchDirectory;
+    return;
+  }
+  const char *name = path.data() + leafStart;
+  if (!isValidName(name, leafSize)) {
+    out << invalidCommand;
+    return;
+  }
+  if (findChild(parent, name, leafSize) != none) {
+    out << alreadyExists;
+    return;
+  }
+  if (names.size() + leafSize > UINT32_MAX)
+    throw std::length_error("CompactFileSystem::create");
+
+  // ids of removed nodes are reused, before arrays grow
+  NodeId node = freeIds;
+  if (node != none) {
+    freeIds = nextSiblings[node];
+  } else {
+    if (parents.size() >= erased)
+      throw std::length_error("CompactFileSystem::create");
+    node = static_cast<NodeId>(parents.size());
+    parents.push_back(none);
+    firstChildren.push_back(none);
+    lastChildren.push_back(none);
+    nextSiblings.push_back(none);
+    previousSiblings.push_back(none);
+    nameOffsets.push_back(0);
+    nameSizes.push_back(0);
+    timesCreated.push_back(0);
+    types.push_back(Free);
+  }
+  parents[node] = parent;
+  firstChildren[node] = none;
+  lastChildren[node] = none;
+  nameOffsets[node] = static_cast<std::uint32_t>(names.size());
+  nameSizes[node] = static_cast<std::uint32_t>(leafSize);
+  names.append(name, leafSize);
+  timesCreated[node] = return_current_time();
+  types[node] = type;
+
+  // linked after the last child, so children stay in order of creation
+  const NodeId last = lastChildren[parent];
+  previousSiblings[node] = last;
+  nextSiblings[node] = none;
+  if (last == none)
+    firstChildren[parent] = node;
+  else
+    nextSiblings[last] = node;
+  lastChildren[parent] = node;
+  insertSlot(node);
+  ++count;
+}
+
+void CompactFileSystem::changeDirectory(const std::string &nameDirectory) {
+  // cd  - goes to home directory
+  // cd .., cd someDirectory or cd some/path - goes to directory, if exists
+  const NodeId directory =
+      nameDirectory.empty()
+          ? head
+          : findDirectory(nameDirectory.data(), nameDirectory.size());
+  if (directory == none) {
+    out << noSuchDirectory;
+    return;
+  }
+  currentDirectory = directory;
+}
+
+void CompactFileSystem::list(const std::string &path) const {
+  const NodeId directory = path.empty()
+                               ? currentDirectory
+                               : findDirectory(path.data(), path.size());
+  if (directory == none) {
+    out << noSuchDirectory;
+    return;
+  }
+  if (firstChildren[directory] == none) {
+    out << emptyDirectory;
+    return;
+  }
+  // directories are listed before files, both in order of creation
+  char buffer[timeFormatLength];
+  for (Type type : {Directory, File}) {
+    for (NodeId child = firstChildren[directory]; child != none;
+         child = nextSiblings[child]) {
+      if (types[child] != type)
+        continue;
+      out << (type == Directory ? "d------ " : "f------ ");
+      format_time_and_date(timesCreated[child], buffer);
+      out.write(buffer, timeFormatLength);
+      out << " ";
+      out.write(names.data() + nameOffsets[child], nameSizes[child]);
+      out << '\n';
+    }
+  }
+}
+
+void CompactFileSystem::remove(const std::string &name) {
+  std::size_t leafStart = 0, leafSize = 0;
+  const NodeId parent = findParent(name, leafStart, leafSize);
+  if (parent == none) {
+    out << noSuchDirectory;
+    return;
+  }
+  if (!isValidName(name.data() + leafStart, leafSize)) {
+    out << invalidCommand;
+    return;
+  }
+  const NodeId removed = findChild(parent, name.data() + leafStart, leafSize);
+  if (removed == none)
+    return;
+
+  // current directory in removed subtree goes to parent of the subtree
+  for (NodeId up = currentDirectory; up != none; up = parents[up]) {
+    if (up == removed) {
+      currentDirectory = parent;
+      break;
+    }
+  }
+
+  const NodeId previous = previousSiblings[removed];
+  const NodeId next = nextSiblings[removed];
+  if (previous == none)
+    firstChildren[parent] = next;
+  else
+    nextSiblings[previous] = next;
+  if (next == none)
+    lastChildren[parent] = previous;
+  else
+    previousSiblings[next] = previous;
+
+  // children are pushed before node is freed, its free list link overwrites
+  // nextSiblings only of nodes that were already visited
+  std::vector<NodeId> stack{removed};
+  while (!stack.empty()) {
+    const NodeId node = stack.back();
+    stack.pop_back();
+    for (NodeId child = firstChildren[node]; child != none;
+         child = nextSiblings[child])
+      stack.push_back(child);
+    eraseSlot(node);
+    garbage += nameSizes[node];
+    types[node] = Free;
+    nextSiblings[node] = freeIds;
+    freeIds = node;
+    --count;
+  }
+  if (garbage * 2 > names.size())
+    compactNames();
+}
+
+void CompactFileSystem::diskUsage(const std::string &path) const {
+  const NodeId directory = path.empty()
+                               ? currentDirectory
+                               : findDirectory(path.data(), path.size());
+  if (directory == none) {
+    out << noSuchDirectory;
+    return;
+  }
+  std::size_t directories = 0, files = 0;
+  if (directory == head) { // whole tree is scan of types
+    for (Type type : types) {
+      directories += type == Directory;
+      files += type == File;
+    }
+    --directories; // without head
+  } else {
+    std::vector<NodeId> stack{directory};
+    while (!stack.empty()) {
+      const NodeId node = stack.back();
+      stack.pop_back();
+      for (NodeId child = firstChildren[node]; child != none;
+           child = nextSiblings[child]) {
+        if (types[child] == Directory) {
+          ++directories;
+          stack.push_back(child);
+        } else {
+          ++files;
+        }
+      }
+    }
+  }
+  out << directories << " directories, " << files << " files\n";
+}
+
+void CompactFileSystem::find(const std::string &path,
+                             const std::string &name) const {
+  const NodeId directory = path.empty()
+                               ? currentDirectory
+                               : findDirectory(path.data(), path.size());
+  if (directory == none) {
+    out << noSuchDirectory;
+    return;
+  }
+  const Glob glob(name);
+  std::vector<std::string> paths;
+  std::vector<NodeId> stack{directory};
+  while (!stack.empty()) {
+    const NodeId node = stack.back();
+    stack.pop_back();
+    for (NodeId child = firstChildren[node]; child != none;
+         child = nextSiblings[child]) {
+      if (glob.match(names.data() + nameOffsets[child], nameSizes[child]))
+        paths.push_back(pathOf(child));
+      if (types[child] == Directory)
+        stack.push_back(child);
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+  for (const auto &foundPath : paths)
+    out << foundPath << '\n';
+}
+
+std::size_t CompactFileSystem::memoryUsage() const {
+  return (parents.capacity() + firstChildren.capacity() +
+          lastChildren.capacity() + nextSiblings.capacity() +
+          previousSiblings.capacity() + slots.capacity()) *
+             sizeof(NodeId) +
+         (nameOffsets.capacity() + nameSizes.capacity()) *
+             sizeof(std::uint32_t) +
+         timesCreated.capacity() * sizeof(std::int64_t) +
+         types.capacity() * sizeof(Type) + names.capacity();
+}
+
+void CompactFileSystem::insertSlot(NodeId node) {
+  // erased slots are used too, table is rebuilt at 3/4 of them, with all
+  // nodes that have type, node too
+  if ((usedSlots + 1) * 4 > slots.size() * 3) {
+    rehash();
+    return;
+  }
+  const std::size_t mask = slots.size() - 1;
+  std::size_t i =
+      hashOf(parents[node], names.data() + nameOffsets[node], nameSizes[node]) &
+      mask;
+  while (slots[i] != none && slots[i] != erased)
+    i = (i + 1) & mask;
+  if (slots[i] == none)
+    ++usedSlots;
+  slots[i] = node;
+}
+
+void CompactFileSystem::eraseSlot(NodeId node) {
+  if (node == head)
+    return;
+  const std::size_t mask = slots.size() - 1;
+  std::size_t i =
+      hashOf(parents[node], names.data() + nameOffsets[node], nameSizes[node]) &
+      mask;
+  while (slots[i] != node)
+    i = (i + 1) & mask;
+  slots[i] = erased;
+}
+
+void CompactFileSystem::rehash() {
+  // at most half full after rehash
+  std::size_t size = minimumSlots;
+  while (size < count * 2)
+    size *= 2;
+  slots.assign(size, none);
+  usedSlots = 0;
+  const std::size_t mask = size - 1;
+  for (NodeId node = 1; node < types.size(); ++node) {
+    if (types[node] == Free)
+      continue;
+    std::size_t i = hashOf(parents[node], names.data() + nameOffsets[node],
+                           nameSizes[node]) &
+                    mask;
+    while (slots[i] != none)
+      i = (i + 1) & mask;
+    slots[i] = node;
+    ++usedSlots;
+  }
+}
+
+void CompactFileSystem::compactNames() {
+  std::string compacted;
+  compacted.reserve(names.size() - garbage);
+  for (NodeId node = 0; node < types.size(); ++node) {
+    if (types[node] == Free)
+      continue;
+    const std::uint32_t offset = static_cast<std::uint32_t>(compacted.size());
+    compacted.append(names, nameOffsets[node], nameSizes[node]);
+    nameOffsets[node] = offset;
+  }
+  names.swap(compacted);
+  garbage = 0;
+}
+
+std::string CompactFileSystem::pathOf(NodeId node) const {
+  std::vector<NodeId> chain;
+  for (NodeId up = node; up != none; up = parents[up])
+    chain.push_back(up);
+  std::string path;
+  for (auto component = chain.rbegin(); component != chain.rend();
+       ++component) {
+    path += '/';
+    path.append(names, nameOffsets[*component], nameSizes[*component]);
+  }
+  return path;
+}
+} // namespace vfs
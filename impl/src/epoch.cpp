@@ -0,0 +1,145 @@
+#include "epoch.h"
+#include <algorithm>
+#include <chrono>
+
+namespace vfs {
+
+constexpr std::uint64_t EpochManager::idle;
+
+EpochManager::~EpochManager() {
+  stopReclaimer();
+  reclaimAll();
+  for (auto participant : participants)
+    delete participant;
+}
+
+EpochManager::Participant *EpochManager::join() {
+  std::lock_guard<std::mutex> lock(mutex);
+  participants.push_back(new Participant());
+  return participants.back();
+}
+
+void EpochManager::leave(Participant *participant) {
+  std::lock_guard<std::mutex> lock(mutex);
+  participants.erase(
+      std::find(participants.begin(), participants.end(), participant));
+  delete participant;
+}
+
+void EpochManager::retire(void *pointer, Reclaim reclaim, void *context) {
+  bool collecting = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    retired.push_back(Retired{pointer, reclaim, context, globalEpoch.load()});
+    if (reclaimer.joinable()) {
+      // reclaimer polls while there is retired memory
+      if (retired.size() == 1)
+        retiredCondition.notify_one();
+      return;
+    }
+    collecting = ++sinceCollect >= 64;
+  }
+  if (collecting)
+    collect();
+}
+
+void EpochManager::collect() {
+  std::vector<Retired> released;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    sinceCollect = 0;
+    const std::uint64_t epoch = globalEpoch.load();
+    bool advance = true;
+    for (auto participant : participants) {
+      const std::uint64_t seen = participant->epoch.load();
+      if (seen != idle && seen != epoch) {
+        advance = false;
+        break;
+      }
+    }
+    if (advance)
+      globalEpoch.store(epoch + 1);
+
+    // memory retired two epochs ago can't be seen by any reader
+    const std::uint64_t safe = globalEpoch.load();
+    auto end = std::find_if(retired.begin(), retired.end(),
+                            [safe](const Retired &item) {
+                              return item.epoch + 2 > safe;
+                            });
+    released.assign(retired.begin(), end);
+    retired.erase(retired.begin(), end);
+    releasing += released.size();
+  }
+  // released outside of lock, reclaim can retire more memory
+  for (const auto &item : released)
+    item.reclaim(item.context, item.pointer);
+  std::lock_guard<std::mutex> lock(mutex);
+  releasing -= released.size();
+  if (releasing == 0)
+    releasedCondition.notify_all();
+}
+
+void EpochManager::reclaimAll() {
+  std::vector<Retired> released;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    released.swap(retired);
+  }
+  for (const auto &item : released)
+    item.reclaim(item.context, item.pointer);
+  std::unique_lock<std::mutex> lock(mutex);
+  releasedCondition.wait(lock, [this]() { return releasing == 0; });
+}
+
+std::size_t EpochManager::pending() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return retired.size() + releasing;
+}
+
+void EpochManager::startReclaimer() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (reclaimer.joinable())
+    return;
+  stopping = false;
+  reclaimer = std::thread(&EpochManager::reclaim, this);
+}
+
+void EpochManager::stopReclaimer() {
+  std::thread stopped;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!reclaimer.joinable())
+      return;
+    stopping = true;
+    stopped.swap(reclaimer);
+  }
+  retiredCondition.notify_one();
+  stopped.join();
+}
+
+void EpochManager::drain() {
+  for (;;) {
+    collect();
+    if (pending() == 0)
+      return;
+    std::this_thread::yield();
+  }
+}
+
+void EpochManager::reclaim() {
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;) {
+    retiredCondition.wait(lock,
+                          [this]() { return stopping || !retired.empty(); });
+    if (stopping)
+      return;
+    lock.unlock();
+    collect();
+    lock.lock();
+    // readers that are still in epoch are given time to leave it
+    if (!retired.empty())
+      retiredCondition.wait_for(lock, std::chrono::milliseconds(1),
+                                [this]() { return stopping; });
+  }
+}
+} // namespace vfs
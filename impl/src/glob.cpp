@@ -0,0 +1,144 @@
+#include "glob.h"
+#include <cstring>
+
+namespace vfs {
+
+Glob::Glob(const std::string &pattern) : chunks(1) {
+  const std::size_t size = pattern.size();
+  for (std::size_t i = 0; i < size; ++i) {
+    Chunk &chunk = chunks.back();
+    char character = pattern[i];
+    if (character == '*') {
+      chunks.emplace_back();
+      continue;
+    }
+    if (character == '?') {
+      chunk.elements.push_back(Element{Element::Kind::Any});
+      ++chunk.size;
+      continue;
+    }
+    if (character == '[') {
+      std::size_t j = i + 1;
+      const bool negate = j < size && (pattern[j] == '!' || pattern[j] == '^');
+      if (negate)
+        ++j;
+      const std::size_t first = j;
+      if (j < size && pattern[j] == ']') // ] right after [ is in the set
+        ++j;
+      while (j < size && pattern[j] != ']')
+        ++j;
+      if (j < size) {
+        Element element{Element::Kind::Set};
+        for (std::size_t k = first; k < j; ++k) {
+          const auto low = static_cast<unsigned char>(pattern[k]);
+          if (k + 2 < j && pattern[k + 1] == '-') {
+            const auto high = static_cast<unsigned char>(pattern[k + 2]);
+            for (unsigned member = low; member <= high; ++member)
+              element.set.set(member);
+            k += 2;
+          } else {
+            element.set.set(low);
+          }
+        }
+        if (negate)
+          element.set.flip();
+        chunk.elements.push_back(std::move(element));
+        ++chunk.size;
+        i = j;
+        continue;
+      }
+      // [ without ] is matched as it is
+    }
+    if (character == '\\' && i + 1 < size)
+      character = pattern[++i];
+    if (chunk.elements.empty() ||
+        chunk.elements.back().kind != Element::Kind::Literal)
+      chunk.elements.push_back(Element{Element::Kind::Literal});
+    chunk.elements.back().literal += character;
+    ++chunk.size;
+  }
+
+  const Chunk &first = chunks.front();
+  if (!first.elements.empty() &&
+      first.elements.front().kind == Element::Kind::Literal)
+    literalPrefix = first.elements.front().literal;
+}
+
+bool Glob::isPattern(const char *text, std::size_t size) {
+  for (std::size_t i = 0; i < size; ++i) {
+    if (text[i] == '*' || text[i] == '?' || text[i] == '[')
+      return true;
+  }
+  return false;
+}
+
+bool Glob::match(const char *name, std::size_t size) const {
+  const Chunk &first = chunks.front();
+  if (chunks.size() == 1) // no stars
+    return size == first.size && matchAt(first, name);
+
+  const Chunk &last = chunks.back();
+  if (size < first.size + last.size || !matchAt(first, name) ||
+      !matchAt(last, name + size - last.size))
+    return false;
+  // chunks between stars are found from left to right, the leftmost match
+  // leaves the most characters for chunks after it
+  const char *position = name + first.size;
+  const char *end = name + size - last.size;
+  for (std::size_t i = 1; i + 1 < chunks.size(); ++i) {
+    const char *found = find(chunks[i], position, end);
+    if (found == nullptr)
+      return false;
+    position = found + chunks[i].size;
+  }
+  return true;
+}
+
+bool Glob::matchAt(const Chunk &chunk, const char *name) {
+  for (const auto &element : chunk.elements) {
+    switch (element.kind) {
+    case Element::Kind::Literal:
+      if (std::memcmp(name, element.literal.data(), element.literal.size()) !=
+          0)
+        return false;
+      name += element.literal.size();
+      break;
+    case Element::Kind::Any:
+      ++name;
+      break;
+    case Element::Kind::Set:
+      if (!element.set.test(static_cast<unsigned char>(*name)))
+        return false;
+      ++name;
+      break;
+    }
+  }
+  return true;
+}
+
+const char *Glob::find(const Chunk &chunk, const char *begin,
+                       const char *end) {
+  if (static_cast<std::size_t>(end - begin) < chunk.size)
+    return nullptr;
+  const char *last = end - chunk.size; // last position where chunk can start
+  if (!chunk.elements.empty() &&
+      chunk.elements.front().kind == Element::Kind::Literal) {
+    // candidates are positions of the first literal character
+    const char character = chunk.elements.front().literal.front();
+    for (const char *position = begin; position <= last; ++position) {
+      position = static_cast<const char *>(
+          std::memchr(position, character, last - position + 1));
+      if (position == nullptr)
+        return nullptr;
+      if (matchAt(chunk, position))
+        return position;
+    }
+    return nullptr;
+  }
+  for (const char *position = begin; position <= last; ++position) {
+    if (matchAt(chunk, position))
+      return position;
+  }
+  return nullptr;
+}
+} // namespace vfs
@@ -0,0 +1,172 @@
+#include "image.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace vfs {
+
+namespace {
+constexpr char imageMagic[8] = {'V', 'F', 'S', 'I', 'M', 'G', '3', '\0'};
+} // namespace
+
+Image::~Image() { close(); }
+
+bool Image::open(const std::string &path) {
+  close();
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat status {};
+  if (fstat(fd, &status) != 0 ||
+      static_cast<std::size_t>(status.st_size) < sizeof(ImageHeader)) {
+    ::close(fd);
+    return false;
+  }
+  const std::size_t length = static_cast<std::size_t>(status.st_size);
+  void *mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd); // mapping stays valid without descriptor
+  if (mapped == MAP_FAILED)
+    return false;
+  data = static_cast<const char *>(mapped);
+  size = length;
+
+  // only header is checked, nodes are checked when they are read
+  const ImageHeader *header = reinterpret_cast<const ImageHeader *>(data);
+  const std::uint64_t tableEnd =
+      sizeof(ImageHeader) + header->nodeCount * sizeof(ImageNode);
+  if (std::memcmp(header->magic, imageMagic, sizeof(imageMagic)) != 0 ||
+      header->nodeCount == 0 ||
+      header->nodeCount > (size - sizeof(ImageHeader)) / sizeof(ImageNode) ||
+      header->stringOffset < tableEnd || header->stringOffset > size ||
+      header->stringSize > size - header->stringOffset) {
+    close();
+    return false;
+  }
+  nodes = reinterpret_cast<const ImageNode *>(data + sizeof(ImageHeader));
+  nodeCount = static_cast<std::size_t>(header->nodeCount);
+  strings = data + header->stringOffset;
+  stringSize = static_cast<std::size_t>(header->stringSize);
+  journal = header->journalSequence;
+  if (name(root()) == nullptr) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void Image::close() {
+  if (data != nullptr)
+    munmap(const_cast<char *>(data), size);
+  data = nullptr;
+  size = 0;
+  nodes = nullptr;
+  nodeCount = 0;
+  strings = nullptr;
+  stringSize = 0;
+  journal = 0;
+}
+
+void Image::swap(Image &other) {
+  std::swap(data, other.data);
+  std::swap(size, other.size);
+  std::swap(nodes, other.nodes);
+  std::swap(nodeCount, other.nodeCount);
+  std::swap(strings, other.strings);
+  std::swap(stringSize, other.stringSize);
+  std::swap(journal, other.journal);
+}
+
+const ImageNode *Image::root() const { return nodes; }
+
+const ImageNode *Image::child(const ImageNode *node, std::size_t index) const {
+  const std::uint64_t position =
+      static_cast<std::uint64_t>(node->firstChild) + index;
+  if (node->firstChild == 0 || position >= nodeCount)
+    return nullptr;
+  return nodes + position;
+}
+
+const char *Image::name(const ImageNode *node) const {
+  if (node->nameOffset > stringSize ||
+      node->nameSize > stringSize - node->nameOffset)
+    return nullptr;
+  return strings + node->nameOffset;
+}
+
+const char *Image::fileData(const ImageNode *node) const {
+  if (node->dataOffset > stringSize ||
+      node->dataSize > stringSize - node->dataOffset)
+    return nullptr;
+  return strings + node->dataOffset;
+}
+
+std::uint64_t Image::journalSequence() const { return journal; }
+
+bool ImageWriter::open(const std::string &imagePath) {
+  path = imagePath;
+  file.open(path + ".tmp", std::ios::binary | std::ios::trunc);
+  // header is written when node table and string heap are written
+  const ImageHeader header{};
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  return static_cast<bool>(file);
+}
+
+void ImageWriter::add(const char *name, std::size_t nameSize,
+                      std::int64_t timeCreated, std::size_t directoryCount,
+                      std::size_t fileCount) {
+  ImageNode node{};
+  node.nameOffset = strings.size();
+  node.timeCreated = timeCreated;
+  node.nameSize = static_cast<std::uint32_t>(nameSize);
+  node.directoryCount = static_cast<std::uint32_t>(directoryCount);
+  node.fileCount = static_cast<std::uint32_t>(fileCount);
+  node.firstChild = static_cast<std::uint32_t>(nextChild);
+  node.dataOffset = dataOffset;
+  node.dataSize = dataSize;
+  nextChild += directoryCount + fileCount;
+  dataOffset = 0;
+  dataSize = 0;
+  strings.append(name, nameSize);
+  file.write(reinterpret_cast<const char *>(&node), sizeof(node));
+  ++nodeCount;
+}
+
+void ImageWriter::addData(const char *data, std::size_t size) {
+  if (size == 0) // file without data has offset 0
+    return;
+  if (dataSize == 0)
+    dataOffset = strings.size();
+  strings.append(data, size);
+  dataSize += size;
+}
+
+bool ImageWriter::close(std::uint64_t journalSequence) {
+  ImageHeader header{};
+  std::memcpy(header.magic, imageMagic, sizeof(imageMagic));
+  header.nodeCount = nodeCount;
+  header.stringOffset = sizeof(ImageHeader) + nodeCount * sizeof(ImageNode);
+  header.stringSize = strings.size();
+  header.journalSequence = journalSequence;
+  file.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+  file.seekp(0);
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.close();
+  const std::string temporary = path + ".tmp";
+  bool written = file && nodeCount != 0 && nextChild == nodeCount;
+  if (written) { // image is on disk before it replaces image file
+    const int fd = ::open(temporary.c_str(), O_RDONLY);
+    written = fd >= 0 && fsync(fd) == 0;
+    if (fd >= 0)
+      ::close(fd);
+  }
+  if (!written) {
+    std::remove(temporary.c_str());
+    return false;
+  }
+  return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+} // namespace vfs
@@ -0,0 +1,225 @@
+#include "journal.h"
+#include "nameIndex.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+
+namespace vfs {
+
+namespace {
+// record is path size, operation, sequence, creation time, offset, data
+// size, path, data and checksum of all of them
+constexpr std::size_t recordHeaderSize =
+    sizeof(std::uint32_t) + sizeof(std::uint8_t) + sizeof(std::uint64_t) +
+    sizeof(std::int64_t) + sizeof(std::uint64_t) + sizeof(std::uint64_t);
+constexpr std::size_t checksumSize = sizeof(std::uint32_t);
+
+std::uint32_t checksum(const char *data, std::size_t size) {
+  return static_cast<std::uint32_t>(hashName(data, size));
+}
+
+bool writeAll(int fd, const char *data, std::size_t size) {
+  while (size > 0) {
+    const ssize_t written = ::write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    data += written;
+    size -= static_cast<std::size_t>(written);
+  }
+  return true;
+}
+
+// rename is durable only when directory of the file is synced
+bool syncDirectory(const std::string &path) {
+  const std::size_t slash = path.rfind('/');
+  const std::string directory =
+      slash == std::string::npos ? "." : path.substr(0, slash + 1);
+  const int fd = ::open(directory.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  const bool synced = fsync(fd) == 0;
+  ::close(fd);
+  return synced;
+}
+} // namespace
+
+Journal::~Journal() { close(); }
+
+bool Journal::open(const std::string &journalPath, std::size_t validSize,
+                   std::uint64_t lastSequence,
+                   std::chrono::microseconds delay) {
+  close();
+  fd = ::open(journalPath.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (fd < 0)
+    return false;
+  // record that was not completely written is dropped
+  if (ftruncate(fd, static_cast<off_t>(validSize)) != 0 ||
+      fdatasync(fd) != 0) {
+    ::close(fd);
+    fd = -1;
+    return false;
+  }
+  syncDirectory(journalPath);
+  path = journalPath;
+  commitDelay = delay;
+  appended = durable = lastSequence;
+  failed = stopping = false;
+  flusher = std::thread(&Journal::flush, this);
+  opened.store(true);
+  return true;
+}
+
+void Journal::close() {
+  if (fd < 0)
+    return;
+  opened.store(false);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  appendedCondition.notify_one();
+  flusher.join();
+  ::close(fd);
+  fd = -1;
+}
+
+std::uint64_t Journal::append(Operation operation, std::int64_t timeCreated,
+                              const std::string &path, std::uint64_t offset,
+                              const char *data, std::size_t size) {
+  std::lock_guard<std::mutex> lock(mutex);
+  const std::uint64_t sequence = ++appended;
+  const std::uint32_t pathSize = static_cast<std::uint32_t>(path.size());
+  const std::uint64_t dataSize = size;
+  const std::size_t start = buffer.size();
+  buffer.append(reinterpret_cast<const char *>(&pathSize), sizeof(pathSize));
+  buffer.push_back(static_cast<char>(operation));
+  buffer.append(reinterpret_cast<const char *>(&sequence), sizeof(sequence));
+  buffer.append(reinterpret_cast<const char *>(&timeCreated),
+                sizeof(timeCreated));
+  buffer.append(reinterpret_cast<const char *>(&offset), sizeof(offset));
+  buffer.append(reinterpret_cast<const char *>(&dataSize), sizeof(dataSize));
+  buffer.append(path);
+  if (size != 0)
+    buffer.append(data, size);
+  const std::uint32_t sum =
+      checksum(buffer.data() + start, buffer.size() - start);
+  buffer.append(reinterpret_cast<const char *>(&sum), sizeof(sum));
+  if (start == 0) // flusher waits for first record
+    appendedCondition.notify_one();
+  return sequence;
+}
+
+bool Journal::waitDurable(std::uint64_t sequence) {
+  std::unique_lock<std::mutex> lock(mutex);
+  durableCondition.wait(lock,
+                        [&]() { return durable >= sequence || failed; });
+  return durable >= sequence;
+}
+
+std::uint64_t Journal::lastSequence() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return appended;
+}
+
+bool Journal::reset() {
+  std::unique_lock<std::mutex> lock(mutex);
+  durableCondition.wait(lock, [&]() { return durable == appended || failed; });
+  if (failed)
+    return false;
+  // empty journal replaces journal file, old journal is valid until rename
+  const std::string temporary = path + ".tmp";
+  const int created =
+      ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+  if (created < 0)
+    return false;
+  if (fdatasync(created) != 0 ||
+      std::rename(temporary.c_str(), path.c_str()) != 0) {
+    ::close(created);
+    return false;
+  }
+  syncDirectory(path);
+  ::close(fd);
+  fd = created;
+  return true;
+}
+
+std::size_t Journal::read(const std::string &path,
+                          std::vector<Record> &records) {
+  std::ifstream file(path, std::ios::binary);
+  const std::string contents((std::istreambuf_iterator<char>(file)),
+                             std::istreambuf_iterator<char>());
+  std::size_t position = 0;
+  while (contents.size() - position >= recordHeaderSize + checksumSize) {
+    const char *record = contents.data() + position;
+    const std::size_t available = contents.size() - position - checksumSize;
+    std::uint32_t size = 0;
+    std::uint64_t dataSize = 0;
+    std::memcpy(&size, record, sizeof(size));
+    std::memcpy(&dataSize, record + recordHeaderSize - sizeof(dataSize),
+                sizeof(dataSize));
+    if (dataSize > available || available - dataSize < recordHeaderSize + size)
+      break;
+    const std::size_t length =
+        recordHeaderSize + size + static_cast<std::size_t>(dataSize);
+    std::uint32_t sum = 0;
+    std::memcpy(&sum, record + length, sizeof(sum));
+    if (sum != checksum(record, length))
+      break;
+    Record read;
+    read.operation = static_cast<Operation>(record[sizeof(size)]);
+    std::memcpy(&read.sequence, record + sizeof(size) + 1,
+                sizeof(read.sequence));
+    std::memcpy(&read.timeCreated,
+                record + sizeof(size) + 1 + sizeof(read.sequence),
+                sizeof(read.timeCreated));
+    std::memcpy(&read.offset,
+                record + sizeof(size) + 1 + sizeof(read.sequence) +
+                    sizeof(read.timeCreated),
+                sizeof(read.offset));
+    read.path.assign(record + recordHeaderSize, size);
+    read.data.assign(record + recordHeaderSize + size,
+                     static_cast<std::size_t>(dataSize));
+    records.push_back(std::move(read));
+    position += length + checksumSize;
+  }
+  return position;
+}
+
+void Journal::flush() {
+  std::string writing;
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;) {
+    appendedCondition.wait(lock,
+                           [&]() { return stopping || !buffer.empty(); });
+    if (buffer.empty()) // stopping, everything is synced
+      return;
+    // more records are collected, so they share one sync
+    if (commitDelay.count() > 0 && !stopping) {
+      lock.unlock();
+      std::this_thread::sleep_for(commitDelay);
+      lock.lock();
+    }
+    writing.swap(buffer);
+    const std::uint64_t sequence = appended;
+    lock.unlock();
+
+    const bool written =
+        writeAll(fd, writing.data(), writing.size()) && fdatasync(fd) == 0;
+    writing.clear();
+
+    lock.lock();
+    if (written)
+      durable = sequence;
+    else
+      failed = true;
+    durableCondition.notify_all();
+  }
+}
+} // namespace vfs
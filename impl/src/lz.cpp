@@ -0,0 +1,183 @@
+#include "lz.h"
+#include <cstdint>
+#include <cstring>
+
+namespace vfs {
+
+namespace {
+constexpr std::size_t minMatch = 4;
+constexpr std::size_t maxOffset = 65535;
+constexpr int hashBits = 12;
+// nibble of the token, bigger lengths continue in bytes
+constexpr std::size_t nibbleLimit = 15;
+
+std::uint32_t read32(const unsigned char *bytes) {
+  std::uint32_t value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+std::uint32_t hashOf(std::uint32_t prefix) {
+  return (prefix * 2654435761U) >> (32 - hashBits);
+}
+
+// Output of the compressor, that stops when capacity is exceeded
+class Output {
+public:
+  Output(char *destination, std::size_t capacity)
+      : bytes(reinterpret_cast<unsigned char *>(destination)),
+        capacity(capacity) {}
+
+  bool put(unsigned char byte) {
+    if (size == capacity)
+      return false;
+    bytes[size++] = byte;
+    return true;
+  }
+
+  bool put(const unsigned char *source, std::size_t length) {
+    if (length > capacity - size)
+      return false;
+    std::memcpy(bytes + size, source, length);
+    size += length;
+    return true;
+  }
+
+  // rest of length that doesn't fit in nibble, 255 continues it
+  bool putLength(std::size_t length) {
+    for (; length >= 255; length -= 255) {
+      if (!put(255))
+        return false;
+    }
+    return put(static_cast<unsigned char>(length));
+  }
+
+  // literals and match, match is empty in the last sequence
+  bool sequence(const unsigned char *literals, std::size_t literalLength,
+                std::size_t offset, std::size_t matchLength) {
+    const std::size_t literalNibble =
+        literalLength < nibbleLimit ? literalLength : nibbleLimit;
+    const std::size_t extra = matchLength - (offset == 0 ? 0 : minMatch);
+    const std::size_t matchNibble = extra < nibbleLimit ? extra : nibbleLimit;
+    if (!put(static_cast<unsigned char>(literalNibble << 4 | matchNibble)))
+      return false;
+    if (literalNibble == nibbleLimit &&
+        !putLength(literalLength - nibbleLimit))
+      return false;
+    if (!put(literals, literalLength))
+      return false;
+    if (offset == 0)
+      return true;
+    if (!put(static_cast<unsigned char>(offset)) ||
+        !put(static_cast<unsigned char>(offset >> 8)))
+      return false;
+    return matchNibble != nibbleLimit || putLength(extra - nibbleLimit);
+  }
+
+  std::size_t written() const { return size; }
+
+private:
+  unsigned char *bytes;
+  std::size_t capacity;
+  std::size_t size = 0;
+};
+
+// Input of the decompressor
+struct Input {
+  const unsigned char *bytes;
+  std::size_t size;
+  std::size_t position;
+
+  bool length(std::size_t &length) {
+    unsigned char byte;
+    do {
+      if (position == size)
+        return false;
+      byte = bytes[position++];
+      length += byte;
+    } while (byte == 255);
+    return true;
+  }
+};
+} // namespace
+
+std::size_t lzCompress(const char *source, std::size_t size, char *destination,
+                       std::size_t capacity) {
+  const auto *bytes = reinterpret_cast<const unsigned char *>(source);
+  Output output(destination, capacity);
+  // positions of 4 byte prefixes, plus one, so 0 is empty entry
+  std::uint32_t table[1 << hashBits] = {};
+  std::size_t anchor = 0;
+  std::size_t position = 0;
+  std::size_t misses = 0;
+  while (position + minMatch <= size) {
+    const std::uint32_t prefix = read32(bytes + position);
+    std::uint32_t &entry = table[hashOf(prefix)];
+    const std::size_t candidate = entry;
+    entry = static_cast<std::uint32_t>(position + 1);
+    if (candidate == 0 || position - (candidate - 1) > maxOffset ||
+        read32(bytes + candidate - 1) != prefix) {
+      // step grows while nothing matches, so random data is skipped
+      position += 1 + (misses++ >> 5);
+      continue;
+    }
+    const std::size_t match = candidate - 1;
+    std::size_t length = minMatch;
+    while (position + length < size &&
+           bytes[match + length] == bytes[position + length])
+      ++length;
+    if (!output.sequence(bytes + anchor, position - anchor, position - match,
+                         length))
+      return 0;
+    position += length;
+    anchor = position;
+    misses = 0;
+  }
+  if (!output.sequence(bytes + anchor, size - anchor, 0, 0))
+    return 0;
+  return output.written();
+}
+
+bool lzDecompress(const char *source, std::size_t size, char *destination,
+                  std::size_t length) {
+  Input input{reinterpret_cast<const unsigned char *>(source), size, 0};
+  auto *output = reinterpret_cast<unsigned char *>(destination);
+  std::size_t written = 0;
+  while (input.position < size) {
+    const unsigned char token = input.bytes[input.position++];
+    std::size_t literals = token >> 4;
+    if (literals == nibbleLimit && !input.length(literals))
+      return false;
+    if (literals > size - input.position || literals > length - written)
+      return false;
+    std::memcpy(output + written, input.bytes + input.position, literals);
+    input.position += literals;
+    written += literals;
+    if (input.position == size) // the last sequence has only literals
+      break;
+
+    if (size - input.position < 2)
+      return false;
+    const std::size_t offset =
+        input.bytes[input.position] |
+        static_cast<std::size_t>(input.bytes[input.position + 1]) << 8;
+    input.position += 2;
+    std::size_t match = token & nibbleLimit;
+    if (match == nibbleLimit && !input.length(match))
+      return false;
+    match += minMatch;
+    if (offset == 0 || offset > written || match > length - written)
+      return false;
+    const unsigned char *from = output + written - offset;
+    if (offset >= match) {
+      std::memcpy(output + written, from, match);
+    } else {
+      // overlapping match repeats the last offset bytes
+      for (std::size_t i = 0; i < match; ++i)
+        output[written + i] = from[i];
+    }
+    written += match;
+  }
+  return written == length;
+}
+} // namespace vfs
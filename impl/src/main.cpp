@@ -1,8 +1,39 @@
 #include "commands.h"
 #include "commandsIf.h"
+#include "outputBuffer.h"
+#include <cstring>
+#include <fstream>
 
-int main() {
-  vfs::CommandsIf *commands = new vfs::Commands();
+// vfs             - interactive mode
+// vfs -b [script] - batch mode, commands are read from script or stdin
+// vfs -c ...      - compact storage, with any of the modes
+int main(int argc, char *argv[]) {
+  vfs::Commands::Storage storage = vfs::Commands::Storage::Tree;
+  if (argc > 1 && (std::strcmp(argv[1], "-c") == 0 ||
+                   std::strcmp(argv[1], "--compact") == 0)) {
+    storage = vfs::Commands::Storage::Compact;
+    --argc;
+    ++argv;
+  }
+  if (argc > 1 && (std::strcmp(argv[1], "-b") == 0 ||
+                   std::strcmp(argv[1], "--batch") == 0)) {
+    std::ios::sync_with_stdio(false);
+    vfs::Commands commands(storage);
+    vfs::OutputBuffer output;
+    if (argc > 2) {
+      std::ifstream script(argv[2]);
+      if (!script) {
+        std::cerr << "Can't open " << argv[2] << std::endl;
+        return 1;
+      }
+      commands.batch(script, &output);
+    } else {
+      commands.batch(std::cin, &output);
+    }
+    return output.flush() ? 0 : 1;
+  }
+
+  vfs::CommandsIf *commands = new vfs::Commands(storage);
   commands->command();
   delete commands;
   return 0;
@@ -0,0 +1,106 @@
+#include "name.h"
+#include <new>
+
+namespace vfs {
+
+constexpr std::size_t Name::inlineCapacity;
+constexpr unsigned char Name::internedTag;
+constexpr std::size_t NameTable::shardCount;
+
+void NameTable::clear() {
+  for (auto &shard : shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.entries.clear();
+  }
+  memory.release();
+}
+
+Name NameTable::intern(const char *data, std::size_t size) {
+  return lookup(data, size, true);
+}
+
+Name NameTable::find(const char *data, std::size_t size) {
+  return lookup(data, size, false);
+}
+
+Name NameTable::lookup(const char *data, std::size_t size, bool insert) {
+  Name name;
+  if (size <= Name::inlineCapacity) {
+    name.words = Name::inlineWords(data, size);
+    return name;
+  }
+
+  const std::uint64_t hash = hashName(data, size);
+  Shard &shard = shardOf(hash);
+  Name::Entry *entry = nullptr;
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  const auto range = shard.entries.equal_range(hash);
+  for (auto interned = range.first; interned != range.second; ++interned) {
+    if (interned->second->size == size &&
+        std::memcmp(interned->second->characters(), data, size) == 0) {
+      entry = interned->second;
+      // last reference is released only under lock, so entry is alive
+      entry->references.fetch_add(1, std::memory_order_relaxed);
+      break;
+    }
+  }
+  if (entry == nullptr) {
+    if (!insert)
+      return name;
+    entry = new (memory.allocate(sizeof(Name::Entry) + size))
+        Name::Entry{this, {1}, hash, size};
+    std::memcpy(const_cast<char *>(entry->characters()), data, size);
+    shard.entries.emplace(hash, entry);
+  }
+  name.words[0] = reinterpret_cast<std::uintptr_t>(entry);
+  reinterpret_cast<char *>(&name.words)[Name::inlineCapacity] =
+      static_cast<char>(Name::internedTag);
+  return name;
+}
+
+void NameTable::release(Name::Entry *entry) {
+  // references above one are released without lock, the last one under
+  // lock, so lookup can't find entry that is released
+  std::size_t references = entry->references.load(std::memory_order_relaxed);
+  while (references > 1) {
+    if (entry->references.compare_exchange_weak(references, references - 1,
+                                                std::memory_order_acq_rel))
+      return;
+  }
+  Shard &shard = shardOf(entry->hash);
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (entry->references.fetch_sub(1, std::memory_order_acq_rel) != 1)
+      return;
+    const auto range = shard.entries.equal_range(entry->hash);
+    for (auto interned = range.first; interned != range.second; ++interned) {
+      if (interned->second == entry) {
+        shard.entries.erase(interned);
+        break;
+      }
+    }
+  }
+  const std::size_t bytes = sizeof(Name::Entry) + entry->size;
+  entry->~Entry();
+  memory.deallocate(entry, bytes);
+}
+
+std::size_t NameTable::size() const {
+  std::size_t count = 0;
+  for (const auto &shard : shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    count += shard.entries.size();
+  }
+  return count;
+}
+
+std::size_t NameTable::bytes() const {
+  std::size_t total = 0;
+  for (const auto &shard : shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (const auto &interned : shard.entries)
+      total += sizeof(Name::Entry) + interned.second->size;
+  }
+  return total;
+}
+} // namespace vfs
@@ -0,0 +1,59 @@
+#include "outputBuffer.h"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+namespace vfs {
+
+OutputBuffer::OutputBuffer(int fileDescriptor, std::size_t threshold)
+    : fd(fileDescriptor), buffer(threshold) {
+  setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+OutputBuffer::~OutputBuffer() { flush(); }
+
+bool OutputBuffer::flush() {
+  const std::size_t size = static_cast<std::size_t>(pptr() - pbase());
+  setp(buffer.data(), buffer.data() + buffer.size());
+  return writeAll(buffer.data(), size);
+}
+
+OutputBuffer::int_type OutputBuffer::overflow(int_type character) {
+  if (!flush())
+    return traits_type::eof();
+  if (!traits_type::eq_int_type(character, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(character);
+    pbump(1);
+  }
+  return traits_type::not_eof(character);
+}
+
+std::streamsize OutputBuffer::xsputn(const char *data, std::streamsize size) {
+  const std::size_t length = static_cast<std::size_t>(size);
+  if (length > static_cast<std::size_t>(epptr() - pptr())) {
+    if (!flush())
+      return 0;
+    if (length >= buffer.size()) // bigger than buffer, written directly
+      return writeAll(data, length) ? size : 0;
+  }
+  std::memcpy(pptr(), data, length);
+  pbump(static_cast<int>(length));
+  return size;
+}
+
+int OutputBuffer::sync() { return 0; }
+
+bool OutputBuffer::writeAll(const char *data, std::size_t size) {
+  while (size > 0) {
+    const ssize_t written = ::write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    data += written;
+    size -= static_cast<std::size_t>(written);
+  }
+  return true;
+}
+} // namespace vfs
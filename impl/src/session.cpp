@@ -0,0 +1,114 @@
+#include "session.h"
+
+namespace vfs {
+
+Session::Session(VirtualFileSystem &fileSystem, std::ostream &output)
+    : fileSystem(fileSystem), out(output),
+      participant(fileSystem.epochs.join()),
+      shard(fileSystem.statistics.join()) {
+  currentDirectory.store(fileSystem.head);
+  std::lock_guard<std::mutex> lock(fileSystem.sessionMutex);
+  fileSystem.workingDirectories.push_back(&currentDirectory);
+}
+
+Session::~Session() {
+  {
+    std::lock_guard<std::mutex> lock(fileSystem.sessionMutex);
+    auto &workingDirectories = fileSystem.workingDirectories;
+    workingDirectories.erase(std::find(workingDirectories.begin(),
+                                       workingDirectories.end(),
+                                       &currentDirectory));
+  }
+  fileSystem.epochs.leave(participant);
+  fileSystem.statistics.leave(shard);
+}
+
+VirtualFileSystem::Context Session::context() const {
+  return VirtualFileSystem::Context{*participant, currentDirectory, dentries,
+                                    *shard, out};
+}
+
+void Session::makeDirectory(const std::string &nameDirectory) {
+  fileSystem.makeDirectory(context(), nameDirectory);
+}
+
+void Session::changeDirectory(const std::string &nameDirectory) {
+  fileSystem.changeDirectory(context(), nameDirectory);
+}
+
+void Session::list() const { fileSystem.list(context(), std::string()); }
+
+void Session::list(const std::string &path) const {
+  fileSystem.list(context(), path);
+}
+
+void Session::list(const std::string &path,
+                   const VirtualFileSystem::ListOptions &options) const {
+  fileSystem.list(context(), path, options);
+}
+
+bool Session::forEach(const std::string &path,
+                      const VirtualFileSystem::ListOptions &options,
+                      const VirtualFileSystem::ListVisitor &visit) const {
+  return fileSystem.forEach(context(), path, options, visit);
+}
+
+void Session::remove(const std::string &name) {
+  fileSystem.remove(context(), name);
+}
+
+void Session::makeFile(const std::string &nameFile) {
+  fileSystem.makeFile(context(), nameFile);
+}
+
+void Session::copy(const std::string &source,
+                   const std::string &destination) {
+  fileSystem.copy(context(), source, destination);
+}
+
+void Session::diskUsage(const std::string &path) const {
+  fileSystem.diskUsage(context(), path);
+}
+
+void Session::find(const std::string &path, const std::string &name) const {
+  fileSystem.find(context(), path, name);
+}
+
+bool Session::write(const std::string &path, std::uint64_t offset,
+                    const char *data, std::size_t size) {
+  return fileSystem.write(context(), path, offset, data, size, false);
+}
+
+bool Session::append(const std::string &path, const char *data,
+                     std::size_t size) {
+  return fileSystem.write(context(), path, 0, data, size, true);
+}
+
+bool Session::truncate(const std::string &path, std::uint64_t size) {
+  return fileSystem.truncate(context(), path, size);
+}
+
+bool Session::read(const std::string &path, std::uint64_t offset,
+                   std::uint64_t size,
+                   const VirtualFileSystem::ReadVisitor &visit) const {
+  return fileSystem.read(context(), path, offset, size, visit);
+}
+
+void Session::complete(const std::string &prefix, std::size_t limit) const {
+  fileSystem.complete(context(), prefix, limit);
+}
+
+void Session::locate(const std::string &prefix, std::size_t limit) const {
+  fileSystem.locate(context(), prefix, limit);
+}
+
+bool Session::grep(const std::string &pattern, const std::string &path,
+                   const VirtualFileSystem::GrepVisitor &visit) const {
+  return fileSystem.grep(context(), pattern, path, visit);
+}
+
+std::string Session::currentDirectoryName() const {
+  EpochManager::Guard guard(fileSystem.epochs, *participant);
+  return currentDirectory->directoryName.str();
+}
+} // namespace vfs
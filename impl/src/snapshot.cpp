@@ -0,0 +1,54 @@
+#include "snapshot.h"
+#include "vfs.h"
+
+namespace vfs {
+
+Snapshot::Snapshot(VirtualFileSystem &fileSystem, std::uint64_t id,
+                   std::ostream &output)
+    : fileSystem(&fileSystem), id(id), out(&output),
+      participant(fileSystem.epochs.join()) {}
+
+Snapshot::~Snapshot() { release(); }
+
+Snapshot::Snapshot(Snapshot &&rhs) noexcept
+    : fileSystem(rhs.fileSystem), id(rhs.id), out(rhs.out),
+      participant(rhs.participant) {
+  rhs.fileSystem = nullptr;
+  rhs.id = 0;
+  rhs.participant = nullptr;
+}
+
+Snapshot &Snapshot::operator=(Snapshot &&rhs) noexcept {
+  if (this != &rhs) {
+    release();
+    fileSystem = rhs.fileSystem;
+    id = rhs.id;
+    out = rhs.out;
+    participant = rhs.participant;
+    rhs.fileSystem = nullptr;
+    rhs.id = 0;
+    rhs.participant = nullptr;
+  }
+  return *this;
+}
+
+void Snapshot::list(const std::string &path) const {
+  if (fileSystem != nullptr)
+    fileSystem->listSnapshot(id, *participant, path, false, *out);
+}
+
+void Snapshot::listRecursive(const std::string &path) const {
+  if (fileSystem != nullptr)
+    fileSystem->listSnapshot(id, *participant, path, true, *out);
+}
+
+void Snapshot::release() {
+  if (fileSystem == nullptr)
+    return;
+  fileSystem->releaseSnapshot(id, *participant);
+  fileSystem->epochs.leave(participant);
+  fileSystem = nullptr;
+  id = 0;
+  participant = nullptr;
+}
+} // namespace vfs
@@ -0,0 +1,86 @@
+#include "spillFile.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace vfs {
+
+bool SpillFile::open(const std::string &path) {
+  close();
+  fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0)
+    return false;
+  // file lives while it is open, nothing is left when program ends
+  ::unlink(path.c_str());
+  return true;
+}
+
+void SpillFile::close() {
+  clear();
+  if (fd < 0)
+    return;
+  ::close(fd);
+  fd = -1;
+}
+
+std::uint64_t SpillFile::allocate() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (freeSlots.empty())
+    return slotCount++;
+  const std::uint64_t slot = freeSlots.back();
+  freeSlots.pop_back();
+  return slot;
+}
+
+void SpillFile::release(std::uint64_t slot) {
+  std::lock_guard<std::mutex> lock(mutex);
+  freeSlots.push_back(slot);
+}
+
+void SpillFile::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  slotCount = 0;
+  freeSlots.clear();
+  // slots are written before they are read, file that is not truncated
+  // only takes space
+  if (fd >= 0 && ::ftruncate(fd, 0) != 0)
+    return;
+}
+
+bool SpillFile::write(std::uint64_t slot, const char *data, std::size_t size) {
+  auto offset = static_cast<off_t>(slot * slotSize);
+  while (size > 0) {
+    const ssize_t written = ::pwrite(fd, data, size, offset);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    data += written;
+    size -= static_cast<std::size_t>(written);
+    offset += written;
+  }
+  return true;
+}
+
+bool SpillFile::read(std::uint64_t slot, char *data, std::size_t size) const {
+  auto offset = static_cast<off_t>(slot * slotSize);
+  while (size > 0) {
+    const ssize_t read = ::pread(fd, data, size, offset);
+    if (read <= 0) {
+      if (read < 0 && errno == EINTR)
+        continue;
+      return false;
+    }
+    data += read;
+    size -= static_cast<std::size_t>(read);
+    offset += read;
+  }
+  return true;
+}
+
+std::size_t SpillFile::slots() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return static_cast<std::size_t>(slotCount - freeSlots.size());
+}
+} // namespace vfs
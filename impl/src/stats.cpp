@@ -0,0 +1,105 @@
+#include "stats.h"
+#include <algorithm>
+#include <cmath>
+
+namespace vfs {
+
+constexpr std::size_t Stats::operationCount;
+constexpr std::size_t Stats::counterCount;
+constexpr std::size_t Stats::bucketCount;
+
+std::uint64_t Stats::Histogram::percentile(double percentile) const {
+  if (count == 0)
+    return 0;
+  const auto rank = std::max<std::uint64_t>(
+      1, static_cast<std::uint64_t>(std::ceil(percentile / 100 * count)));
+  std::uint64_t seen = 0;
+  for (std::size_t bucket = 0; bucket < bucketCount; ++bucket) {
+    seen += buckets[bucket];
+    if (seen >= rank)
+      return std::min(bucketLimit(bucket), max);
+  }
+  return max;
+}
+
+Stats::Shard *Stats::join() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!unused.empty()) {
+    Shard *shard = unused.back();
+    unused.pop_back();
+    return shard;
+  }
+  shards.emplace_back();
+  return &shards.back();
+}
+
+void Stats::leave(Shard *shard) {
+  std::lock_guard<std::mutex> lock(mutex);
+  unused.push_back(shard);
+}
+
+Stats::Snapshot Stats::snapshot() const {
+  Snapshot merged;
+#if VFS_STATS
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const auto &shard : shards) {
+    for (std::size_t i = 0; i < operationCount; ++i) {
+      const Shard::Latencies &latencies = shard.operations[i];
+      Histogram &histogram = merged.operations[i];
+      for (std::size_t bucket = 0; bucket < bucketCount; ++bucket)
+        histogram.buckets[bucket] +=
+            latencies.buckets[bucket].load(std::memory_order_relaxed);
+      histogram.count += latencies.count.load(std::memory_order_relaxed);
+      histogram.total += latencies.total.load(std::memory_order_relaxed);
+      histogram.max = std::max(histogram.max,
+                               latencies.max.load(std::memory_order_relaxed));
+    }
+    for (std::size_t i = 0; i < counterCount; ++i)
+      merged.counters[i] += shard.counters[i].load(std::memory_order_relaxed);
+  }
+  merged.largestFanOut = largestFanOut.load(std::memory_order_relaxed);
+#endif
+  return merged;
+}
+
+const char *Stats::name(Operation operation) {
+  switch (operation) {
+  case Operation::MakeDirectory:
+    return "mkdir";
+  case Operation::ChangeDirectory:
+    return "cd";
+  case Operation::List:
+    return "ls";
+  case Operation::Remove:
+    return "rm";
+  case Operation::MakeFile:
+    return "mkfile";
+  case Operation::Copy:
+    return "cp";
+  case Operation::DiskUsage:
+    return "du";
+  case Operation::Find:
+    return "find";
+  case Operation::Read:
+    return "read";
+  case Operation::Write:
+    return "write";
+  case Operation::Decompress:
+    return "decompress";
+  case Operation::PageIn:
+    return "pagein";
+  case Operation::Grep:
+    return "grep";
+  }
+  return "";
+}
+
+std::uint64_t Stats::bucketLimit(std::size_t bucket) {
+  if (bucket < 4)
+    return bucket;
+  const std::size_t exponent = bucket / 4 + 1;
+  const std::uint64_t lower = std::uint64_t(4 + bucket % 4) << (exponent - 2);
+  // the last bucket wraps to the largest value
+  return lower + (std::uint64_t(1) << (exponent - 2)) - 1;
+}
+} // namespace vfs
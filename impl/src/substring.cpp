@@ -0,0 +1,56 @@
+#include "substring.h"
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace vfs {
+
+const char *Substring::find(const char *text, std::size_t size) const {
+  const std::size_t length = needle.size();
+  if (length == 0)
+    return text;
+  if (length > size)
+    return nullptr;
+  const char first = needle[0];
+  if (length == 1)
+    return static_cast<const char *>(std::memchr(text, first, size));
+  const char last = needle[length - 1];
+  // positions where occurrence can start
+  const std::size_t starts = size - length + 1;
+  std::size_t position = 0;
+#if defined(__SSE2__)
+  const __m128i firsts = _mm_set1_epi8(first);
+  const __m128i lasts = _mm_set1_epi8(last);
+  for (; position + 16 <= starts; position += 16) {
+    const __m128i heads = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(text + position));
+    const __m128i tails = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(text + position + length - 1));
+    unsigned candidates = static_cast<unsigned>(_mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(heads, firsts),
+                      _mm_cmpeq_epi8(tails, lasts))));
+    while (candidates != 0) {
+      const std::size_t candidate =
+          position + static_cast<std::size_t>(__builtin_ctz(candidates));
+      if (std::memcmp(text + candidate + 1, needle.data() + 1, length - 2) ==
+          0)
+        return text + candidate;
+      candidates &= candidates - 1;
+    }
+  }
+#endif
+  while (position < starts) {
+    const void *found = std::memchr(text + position, first, starts - position);
+    if (found == nullptr)
+      return nullptr;
+    position =
+        static_cast<std::size_t>(static_cast<const char *>(found) - text);
+    if (text[position + length - 1] == last &&
+        std::memcmp(text + position + 1, needle.data() + 1, length - 2) == 0)
+      return text + position;
+    ++position;
+  }
+  return nullptr;
+}
+} // namespace vfs
@@ -1,153 +1,3170 @@
 #include "vfs.h"
+#include "lz.h"
+#include "path.h"
+#include "xxHash.h"
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <numeric>
 
 namespace vfs {
 
-VirtualFileSystem::VirtualFileSystem() {
+namespace {
+// nodes that are released with one lock of the pools
+constexpr std::size_t releaseBatch = 4096;
+
+// printed when chunk of file data can't be read from backing file
+constexpr const char *unreadableData = "Can't read file data\n";
+
+// chunks that hold size bytes of file data
+std::size_t chunksFor(std::uint64_t size) {
+  return static_cast<std::size_t>(
+      (size + VirtualFileSystem::chunkSize - 1) /
+      VirtualFileSystem::chunkSize);
+}
+
+// time when chunks are used, compared with compressAfter
+std::int64_t milliseconds() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Formats timeCreated for list, nodes created in the same second, as most of
+// the nodes in directory are, reuse the formatted time and date
+class TimeFormatter {
+public:
+  const char *format(std::int64_t time) {
+    if (!valid || time != last) {
+      format_time_and_date(time, buffer);
+      last = time;
+      valid = true;
+    }
+    return buffer;
+  }
+
+private:
+  bool valid = false;
+  std::int64_t last = 0;
+  char buffer[timeFormatLength];
+};
+
+// glob matches characters of the name
+bool nameMatches(const Glob &glob, const Name &name) {
+  return glob.match(name.data(), name.size());
+}
+} // namespace
+
+const Name &VirtualFileSystem::Child::name() const {
+  return (bits & fileBit) != 0 ? file()->fileName : directory()->directoryName;
+}
+
+std::int64_t VirtualFileSystem::Child::timeCreated() const {
+  return (bits & fileBit) != 0 ? file()->timeCreated
+                               : directory()->timeCreated;
+}
+
+constexpr std::size_t VirtualFileSystem::chunkSize;
+constexpr std::size_t VirtualFileSystem::completeLimit;
+constexpr std::size_t VirtualFileSystem::locateLimit;
+constexpr std::size_t VirtualFileSystem::grepLineLimit;
+
+VirtualFileSystem::VirtualFileSystem(std::size_t threads) : workers(threads) {
+  // erased subtrees are released in background, not by rm
+  epochs.startReclaimer();
   // creating home directory in ctor
-  head = new Directory("home");
-  currentDirectory = head;
+  head = directoryPool.create(names.intern("home"), nodeMemory);
+  currentDirectory.store(head);
   head->parentDirectory = nullptr;
+  participant = epochs.join();
+  shard = statistics.join();
+  workingDirectories.push_back(&currentDirectory);
 }
 
 VirtualFileSystem::~VirtualFileSystem() {
-  currentDirectory = head;
-  deleteDirectory(currentDirectory);
-  currentDirectory = nullptr;
-  delete currentDirectory;
+  {
+    std::lock_guard<std::mutex> lock(compressorMutex);
+    compressorStopping = true;
+  }
+  compressorCondition.notify_one();
+  if (compressor.joinable())
+    compressor.join();
+  // retired directories and files are released before the pools, rest of
+  // directories and files are released with slabs of the pools
+  epochs.stopReclaimer();
+  epochs.reclaimAll();
+  for (const auto &kept : retained) {
+    if (kept.kind == Retained::Kind::Frozen)
+      delete static_cast<Frozen *>(kept.pointer);
+  }
+  currentDirectory.store(nullptr);
+  head = nullptr;
+  releaseNodes();
 }
 
-void VirtualFileSystem::deleteDirectory(Directory *directory) {
-  if (directory == nullptr)
-    return;
+void VirtualFileSystem::releaseNodes() {
+  // nodes are not visited, their children, tables and sorted children are
+  // in nodeMemory, and only nodes have handles of interned names
+  directoryPool.release();
+  filePool.release();
+  nodeMemory.release();
+  names.clear();
+}
 
-  for (auto &dir : directory->subDirectories) {
+VirtualFileSystem::Context VirtualFileSystem::context() const {
+  return Context{*participant, currentDirectory, dentries, *shard, std::cout};
+}
 
-    if (dir->files.size() > 0) {
-      for (auto &file : dir->files) {
-        delete file;
-        file = nullptr;
-      }
-      dir->files.erase(
-          std::remove(dir->files.begin(), dir->files.end(), nullptr),
-          dir->files.end());
+VirtualFileSystem::Directory *
+VirtualFileSystem::findChild(Directory *directory, const char *name,
+                             std::size_t size) const {
+  materialize(directory);
+  return directory->children.find(name, size).directory();
+}
+
+VirtualFileSystem::Directory *
+VirtualFileSystem::findDirectory(Directory *currentDirectory,
+                                 DentryCache<Directory> &cache,
+                                 Stats::Shard &shard, const char *path,
+                                 std::size_t size) const {
+  const bool absolute = size > 0 && path[0] == '/';
+  const bool cached = std::memchr(path, '/', size) != nullptr;
+  const Directory *base = absolute ? nullptr : currentDirectory;
+  const std::uint64_t currentGeneration = generation.load();
+  if (cached) {
+    Directory *directory = cache.find(base, path, size, currentGeneration);
+    if (directory != nullptr) {
+      shard.count(Stats::Counter::DentryHits);
+      return directory;
+    }
+  }
+
+  // absolute path starts above head, its first component is name of head
+  Directory *directory = absolute ? nullptr : currentDirectory;
+  std::size_t position = 0, length = 0;
+  const char *name = nullptr;
+  while (nextComponent(path, size, position, name, length)) {
+    if (directory == nullptr) {
+      if (length != head->directoryName.size() ||
+          std::memcmp(name, head->directoryName.data(), length) != 0)
+        return nullptr;
+      directory = head;
+    } else if (isCurrentDirectory(name, length)) {
+      continue;
+    } else if (isParentDirectory(name, length)) {
+      if (directory->parentDirectory != nullptr)
+        directory = directory->parentDirectory;
+    } else {
+      shard.count(Stats::Counter::Lookups);
+      directory = findChild(directory, name, length);
+      if (directory == nullptr)
+        return nullptr;
     }
-    deleteDirectory(dir);
   }
-  delete directory;
+  if (directory == nullptr) // path is only /
+    directory = head;
+
+  if (cached)
+    cache.insert(base, path, size, directory, currentGeneration);
+  return directory;
+}
+
+VirtualFileSystem::Directory *
+VirtualFileSystem::findParent(Directory *currentDirectory,
+                              DentryCache<Directory> &cache,
+                              Stats::Shard &shard, const std::string &path,
+                              std::size_t &leafStart,
+                              std::size_t &leafSize) const {
+  const std::size_t parentSize = splitPath(path, leafStart, leafSize);
+  if (parentSize == std::string::npos) // name in currentDirectory
+    return currentDirectory;
+  if (parentSize == 0) // parent is above head
+    return nullptr;
+  return findDirectory(currentDirectory, cache, shard, path.data(),
+                       parentSize);
 }
 
 void VirtualFileSystem::makeDirectory(const std::string &nameDirectory) {
-  Directory *temp = new Directory(nameDirectory);
-  temp->parentDirectory = currentDirectory;
-  currentDirectory->subDirectories.push_back(temp);
+  makeDirectory(context(), nameDirectory);
+}
+
+void VirtualFileSystem::makeDirectory(const Context &context,
+                                      const std::string &nameDirectory,
+                                      std::int64_t timeCreated) {
+  Stats::Timer timer(context.shard, Stats::Operation::MakeDirectory);
+  EpochManager::Guard guard(epochs, context.participant);
+  std::size_t leafStart = 0, leafSize = 0;
+  Directory *parent =
+      findParent(context.currentDirectory, context.dentries, context.shard,
+                 nameDirectory, leafStart, leafSize);
+  if (parent == nullptr) {
+    context.out << noSuchDirectory;
+    return;
+  }
+  if (!isValidName(nameDirectory.data() + leafStart, leafSize)) {
+    context.out << invalidCommand;
+    return;
+  }
+
+  materialize(parent);
+  Directory *temp = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    temp = directoryPool.create(
+        names.intern(nameDirectory.data() + leafStart, leafSize), nodeMemory);
+  }
+  temp->parentDirectory = parent;
+  if (timeCreated != 0)
+    temp->timeCreated = timeCreated;
+  // checkpoint and snapshot are taken between mutations
+  std::shared_lock<std::shared_timed_mutex> mutation(mutationMutex);
+  bool removed = false, inserted = false;
+  std::uint64_t sequence = 0;
+  {
+    // directory is written before it is published to readers, it is
+    // journaled in the same order in which it is published
+    std::lock_guard<std::mutex> lock(parent->mutex);
+    removed = parent->removed.load();
+    inserted = !removed && !parent->children.find(temp->directoryName);
+    if (inserted) {
+      const Child added(temp);
+      freeze(parent, &added, 1, true);
+      parent->children.insert(Child(temp), epochs);
+      parent->subDirectories.push_back(temp, epochs);
+      changed(parent, &added, 1, true);
+      statistics.fanOut(parent->children.size());
+      indexTree(parent, Child(temp));
+      sequence = record(Journal::Operation::MakeDirectory, parent,
+                        temp->directoryName, temp->timeCreated);
+    }
+  }
+  if (inserted) {
+    waitDurable(sequence, context.out);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    directoryPool.destroy(temp);
+  }
+  context.out << (removed ? noSuchDirectory
+                          : alreadyExists);
 }
 
 void VirtualFileSystem::changeDirectory(const std::string &nameDirectory) {
-  if ((nameDirectory.empty() && currentDirectory == head) ||
-      (nameDirectory == ".." && currentDirectory == head) ||
-      (nameDirectory.empty() &&
-       currentDirectory != head)) { // cd  - goes to home directory
-    currentDirectory = head;
-  } else if (nameDirectory == ".." &&
-             currentDirectory->parentDirectory !=
-                 nullptr) { // cd ..  - goes to parent directory
-    currentDirectory = currentDirectory->parentDirectory;
-  } else if (!nameDirectory.empty()) { // cd someDirectory - goes to
-                                       // subDirectory, if exists
-    if (currentDirectory->subDirectories.size() != 0) {
-      bool match = false;
-      auto matchDirectory = currentDirectory;
-      for (const auto &dir : currentDirectory->subDirectories) {
-        if (dir->directoryName == nameDirectory) {
-          match = true;
-          matchDirectory = dir;
-        }
+  changeDirectory(context(), nameDirectory);
+}
+
+void VirtualFileSystem::changeDirectory(const Context &context,
+                                        const std::string &nameDirectory) {
+  Stats::Timer timer(context.shard, Stats::Operation::ChangeDirectory);
+  EpochManager::Guard guard(epochs, context.participant);
+  Directory *current = context.currentDirectory;
+  for (;;) {
+    const std::uint64_t startGeneration = generation.load();
+    // cd  - goes to home directory
+    // cd .., cd someDirectory or cd some/path - goes to directory, if exists
+    Directory *directory =
+        nameDirectory.empty()
+            ? head
+            : findDirectory(current, context.dentries, context.shard,
+                            nameDirectory.data(), nameDirectory.size());
+    if (directory == nullptr) {
+      context.out << noSuchDirectory; // if subDirectory doesn't exist
+      return;
+    }
+    // current directory is moved by rm, if it was moved meanwhile, path is
+    // resolved again from the new current directory
+    if (!context.currentDirectory.compareExchange(current, directory))
+      continue;
+    // directory could be removed while path was resolved
+    if (generation.load() != startGeneration)
+      leaveRemoved(context.currentDirectory);
+    return;
+  }
+}
+
+void VirtualFileSystem::list() const { list(context(), std::string()); }
+
+void VirtualFileSystem::list(const std::string &path) const {
+  list(context(), path);
+}
+
+void VirtualFileSystem::list(const Context &context,
+                             const std::string &path) const {
+  Stats::Timer timer(context.shard, Stats::Operation::List);
+  EpochManager::Guard guard(epochs, context.participant);
+  if (Glob::isPattern(path)) { // ls a/*.log lists matching children of a
+    std::size_t leafStart = 0, leafSize = 0;
+    Directory *parent =
+        findParent(context.currentDirectory, context.dentries, context.shard,
+                   path, leafStart, leafSize);
+    if (parent == nullptr) {
+      context.out << noSuchDirectory;
+      return;
+    }
+    std::vector<Child> matches;
+    matchChildren(parent, Glob(path.substr(leafStart, leafSize)), true,
+                  matches);
+    if (matches.empty())
+      context.out << "No such directory or file\n";
+    TimeFormatter formatter;
+    for (const auto &child : matches) {
+      context.out << (child.directory() != nullptr ? "d------ " : "f------ ");
+      context.out.write(formatter.format(child.timeCreated()),
+                        timeFormatLength);
+      context.out << " " << child.name() << '\n';
+    }
+    return;
+  }
+  const Directory *directory =
+      path.empty() ? context.currentDirectory
+                   : findDirectory(context.currentDirectory, context.dentries,
+                                   context.shard, path.data(), path.size());
+  if (directory == nullptr) {
+    context.out << noSuchDirectory;
+    return;
+  }
+  listDirectory(directory, context.out);
+}
+
+void VirtualFileSystem::list(const std::string &path,
+                             const ListOptions &options) const {
+  list(context(), path, options);
+}
+
+void VirtualFileSystem::list(const Context &context, const std::string &path,
+                             const ListOptions &options) const {
+  // one more child is visited, to know if there is next page
+  ListOptions page = options;
+  if (page.limit != 0)
+    ++page.limit;
+  const bool byTime = options.order == Order::Time;
+  TimeFormatter formatter;
+  std::size_t listed = 0;
+  bool more = false;
+  std::string cursor;
+  std::ostream &out = context.out;
+  const bool listable = forEach(context, path, page, [&](const Entry &entry) {
+    if (options.limit != 0 && listed == options.limit) {
+      more = true;
+      return false;
+    }
+    out << (entry.directory ? "d------ " : "f------ ");
+    out.write(formatter.format(entry.timeCreated), timeFormatLength);
+    out << " " << entry.name << '\n';
+    if (++listed == options.limit)
+      cursor = byTime ? std::to_string(entry.timeCreated) + "/" + entry.name
+                      : entry.name;
+    return true;
+  });
+  if (!listable)
+    return;
+  if (listed == 0 && options.after.empty())
+    out << emptyDirectory;
+  if (more)
+    out << "Next page: --after " << cursor << '\n';
+}
+
+bool VirtualFileSystem::forEach(const std::string &path,
+                                const ListOptions &options,
+                                const ListVisitor &visit) const {
+  return forEach(context(), path, options, visit);
+}
+
+bool VirtualFileSystem::forEach(const Context &context,
+                                const std::string &path,
+                                const ListOptions &options,
+                                const ListVisitor &visit) const {
+  Stats::Timer timer(context.shard, Stats::Operation::List);
+  EpochManager::Guard guard(epochs, context.participant);
+  Directory *directory =
+      path.empty() ? context.currentDirectory
+                   : findDirectory(context.currentDirectory, context.dentries,
+                                   context.shard, path.data(), path.size());
+  if (directory == nullptr) {
+    context.out << noSuchDirectory;
+    return false;
+  }
+  if (options.order == Order::Insertion && options.limit == 0 &&
+      options.after.empty()) {
+    materialize(directory);
+    // names are copied to one buffer, short names without allocation
+    std::string name;
+    for (auto subDirectory : directory->subDirectories.snapshot()) {
+      const Name &directoryName = subDirectory->directoryName;
+      name.assign(directoryName.data(), directoryName.size());
+      if (!visit(Entry{true, name, subDirectory->timeCreated}))
+        return true;
+    }
+    for (auto file : directory->files.snapshot()) {
+      name.assign(file->fileName.data(), file->fileName.size());
+      if (!visit(Entry{false, name, file->timeCreated}))
+        return true;
+    }
+    return true;
+  }
+
+  // page starts after the cursor, it is found with binary search
+  const Order order = options.order == Order::Time ? Order::Time : Order::Name;
+  std::int64_t afterTime = 0;
+  std::string afterName = options.after;
+  if (order == Order::Time && !options.after.empty()) {
+    const std::size_t slash = options.after.find('/');
+    char *end = nullptr;
+    afterTime = std::strtoll(options.after.c_str(), &end, 10);
+    if (slash == std::string::npos || slash == 0 ||
+        end != options.after.c_str() + slash) {
+      context.out << "Invalid cursor\n";
+      return false;
+    }
+    afterName = options.after.substr(slash + 1);
+  }
+  const Sorted *sorted = sortedChildren(directory, order);
+  auto child = sorted->begin();
+  if (!options.after.empty()) {
+    child = std::upper_bound(
+        sorted->begin(), sorted->end(), afterName,
+        [order, afterTime](const std::string &name, const Child &next) {
+          if (order == Order::Time && afterTime != next.timeCreated())
+            return afterTime < next.timeCreated();
+          return next.name().compare(name.data(), name.size()) > 0;
+        });
+  }
+  std::string name;
+  for (std::size_t visited = 0; child != sorted->end() &&
+                                (options.limit == 0 || visited < options.limit);
+       ++child, ++visited) {
+    name.assign(child->name().data(), child->name().size());
+    if (!visit(Entry{child->directory() != nullptr, name,
+                     child->timeCreated()}))
+      break;
+  }
+  return true;
+}
+
+const VirtualFileSystem::Sorted *
+VirtualFileSystem::sortedChildren(Directory *directory, Order order) const {
+  std::atomic<Sorted *> &cached =
+      order == Order::Time ? directory->byTime : directory->byName;
+  const std::atomic<Sorted *> &other =
+      order == Order::Time ? directory->byName : directory->byTime;
+  materialize(directory);
+  // changes are read before children, so children are at least as new
+  const std::uint64_t changes =
+      directory->changes.load(std::memory_order_acquire);
+  Sorted *current = cached.load(std::memory_order_acquire);
+  if (current != nullptr && current->changes == changes)
+    return current;
+
+  Sorted *sorted = nullptr;
+  if (current != nullptr) {
+    std::vector<Change> recent;
+    std::uint64_t version = 0;
+    bool logged = false;
+    {
+      std::lock_guard<std::mutex> lock(directory->mutex);
+      version = directory->changes.load(std::memory_order_relaxed);
+      logged = current->changes >= directory->recentSince;
+      ChangeLog *log = directory->recent;
+      for (std::size_t i = 0; logged && log != nullptr && i < log->size; ++i) {
+        if (log->at(i).changes > current->changes)
+          recent.push_back(log->at(i));
       }
-      if (match) {
-        currentDirectory = matchDirectory;
-      } else {
-        std::cout << "No such directory"
-                  << std::endl; // if subDirectory doesn't exist
+      // changes that both sorted children have are not merged again
+      const Sorted *otherSorted = other.load(std::memory_order_acquire);
+      const std::uint64_t merged =
+          otherSorted == nullptr ? version
+                                 : std::min(version, otherSorted->changes);
+      while (log != nullptr && log->size != 0 &&
+             log->at(0).changes <= merged) {
+        ++log->first;
+        --log->size;
       }
-    } else {
-      std::cout << "No such directory"
-                << std::endl; // if subDirectory doesn't exist
+      directory->recentSince = std::max(directory->recentSince, merged);
     }
+    if (logged)
+      sorted = mergeSorted(current, order, recent, version);
+  }
+
+  if (sorted == nullptr) {
+    std::vector<Child> children;
+    children.reserve(directory->subDirectories.size() +
+                     directory->files.size());
+    for (auto subDirectory : directory->subDirectories.snapshot())
+      children.push_back(Child(subDirectory));
+    for (auto file : directory->files.snapshot())
+      children.push_back(Child(file));
+    sorted = createSorted(changes, children.size());
+    std::copy(children.begin(), children.end(), sorted->begin());
+    std::sort(sorted->begin(), sorted->end(),
+              [order](const Child &lhs, const Child &rhs) {
+                return before(lhs, rhs, order);
+              });
+  }
+
+  // replaced children are retired, readers can still page through them
+  if (cached.compare_exchange_strong(current, sorted)) {
+    if (current != nullptr)
+      retireSorted(current);
+  } else { // other reader sorted them meanwhile, these are used only here
+    retireSorted(sorted);
+  }
+  return sorted;
+}
+
+VirtualFileSystem::Sorted *
+VirtualFileSystem::mergeSorted(const Sorted *current, Order order,
+                               std::vector<Change> &changes,
+                               std::uint64_t version) const {
+  // the last change of the child decides if it is merged in, children that
+  // were removed may be in current, they are compared only as pointers
+  std::stable_sort(changes.begin(), changes.end(),
+                   [](const Change &lhs, const Change &rhs) {
+                     return lhs.child.toBits() < rhs.child.toBits();
+                   });
+  std::vector<std::uintptr_t> mentioned;
+  std::vector<Child> added;
+  for (std::size_t i = 0; i < changes.size(); ++i) {
+    const std::uintptr_t bits = changes[i].child.toBits();
+    if (i + 1 != changes.size() && changes[i + 1].child.toBits() == bits)
+      continue;
+    mentioned.push_back(bits);
+    if (changes[i].added)
+      added.push_back(changes[i].child);
+  }
+  std::sort(added.begin(), added.end(),
+            [order](const Child &lhs, const Child &rhs) {
+              return before(lhs, rhs, order);
+            });
+  auto kept = [&mentioned](const Child &child) {
+    return !std::binary_search(mentioned.begin(), mentioned.end(),
+                               child.toBits());
+  };
+
+  const std::size_t size =
+      static_cast<std::size_t>(
+          std::count_if(current->begin(), current->end(), kept)) +
+      added.size();
+  Sorted *sorted = createSorted(version, size);
+  Child *next = sorted->begin();
+  auto fresh = added.begin();
+  for (const auto &child : *current) {
+    if (!kept(child))
+      continue;
+    while (fresh != added.end() && before(*fresh, child, order))
+      *next++ = *fresh++;
+    *next++ = child;
+  }
+  std::copy(fresh, added.end(), next);
+  return sorted;
+}
+
+bool VirtualFileSystem::before(const Child &lhs, const Child &rhs,
+                               Order order) {
+  if (order == Order::Time && lhs.timeCreated() != rhs.timeCreated())
+    return lhs.timeCreated() < rhs.timeCreated();
+  return lhs.name() < rhs.name();
+}
 
+void VirtualFileSystem::changed(Directory *directory, const Child *children,
+                                std::size_t count, bool added) {
+  const std::uint64_t changes =
+      directory->changes.load(std::memory_order_relaxed) + 1;
+  const bool sorted =
+      directory->byName.load(std::memory_order_relaxed) != nullptr ||
+      directory->byTime.load(std::memory_order_relaxed) != nullptr;
+  // merging many changes costs as much as sorting all children again
+  const std::size_t logged =
+      directory->recent == nullptr ? 0 : directory->recent->size;
+  if (!sorted || logged + count > 16 + directory->children.size() / 4) {
+    if (directory->recent != nullptr)
+      directory->recent->size = 0;
+    directory->recentSince = changes;
   } else {
-    std::cout << "Invalid command" << std::endl;
+    for (std::size_t i = 0; i < count; ++i)
+      logChange(directory, Change{changes, children[i], added});
+  }
+  directory->changes.store(changes, std::memory_order_release);
+}
+
+void VirtualFileSystem::logChange(Directory *directory, const Change &change) {
+  ChangeLog *log = directory->recent;
+  if (log == nullptr || log->size == log->capacity) {
+    const std::size_t capacity = log == nullptr ? 8 : log->capacity * 2;
+    ChangeLog *grown = new (nodeMemory.allocate(
+        sizeof(ChangeLog) + capacity * sizeof(Change))) ChangeLog{capacity,
+                                                                  0, 0};
+    for (; log != nullptr && grown->size < log->size; ++grown->size)
+      new (&grown->at(grown->size)) Change(log->at(grown->size));
+    destroyLog(nodeMemory, log);
+    directory->recent = log = grown;
   }
+  new (&log->at(log->size)) Change(change);
+  ++log->size;
+}
+
+void VirtualFileSystem::destroyLog(BlockArena &memory, ChangeLog *log) {
+  if (log == nullptr)
+    return;
+  const std::size_t bytes = sizeof(ChangeLog) + log->capacity * sizeof(Change);
+  log->~ChangeLog();
+  memory.deallocate(log, bytes);
 }
 
-void VirtualFileSystem::list() const {
-  if (currentDirectory->subDirectories.size() == 0 &&
-      currentDirectory->files.size() == 0)
-    std::cout << "Empty directory " << std::endl;
-  if (currentDirectory->subDirectories.size() > 0 &&
-      currentDirectory->subDirectories.at(0) != nullptr) {
-    for (const auto &dir : currentDirectory->subDirectories) {
-      std::cout << "d------ " << dir->timeCreated << " " << dir->directoryName
-                << std::endl; // list directories
+void VirtualFileSystem::matchChildren(Directory *directory, const Glob &glob,
+                                      bool sorted,
+                                      std::vector<Child> &matches) const {
+  materialize(directory);
+  const std::string &prefix = glob.prefix();
+  const Sorted *byName = directory->byName.load(std::memory_order_acquire);
+  if (!prefix.empty() &&
+      (sorted || (byName != nullptr &&
+                  byName->changes == directory->changes.load(
+                                         std::memory_order_acquire)))) {
+    // only names with the prefix are compared, they are one range of names
+    // sorted by name
+    byName = sortedChildren(directory, Order::Name);
+    auto child = std::lower_bound(
+        byName->begin(), byName->end(), prefix,
+        [](const Child &next, const std::string &name) {
+          return next.name().compare(name.data(), name.size()) < 0;
+        });
+    for (; child != byName->end() &&
+           child->name().size() >= prefix.size() &&
+           std::memcmp(child->name().data(), prefix.data(), prefix.size()) ==
+               0;
+         ++child) {
+      if (nameMatches(glob, child->name()))
+        matches.push_back(*child);
     }
+    return;
+  }
+
+  for (auto subDirectory : directory->subDirectories.snapshot()) {
+    if (nameMatches(glob, subDirectory->directoryName))
+      matches.push_back(Child(subDirectory));
+  }
+  for (auto file : directory->files.snapshot()) {
+    if (nameMatches(glob, file->fileName))
+      matches.push_back(Child(file));
+  }
+  if (sorted)
+    std::sort(matches.begin(), matches.end(),
+              [](const Child &lhs, const Child &rhs) {
+                return lhs.name() < rhs.name();
+              });
+}
+
+void VirtualFileSystem::listDirectory(const Directory *directory,
+                                      std::ostream &out) const {
+  const ImageNode *node = directory->image.load(std::memory_order_acquire);
+  if (node != nullptr) { // listed from image, without copying it
+    listImage(node, out);
+    return;
+  }
+  listChildren(directory->subDirectories.snapshot(),
+               directory->files.snapshot(), out);
+}
+
+template <typename Directories, typename Files>
+void VirtualFileSystem::listChildren(const Directories &subDirectories,
+                                     const Files &files,
+                                     std::ostream &out) const {
+  TimeFormatter formatter;
+  if (!(subDirectories.begin() != subDirectories.end()) &&
+      !(files.begin() != files.end()))
+    out << emptyDirectory;
+  for (const auto &dir : subDirectories) { // list directories
+    out << "d------ ";
+    out.write(formatter.format(dir->timeCreated), timeFormatLength);
+    out << " " << dir->directoryName << '\n';
+  }
+  for (const auto &file : files) { // list files
+    out << "f------ ";
+    out.write(formatter.format(file->timeCreated), timeFormatLength);
+    out << " " << file->fileName << '\n';
+  }
+}
+
+void VirtualFileSystem::listImage(const ImageNode *node,
+                                  std::ostream &out) const {
+  TimeFormatter formatter;
+  if (node->directoryCount == 0 && node->fileCount == 0)
+    out << emptyDirectory;
+  for (std::size_t i = 0; i < node->directoryCount + node->fileCount; ++i) {
+    const ImageNode *child = mappedImage.child(node, i);
+    const char *name = child == nullptr ? nullptr : mappedImage.name(child);
+    if (name == nullptr)
+      continue;
+    out << (i < node->directoryCount ? "d------ " : "f------ ");
+    out.write(formatter.format(child->timeCreated), timeFormatLength);
+    out << " ";
+    out.write(name, child->nameSize);
+    out << '\n';
   }
-  if (currentDirectory->files.size() > 0 &&
-      currentDirectory->files.at(0) != nullptr) { // list files
-    for (const auto &file : currentDirectory->files) {
-      std::cout << "f------ " << file->timeCreated << " " << file->fileName
-                << std::endl;
+}
+
+void VirtualFileSystem::materialize(Directory *directory) const {
+  if (directory->image.load(std::memory_order_acquire) == nullptr)
+    return;
+  std::lock_guard<std::mutex> lock(directory->mutex);
+  const ImageNode *node = directory->image.load(std::memory_order_relaxed);
+  if (node == nullptr) // materialized meanwhile
+    return;
+
+  // nodes are created first, index and lists can release retired memory
+  // to the pools
+  std::vector<Directory *> subDirectories;
+  std::vector<File *> files;
+  std::vector<const ImageNode *> fileNodes;
+  {
+    std::lock_guard<std::mutex> pool(poolMutex);
+    for (std::size_t i = 0; i < node->directoryCount + node->fileCount; ++i) {
+      const ImageNode *child = mappedImage.child(node, i);
+      const char *name = child == nullptr ? nullptr : mappedImage.name(child);
+      if (name == nullptr)
+        continue;
+      if (i < node->directoryCount) {
+        Directory *created = directoryPool.create(
+            names.intern(name, child->nameSize), nodeMemory);
+        created->timeCreated = child->timeCreated;
+        created->parentDirectory = directory;
+        created->image.store(child, std::memory_order_relaxed);
+        subDirectories.push_back(created);
+      } else {
+        File *created = filePool.create(names.intern(name, child->nameSize));
+        created->timeCreated = child->timeCreated;
+        files.push_back(created);
+        fileNodes.push_back(child);
+      }
     }
   }
+  // data is copied before files are published, directory is locked like
+  // parent of written file
+  for (std::size_t i = 0; i < files.size(); ++i) {
+    const char *bytes = mappedImage.fileData(fileNodes[i]);
+    if (bytes != nullptr)
+      writeData(files[i], 0, bytes,
+                static_cast<std::size_t>(fileNodes[i]->dataSize));
+  }
+
+  std::vector<Directory *> duplicateDirectories;
+  std::vector<File *> duplicateFiles;
+  for (auto created : subDirectories) {
+    if (directory->children.insert(Child(created), epochs))
+      directory->subDirectories.push_back(created, epochs);
+    else
+      duplicateDirectories.push_back(created);
+  }
+  for (auto created : files) {
+    if (directory->children.insert(Child(created), epochs))
+      directory->files.push_back(created, epochs);
+    else
+      duplicateFiles.push_back(created);
+  }
+  directory->image.store(nullptr, std::memory_order_release);
+
+  if (!duplicateDirectories.empty() || !duplicateFiles.empty()) {
+    std::lock_guard<std::mutex> pool(poolMutex);
+    for (auto duplicate : duplicateDirectories)
+      directoryPool.destroy(duplicate);
+    for (auto duplicate : duplicateFiles)
+      filePool.destroy(duplicate);
+  }
 }
 
 void VirtualFileSystem::remove(const std::string &name) {
-  if (currentDirectory->subDirectories.size() > 0) { // remove directory
-    for (auto &dir : currentDirectory->subDirectories) {
-      if (dir->directoryName == name) {
-        // remove all files in directory, before erasing directory
-        for (auto &file : dir->files) {
-          delete file;
-          file = nullptr;
+  remove(context(), name);
+}
+
+void VirtualFileSystem::remove(const Context &context, const std::string &name,
+                               bool expand) {
+  Stats::Timer timer(context.shard, Stats::Operation::Remove);
+  EpochManager::Guard guard(epochs, context.participant);
+  std::size_t leafStart = 0, leafSize = 0;
+  Directory *parent =
+      findParent(context.currentDirectory, context.dentries, context.shard,
+                 name, leafStart, leafSize);
+  if (parent == nullptr) {
+    context.out << noSuchDirectory;
+    return;
+  }
+  if (!isValidName(name.data() + leafStart, leafSize)) {
+    context.out << invalidCommand;
+    return;
+  }
+
+  // only parent, and directory that is removed, are locked
+  materialize(parent);
+  // checkpoint and snapshot are taken between mutations
+  std::shared_lock<std::shared_timed_mutex> mutation(mutationMutex);
+  std::uint64_t sequence = 0;
+  {
+    std::lock_guard<std::mutex> lock(parent->mutex);
+    if (parent->removed.load()) {
+      context.out << noSuchDirectory;
+      return;
+    }
+    if (expand && Glob::isPattern(name.data() + leafStart, leafSize)) {
+      sequence = removeMatching(parent, Glob(name.substr(leafStart, leafSize)));
+    } else {
+      const Child found =
+          parent->children.find(name.data() + leafStart, leafSize);
+      if (!found)
+        return;
+      sequence = record(Journal::Operation::Remove, parent, found.name(), 0);
+      freeze(parent, &found, 1, false);
+      if (found.directory() != nullptr) { // remove directory
+        eraseDirectory(parent, found.directory());
+      } else { // remove file
+        File *file = found.file();
+        parent->children.erase(file->fileName);
+        parent->files.erase(file, epochs);
+        changed(parent, &found, 1, false);
+        unindexFile(parent, file);
+        retain(Retained::Kind::File, file);
+      }
+    }
+  }
+  waitDurable(sequence, context.out);
+}
+
+std::uint64_t VirtualFileSystem::record(Journal::Operation operation,
+                                        const Directory *parent,
+                                        const Name &name,
+                                        std::int64_t timeCreated,
+                                        std::uint64_t offset,
+                                        const char *bytes, std::size_t size) {
+  if (!journal.isOpen())
+    return 0;
+  return journal.append(operation, timeCreated, pathOf(parent, name), offset,
+                        bytes, size);
+}
+
+std::uint64_t VirtualFileSystem::recordData(const Directory *parent,
+                                            const File *file,
+                                            std::uint64_t sequence,
+                                            std::ostream &out) {
+  if (!journal.isOpen())
+    return sequence;
+  std::uint64_t offset = 0;
+  if (!visitData(file, [&](const char *bytes, std::size_t size) {
+        sequence = record(Journal::Operation::Write, parent, file->fileName,
+                          0, offset, bytes, size);
+        offset += size;
+        return true;
+      }))
+    out << unreadableData;
+  return sequence;
+}
+
+std::uint64_t VirtualFileSystem::recordTree(const Directory *directory,
+                                            std::ostream &out) {
+  if (!journal.isOpen())
+    return 0;
+  std::uint64_t sequence = 0;
+  std::vector<const Directory *> stack{directory};
+  while (!stack.empty()) {
+    const Directory *current = stack.back();
+    stack.pop_back();
+    sequence = record(Journal::Operation::MakeDirectory,
+                      current->parentDirectory, current->directoryName,
+                      current->timeCreated);
+    for (auto file : current->files.snapshot()) {
+      sequence = record(Journal::Operation::MakeFile, current, file->fileName,
+                        file->timeCreated);
+      sequence = recordData(current, file, sequence, out);
+    }
+    for (auto subDirectory : current->subDirectories.snapshot())
+      stack.push_back(subDirectory);
+  }
+  return sequence;
+}
+
+std::string VirtualFileSystem::pathOf(const Directory *parent,
+                                      const Name &name) {
+  std::vector<const Name *> components{&name};
+  for (const Directory *up = parent; up != nullptr; up = up->parentDirectory)
+    components.push_back(&up->directoryName);
+  std::string path;
+  for (auto component = components.rbegin(); component != components.rend();
+       ++component) {
+    path += '/';
+    path.append((*component)->data(), (*component)->size());
+  }
+  return path;
+}
+
+void VirtualFileSystem::waitDurable(std::uint64_t sequence, std::ostream &out) {
+  if (sequence != 0 && !journal.waitDurable(sequence))
+    out << "Can't write journal\n";
+}
+
+void VirtualFileSystem::leaveRemoved(
+    const DirectoryPointer &currentDirectory) const {
+  Directory *directory = currentDirectory;
+  for (;;) {
+    // parent of the highest removed directory is not removed
+    Directory *target = directory;
+    for (Directory *up = directory; up != nullptr; up = up->parentDirectory) {
+      if (up->removed.load())
+        target = up->parentDirectory;
+    }
+    if (target == directory ||
+        currentDirectory.compareExchange(directory, target))
+      return;
+  }
+}
+
+void VirtualFileSystem::eraseDirectory(Directory *parent,
+                                       Directory *directory) {
+  {
+    // nothing can be created in directory once it is removed
+    std::lock_guard<std::mutex> lock(directory->mutex);
+    directory->removed.store(true);
+  }
+  parent->children.erase(directory->directoryName);
+  parent->subDirectories.erase(directory, epochs);
+  const Child erased(directory);
+  changed(parent, &erased, 1, false);
+  ++generation;
+  leaveRemovedAll();
+
+  // directory and its files are released when no reader, and no snapshot,
+  // can see them
+  retain(Retained::Kind::Directory, directory);
+}
+
+void VirtualFileSystem::leaveRemovedAll() {
+  // current directories can't stay in erased directory
+  std::lock_guard<std::mutex> lock(sessionMutex);
+  for (auto workingDirectory : workingDirectories)
+    leaveRemoved(*workingDirectory);
+}
+
+std::uint64_t VirtualFileSystem::removeMatching(Directory *parent,
+                                                const Glob &glob) {
+  std::vector<Child> matches;
+  matchChildren(parent, glob, false, matches);
+  if (matches.empty())
+    return 0;
+  freeze(parent, matches.data(), matches.size(), false);
+  std::uint64_t sequence = 0;
+  bool directories = false;
+  for (const auto &child : matches) {
+    sequence = record(Journal::Operation::Remove, parent, child.name(), 0);
+    parent->children.erase(child.name());
+    if (child.directory() != nullptr) {
+      std::lock_guard<std::mutex> lock(child.directory()->mutex);
+      child.directory()->removed.store(true);
+      directories = true;
+    } else {
+      unindexFile(parent, child.file());
+    }
+  }
+  // every list is copied once, without all matching children
+  parent->subDirectories.eraseIf(
+      [&glob](const Directory *directory) {
+        return nameMatches(glob, directory->directoryName);
+      },
+      epochs);
+  parent->files.eraseIf(
+      [&glob](const File *file) { return nameMatches(glob, file->fileName); },
+      epochs);
+  changed(parent, matches.data(), matches.size(), false);
+  if (directories) {
+    ++generation;
+    leaveRemovedAll();
+  }
+  retain(std::move(matches));
+  return sequence;
+}
+
+void VirtualFileSystem::freeze(Directory *directory, const Child *children,
+                               std::size_t count, bool added) {
+  Frozen *frozen = directory->frozen.load(std::memory_order_relaxed);
+  // directory that was already changed since the last snapshot has Frozen
+  if (frozen == nullptr || frozen->version != version) {
+    {
+      std::lock_guard<std::mutex> lock(snapshotMutex);
+      if (liveSnapshots.empty())
+        return;
+      frozen = new Frozen(version, directory);
+      retained.push_back(
+          Retained{version, Retained::Kind::Frozen, frozen, directory});
+    }
+    directory->subDirectories.pinSlots(true);
+    directory->files.pinSlots(true);
+    // changes are published before directory is changed
+    directory->frozen.store(frozen, std::memory_order_release);
+  }
+  for (std::size_t i = 0; i < count; ++i) {
+    const Child &child = children[i];
+    const std::size_t slot = added ? 0
+                             : child.directory() != nullptr
+                                 ? child.directory()->listSlot
+                                 : child.file()->listSlot;
+    frozen->changes.push_back(FrozenChange{child, slot, added});
+  }
+}
+
+void VirtualFileSystem::retain(Retained::Kind kind, void *pointer) {
+  {
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    if (!liveSnapshots.empty()) {
+      retained.push_back(Retained{version, kind, pointer, nullptr});
+      return;
+    }
+  }
+  epochs.retire(pointer,
+                kind == Retained::Kind::Directory ? releaseDirectory
+                                                  : releaseFile,
+                this);
+}
+
+void VirtualFileSystem::retain(std::vector<Child> &&children) {
+  {
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    if (!liveSnapshots.empty()) {
+      for (const auto &child : children) {
+        if (child.directory() != nullptr)
+          retained.push_back(Retained{version, Retained::Kind::Directory,
+                                      child.directory(), nullptr});
+        else
+          retained.push_back(
+              Retained{version, Retained::Kind::File, child.file(), nullptr});
+      }
+      return;
+    }
+  }
+  // children are retired as one batch
+  epochs.retire(new std::vector<Child>(std::move(children)), releaseChildren,
+                this);
+}
+
+const VirtualFileSystem::Frozen *
+VirtualFileSystem::frozenAt(const Directory *directory,
+                            std::uint64_t version) {
+  const Frozen *found = nullptr;
+  for (const Frozen *frozen = directory->frozen.load(std::memory_order_acquire);
+       frozen != nullptr && frozen->version > version;
+       frozen = frozen->next.load(std::memory_order_acquire))
+    found = frozen;
+  return found;
+}
+
+VirtualFileSystem::Listing
+VirtualFileSystem::snapshotChildren(Directory *directory,
+                                    std::uint64_t version) const {
+  materialize(directory);
+  if (frozenAt(directory, version) == nullptr) {
+    const auto subDirectories = directory->subDirectories.snapshot();
+    const auto files = directory->files.snapshot();
+    Listing live{{subDirectories.begin(), subDirectories.end()},
+                 {files.begin(), files.end()}};
+    // directory could be changed while its children were read, changes are
+    // kept before it is changed, and erased child is seen only after them
+    if (frozenAt(directory, version) == nullptr)
+      return live;
+  }
+
+  // the first change of the child after the snapshot tells if snapshot has
+  // it, newer Frozen are first, so they are collected in reverse
+  std::lock_guard<std::mutex> lock(directory->mutex);
+  std::vector<const Frozen *> newer;
+  for (const Frozen *frozen = directory->frozen.load(std::memory_order_relaxed);
+       frozen != nullptr && frozen->version > version;
+       frozen = frozen->next.load(std::memory_order_relaxed))
+    newer.push_back(frozen);
+  std::vector<FrozenChange> changes;
+  for (auto frozen = newer.rbegin(); frozen != newer.rend(); ++frozen)
+    changes.insert(changes.end(), (*frozen)->changes.begin(),
+                   (*frozen)->changes.end());
+  std::stable_sort(changes.begin(), changes.end(),
+                   [](const FrozenChange &lhs, const FrozenChange &rhs) {
+                     return lhs.child.toBits() < rhs.child.toBits();
+                   });
+  std::vector<std::pair<std::size_t, Directory *>> removedDirectories;
+  std::vector<std::pair<std::size_t, File *>> removedFiles;
+  std::vector<std::uintptr_t> added;
+  for (std::size_t i = 0; i < changes.size(); ++i) {
+    const FrozenChange &change = changes[i];
+    if (i != 0 && changes[i - 1].child.toBits() == change.child.toBits())
+      continue;
+    if (change.added)
+      added.push_back(change.child.toBits());
+    else if (change.child.directory() != nullptr)
+      removedDirectories.emplace_back(change.slot, change.child.directory());
+    else
+      removedFiles.emplace_back(change.slot, change.child.file());
+  }
+  Listing listing;
+  thawChildren(directory->subDirectories, removedDirectories, added,
+               listing.subDirectories);
+  thawChildren(directory->files, removedFiles, added, listing.files);
+  return listing;
+}
+
+template <typename T>
+void VirtualFileSystem::thawChildren(
+    const ChildList<T> &live, std::vector<std::pair<std::size_t, T *>> &removed,
+    const std::vector<std::uintptr_t> &added, std::vector<T *> &children) {
+  // slots are pinned, so removed children go between live ones by slot
+  std::sort(removed.begin(), removed.end());
+  auto restored = removed.begin();
+  for (auto child : live.snapshot()) {
+    for (; restored != removed.end() && restored->first < child->listSlot;
+         ++restored)
+      children.push_back(restored->second);
+    if (!std::binary_search(added.begin(), added.end(), Child(child).toBits()))
+      children.push_back(child);
+  }
+  for (; restored != removed.end(); ++restored)
+    children.push_back(restored->second);
+}
+
+VirtualFileSystem::Directory *
+VirtualFileSystem::findSnapshot(std::uint64_t version,
+                                const std::string &path) const {
+  const bool absolute = !path.empty() && path[0] == '/';
+  Directory *directory = absolute ? nullptr : head;
+  std::size_t i = 0;
+  while (i < path.size()) {
+    while (i < path.size() && path[i] == '/')
+      ++i;
+    const std::size_t start = i;
+    while (i < path.size() && path[i] != '/')
+      ++i;
+    const std::size_t length = i - start;
+    if (length == 0)
+      break;
+    const std::string name = path.substr(start, length);
+
+    if (directory == nullptr) {
+      if (head->directoryName != name)
+        return nullptr;
+      directory = head;
+    } else if (name == ".") { // stays in directory
+      continue;
+    } else if (name == "..") {
+      if (directory->parentDirectory != nullptr)
+        directory = directory->parentDirectory;
+    } else {
+      Directory *found = nullptr;
+      for (auto child : snapshotChildren(directory, version).subDirectories) {
+        if (child->directoryName == name) {
+          found = child;
+          break;
         }
-        dir->files.erase(
-            std::remove(dir->files.begin(), dir->files.end(), nullptr),
-            dir->files.end());
+      }
+      if (found == nullptr)
+        return nullptr;
+      directory = found;
+    }
+  }
+  return directory == nullptr ? head : directory;
+}
+
+void VirtualFileSystem::listSnapshot(std::uint64_t version,
+                                     EpochManager::Participant &participant,
+                                     const std::string &path, bool recursive,
+                                     std::ostream &out) const {
+  EpochManager::Guard guard(epochs, participant);
+  Directory *directory = findSnapshot(version, path);
+  if (directory == nullptr) {
+    out << noSuchDirectory;
+    return;
+  }
+  if (!recursive) {
+    const Listing listing = snapshotChildren(directory, version);
+    listChildren(listing.subDirectories, listing.files, out);
+    return;
+  }
+
+  // depth first, subdirectories are pushed in reverse, so they are listed in
+  // order
+  const std::string absolute =
+      pathOf(directory->parentDirectory, directory->directoryName);
+  std::vector<std::pair<Directory *, std::string>> stack{{directory, absolute}};
+  while (!stack.empty()) {
+    const auto current = std::move(stack.back());
+    stack.pop_back();
+    const Listing listing = snapshotChildren(current.first, version);
+    out << current.second << ":\n";
+    listChildren(listing.subDirectories, listing.files, out);
+    out << '\n';
+    for (std::size_t i = listing.subDirectories.size(); i > 0; --i) {
+      Directory *child = listing.subDirectories[i - 1];
+      stack.emplace_back(child,
+                         current.second + "/" + child->directoryName.str());
+    }
+  }
+}
+
+Snapshot VirtualFileSystem::snapshot(std::ostream &out) {
+  // no mutation runs, mutations after this one see new version
+  std::unique_lock<std::shared_timed_mutex> lock(mutationMutex);
+  std::lock_guard<std::mutex> snapshots(snapshotMutex);
+  const std::uint64_t taken = version++;
+  liveSnapshots.insert(taken);
+  return Snapshot(*this, taken, out);
+}
 
-        delete dir;
-        dir = nullptr;
+void VirtualFileSystem::releaseSnapshot(
+    std::uint64_t released, EpochManager::Participant &participant) {
+  // owners of released copies are not released while guard exists
+  EpochManager::Guard guard(epochs, participant);
+  std::vector<Retained> unseen;
+  {
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    liveSnapshots.erase(released);
+    const std::uint64_t oldest = liveSnapshots.empty()
+                                     ? std::numeric_limits<std::uint64_t>::max()
+                                     : *liveSnapshots.begin();
+    while (!retained.empty() && retained.front().version <= oldest) {
+      unseen.push_back(retained.front());
+      retained.pop_front();
+    }
+  }
+  for (const auto &kept : unseen) {
+    switch (kept.kind) {
+    case Retained::Kind::Frozen: {
+      auto frozen = static_cast<Frozen *>(kept.pointer);
+      {
+        std::lock_guard<std::mutex> lock(kept.owner->mutex);
+        std::atomic<Frozen *> *link = &kept.owner->frozen;
+        while (link->load(std::memory_order_relaxed) != frozen)
+          link = &link->load(std::memory_order_relaxed)->next;
+        link->store(frozen->next.load(std::memory_order_relaxed),
+                    std::memory_order_release);
+        // children without changes for snapshots drop erased slots again
+        if (kept.owner->frozen.load(std::memory_order_relaxed) == nullptr) {
+          kept.owner->subDirectories.pinSlots(false);
+          kept.owner->files.pinSlots(false);
+        }
       }
+      epochs.retire(frozen);
+      break;
+    }
+    case Retained::Kind::Directory:
+      epochs.retire(kept.pointer, releaseDirectory, this);
+      break;
+    case Retained::Kind::File:
+      epochs.retire(kept.pointer, releaseFile, this);
+      break;
+    }
+  }
+}
+
+void VirtualFileSystem::releaseDirectory(void *fileSystem, void *directory) {
+  auto self = static_cast<VirtualFileSystem *>(fileSystem);
+  // every worker collects its part of the subtree, nodes are destroyed with
+  // one lock of the pools
+  std::vector<std::vector<Directory *>> directories(self->workers.size());
+  std::vector<std::vector<File *>> files(self->workers.size());
+  self->workers.run(directory, [&directories, &files](
+                                   void *item, std::size_t worker,
+                                   std::vector<void *> &children) {
+    auto erased = static_cast<Directory *>(item);
+    directories[worker].push_back(erased);
+    const auto erasedFiles = erased->files.snapshot();
+    files[worker].insert(files[worker].end(), erasedFiles.begin(),
+                         erasedFiles.end());
+    const auto subDirectories = erased->subDirectories.snapshot();
+    children.assign(subDirectories.begin(), subDirectories.end());
+  });
+
+  // names are erased before any node is destroyed, so complete and locate
+  // see only nodes that are not released
+  if (self->nameTreeBuilt.load()) {
+    std::size_t unindexed = 0;
+    std::unique_lock<std::shared_timed_mutex> names(self->nameTreeMutex);
+    auto erase = [self, &unindexed, &names](Child child) {
+      const Name &name = child.name();
+      self->nameTree.erase(name.data(), name.size(), Located{nullptr, child});
+      if (++unindexed % releaseBatch != 0)
+        return;
+      names.unlock();
+      names.lock();
+    };
+    for (const auto &part : files) {
+      for (auto file : part)
+        erase(Child(file));
+    }
+    for (const auto &part : directories) {
+      for (auto erased : part)
+        erase(Child(erased));
+    }
+  }
+
+  for (const auto &part : files) {
+    for (auto file : part)
+      self->releaseData(file);
+  }
+
+  // nodes are destroyed in batches, so commands that create nodes don't
+  // wait for the whole subtree
+  std::size_t batch = 0;
+  std::unique_lock<std::mutex> lock(self->poolMutex);
+  auto next = [&batch, &lock]() {
+    if (++batch % releaseBatch != 0)
+      return;
+    lock.unlock();
+    lock.lock();
+  };
+  // remove all files in directories, before erasing directories
+  std::uint64_t releasedFiles = 0, releasedDirectories = 0;
+  for (const auto &part : files) {
+    for (auto file : part) {
+      self->filePool.destroy(file);
+      next();
     }
-    currentDirectory->subDirectories.erase(
-        std::remove(currentDirectory->subDirectories.begin(),
-                    currentDirectory->subDirectories.end(), nullptr),
-        currentDirectory->subDirectories.end());
+    releasedFiles += part.size();
   }
+  for (const auto &part : directories) {
+    for (auto erased : part) {
+      self->directoryPool.destroy(erased);
+      next();
+    }
+    releasedDirectories += part.size();
+  }
+  lock.unlock();
+  self->releasedFiles.fetch_add(releasedFiles, std::memory_order_relaxed);
+  self->releasedDirectories.fetch_add(releasedDirectories,
+                                      std::memory_order_relaxed);
+}
+
+void VirtualFileSystem::releaseFile(void *fileSystem, void *file) {
+  auto self = static_cast<VirtualFileSystem *>(fileSystem);
+  self->releaseData(static_cast<File *>(file));
+  {
+    std::lock_guard<std::mutex> lock(self->poolMutex);
+    self->filePool.destroy(static_cast<File *>(file));
+  }
+  self->releasedFiles.fetch_add(1, std::memory_order_relaxed);
+}
 
-  if (currentDirectory->files.size() > 0) { // remove files
-    for (auto &file : currentDirectory->files) {
-      if (file->fileName == name) {
-        delete file;
-        file = nullptr;
+void VirtualFileSystem::releaseChildren(void *fileSystem, void *children) {
+  auto self = static_cast<VirtualFileSystem *>(fileSystem);
+  std::unique_ptr<std::vector<Child>> batch(
+      static_cast<std::vector<Child> *>(children));
+  std::uint64_t releasedFiles = 0;
+  for (const auto &child : *batch) {
+    if (child.file() != nullptr)
+      self->releaseData(child.file());
+  }
+  {
+    std::unique_lock<std::mutex> lock(self->poolMutex);
+    for (const auto &child : *batch) {
+      if (child.file() == nullptr)
+        continue;
+      self->filePool.destroy(child.file());
+      if (++releasedFiles % releaseBatch == 0) {
+        lock.unlock();
+        lock.lock();
       }
     }
-    currentDirectory->files.erase(std::remove(currentDirectory->files.begin(),
-                                              currentDirectory->files.end(),
-                                              nullptr),
-                                  currentDirectory->files.end());
+  }
+  self->releasedFiles.fetch_add(releasedFiles, std::memory_order_relaxed);
+  for (const auto &child : *batch) {
+    if (child.directory() != nullptr)
+      releaseDirectory(fileSystem, child.directory());
   }
 }
 
 void VirtualFileSystem::makeFile(const std::string &nameFile) {
-  currentDirectory->files.push_back(new File(nameFile));
+  makeFile(context(), nameFile);
 }
 
-std::string return_current_time_and_date() {
-  time_t now =
-      std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+void VirtualFileSystem::makeFile(const Context &context,
+                                 const std::string &nameFile,
+                                 std::int64_t timeCreated) {
+  Stats::Timer timer(context.shard, Stats::Operation::MakeFile);
+  EpochManager::Guard guard(epochs, context.participant);
+  std::size_t leafStart = 0, leafSize = 0;
+  Directory *parent =
+      findParent(context.currentDirectory, context.dentries, context.shard,
+                 nameFile, leafStart, leafSize);
+  if (parent == nullptr) {
+    context.out << noSuchDirectory;
+    return;
+  }
+  if (!isValidName(nameFile.data() + leafStart, leafSize)) {
+    context.out << invalidCommand;
+    return;
+  }
+
+  materialize(parent);
+  File *temp = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    temp = filePool.create(names.intern(nameFile.data() + leafStart, leafSize));
+  }
+  if (timeCreated != 0)
+    temp->timeCreated = timeCreated;
+  // checkpoint and snapshot are taken between mutations
+  std::shared_lock<std::shared_timed_mutex> mutation(mutationMutex);
+  bool removed = false, inserted = false;
+  std::uint64_t sequence = 0;
+  {
+    // file is written before it is published to readers, it is journaled
+    // in the same order in which it is published
+    std::lock_guard<std::mutex> lock(parent->mutex);
+    removed = parent->removed.load();
+    inserted = !removed && !parent->children.find(temp->fileName);
+    if (inserted) {
+      const Child added(temp);
+      freeze(parent, &added, 1, true);
+      parent->children.insert(Child(temp), epochs);
+      parent->files.push_back(temp, epochs);
+      changed(parent, &added, 1, true);
+      statistics.fanOut(parent->children.size());
+      indexTree(parent, Child(temp));
+      sequence = record(Journal::Operation::MakeFile, parent, temp->fileName,
+                        temp->timeCreated);
+    }
+  }
+  if (inserted) {
+    waitDurable(sequence, context.out);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    filePool.destroy(temp);
+  }
+  context.out << (removed ? noSuchDirectory
+                          : alreadyExists);
+}
+
+void VirtualFileSystem::copy(const std::string &source,
+                             const std::string &destination) {
+  copy(context(), source, destination);
+}
 
-  std::string s(30, '\0');
-  std::strftime(
-      &s[0], s.size(), "%Y-%m-%d %H:%M:%S",
-      localtime(&now)); // prints time and date when file/directory was created
+void VirtualFileSystem::copy(const Context &context, const std::string &source,
+                             const std::string &destination) {
+  Stats::Timer timer(context.shard, Stats::Operation::Copy);
+  EpochManager::Guard guard(epochs, context.participant);
+  std::size_t leafStart = 0, leafSize = 0;
+  Directory *sourceParent =
+      findParent(context.currentDirectory, context.dentries, context.shard,
+                 source, leafStart, leafSize);
+  Child found;
+  if (sourceParent != nullptr &&
+      isValidName(source.data() + leafStart, leafSize)) {
+    materialize(sourceParent);
+    found = sourceParent->children.find(source.data() + leafStart, leafSize);
+  }
+  if (!found) {
+    context.out << "No such directory or file\n";
+    return;
+  }
+  Directory *parent =
+      findParent(context.currentDirectory, context.dentries, context.shard,
+                 destination, leafStart, leafSize);
+  if (parent == nullptr) {
+    context.out << noSuchDirectory;
+    return;
+  }
+  if (!isValidName(destination.data() + leafStart, leafSize)) {
+    context.out << invalidCommand;
+    return;
+  }
+  const Name name = names.intern(destination.data() + leafStart, leafSize);
+
+  // copy is built before it is published, so nobody sees partial copy, and
+  // copy inside the source directory doesn't copy itself
+  materialize(parent);
+  Child copied;
+  if (found.file() != nullptr) {
+    {
+      std::lock_guard<std::mutex> lock(poolMutex);
+      copied = Child(filePool.create(name));
+    }
+    copyData(found.file(), copied.file());
+  } else {
+    Directory *root = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(poolMutex);
+      root = directoryPool.create(name, nodeMemory);
+    }
+    root->parentDirectory = parent;
+    copyTree(found.directory(), root);
+    copied = Child(root);
+  }
+
+  // checkpoint and snapshot are taken between mutations
+  std::shared_lock<std::shared_timed_mutex> mutation(mutationMutex);
+  bool removed = false, inserted = false;
+  std::uint64_t sequence = 0;
+  {
+    std::lock_guard<std::mutex> lock(parent->mutex);
+    removed = parent->removed.load();
+    inserted = !removed && !parent->children.find(name);
+    if (inserted) {
+      freeze(parent, &copied, 1, true);
+      indexTree(parent, copied);
+      parent->children.insert(copied, epochs);
+      if (copied.directory() != nullptr) {
+        parent->subDirectories.push_back(copied.directory(), epochs);
+        sequence = recordTree(copied.directory(), context.out);
+      } else {
+        parent->files.push_back(copied.file(), epochs);
+        sequence = record(Journal::Operation::MakeFile, parent, name,
+                          copied.file()->timeCreated);
+        sequence = recordData(parent, copied.file(), sequence, context.out);
+      }
+      changed(parent, &copied, 1, true);
+      statistics.fanOut(parent->children.size());
+    }
+  }
+  if (inserted) {
+    waitDurable(sequence, context.out);
+    return;
+  }
+  // nobody saw the copy
+  if (copied.directory() != nullptr)
+    releaseDirectory(this, copied.directory());
+  else
+    releaseFile(this, copied.file());
+  context.out << (removed ? noSuchDirectory
+                          : alreadyExists);
+}
+
+void VirtualFileSystem::copyTree(Directory *source, Directory *copy) {
+  // item is source directory and its copy, that is not yet published
+  struct Copying {
+    Directory *source;
+    Directory *copy;
+  };
+  workers.run(new Copying{source, copy}, [this](void *item, std::size_t,
+                                                std::vector<void *> &children) {
+    std::unique_ptr<Copying> current(static_cast<Copying *>(item));
+    materialize(current->source);
+    const auto directorySnapshot = current->source->subDirectories.snapshot();
+    const auto fileSnapshot = current->source->files.snapshot();
+    const std::vector<Directory *> subDirectories(directorySnapshot.begin(),
+                                                  directorySnapshot.end());
+    const std::vector<File *> files(fileSnapshot.begin(), fileSnapshot.end());
+    std::vector<Directory *> directoryCopies;
+    std::vector<File *> fileCopies;
+    {
+      std::lock_guard<std::mutex> lock(poolMutex);
+      for (auto directory : subDirectories)
+        directoryCopies.push_back(
+            directoryPool.create(directory->directoryName, nodeMemory));
+      for (auto file : files)
+        fileCopies.push_back(filePool.create(file->fileName));
+    }
+    Directory *parent = current->copy;
+    for (std::size_t i = 0; i < directoryCopies.size(); ++i) {
+      directoryCopies[i]->parentDirectory = parent;
+      parent->children.insert(Child(directoryCopies[i]), epochs);
+      parent->subDirectories.push_back(directoryCopies[i], epochs);
+      children.push_back(new Copying{subDirectories[i], directoryCopies[i]});
+    }
+    for (std::size_t i = 0; i < fileCopies.size(); ++i) {
+      copyData(files[i], fileCopies[i]);
+      parent->children.insert(Child(fileCopies[i]), epochs);
+      parent->files.push_back(fileCopies[i], epochs);
+    }
+  });
+}
+
+void VirtualFileSystem::diskUsage(const std::string &path) const {
+  diskUsage(context(), path);
+}
+
+void VirtualFileSystem::diskUsage(const Context &context,
+                                  const std::string &path) const {
+  Stats::Timer timer(context.shard, Stats::Operation::DiskUsage);
+  EpochManager::Guard guard(epochs, context.participant);
+  Directory *directory =
+      path.empty() ? context.currentDirectory
+                   : findDirectory(context.currentDirectory, context.dentries,
+                                   context.shard, path.data(), path.size());
+  if (directory == nullptr) {
+    context.out << noSuchDirectory;
+    return;
+  }
+  // every worker counts its part of the subtree, workers read in epoch of
+  // this command, that waits for them
+  std::vector<std::size_t> directories(workers.size()), files(workers.size());
+  workers.run(directory, [this, &directories, &files](
+                             void *item, std::size_t worker,
+                             std::vector<void *> &children) {
+    auto visited = static_cast<Directory *>(item);
+    materialize(visited);
+    const auto subDirectories = visited->subDirectories.snapshot();
+    children.assign(subDirectories.begin(), subDirectories.end());
+    directories[worker] += children.size();
+    files[worker] += visited->files.size();
+  });
+  context.out << std::accumulate(directories.begin(), directories.end(),
+                                 std::size_t(0))
+              << " directories, "
+              << std::accumulate(files.begin(), files.end(), std::size_t(0))
+              << " files\n";
+}
+
+void VirtualFileSystem::find(const std::string &path,
+                             const std::string &name) const {
+  find(context(), path, name);
+}
+
+void VirtualFileSystem::find(const Context &context, const std::string &path,
+                             const std::string &name) const {
+  Stats::Timer timer(context.shard, Stats::Operation::Find);
+  EpochManager::Guard guard(epochs, context.participant);
+  Directory *directory =
+      path.empty() ? context.currentDirectory
+                   : findDirectory(context.currentDirectory, context.dentries,
+                                   context.shard, path.data(), path.size());
+  if (directory == nullptr) {
+    context.out << noSuchDirectory;
+    return;
+  }
+  // plain name is compiled too, it is one literal compared with memcmp
+  const Glob glob(name);
+  std::vector<std::vector<std::string>> found(workers.size());
+  workers.run(directory, [this, &found, &glob](void *item, std::size_t worker,
+                                               std::vector<void *> &children) {
+    auto visited = static_cast<Directory *>(item);
+    materialize(visited);
+    const auto subDirectories = visited->subDirectories.snapshot();
+    for (auto subDirectory : subDirectories) {
+      if (nameMatches(glob, subDirectory->directoryName))
+        found[worker].push_back(pathOf(visited, subDirectory->directoryName));
+    }
+    for (auto file : visited->files.snapshot()) {
+      if (nameMatches(glob, file->fileName))
+        found[worker].push_back(pathOf(visited, file->fileName));
+    }
+    children.assign(subDirectories.begin(), subDirectories.end());
+  });
+  std::vector<std::string> paths;
+  for (auto &part : found)
+    std::move(part.begin(), part.end(), std::back_inserter(paths));
+  std::sort(paths.begin(), paths.end());
+  for (const auto &foundPath : paths)
+    context.out << foundPath << '\n';
+}
+
+bool VirtualFileSystem::grep(const std::string &pattern,
+                             const std::string &path,
+                             const GrepVisitor &visit) const {
+  return grep(context(), pattern, path, visit);
+}
+
+void VirtualFileSystem::grep(const std::string &pattern,
+                             const std::string &path) const {
+  const Context command = context();
+  grep(command, pattern, path,
+       [&command](const std::string &filePath, std::uint64_t line,
+                  const std::string &text) {
+         command.out << filePath << ':' << line << ':' << text << '\n';
+         return true;
+       });
+}
+
+bool VirtualFileSystem::grep(const Context &context,
+                             const std::string &pattern,
+                             const std::string &path,
+                             const GrepVisitor &visit) const {
+  Stats::Timer timer(context.shard, Stats::Operation::Grep);
+  EpochManager::Guard guard(epochs, context.participant);
+  Directory *directory =
+      path.empty() ? context.currentDirectory
+                   : findDirectory(context.currentDirectory, context.dentries,
+                                   context.shard, path.data(), path.size());
+  Directory *parent = nullptr;
+  const File *file = nullptr;
+  if (directory == nullptr) {
+    std::size_t leafStart = 0, leafSize = 0;
+    parent = findParent(context.currentDirectory, context.dentries,
+                        context.shard, path, leafStart, leafSize);
+    if (parent != nullptr && leafSize != 0) {
+      materialize(parent);
+      file = parent->children.find(path.data() + leafStart, leafSize).file();
+    }
+    if (file == nullptr) {
+      context.out << "No such directory or file\n";
+      return false;
+    }
+  }
+  // lines don't have newline
+  if (pattern.find('\n') != std::string::npos)
+    return true;
+
+  // workers visit lines one at a time, as soon as they find them, search
+  // stops at the first visit that returns false
+  const Substring substring(pattern);
+  std::mutex visitMutex;
+  std::atomic<bool> stopped{false};
+  std::atomic<bool> unreadable{false};
+  const GrepVisitor found = [&visit, &visitMutex, &stopped](
+                                const std::string &filePath,
+                                std::uint64_t line, const std::string &text) {
+    std::lock_guard<std::mutex> lock(visitMutex);
+    if (stopped.load() || !visit(filePath, line, text)) {
+      stopped.store(true);
+      return false;
+    }
+    return true;
+  };
+  if (file != nullptr) {
+    grepFile(file, pathOf(parent, file->fileName), substring, found,
+             unreadable);
+  } else {
+    // subdirectories are pushed before files are searched, so other workers
+    // steal them meanwhile, workers read in epoch of this command, that
+    // waits for them. Worker that can't read data stops the search, error
+    // is printed by this thread, when workers are done.
+    workers.run(directory, [this, &substring, &found, &stopped, &unreadable](
+                               void *item, std::size_t,
+                               std::vector<void *> &children) {
+      if (stopped.load())
+        return;
+      auto visited = static_cast<Directory *>(item);
+      materialize(visited);
+      const auto subDirectories = visited->subDirectories.snapshot();
+      children.assign(subDirectories.begin(), subDirectories.end());
+      for (auto visitedFile : visited->files.snapshot()) {
+        if (!grepFile(visitedFile, pathOf(visited, visitedFile->fileName),
+                      substring, found, unreadable)) {
+          stopped.store(true);
+          return;
+        }
+      }
+    });
+  }
+  if (unreadable.load()) {
+    context.out << unreadableData;
+    return false;
+  }
+  return true;
+}
+
+bool VirtualFileSystem::grepFile(const File *file, const std::string &path,
+                                 const Substring &substring,
+                                 const GrepVisitor &visit,
+                                 std::atomic<bool> &unreadable) const {
+  const FileData *data = file->data.load(std::memory_order_acquire);
+  if (data == nullptr)
+    return true;
+  const std::uint64_t fileSize = data->size.load(std::memory_order_acquire);
+  // occurrence that crosses chunk boundary starts in the last length - 1
+  // bytes of the line in previous chunk
+  const std::size_t overlap = substring.size() > 1 ? substring.size() - 1 : 0;
+  std::string carried, window;
+  std::string text; // the first bytes of current line
+  std::uint64_t line = 1;
+  bool matched = false;
+  auto extend = [&text](const char *bytes, std::size_t size) {
+    if (text.size() < grepLineLimit)
+      text.append(bytes, std::min(size, grepLineLimit - text.size()));
+  };
+  // scans bytes from..to of the chunk, visits current line at its end if it
+  // has pattern, lines after it don't have pattern
+  auto advance = [&](const char *bytes, std::size_t from, std::size_t to) {
+    const char *end = bytes + to;
+    const auto newline = static_cast<const char *>(
+        std::memchr(bytes + from, '\n', to - from));
+    if (newline == nullptr) {
+      extend(bytes + from, to - from);
+      return true;
+    }
+    extend(bytes + from, static_cast<std::size_t>(newline - bytes) - from);
+    if (matched && !visit(path, line, text))
+      return false;
+    matched = false;
+    line += 1 + static_cast<std::uint64_t>(std::count(newline + 1, end, '\n'));
+    const char *start = end;
+    while (start[-1] != '\n')
+      --start;
+    text.clear();
+    extend(start, static_cast<std::size_t>(end - start));
+    return true;
+  };
+
+  for (std::size_t index = 0; index < chunksFor(fileSize); ++index) {
+    Chunk *chunk = data->chunks[index].load(std::memory_order_acquire);
+    // scan doesn't mark chunks as used, so it doesn't keep them in memory
+    const Page *page = chunk->page.load(std::memory_order_acquire);
+    if (page == nullptr)
+      page = restoreChunk(chunk);
+    if (page == nullptr) {
+      unreadable.store(true);
+      return false;
+    }
+    const char *bytes = page->bytes;
+    const std::size_t size = static_cast<std::size_t>(
+        std::min<std::uint64_t>(chunkSize, fileSize - index * chunkSize));
+    if (!matched && !carried.empty()) {
+      window.assign(carried);
+      window.append(bytes, std::min(size, overlap));
+      const char *found = substring.find(window.data(), window.size());
+      matched = found != nullptr && found < window.data() + carried.size();
+    }
+    for (std::size_t position = 0; position < size;) {
+      std::size_t end = size;
+      if (matched) { // rest of the line is only scanned for its end
+        const auto newline = static_cast<const char *>(
+            std::memchr(bytes + position, '\n', size - position));
+        if (newline != nullptr)
+          end = static_cast<std::size_t>(newline - bytes) + 1;
+        if (!advance(bytes, position, end))
+          return false;
+      } else {
+        const char *found = substring.find(bytes + position, size - position);
+        if (found != nullptr)
+          end = static_cast<std::size_t>(found - bytes);
+        if (!advance(bytes, position, end))
+          return false;
+        matched = found != nullptr;
+      }
+      position = end;
+    }
+
+    std::size_t tail = 0; // bytes after the last newline, up to overlap
+    while (tail < overlap && tail < size && bytes[size - 1 - tail] != '\n')
+      ++tail;
+    if (tail == size && tail < overlap) { // line continues carried bytes
+      carried.append(bytes, size);
+      carried.erase(0, carried.size() - std::min(carried.size(), overlap));
+    } else {
+      carried.assign(bytes + size - tail, tail);
+    }
+  }
+  return !matched || visit(path, line, text);
+}
+
+VirtualFileSystem::File *
+VirtualFileSystem::findFile(const Context &context, const std::string &path,
+                            Directory *&parent) const {
+  std::size_t leafStart = 0, leafSize = 0;
+  parent = findParent(context.currentDirectory, context.dentries,
+                      context.shard, path, leafStart, leafSize);
+  if (parent == nullptr) {
+    context.out << noSuchDirectory;
+    return nullptr;
+  }
+  File *file = nullptr;
+  if (leafSize != 0) {
+    materialize(parent);
+    file = parent->children.find(path.data() + leafStart, leafSize).file();
+  }
+  if (file == nullptr)
+    context.out << "No such file\n";
+  return file;
+}
+
+VirtualFileSystem::Chunk *VirtualFileSystem::allocateChunk() const {
+  Chunk *chunk;
+  bool full;
+  {
+    std::lock_guard<std::mutex> lock(chunkMutex);
+    chunk = chunkPool.create();
+    chunk->page.store(pagePool.create(), std::memory_order_relaxed);
+    const std::uint64_t limit = memoryLimit.load(std::memory_order_relaxed);
+    full = limit != 0 && residentBytes() > limit;
+  }
+  chunk->used.store(milliseconds(), std::memory_order_relaxed);
+  if (full)
+    spillChunks();
+  return chunk;
+}
+
+const char *VirtualFileSystem::chunkBytes(const Chunk *chunk,
+                                          char *buffer) const {
+  const Page *page = chunk->page.load(std::memory_order_acquire);
+  if (page != nullptr)
+    return page->bytes;
+  // page and packed are released only after packed or spill is set
+  const Packed *packed = chunk->packed.load(std::memory_order_acquire);
+  if (packed != nullptr)
+    lzDecompress(packed->bytes.get(), packed->size, buffer, packed->length);
+  else if (!readSpilled(chunk, buffer))
+    return nullptr;
+  return buffer;
+}
+
+bool VirtualFileSystem::readSpilled(const Chunk *chunk,
+                                    char *destination) const {
+  const std::uint64_t slot = chunk->spill.load(std::memory_order_acquire) - 1;
+  if (!chunk->spillPacked)
+    return spillFile.read(slot, destination, chunk->spillSize);
+  char packed[chunkSize];
+  return spillFile.read(slot, packed, chunk->spillSize) &&
+         lzDecompress(packed, chunk->spillSize, destination,
+                      chunk->spillLength);
+}
+
+const VirtualFileSystem::Page *
+VirtualFileSystem::restoreChunk(Chunk *chunk) const {
+  Page *page;
+  {
+    std::lock_guard<std::mutex> lock(chunkMutex);
+    page = pagePool.create();
+  }
+  // bytes were compressed by lzCompress, so they always decompress
+  const Packed *packed = chunk->packed.load(std::memory_order_acquire);
+  if (packed != nullptr) {
+    lzDecompress(packed->bytes.get(), packed->size, page->bytes,
+                 packed->length);
+  } else if (!readSpilled(chunk, page->bytes)) {
+    std::lock_guard<std::mutex> lock(chunkMutex);
+    pagePool.destroy(page);
+    return nullptr;
+  }
+  Page *installed = nullptr;
+  if (!chunk->page.compare_exchange_strong(installed, page,
+                                           std::memory_order_acq_rel)) {
+    // other reader decompressed it first
+    std::lock_guard<std::mutex> lock(chunkMutex);
+    pagePool.destroy(page);
+    return installed;
+  }
+  addHot(chunk);
+  return page;
+}
+
+void VirtualFileSystem::addHot(Chunk *chunk) const {
+  std::vector<Page *> released;
+  {
+    std::lock_guard<std::mutex> lock(hotMutex);
+    const std::int64_t now = milliseconds();
+    hotChunks.push_front(chunk);
+    chunk->hotEntry = hotChunks.begin();
+    chunk->hot = true;
+    chunk->hotSince = now;
+    chunk->used.store(now, std::memory_order_relaxed);
+    // chunk that was read since it was put to front gets second chance, so
+    // hotChunks is LRU without locking readers of hot chunks
+    std::size_t limit = hotLimit.load();
+    const std::uint64_t memory = memoryLimit.load(std::memory_order_relaxed);
+    if (memory != 0)
+      limit = std::min<std::size_t>(
+          limit, std::max<std::uint64_t>(memory / chunkSize / 4, 1));
+    std::size_t examined = 0;
+    while (hotChunks.size() > limit) {
+      Chunk *oldest = hotChunks.back();
+      if (examined++ < hotChunks.size() &&
+          oldest->used.load(std::memory_order_relaxed) > oldest->hotSince) {
+        hotChunks.splice(hotChunks.begin(), hotChunks, oldest->hotEntry);
+        oldest->hotSince = now;
+        continue;
+      }
+      hotChunks.pop_back();
+      oldest->hot = false;
+      released.push_back(oldest->page.exchange(nullptr));
+    }
+  }
+  retirePages(std::move(released));
+}
+
+void VirtualFileSystem::retirePages(std::vector<Page *> &&pages) const {
+  if (pages.empty())
+    return;
+  retiredPages.fetch_add(pages.size());
+  epochs.retire(new std::vector<Page *>(std::move(pages)), releasePages,
+                const_cast<VirtualFileSystem *>(this));
+}
+
+void VirtualFileSystem::releasePages(void *fileSystem, void *pages) {
+  auto self = static_cast<VirtualFileSystem *>(fileSystem);
+  std::unique_ptr<std::vector<Page *>> batch(
+      static_cast<std::vector<Page *> *>(pages));
+  std::lock_guard<std::mutex> lock(self->chunkMutex);
+  for (auto page : *batch)
+    self->pagePool.destroy(page);
+  self->retiredPages.fetch_sub(batch->size());
+}
+
+bool VirtualFileSystem::write(const std::string &path, std::uint64_t offset,
+                              const char *data, std::size_t size) {
+  return write(context(), path, offset, data, size, false);
+}
+
+bool VirtualFileSystem::append(const std::string &path, const char *data,
+                               std::size_t size) {
+  return write(context(), path, 0, data, size, true);
+}
+
+bool VirtualFileSystem::write(const Context &context, const std::string &path,
+                              std::uint64_t offset, const char *data,
+                              std::size_t size, bool append) {
+  Stats::Timer timer(context.shard, Stats::Operation::Write);
+  EpochManager::Guard guard(epochs, context.participant);
+  Directory *parent = nullptr;
+  File *file = findFile(context, path, parent);
+  if (file == nullptr)
+    return false;
+  // checkpoint is taken between writes too
+  std::shared_lock<std::shared_timed_mutex> mutation(mutationMutex);
+  std::uint64_t sequence = 0;
+  {
+    // writers of files lock their parent, like mkfile and rm
+    std::lock_guard<std::mutex> lock(parent->mutex);
+    if (parent->removed.load() ||
+        parent->children.find(file->fileName).file() != file) {
+      context.out << "No such file\n"; // removed meanwhile
+      return false;
+    }
+    const FileData *current = file->data.load(std::memory_order_relaxed);
+    const std::uint64_t fileSize =
+        current == nullptr ? 0 : current->size.load(std::memory_order_relaxed);
+    if (append)
+      offset = fileSize;
+    if ((offset > fileSize &&
+         !writeData(file, fileSize, nullptr, offset - fileSize)) ||
+        !writeData(file, offset, data, size)) {
+      context.out << unreadableData;
+      return false;
+    }
+    // append is journaled as write at the offset where it was done
+    sequence = record(Journal::Operation::Write, parent, file->fileName, 0,
+                      offset, data, size);
+  }
+  waitDurable(sequence, context.out);
+  return true;
+}
+
+bool VirtualFileSystem::writeData(File *file, std::uint64_t offset,
+                                  const char *bytes, std::size_t size) const {
+  if (size == 0)
+    return true;
+  FileData *data = file->data.load(std::memory_order_relaxed);
+  const std::uint64_t fileSize =
+      data == nullptr ? 0 : data->size.load(std::memory_order_relaxed);
+  const std::uint64_t end = offset + size;
+  const std::size_t needed = chunksFor(end);
+  if (data == nullptr || data->capacity < needed) {
+    // table is doubled, readers of the old one keep it until they leave
+    // epoch, chunks are not copied
+    std::size_t capacity = data == nullptr ? 1 : data->capacity * 2;
+    while (capacity < needed)
+      capacity *= 2;
+    FileData *grown = createData(capacity);
+    grown->size.store(fileSize, std::memory_order_relaxed);
+    for (std::size_t i = 0; data != nullptr && i < data->capacity; ++i)
+      grown->chunks[i].store(data->chunks[i].load(std::memory_order_relaxed),
+                             std::memory_order_relaxed);
+    file->data.store(grown, std::memory_order_release);
+    if (data != nullptr)
+      retireData(data);
+    data = grown;
+  }
+
+  const bool tracked = compressAfter.load(std::memory_order_relaxed) != 0 ||
+                       memoryLimit.load(std::memory_order_relaxed) != 0;
+  const std::int64_t now = tracked ? milliseconds() : 0;
+  char buffer[chunkSize];
+  std::vector<Chunk *> replaced;
+  bool readable = true;
+  for (std::uint64_t position = offset; position < end;) {
+    const std::size_t index = static_cast<std::size_t>(position / chunkSize);
+    const std::size_t begin = static_cast<std::size_t>(position % chunkSize);
+    const std::size_t length = static_cast<std::size_t>(
+        std::min<std::uint64_t>(chunkSize - begin, end - position));
+    const std::uint64_t chunkStart = position - begin;
+    // bytes of the chunk that readers can see
+    const std::size_t visible =
+        fileSize <= chunkStart
+            ? 0
+            : static_cast<std::size_t>(
+                  std::min<std::uint64_t>(chunkSize, fileSize - chunkStart));
+    Chunk *chunk = data->chunks[index].load(std::memory_order_relaxed);
+    Chunk *written = chunk;
+    if (chunk == nullptr || begin < visible || !ownChunk(chunk)) {
+      // chunk is read before new one is allocated, that can spill, and
+      // chunk that is overwritten up to its visible bytes is not read
+      const char *copied = nullptr;
+      if (chunk != nullptr && (begin != 0 || length < visible)) {
+        copied = chunkBytes(chunk, buffer);
+        if (copied == nullptr) {
+          readable = false;
+          break;
+        }
+      }
+      written = allocateChunk();
+      char *page = written->page.load(std::memory_order_relaxed)->bytes;
+      if (copied != nullptr) {
+        std::memcpy(page, copied, visible);
+        // appended copy has the bytes that were hashed
+        if (begin >= visible)
+          written->appendedHash = chunk->appendedHash;
+      } else if (chunk == nullptr)
+        std::memset(page, 0, begin);
+    }
+    char *page = written->page.load(std::memory_order_relaxed)->bytes;
+    if (bytes != nullptr)
+      std::memcpy(page + begin, bytes + (position - offset), length);
+    else
+      std::memset(page + begin, 0, length);
+    if (written != chunk) {
+      data->chunks[index].store(written, std::memory_order_release);
+      if (chunk != nullptr)
+        replaced.push_back(chunk);
+    }
+    const std::size_t chunkLength =
+        static_cast<std::size_t>(std::min<std::uint64_t>(
+            chunkSize, std::max(end, fileSize) - chunkStart));
+    deduplicate(data, index, chunkLength, replaced);
+    if (tracked)
+      data->chunks[index]
+          .load(std::memory_order_relaxed)
+          ->used.store(now, std::memory_order_relaxed);
+    position += length;
+  }
+  // chunks that were written before the one that can't be read are kept,
+  // but size is not changed
+  if (readable && end > fileSize) {
+    data->size.store(end, std::memory_order_release);
+    logicalBytes.fetch_add(end - fileSize);
+  }
+  retireChunks(std::move(replaced));
+  return readable;
+}
+
+bool VirtualFileSystem::truncate(const std::string &path, std::uint64_t size) {
+  return truncate(context(), path, size);
+}
+
+bool VirtualFileSystem::truncate(const Context &context,
+                                 const std::string &path, std::uint64_t size) {
+  Stats::Timer timer(context.shard, Stats::Operation::Write);
+  EpochManager::Guard guard(epochs, context.participant);
+  Directory *parent = nullptr;
+  File *file = findFile(context, path, parent);
+  if (file == nullptr)
+    return false;
+  std::shared_lock<std::shared_timed_mutex> mutation(mutationMutex);
+  std::uint64_t sequence = 0;
+  {
+    std::lock_guard<std::mutex> lock(parent->mutex);
+    if (parent->removed.load() ||
+        parent->children.find(file->fileName).file() != file) {
+      context.out << "No such file\n"; // removed meanwhile
+      return false;
+    }
+    if (!truncateData(file, size)) {
+      context.out << unreadableData;
+      return false;
+    }
+    sequence = record(Journal::Operation::Truncate, parent, file->fileName, 0,
+                      size);
+  }
+  waitDurable(sequence, context.out);
+  return true;
+}
+
+bool VirtualFileSystem::truncateData(File *file, std::uint64_t size) {
+  FileData *data = file->data.load(std::memory_order_relaxed);
+  const std::uint64_t fileSize =
+      data == nullptr ? 0 : data->size.load(std::memory_order_relaxed);
+  if (size >= fileSize)
+    return writeData(file, fileSize, nullptr, size - fileSize);
+
+  // the last chunk is read first, so file is not changed if it can't be
+  const std::size_t kept = chunksFor(size);
+  const std::size_t tail = static_cast<std::size_t>(size % chunkSize);
+  char buffer[chunkSize];
+  const char *tailBytes =
+      tail == 0
+          ? nullptr
+          : chunkBytes(data->chunks[kept - 1].load(std::memory_order_relaxed),
+                       buffer);
+  if (tail != 0 && tailBytes == nullptr)
+    return false;
+
+  // readers of the old table can read up to its size, so new table doesn't
+  // share any chunk that is written in place later
+  FileData *truncated = createData(data->capacity);
+  for (std::size_t i = 0; i < kept; ++i)
+    truncated->chunks[i].store(data->chunks[i].load(std::memory_order_relaxed),
+                               std::memory_order_relaxed);
+  std::vector<Chunk *> replaced;
+  if (tail != 0) {
+    Chunk *last = data->chunks[kept - 1].load(std::memory_order_relaxed);
+    Chunk *copy = allocateChunk();
+    std::memcpy(copy->page.load(std::memory_order_relaxed)->bytes, tailBytes,
+                tail);
+    truncated->chunks[kept - 1].store(copy, std::memory_order_relaxed);
+    replaced.push_back(last);
+    deduplicate(truncated, kept - 1, tail, replaced);
+  }
+  for (std::size_t i = kept; i < chunksFor(fileSize); ++i)
+    replaced.push_back(data->chunks[i].load(std::memory_order_relaxed));
+  truncated->size.store(size, std::memory_order_relaxed);
+  file->data.store(truncated, std::memory_order_release);
+  logicalBytes.fetch_sub(fileSize - size);
+  retireData(data);
+  retireChunks(std::move(replaced));
+  return true;
+}
+
+bool VirtualFileSystem::read(const std::string &path, std::uint64_t offset,
+                             std::uint64_t size,
+                             const ReadVisitor &visit) const {
+  return read(context(), path, offset, size, visit);
+}
+
+bool VirtualFileSystem::read(const Context &context, const std::string &path,
+                             std::uint64_t offset, std::uint64_t size,
+                             const ReadVisitor &visit) const {
+  Stats::Timer timer(context.shard, Stats::Operation::Read);
+  EpochManager::Guard guard(epochs, context.participant);
+  Directory *parent = nullptr;
+  const File *file = findFile(context, path, parent);
+  if (file == nullptr)
+    return false;
+  const FileData *data = file->data.load(std::memory_order_acquire);
+  if (data == nullptr)
+    return true;
+  // chunks of the table are read up to its size, that is loaded once
+  const std::uint64_t fileSize = data->size.load(std::memory_order_acquire);
+  if (offset >= fileSize)
+    return true;
+  const std::uint64_t end = size > fileSize - offset ? fileSize : offset + size;
+  // use of chunks is tracked only while they are compressed or spilled
+  const bool tracked = compressAfter.load(std::memory_order_relaxed) != 0 ||
+                       memoryLimit.load(std::memory_order_relaxed) != 0;
+  const std::int64_t now = tracked ? milliseconds() : 0;
+  for (std::uint64_t position = offset; position < end;) {
+    const std::size_t begin = static_cast<std::size_t>(position % chunkSize);
+    const std::size_t length = static_cast<std::size_t>(
+        std::min<std::uint64_t>(chunkSize - begin, end - position));
+    Chunk *chunk =
+        data->chunks[static_cast<std::size_t>(position / chunkSize)].load(
+            std::memory_order_acquire);
+    const Page *page = chunk->page.load(std::memory_order_acquire);
+    if (page == nullptr) {
+      Stats::Timer restore(
+          context.shard,
+          chunk->packed.load(std::memory_order_relaxed) != nullptr
+              ? Stats::Operation::Decompress
+              : Stats::Operation::PageIn);
+      page = restoreChunk(chunk);
+    }
+    if (page == nullptr) {
+      context.out << unreadableData;
+      return false;
+    }
+    if (tracked && chunk->used.load(std::memory_order_relaxed) != now)
+      chunk->used.store(now, std::memory_order_relaxed);
+    if (!visit(page->bytes + begin, length))
+      break;
+    position += length;
+  }
+  return true;
+}
+
+void VirtualFileSystem::cat(const std::string &path) const {
+  const Context command = context();
+  read(command, path, 0, std::numeric_limits<std::uint64_t>::max(),
+       [&command](const char *data, std::size_t size) {
+         command.out.write(data, static_cast<std::streamsize>(size));
+         return true;
+       });
+}
+
+void VirtualFileSystem::copyData(const File *source, File *copy) const {
+  const FileData *data = source->data.load(std::memory_order_acquire);
+  if (data == nullptr)
+    return;
+  const std::uint64_t size = data->size.load(std::memory_order_acquire);
+  // copy shares chunks of the source, chunk is copied when one of the files
+  // writes it
+  FileData *copied = createData(std::max<std::size_t>(chunksFor(size), 1));
+  {
+    std::lock_guard<std::mutex> lock(chunkMutex);
+    for (std::size_t i = 0; i < chunksFor(size); ++i) {
+      Chunk *chunk = data->chunks[i].load(std::memory_order_acquire);
+      ++chunk->references;
+      copied->chunks[i].store(chunk, std::memory_order_relaxed);
+    }
+  }
+  copied->size.store(size, std::memory_order_relaxed);
+  copy->data.store(copied, std::memory_order_release);
+  logicalBytes.fetch_add(size);
+}
+
+bool VirtualFileSystem::visitData(const File *file,
+                                  const ReadVisitor &visit) const {
+  const FileData *data = file->data.load(std::memory_order_acquire);
+  if (data == nullptr)
+    return true;
+  const std::uint64_t size = data->size.load(std::memory_order_acquire);
+  char buffer[chunkSize];
+  for (std::size_t index = 0; index < chunksFor(size); ++index) {
+    const Chunk *chunk = data->chunks[index].load(std::memory_order_acquire);
+    const char *bytes = chunkBytes(chunk, buffer);
+    if (bytes == nullptr ||
+        !visit(bytes, static_cast<std::size_t>(std::min<std::uint64_t>(
+                          chunkSize, size - index * chunkSize))))
+      return false;
+  }
+  return true;
+}
+
+bool VirtualFileSystem::ownChunk(Chunk *chunk) const {
+  std::lock_guard<std::mutex> lock(chunkMutex);
+  if (chunk->references != 1 ||
+      chunk->packed.load(std::memory_order_relaxed) != nullptr ||
+      chunk->spill.load(std::memory_order_relaxed) != 0)
+    return false;
+  unindexChunk(chunk);
+  return true;
+}
+
+void VirtualFileSystem::deduplicate(FileData *data, std::size_t index,
+                                    std::size_t length,
+                                    std::vector<Chunk *> &replaced) const {
+  Chunk *chunk = data->chunks[index].load(std::memory_order_relaxed);
+  const char *bytes = chunk->page.load(std::memory_order_relaxed)->bytes;
+  const std::uint64_t hash = chunk->appendedHash.hash(bytes, length);
+  const std::int64_t now = milliseconds();
+  // candidates are referenced, so they are not released and not written,
+  // while they are decompressed or read back without chunkMutex
+  std::vector<Chunk *> candidates;
+  {
+    std::lock_guard<std::mutex> lock(chunkMutex);
+    const auto range = dedupIndex.equal_range(hash);
+    for (auto candidate = range.first; candidate != range.second;
+         ++candidate) {
+      if (candidate->second->length == length) {
+        ++candidate->second->references;
+        candidates.push_back(candidate->second);
+      }
+    }
+    if (candidates.empty()) {
+      indexChunk(chunk, length, hash, now);
+      return;
+    }
+  }
+  Chunk *shared = nullptr;
+  char buffer[chunkSize];
+  for (auto candidate : candidates) {
+    // candidate that can't be read from backing file is not shared
+    const char *candidateBytes = chunkBytes(candidate, buffer);
+    if (candidateBytes != nullptr &&
+        std::memcmp(candidateBytes, bytes, length) == 0) {
+      shared = candidate;
+      break;
+    }
+  }
+  {
+    // shared chunk keeps its reference for the file
+    std::lock_guard<std::mutex> lock(chunkMutex);
+    for (auto candidate : candidates)
+      if (candidate != shared)
+        releaseChunk(candidate);
+    if (shared == nullptr) {
+      indexChunk(chunk, length, hash, now);
+      return;
+    }
+  }
+  // bytes are the same, readers see the same data in both chunks
+  data->chunks[index].store(shared, std::memory_order_release);
+  replaced.push_back(chunk);
+}
+
+void VirtualFileSystem::queueChunk(Chunk *chunk, std::list<Chunk *> &queue,
+                                   std::int64_t since) const {
+  chunk->queue = &queue;
+  chunk->queuedSince = since;
+  chunk->queueEntry = queue.insert(queue.end(), chunk);
+}
+
+void VirtualFileSystem::dequeueChunk(Chunk *chunk) const {
+  if (chunk->queue == nullptr)
+    return;
+  chunk->queue->erase(chunk->queueEntry);
+  chunk->queue = nullptr;
+}
+
+void VirtualFileSystem::indexChunk(Chunk *chunk, std::size_t length,
+                                   std::uint64_t hash,
+                                   std::int64_t now) const {
+  chunk->length = static_cast<std::uint32_t>(length);
+  chunk->hash = hash;
+  chunk->incompressible = false;
+  dedupIndex.emplace(hash, chunk);
+  queueChunk(chunk, compressQueue, now);
+}
+
+void VirtualFileSystem::unindexChunk(Chunk *chunk) const {
+  dequeueChunk(chunk);
+  if (chunk->length == 0)
+    return;
+  const auto candidates = dedupIndex.equal_range(chunk->hash);
+  for (auto candidate = candidates.first; candidate != candidates.second;
+       ++candidate) {
+    if (candidate->second == chunk) {
+      dedupIndex.erase(candidate);
+      break;
+    }
+  }
+  chunk->length = 0;
+}
+
+void VirtualFileSystem::releaseChunk(Chunk *chunk) const {
+  if (--chunk->references != 0)
+    return;
+  unindexChunk(chunk);
+  const Packed *packed = chunk->packed.load(std::memory_order_relaxed);
+  if (packed != nullptr) {
+    --packedChunks;
+    packedBytes -= packed->size;
+  }
+  const std::uint64_t spill = chunk->spill.load(std::memory_order_relaxed);
+  if (spill != 0)
+    spillFile.release(spill - 1);
+  // only compressed and spilled chunks are in hotChunks
+  if (packed != nullptr || spill != 0) {
+    std::lock_guard<std::mutex> lock(hotMutex);
+    if (chunk->hot) {
+      hotChunks.erase(chunk->hotEntry);
+      chunk->hot = false;
+    }
+  }
+  pagePool.destroy(chunk->page.load(std::memory_order_relaxed));
+  chunkPool.destroy(chunk);
+}
+
+void VirtualFileSystem::setCompression(std::chrono::milliseconds idle,
+                                       std::size_t hotChunks) {
+  hotLimit.store(hotChunks);
+  compressAfter.store(idle.count());
+  {
+    std::lock_guard<std::mutex> lock(compressorMutex);
+    if (idle.count() > 0 && !compressor.joinable()) {
+      compressorStopping = false;
+      compressor = std::thread(&VirtualFileSystem::compress, this);
+    }
+  }
+  compressorCondition.notify_one();
+}
+
+void VirtualFileSystem::compress() {
+  std::unique_lock<std::mutex> lock(compressorMutex);
+  while (!compressorStopping) {
+    // chunk is compressed at most half of compressAfter after it is idle
+    const std::int64_t idle = compressAfter.load();
+    compressorCondition.wait_for(
+        lock, std::chrono::milliseconds(
+                  idle > 0 ? std::max<std::int64_t>(idle / 2, 1) : 1000));
+    if (compressorStopping)
+      break;
+    lock.unlock();
+    compressIdle();
+    lock.lock();
+  }
+}
+
+std::size_t VirtualFileSystem::compressIdle() {
+  std::lock_guard<std::mutex> pass(compressorMutex);
+  const std::int64_t idle = compressAfter.load();
+  if (idle == 0)
+    return 0;
+  const std::int64_t now = milliseconds();
+  std::vector<Page *> released;
+  {
+    // decompressed chunks that are not read any more drop their pages
+    std::lock_guard<std::mutex> lock(hotMutex);
+    for (auto entry = hotChunks.begin(); entry != hotChunks.end();) {
+      Chunk *chunk = *entry;
+      if (now - chunk->used.load(std::memory_order_relaxed) < idle) {
+        ++entry;
+        continue;
+      }
+      entry = hotChunks.erase(entry);
+      chunk->hot = false;
+      released.push_back(chunk->page.exchange(nullptr));
+    }
+  }
+
+  // chunks in dedupIndex are not written in place, and they are referenced,
+  // so they are not released and not written while they are compressed.
+  // Only chunks queued for idle time are visited, chunk that was read since
+  // then is queued again, so queue stays in order of queuedSince.
+  std::vector<std::pair<Chunk *, std::size_t>> idleChunks;
+  {
+    std::lock_guard<std::mutex> lock(chunkMutex);
+    while (!compressQueue.empty() &&
+           now - compressQueue.front()->queuedSince >= idle) {
+      Chunk *chunk = compressQueue.front();
+      if (now - chunk->used.load(std::memory_order_relaxed) < idle) {
+        compressQueue.splice(compressQueue.end(), compressQueue,
+                             chunk->queueEntry);
+        chunk->queuedSince = now;
+        continue;
+      }
+      dequeueChunk(chunk);
+      ++chunk->references;
+      chunk->busy = true;
+      idleChunks.emplace_back(chunk, chunk->length);
+    }
+  }
+  char buffer[chunkSize];
+  std::vector<Chunk *> incompressible;
+  std::uint64_t compressedBytes = 0;
+  for (const auto &idleChunk : idleChunks) {
+    Chunk *chunk = idleChunk.first;
+    // compressed chunk saves at least eighth of the page, or it is kept
+    const std::size_t size =
+        lzCompress(chunk->page.load(std::memory_order_relaxed)->bytes,
+                   idleChunk.second, buffer, chunkSize - chunkSize / 8);
+    if (size == 0) {
+      incompressible.push_back(chunk);
+      continue;
+    }
+    // readers that see no page see packed
+    chunk->packed.store(new Packed(idleChunk.second, buffer, size),
+                        std::memory_order_release);
+    released.push_back(chunk->page.exchange(nullptr));
+    compressedBytes += size;
+  }
+  {
+    std::lock_guard<std::mutex> lock(chunkMutex);
+    packedChunks += idleChunks.size() - incompressible.size();
+    packedBytes += compressedBytes;
+    for (auto chunk : incompressible)
+      chunk->incompressible = true;
+    // compressed and incompressible chunks wait for spill, in order of use
+    for (const auto &idleChunk : idleChunks) {
+      Chunk *chunk = idleChunk.first;
+      chunk->busy = false;
+      queueChunk(chunk, residentQueue,
+                 chunk->used.load(std::memory_order_relaxed));
+      releaseChunk(chunk);
+    }
+  }
+  retirePages(std::move(released));
+  return idleChunks.size() - incompressible.size();
+}
+
+bool VirtualFileSystem::setMemoryLimit(std::uint64_t limit,
+                                       const std::string &backingPath) {
+  {
+    std::lock_guard<std::mutex> spilling(spillMutex);
+    if (limit != 0 && !spillFile.isOpen() && !spillFile.open(backingPath))
+      return false;
+    memoryLimit.store(limit);
+  }
+  spillChunks();
+  return true;
+}
+
+std::uint64_t VirtualFileSystem::residentBytes() const {
+  return static_cast<std::uint64_t>(pagePool.size() - retiredPages.load()) *
+             chunkSize +
+         packedBytes;
+}
+
+void VirtualFileSystem::spillChunks() const {
+  std::lock_guard<std::mutex> spilling(spillMutex);
+  const std::uint64_t limit = memoryLimit.load();
+  std::vector<std::pair<Chunk *, std::size_t>> spilled;
+  const std::int64_t now = milliseconds();
+  {
+    std::lock_guard<std::mutex> lock(chunkMutex);
+    const std::uint64_t resident = residentBytes();
+    if (limit == 0 || resident <= limit) // other writer spilled them
+      return;
+    // the least recently used chunk is at front of one of the queues.
+    // Chunk that was read since it was queued gets second chance at the
+    // back, chunk with page and compressed bytes is in hotChunks, its page
+    // is released by LRU, so it is moved to the back too.
+    std::size_t chances = compressQueue.size() + residentQueue.size();
+    std::uint64_t excess = resident - (limit - limit / 8);
+    while (excess != 0 && (!compressQueue.empty() || !residentQueue.empty())) {
+      std::list<Chunk *> &queue =
+          residentQueue.empty() ||
+                  (!compressQueue.empty() &&
+                   compressQueue.front()->queuedSince <=
+                       residentQueue.front()->queuedSince)
+              ? compressQueue
+              : residentQueue;
+      Chunk *chunk = queue.front();
+      const Packed *packed = chunk->packed.load(std::memory_order_relaxed);
+      if ((packed != nullptr &&
+           chunk->page.load(std::memory_order_relaxed) != nullptr) ||
+          chunk->used.load(std::memory_order_relaxed) > chunk->queuedSince) {
+        if (chances == 0)
+          break;
+        --chances;
+        queue.splice(queue.end(), queue, chunk->queueEntry);
+        chunk->queuedSince = now;
+        continue;
+      }
+      excess -= std::min<std::uint64_t>(
+          excess, packed != nullptr ? packed->size : chunkSize);
+      ++chunk->references;
+      chunk->busy = true;
+      dequeueChunk(chunk);
+      spilled.emplace_back(chunk, chunk->length);
+    }
+  }
+
+  // compressed chunks are spilled compressed
+  std::vector<Page *> released;
+  std::unique_ptr<std::vector<std::unique_ptr<Packed>>> releasedPacked(
+      new std::vector<std::unique_ptr<Packed>>());
+  std::uint64_t releasedPackedBytes = 0;
+  std::uint64_t written = 0;
+  for (const auto &spilledChunk : spilled) {
+    Chunk *chunk = spilledChunk.first;
+    const Packed *packed = chunk->packed.load(std::memory_order_relaxed);
+    const std::uint64_t slot = spillFile.allocate();
+    const bool stored =
+        packed != nullptr
+            ? spillFile.write(slot, packed->bytes.get(), packed->size)
+            : spillFile.write(
+                  slot, chunk->page.load(std::memory_order_relaxed)->bytes,
+                  spilledChunk.second);
+    if (!stored) { // chunk stays in memory
+      spillFile.release(slot);
+      continue;
+    }
+    chunk->spillPacked = packed != nullptr;
+    chunk->spillLength = static_cast<std::uint32_t>(
+        packed != nullptr ? packed->length : spilledChunk.second);
+    chunk->spillSize = static_cast<std::uint32_t>(
+        packed != nullptr ? packed->size : spilledChunk.second);
+    // readers that see no page and no packed see spill
+    chunk->spill.store(slot + 1, std::memory_order_release);
+    if (packed != nullptr) {
+      releasedPackedBytes += packed->size;
+      releasedPacked->emplace_back(chunk->packed.exchange(nullptr));
+    } else {
+      released.push_back(chunk->page.exchange(nullptr));
+    }
+    ++written;
+  }
+  {
+    std::lock_guard<std::mutex> lock(chunkMutex);
+    packedChunks -= releasedPacked->size();
+    packedBytes -= releasedPackedBytes;
+    for (const auto &spilledChunk : spilled) {
+      Chunk *chunk = spilledChunk.first;
+      chunk->busy = false;
+      // chunk that stays in memory is queued again
+      if (chunk->spill.load(std::memory_order_relaxed) == 0)
+        queueChunk(chunk,
+                   chunk->packed.load(std::memory_order_relaxed) != nullptr ||
+                           chunk->incompressible
+                       ? residentQueue
+                       : compressQueue,
+                   now);
+      releaseChunk(chunk);
+    }
+  }
+  evictions.fetch_add(written);
+  retirePages(std::move(released));
+  if (!releasedPacked->empty())
+    epochs.retire(releasedPacked.release());
+}
+
+void VirtualFileSystem::releaseData(File *file) {
+  FileData *data = file->data.exchange(nullptr);
+  if (data == nullptr)
+    return;
+  logicalBytes.fetch_sub(data->size.load(std::memory_order_relaxed));
+  {
+    std::lock_guard<std::mutex> lock(chunkMutex);
+    for (std::size_t i = 0; i < data->capacity; ++i) {
+      Chunk *chunk = data->chunks[i].load(std::memory_order_relaxed);
+      if (chunk != nullptr)
+        releaseChunk(chunk);
+    }
+  }
+  destroyData(nodeMemory, data);
+}
+
+VirtualFileSystem::FileData *
+VirtualFileSystem::createData(std::size_t capacity) const {
+  return new (nodeMemory.allocate(sizeof(FileData) +
+                                  capacity * sizeof(std::atomic<Chunk *>)))
+      FileData(capacity);
+}
+
+void VirtualFileSystem::destroyData(BlockArena &memory, FileData *data) {
+  if (data == nullptr)
+    return;
+  const std::size_t bytes =
+      sizeof(FileData) + data->capacity * sizeof(std::atomic<Chunk *>);
+  data->~FileData();
+  memory.deallocate(data, bytes);
+}
+
+void VirtualFileSystem::retireData(FileData *data) const {
+  epochs.retire(
+      data,
+      [](void *memory, void *pointer) {
+        destroyData(*static_cast<BlockArena *>(memory),
+                    static_cast<FileData *>(pointer));
+      },
+      &nodeMemory);
+}
+
+VirtualFileSystem::Sorted *
+VirtualFileSystem::createSorted(std::uint64_t changes,
+                                std::size_t size) const {
+  return new (nodeMemory.allocate(sizeof(Sorted) + size * sizeof(Child)))
+      Sorted(changes, size);
+}
+
+void VirtualFileSystem::destroySorted(BlockArena &memory, Sorted *sorted) {
+  if (sorted == nullptr)
+    return;
+  const std::size_t bytes = sizeof(Sorted) + sorted->size * sizeof(Child);
+  sorted->~Sorted();
+  memory.deallocate(sorted, bytes);
+}
+
+void VirtualFileSystem::retireSorted(Sorted *sorted) const {
+  epochs.retire(
+      sorted,
+      [](void *memory, void *pointer) {
+        destroySorted(*static_cast<BlockArena *>(memory),
+                      static_cast<Sorted *>(pointer));
+      },
+      &nodeMemory);
+}
+
+void VirtualFileSystem::retireChunks(std::vector<Chunk *> &&chunks) const {
+  if (chunks.empty())
+    return;
+  epochs.retire(new std::vector<Chunk *>(std::move(chunks)), releaseChunks,
+                const_cast<VirtualFileSystem *>(this));
+}
+
+void VirtualFileSystem::releaseChunks(void *fileSystem, void *chunks) {
+  auto self = static_cast<VirtualFileSystem *>(fileSystem);
+  std::unique_ptr<std::vector<Chunk *>> batch(
+      static_cast<std::vector<Chunk *> *>(chunks));
+  std::lock_guard<std::mutex> lock(self->chunkMutex);
+  for (auto chunk : *batch)
+    self->releaseChunk(chunk);
+}
+
+VirtualFileSystem::DedupStats VirtualFileSystem::dedupStats() const {
+  epochs.drain();
+  std::lock_guard<std::mutex> lock(chunkMutex);
+  return {logicalBytes.load(), residentBytes(), chunkPool.size()};
+}
+
+std::size_t VirtualFileSystem::dataChunks() const {
+  epochs.drain();
+  std::lock_guard<std::mutex> lock(chunkMutex);
+  return chunkPool.size();
+}
+
+void VirtualFileSystem::complete(const std::string &prefix,
+                                 std::size_t limit) const {
+  complete(context(), prefix, limit);
+}
+
+void VirtualFileSystem::complete(const Context &context,
+                                 const std::string &prefix,
+                                 std::size_t limit) const {
+  buildNameTree(context.participant);
+  EpochManager::Guard guard(epochs, context.participant);
+  std::shared_lock<std::shared_timed_mutex> lock(nameTreeMutex);
+  std::size_t printed = 0;
+  const bool all = nameTree.visit(
+      prefix.data(), prefix.size(),
+      [&context, &printed, limit](const std::string &name,
+                                  const std::vector<Located> &located) {
+        // name of erased directory is completed only if some other
+        // directory/file has it
+        if (std::none_of(located.begin(), located.end(), isLocated))
+          return true;
+        if (printed == limit)
+          return false;
+        context.out << name << '\n';
+        ++printed;
+        return true;
+      });
+  if (!all)
+    context.out << "...\n";
+}
+
+void VirtualFileSystem::locate(const std::string &prefix,
+                               std::size_t limit) const {
+  locate(context(), prefix, limit);
+}
+
+void VirtualFileSystem::locate(const Context &context,
+                               const std::string &prefix,
+                               std::size_t limit) const {
+  buildNameTree(context.participant);
+  EpochManager::Guard guard(epochs, context.participant);
+  std::shared_lock<std::shared_timed_mutex> lock(nameTreeMutex);
+  std::size_t printed = 0;
+  const bool all = nameTree.visit(
+      prefix.data(), prefix.size(),
+      [&context, &printed, limit](const std::string &,
+                                  const std::vector<Located> &located) {
+        for (const auto &found : located) {
+          if (!isLocated(found))
+            continue;
+          if (printed == limit)
+            return false;
+          context.out << pathOf(found.parent, found.child.name()) << '\n';
+          ++printed;
+        }
+        return true;
+      });
+  if (!all)
+    context.out << "...\n";
+  else if (printed == 0)
+    context.out << "No such directory or file\n";
+}
+
+void VirtualFileSystem::buildNameTree(
+    EpochManager::Participant &participant) const {
+  if (nameTreeBuilt.load())
+    return;
+  // no mutation runs, so every node is added once
+  std::unique_lock<std::shared_timed_mutex> mutation(mutationMutex);
+  if (nameTreeBuilt.load()) // built meanwhile
+    return;
+  EpochManager::Guard guard(epochs, participant);
+  std::unique_lock<std::shared_timed_mutex> lock(nameTreeMutex);
+  const Name &name = head->directoryName;
+  nameTree.insert(name.data(), name.size(), Located{nullptr, Child(head)});
+  std::vector<Directory *> stack{head};
+  while (!stack.empty()) {
+    Directory *directory = stack.back();
+    stack.pop_back();
+    materialize(directory);
+    for (auto subDirectory : directory->subDirectories.snapshot()) {
+      const Name &subName = subDirectory->directoryName;
+      nameTree.insert(subName.data(), subName.size(),
+                      Located{directory, Child(subDirectory)});
+      stack.push_back(subDirectory);
+    }
+    for (auto file : directory->files.snapshot())
+      nameTree.insert(file->fileName.data(), file->fileName.size(),
+                      Located{directory, Child(file)});
+  }
+  nameTreeBuilt.store(true);
+}
+
+void VirtualFileSystem::indexTree(Directory *parent, Child child) {
+  if (!nameTreeBuilt.load())
+    return;
+  std::unique_lock<std::shared_timed_mutex> lock(nameTreeMutex);
+  const Name &name = child.name();
+  nameTree.insert(name.data(), name.size(), Located{parent, child});
+  if (child.directory() == nullptr)
+    return;
+  // copy is not yet published, so nothing is created in it meanwhile
+  std::vector<Directory *> stack{child.directory()};
+  while (!stack.empty()) {
+    Directory *directory = stack.back();
+    stack.pop_back();
+    for (auto subDirectory : directory->subDirectories.snapshot()) {
+      const Name &subName = subDirectory->directoryName;
+      nameTree.insert(subName.data(), subName.size(),
+                      Located{directory, Child(subDirectory)});
+      stack.push_back(subDirectory);
+    }
+    for (auto file : directory->files.snapshot())
+      nameTree.insert(file->fileName.data(), file->fileName.size(),
+                      Located{directory, Child(file)});
+  }
+}
+
+void VirtualFileSystem::unindexFile(Directory *parent, File *file) {
+  if (!nameTreeBuilt.load())
+    return;
+  std::unique_lock<std::shared_timed_mutex> lock(nameTreeMutex);
+  nameTree.erase(file->fileName.data(), file->fileName.size(),
+                 Located{parent, Child(file)});
+}
+
+bool VirtualFileSystem::isLocated(const Located &located) {
+  // erased directories, and their subtrees, are erased from nameTree only
+  // when they are released
+  if (located.child.directory() != nullptr &&
+      located.child.directory()->removed.load())
+    return false;
+  for (const Directory *up = located.parent; up != nullptr;
+       up = up->parentDirectory) {
+    if (up->removed.load())
+      return false;
+  }
+  return true;
+}
+
+std::size_t VirtualFileSystem::nodeCount() const {
+  epochs.drain();
+  std::lock_guard<std::mutex> lock(poolMutex);
+  return directoryPool.size() + filePool.size();
+}
+
+std::size_t VirtualFileSystem::internedNames() const {
+  epochs.drain();
+  return names.size();
+}
+
+void VirtualFileSystem::drain() const { epochs.drain(); }
+
+Stats::Snapshot VirtualFileSystem::stats() const {
+  Stats::Snapshot snapshot = statistics.snapshot();
+#if VFS_STATS
+  {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    snapshot.nodes = directoryPool.size() + filePool.size();
+  }
+  std::lock_guard<std::mutex> lock(chunkMutex);
+  snapshot.compressedChunks = packedChunks;
+  snapshot.spilledChunks = spillFile.slots();
+  snapshot.evictions = evictions.load();
+  // decompressed pages of hot chunks are subtracted from the saving
+  const std::uint64_t resident = residentBytes();
+  const std::uint64_t uncompressed =
+      static_cast<std::uint64_t>(chunkPool.size() - snapshot.spilledChunks) *
+      chunkSize;
+  snapshot.savedBytes = uncompressed > resident ? uncompressed - resident : 0;
+#endif
+  return snapshot;
+}
+
+VirtualFileSystem::ReclaimCounters VirtualFileSystem::reclaimCounters() const {
+  return ReclaimCounters{
+      epochs.pending(),
+      releasedDirectories.load(std::memory_order_relaxed),
+      releasedFiles.load(std::memory_order_relaxed)};
+}
+
+bool VirtualFileSystem::save(const std::string &path) const {
+  // children of directory are written as they were when directory was
+  // written, so node table is consistent while other sessions change vfs
+  struct Pending {
+    const ImageNode *node;
+    std::vector<Directory *> subDirectories;
+    std::vector<File *> files;
+  };
+  std::deque<Pending> pending;
+  ImageWriter writer;
+  // mutations journaled before save are in the image
+  const std::uint64_t sequence = journal.isOpen() ? journal.lastSequence() : 0;
+  auto add = [this, &writer, &pending](const Directory *directory) {
+    const ImageNode *node = directory->image.load(std::memory_order_acquire);
+    const auto subDirectories = directory->subDirectories.snapshot();
+    const auto files = directory->files.snapshot();
+    Pending next{node,
+                 {subDirectories.begin(), subDirectories.end()},
+                 {files.begin(), files.end()}};
+    if (node != nullptr)
+      writer.add(directory->directoryName.data(),
+                 directory->directoryName.size(), directory->timeCreated,
+                 node->directoryCount, node->fileCount);
+    else
+      writer.add(directory->directoryName.data(),
+                 directory->directoryName.size(), directory->timeCreated,
+                 next.subDirectories.size(), next.files.size());
+    pending.push_back(std::move(next));
+  };
+
+  EpochManager::Guard guard(epochs, *participant);
+  if (!writer.open(path)) {
+    std::cout << "Can't save image\n";
+    return false;
+  }
+  add(head);
+  while (!pending.empty()) {
+    const Pending current = std::move(pending.front());
+    pending.pop_front();
+    if (current.node == nullptr) {
+      for (auto directory : current.subDirectories)
+        add(directory);
+      for (auto file : current.files) {
+        if (!visitData(file, [&writer](const char *bytes, std::size_t size) {
+              writer.addData(bytes, size);
+              return true;
+            })) {
+          std::cout << unreadableData << "Can't save image\n";
+          return false;
+        }
+        writer.add(file->fileName.data(), file->fileName.size(),
+                   file->timeCreated, 0, 0);
+      }
+      continue;
+    }
+    // directory in image, its children are copied from image
+    const ImageNode *node = current.node;
+    for (std::size_t i = 0; i < node->directoryCount + node->fileCount; ++i) {
+      const ImageNode *child = mappedImage.child(node, i);
+      const char *name = child == nullptr ? nullptr : mappedImage.name(child);
+      if (name == nullptr) {
+        writer.add("", 0, 0, 0, 0);
+        continue;
+      }
+      if (i < node->directoryCount) {
+        writer.add(name, child->nameSize, child->timeCreated,
+                   child->directoryCount, child->fileCount);
+        pending.push_back(Pending{child, {nullptr, 0}, {nullptr, 0}});
+      } else {
+        const char *bytes = mappedImage.fileData(child);
+        if (bytes != nullptr)
+          writer.addData(bytes, static_cast<std::size_t>(child->dataSize));
+        writer.add(name, child->nameSize, child->timeCreated, 0, 0);
+      }
+    }
+  }
+  if (!writer.close(sequence)) {
+    std::cout << "Can't save image\n";
+    return false;
+  }
+  return true;
+}
+
+bool VirtualFileSystem::load(const std::string &path) {
+  Image loaded;
+  if (!loaded.open(path)) {
+    std::cout << "Can't load image\n";
+    return false;
+  }
+  // no command runs, so nothing can see current vfs structure
+  epochs.reclaimAll();
+  for (const auto &kept : retained) {
+    if (kept.kind == Retained::Kind::Frozen)
+      delete static_cast<Frozen *>(kept.pointer);
+  }
+  retained.clear();
+  {
+    // nameTree is built again from the image, when it is needed
+    std::unique_lock<std::shared_timed_mutex> names(nameTreeMutex);
+    nameTree.clear();
+    nameTreeBuilt.store(false);
+  }
+  releaseNodes();
+  {
+    // compressor doesn't run while chunks are cleared
+    std::lock_guard<std::mutex> pass(compressorMutex);
+    std::lock_guard<std::mutex> lock(hotMutex);
+    hotChunks.clear();
+    chunkPool.clear();
+    pagePool.clear();
+    dedupIndex.clear();
+    compressQueue.clear();
+    residentQueue.clear();
+    spillFile.clear();
+    packedChunks = 0;
+    packedBytes = 0;
+    logicalBytes.store(0);
+  }
+  mappedImage.swap(loaded);
+
+  const ImageNode *root = mappedImage.root();
+  head = directoryPool.create(
+      names.intern(mappedImage.name(root), root->nameSize), nodeMemory);
+  head->timeCreated = root->timeCreated;
+  head->image.store(root);
+  ++generation;
+  std::lock_guard<std::mutex> lock(sessionMutex);
+  for (auto workingDirectory : workingDirectories)
+    workingDirectory->store(head);
+  return true;
+}
+
+bool VirtualFileSystem::recover(const std::string &imagePath,
+                                const std::string &journalPath,
+                                std::chrono::microseconds commitDelay) {
+  journal.close();
+  std::uint64_t sequence = 0;
+  if (std::ifstream(imagePath).good()) {
+    if (!load(imagePath))
+      return false;
+    sequence = mappedImage.journalSequence();
+  }
+
+  // records that are in the image are skipped, other are replayed from head
+  std::vector<Journal::Record> records;
+  const std::size_t validSize = Journal::read(journalPath, records);
+  DirectoryPointer root;
+  root.store(head);
+  DentryCache<Directory> cache;
+  std::ostream discard(nullptr);
+  const Context replay{*participant, root, cache, *shard, discard};
+  for (const auto &replayed : records) {
+    if (replayed.sequence <= sequence)
+      continue;
+    sequence = replayed.sequence;
+    switch (replayed.operation) {
+    case Journal::Operation::MakeDirectory:
+      makeDirectory(replay, replayed.path, replayed.timeCreated);
+      break;
+    case Journal::Operation::MakeFile:
+      makeFile(replay, replayed.path, replayed.timeCreated);
+      break;
+    case Journal::Operation::Remove:
+      remove(replay, replayed.path, false);
+      break;
+    case Journal::Operation::Write:
+      write(replay, replayed.path, replayed.offset, replayed.data.data(),
+            replayed.data.size(), false);
+      break;
+    case Journal::Operation::Truncate:
+      truncate(replay, replayed.path, replayed.offset);
+      break;
+    }
+  }
+
+  if (!journal.open(journalPath, validSize, sequence, commitDelay)) {
+    std::cout << "Can't open journal\n";
+    return false;
+  }
+  return true;
+}
+
+bool VirtualFileSystem::checkpoint(const std::string &imagePath) {
+  if (!journal.isOpen()) {
+    std::cout << "No journal\n";
+    return false;
+  }
+  // no mutation runs, so image has exactly the journaled mutations
+  std::unique_lock<std::shared_timed_mutex> lock(mutationMutex);
+  if (!save(imagePath))
+    return false;
+  if (!journal.reset()) {
+    std::cout << "Can't write journal\n";
+    return false;
+  }
+  return true;
+}
+
+void VirtualFileSystem::closeJournal() { journal.close(); }
+
+std::int64_t return_current_time() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+void format_time_and_date(std::int64_t time, char *buffer) {
+  time_t created = static_cast<time_t>(time);
+  std::tm local{};
+  localtime_r(&created, &local);
+
+  std::fill(buffer, buffer + timeFormatLength, '\0');
+  std::strftime(buffer, timeFormatLength, "%Y-%m-%d %H:%M:%S",
+                &local); // prints time and date when file/directory was created
+}
+
+std::string return_current_time_and_date() {
+  std::string s(timeFormatLength, '\0');
+  format_time_and_date(return_current_time(), &s[0]);
   return s;
 }
 } // namespace vfs
@@ -0,0 +1,114 @@
+#include "workStealingPool.h"
+
+namespace vfs {
+
+WorkStealingPool::WorkStealingPool(std::size_t workers)
+    : count(workers != 0 ? workers
+                         : std::max(1u, std::thread::hardware_concurrency())) {
+  for (std::size_t i = 0; i < count; ++i)
+    this->workers.emplace_back(new Worker());
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto &thread : threads)
+    thread.join();
+}
+
+void WorkStealingPool::run(void *root, const Visit &function) {
+  std::unique_lock<std::mutex> running(runMutex, std::try_to_lock);
+  if (!running.owns_lock() || count == 1) {
+    // pool is busy, maybe visit itself runs it, tree is visited in this
+    // thread with explicit stack
+    std::vector<void *> stack{root};
+    std::vector<void *> children;
+    while (!stack.empty()) {
+      void *item = stack.back();
+      stack.pop_back();
+      children.clear();
+      function(item, 0, children);
+      stack.insert(stack.end(), children.rbegin(), children.rend());
+    }
+    return;
+  }
+
+  pending.store(1);
+  workers[0]->items.push_back(root);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (threads.empty()) {
+      for (std::size_t i = 1; i < count; ++i)
+        threads.emplace_back(&WorkStealingPool::loop, this, i);
+    }
+    visit = &function;
+    ++job;
+  }
+  wake.notify_all();
+  work(0, function);
+
+  // function must outlive threads that still look for items
+  std::unique_lock<std::mutex> lock(mutex);
+  done.wait(lock, [&]() { return active == 0; });
+  visit = nullptr;
+}
+
+void WorkStealingPool::work(std::size_t index, const Visit &function) {
+  std::vector<void *> children;
+  while (pending.load() != 0) {
+    void *item = nullptr;
+    {
+      Worker &own = *workers[index];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.items.empty()) {
+        item = own.items.back();
+        own.items.pop_back();
+      }
+    }
+    for (std::size_t i = 1; item == nullptr && i < count; ++i) {
+      Worker &victim = *workers[(index + i) % count];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.items.empty()) {
+        item = victim.items.front();
+        victim.items.pop_front();
+      }
+    }
+    if (item == nullptr) { // other workers visit the rest of the tree
+      std::this_thread::yield();
+      continue;
+    }
+
+    children.clear();
+    function(item, index, children);
+    if (!children.empty()) {
+      // children are pending before their parent is finished
+      pending.fetch_add(children.size());
+      Worker &own = *workers[index];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      own.items.insert(own.items.end(), children.rbegin(), children.rend());
+    }
+    pending.fetch_sub(1);
+  }
+}
+
+void WorkStealingPool::loop(std::size_t index) {
+  std::uint64_t seen = 0;
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;) {
+    wake.wait(lock, [&]() { return stopping || (job != seen && visit); });
+    if (stopping)
+      return;
+    seen = job;
+    const Visit &function = *visit;
+    ++active;
+    lock.unlock();
+    work(index, function);
+    lock.lock();
+    if (--active == 0)
+      done.notify_all();
+  }
+}
+} // namespace vfs
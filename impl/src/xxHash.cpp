@@ -0,0 +1,114 @@
+#include "xxHash.h"
+#include <cstring>
+
+namespace vfs {
+
+namespace {
+constexpr std::uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+constexpr std::uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr std::uint64_t prime3 = 0x165667B19E3779F9ULL;
+constexpr std::uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr std::uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+std::uint64_t rotateLeft(std::uint64_t value, int bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+// unaligned loads, compiled to one instruction
+std::uint64_t read64(const unsigned char *bytes) {
+  std::uint64_t value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+std::uint32_t read32(const unsigned char *bytes) {
+  std::uint32_t value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+std::uint64_t round(std::uint64_t accumulator, std::uint64_t input) {
+  accumulator += input * prime2;
+  return rotateLeft(accumulator, 31) * prime1;
+}
+
+std::uint64_t mergeRound(std::uint64_t hash, std::uint64_t lane) {
+  hash ^= round(0, lane);
+  return hash * prime1 + prime4;
+}
+
+// whole stripes from bytes to end are added to lanes, returns the first
+// byte that is not in them
+const unsigned char *hashStripes(std::uint64_t lanes[4],
+                                 const unsigned char *bytes,
+                                 const unsigned char *end) {
+  for (; end - bytes >= 32; bytes += 32)
+    for (int lane = 0; lane < 4; ++lane)
+      lanes[lane] = round(lanes[lane], read64(bytes + 8 * lane));
+  return bytes;
+}
+
+std::uint64_t mergeLanes(const std::uint64_t lanes[4]) {
+  std::uint64_t hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) +
+                       rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18);
+  for (int lane = 0; lane < 4; ++lane)
+    hash = mergeRound(hash, lanes[lane]);
+  return hash;
+}
+
+// bytes after the last stripe, and avalanche
+std::uint64_t finish(std::uint64_t hash, const unsigned char *bytes,
+                     const unsigned char *end) {
+  for (; bytes + 8 <= end; bytes += 8)
+    hash = rotateLeft(hash ^ round(0, read64(bytes)), 27) * prime1 + prime4;
+  if (bytes + 4 <= end) {
+    hash ^= static_cast<std::uint64_t>(read32(bytes)) * prime1;
+    hash = rotateLeft(hash, 23) * prime2 + prime3;
+    bytes += 4;
+  }
+  for (; bytes < end; ++bytes) {
+    hash ^= *bytes * prime5;
+    hash = rotateLeft(hash, 11) * prime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= prime2;
+  hash ^= hash >> 29;
+  hash *= prime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+} // namespace
+
+std::uint64_t xxHash64(const void *data, std::size_t size,
+                       std::uint64_t seed) {
+  const auto *bytes = static_cast<const unsigned char *>(data);
+  const unsigned char *end = bytes + size;
+  std::uint64_t hash;
+  if (size >= 32) {
+    // four lanes don't depend on each other
+    std::uint64_t lanes[4] = {seed + prime1 + prime2, seed + prime2, seed,
+                              seed - prime1};
+    bytes = hashStripes(lanes, bytes, end);
+    hash = mergeLanes(lanes);
+  } else {
+    hash = seed + prime5;
+  }
+  hash += static_cast<std::uint64_t>(size);
+  return finish(hash, bytes, end);
+}
+
+AppendedHash::AppendedHash(std::uint64_t seed)
+    : lanes{seed + prime1 + prime2, seed + prime2, seed, seed - prime1} {}
+
+std::uint64_t AppendedHash::hash(const void *data, std::size_t size) {
+  const auto *bytes = static_cast<const unsigned char *>(data);
+  const unsigned char *end = bytes + size;
+  const unsigned char *tail = hashStripes(lanes, bytes + hashed, end);
+  hashed = static_cast<std::size_t>(tail - bytes);
+  // data shorter than stripe has no stripes, so lanes still have the seed
+  std::uint64_t hash = size >= 32 ? mergeLanes(lanes) : lanes[2] + prime5;
+  hash += static_cast<std::uint64_t>(size);
+  return finish(hash, tail, end);
+}
+} // namespace vfs
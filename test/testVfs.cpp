@@ -1,7 +1,23 @@
 #include "commands.h"
 #include "commandsIf.h"
+#include "compactFileSystem.h"
+#include "lz.h"
+#include "outputBuffer.h"
+#include "session.h"
+#include "substring.h"
 #include "vfs.h"
+#include "xxHash.h"
+#include <algorithm>
 #include <catch.hpp>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
 
 // User input commands
 TEST_CASE("UserInputCommands") {
@@ -15,8 +31,8 @@ TEST_CASE("ParseInputCommand") {
   vfs::Commands commands;
   commands.parseInput("mkdir one two three");
   REQUIRE(commands.vfs.currentDirectory->directoryName == "home");
-  // one subdirectory added to home
-  REQUIRE(commands.vfs.currentDirectory->subDirectories.size() == 1);
+  // three subdirectories added to home
+  REQUIRE(commands.vfs.currentDirectory->subDirectories.size() == 3);
   // check names of added subdirectories
   REQUIRE(commands.vfs.currentDirectory->subDirectories.at(0)->directoryName ==
           "one");
@@ -29,12 +45,12 @@ TEST_CASE("ParseInputCommand") {
 
   // make file
   commands.parseInput("mkfile file file1");
-  REQUIRE(commands.vfs.currentDirectory->files.size() == 1);
+  REQUIRE(commands.vfs.currentDirectory->files.size() == 2);
   REQUIRE(commands.vfs.currentDirectory->files.at(0)->fileName == "file");
 
   // rm file
   commands.parseInput("rm file");
-  REQUIRE(commands.vfs.currentDirectory->files.size() == 0);
+  REQUIRE(commands.vfs.currentDirectory->files.size() == 1);
 
   // cd ..
   commands.parseInput("cd ..");
@@ -248,3 +264,2086 @@ TEST_CASE("TestAll") {
   virtualFileSystem.changeDirectory(toAbove);
   REQUIRE(virtualFileSystem.currentDirectory->directoryName == "home");
 }
+
+TEST_CASE("TestDuplicateNames") {
+  vfs::VirtualFileSystem virtualFileSystem;
+
+  std::string one = "one";
+
+  // second directory or file with the same name is not created
+  virtualFileSystem.makeDirectory(one);
+  virtualFileSystem.makeDirectory(one);
+  virtualFileSystem.makeFile(one);
+  REQUIRE(virtualFileSystem.currentDirectory->subDirectories.size() == 1);
+  REQUIRE(virtualFileSystem.currentDirectory->files.size() == 0);
+
+  // after remove, name can be used again
+  virtualFileSystem.remove(one);
+  virtualFileSystem.makeFile(one);
+  REQUIRE(virtualFileSystem.currentDirectory->subDirectories.size() == 0);
+  REQUIRE(virtualFileSystem.currentDirectory->files.size() == 1);
+
+  // cd to file is not possible
+  virtualFileSystem.changeDirectory(one);
+  REQUIRE(virtualFileSystem.currentDirectory->directoryName == "home");
+}
+
+TEST_CASE("TestLargeDirectory") {
+  vfs::VirtualFileSystem virtualFileSystem;
+
+  const int count = 10000;
+  for (int i = 0; i < count; ++i) {
+    virtualFileSystem.makeDirectory("dir" + std::to_string(i));
+    virtualFileSystem.makeFile("file" + std::to_string(i));
+  }
+  REQUIRE(virtualFileSystem.currentDirectory->subDirectories.size() == count);
+  REQUIRE(virtualFileSystem.currentDirectory->files.size() == count);
+
+  // remove every second directory and file
+  for (int i = 0; i < count; i += 2) {
+    virtualFileSystem.remove("dir" + std::to_string(i));
+    virtualFileSystem.remove("file" + std::to_string(i));
+  }
+  REQUIRE(virtualFileSystem.currentDirectory->subDirectories.size() ==
+          count / 2);
+  REQUIRE(virtualFileSystem.currentDirectory->files.size() == count / 2);
+
+  // removed directory can't be found, remaining ones can
+  virtualFileSystem.changeDirectory("dir0");
+  REQUIRE(virtualFileSystem.currentDirectory->directoryName == "home");
+  virtualFileSystem.changeDirectory("dir9999");
+  REQUIRE(virtualFileSystem.currentDirectory->directoryName == "dir9999");
+  virtualFileSystem.changeDirectory("..");
+
+  // erased slots are skipped and compacted, order of the rest is kept
+  auto &files = virtualFileSystem.currentDirectory->files;
+  REQUIRE(files.at(0)->fileName == "file1");
+  REQUIRE(files.at(1)->fileName == "file3");
+  for (int i = 1; i < count - 1; i += 2)
+    virtualFileSystem.remove("file" + std::to_string(i));
+  virtualFileSystem.makeFile("last");
+  REQUIRE(files.size() == 2);
+  std::vector<std::string> names;
+  for (auto file : files.snapshot())
+    names.push_back(file->fileName.str());
+  REQUIRE(names == std::vector<std::string>{"file9999", "last"});
+  virtualFileSystem.remove("file9999");
+  REQUIRE(files.at(0)->fileName == "last");
+}
+
+TEST_CASE("TestNodePool") {
+  vfs::NodePool<std::string, 4> pool;
+
+  std::vector<std::string *> nodes;
+  for (int i = 0; i < 10; ++i)
+    nodes.push_back(pool.create("node" + std::to_string(i)));
+  REQUIRE(pool.size() == 10);
+  REQUIRE(pool.slabCount() == 3);
+  REQUIRE(*nodes.at(9) == "node9");
+
+  // destroyed slot is reused by next node
+  std::string *destroyed = nodes.at(5);
+  pool.destroy(destroyed);
+  REQUIRE(pool.size() == 9);
+  REQUIRE(pool.create("reused") == destroyed);
+  REQUIRE(pool.slabCount() == 3);
+
+  // clear releases all slabs
+  pool.clear();
+  REQUIRE(pool.size() == 0);
+  REQUIRE(pool.slabCount() == 0);
+
+  // release drops slabs of nodes that own nothing, without visiting them
+  vfs::NodePool<int, 4> ints;
+  for (int i = 0; i < 10; ++i)
+    ints.create(i);
+  ints.release();
+  REQUIRE(ints.size() == 0);
+  REQUIRE(ints.slabCount() == 0);
+}
+
+TEST_CASE("TestBlockArena") {
+  vfs::BlockArena arena;
+  REQUIRE(arena.bytes() == 0);
+  void *first = arena.allocate(40);
+  void *second = arena.allocate(48);
+  REQUIRE(first != second);
+  REQUIRE(reinterpret_cast<std::uintptr_t>(first) %
+              vfs::BlockArena::alignment ==
+          0);
+  const std::size_t region = arena.bytes();
+  REQUIRE(region > 0);
+
+  // released block is reused by next block of the same class
+  arena.deallocate(first, 40);
+  REQUIRE(arena.allocate(33) == first);
+  void *odd = arena.allocate(300);
+  arena.deallocate(odd, 300);
+  REQUIRE(arena.allocate(320) == odd);
+
+  // big blocks are allocated one by one
+  char *big = static_cast<char *>(arena.allocate(1 << 20));
+  big[(1 << 20) - 1] = 'x';
+  REQUIRE(arena.bytes() > region + (1 << 20));
+  arena.deallocate(big, 1 << 20);
+  REQUIRE(arena.bytes() == region);
+  arena.allocate(1 << 18);
+
+  // all blocks are released at once
+  arena.release();
+  REQUIRE(arena.bytes() == 0);
+  REQUIRE(arena.allocate(16) != nullptr);
+}
+
+TEST_CASE("TestListFormat") {
+  vfs::VirtualFileSystem virtualFileSystem;
+
+  virtualFileSystem.makeDirectory("one");
+  virtualFileSystem.makeFile("file1");
+
+  std::stringstream output;
+  std::streambuf *coutBuffer = std::cout.rdbuf(output.rdbuf());
+  virtualFileSystem.list();
+  std::cout.rdbuf(coutBuffer);
+
+  // time and date is formatted from stored time, when directory is listed
+  std::string expected;
+  char formatted[vfs::timeFormatLength];
+  vfs::format_time_and_date(
+      virtualFileSystem.currentDirectory->subDirectories.at(0)->timeCreated,
+      formatted);
+  expected += "d------ " + std::string(formatted, vfs::timeFormatLength) +
+              " one\n";
+  vfs::format_time_and_date(
+      virtualFileSystem.currentDirectory->files.at(0)->timeCreated, formatted);
+  expected += "f------ " + std::string(formatted, vfs::timeFormatLength) +
+              " file1\n";
+  REQUIRE(output.str() == expected);
+
+  // same format as return_current_time_and_date
+  std::string now = vfs::return_current_time_and_date();
+  REQUIRE(now.size() == vfs::timeFormatLength);
+  REQUIRE(now.at(4) == '-');
+  REQUIRE(now.at(19) == '\0');
+}
+
+TEST_CASE("TestPaths") {
+  vfs::VirtualFileSystem virtualFileSystem;
+
+  virtualFileSystem.makeDirectory("a");
+  virtualFileSystem.makeDirectory("a/b");
+  virtualFileSystem.makeDirectory("/home/a/b/c");
+  virtualFileSystem.makeFile("a/b/file1");
+  // parent directory doesn't exist
+  virtualFileSystem.makeDirectory("x/y");
+  REQUIRE(virtualFileSystem.currentDirectory->subDirectories.size() == 1);
+
+  // absolute path
+  virtualFileSystem.changeDirectory("/home/a/b/c");
+  REQUIRE(virtualFileSystem.currentDirectory->directoryName == "c");
+  REQUIRE(virtualFileSystem.currentDirectory->parentDirectory->files.size() ==
+          1);
+
+  // relative path with . and ..
+  virtualFileSystem.changeDirectory("../../b/./c/..");
+  REQUIRE(virtualFileSystem.currentDirectory->directoryName == "b");
+  virtualFileSystem.changeDirectory(".");
+  REQUIRE(virtualFileSystem.currentDirectory->directoryName == "b");
+
+  // file is not a directory
+  virtualFileSystem.changeDirectory("file1/x");
+  REQUIRE(virtualFileSystem.currentDirectory->directoryName == "b");
+
+  // .. in home stays in home
+  virtualFileSystem.changeDirectory("../../../..");
+  REQUIRE(virtualFileSystem.currentDirectory->directoryName == "home");
+  virtualFileSystem.changeDirectory("/");
+  REQUIRE(virtualFileSystem.currentDirectory->directoryName == "home");
+
+  // cached path is invalidated by remove
+  virtualFileSystem.changeDirectory("a/b/c");
+  REQUIRE(virtualFileSystem.currentDirectory->directoryName == "c");
+  virtualFileSystem.changeDirectory("/home");
+  virtualFileSystem.remove("a/b/file1");
+  virtualFileSystem.remove("/home/a/b/c");
+  REQUIRE(virtualFileSystem.currentDirectory->subDirectories.at(0)
+              ->subDirectories.at(0)
+              ->subDirectories.size() == 0);
+  REQUIRE(virtualFileSystem.currentDirectory->subDirectories.at(0)
+              ->subDirectories.at(0)
+              ->files.size() == 0);
+  virtualFileSystem.changeDirectory("a/b/c");
+  REQUIRE(virtualFileSystem.currentDirectory->directoryName == "home");
+
+  // removing directory with currentDirectory in it moves to its parent
+  virtualFileSystem.changeDirectory("a/b");
+  virtualFileSystem.remove("/home/a");
+  REQUIRE(virtualFileSystem.currentDirectory->directoryName == "home");
+  REQUIRE(virtualFileSystem.currentDirectory->subDirectories.size() == 0);
+}
+
+TEST_CASE("ParseInputPaths") {
+  vfs::Commands commands;
+  commands.parseInput("mkdir one");
+  commands.parseInput("mkdir one/two");
+  commands.parseInput("mkfile one/two/file");
+  commands.parseInput("cd one/two");
+  REQUIRE(commands.vfs.currentDirectory->directoryName == "two");
+  REQUIRE(commands.vfs.currentDirectory->files.size() == 1);
+
+  std::stringstream output;
+  std::streambuf *coutBuffer = std::cout.rdbuf(output.rdbuf());
+  commands.parseInput("ls /home/one");
+  std::cout.rdbuf(coutBuffer);
+  REQUIRE(output.str().find(" two\n") != std::string::npos);
+
+  commands.parseInput("rm /home/one/two/file");
+  REQUIRE(commands.vfs.currentDirectory->files.size() == 0);
+}
+
+TEST_CASE("BatchCommands") {
+  vfs::Commands commands;
+  std::stringstream input("mkdir one\nmkdir two\ncd one\nmkfile file\nls\n"
+                          "cd\nq\nmkdir three\n");
+  std::stringstream output;
+
+  // commands after q are not executed
+  REQUIRE(commands.batch(input, output.rdbuf()) == 6);
+  REQUIRE(commands.vfs.currentDirectory->directoryName == "home");
+  REQUIRE(commands.vfs.currentDirectory->subDirectories.size() == 2);
+  REQUIRE(output.str().find(" file\n") != std::string::npos);
+}
+
+TEST_CASE("TestOutputBuffer") {
+  int fds[2];
+  REQUIRE(pipe(fds) == 0);
+  {
+    vfs::OutputBuffer buffer(fds[1], 8);
+    std::ostream out(&buffer);
+    out << "abc" << std::endl;
+    // nothing is written until buffer is full
+    out << "0123456789" << "xy";
+    REQUIRE(buffer.flush());
+  }
+  close(fds[1]);
+  char read[32] = {};
+  std::size_t size = 0;
+  ssize_t n;
+  while ((n = ::read(fds[0], read + size, sizeof(read) - size)) > 0)
+    size += static_cast<std::size_t>(n);
+  close(fds[0]);
+  REQUIRE(std::string(read, size) == "abc\n0123456789xy");
+}
+
+TEST_CASE("TestTokenizer") {
+  std::string line = "  mkdir\ta  b c ";
+  vfs::Tokenizer tokenizer(line);
+  vfs::Token token;
+  REQUIRE(tokenizer.next(token));
+  REQUIRE(token == "mkdir");
+  REQUIRE(tokenizer.next(token));
+  REQUIRE(token == "a");
+  REQUIRE(tokenizer.next(token));
+  REQUIRE(token == "b");
+  REQUIRE(tokenizer.next(token));
+  REQUIRE(token == "c");
+  REQUIRE(!tokenizer.next(token));
+
+  std::string empty = "   ";
+  vfs::Tokenizer emptyTokenizer(empty);
+  REQUIRE(!emptyTokenizer.next(token));
+}
+
+TEST_CASE("ParseInputExactCommand") {
+  vfs::Commands commands;
+  // command must match exactly, names can contain command names
+  commands.parseInput("mkfile rmls");
+  commands.parseInput("mkdirs x");
+  commands.parseInput("mkdir cd ls");
+  REQUIRE(commands.vfs.currentDirectory->files.size() == 1);
+  REQUIRE(commands.vfs.currentDirectory->files.at(0)->fileName == "rmls");
+  REQUIRE(commands.vfs.currentDirectory->subDirectories.size() == 2);
+
+  // cd takes one argument
+  commands.parseInput("cd cd ls");
+  REQUIRE(commands.vfs.currentDirectory->directoryName == "home");
+  commands.parseInput("cd ls");
+  REQUIRE(commands.vfs.currentDirectory->directoryName == "ls");
+  commands.parseInput("cd");
+  REQUIRE(commands.vfs.currentDirectory->directoryName == "home");
+
+  commands.parseInput("rm cd ls rmls");
+  REQUIRE(commands.vfs.currentDirectory->files.size() == 0);
+  REQUIRE(commands.vfs.currentDirectory->subDirectories.size() == 0);
+}
+
+TEST_CASE("TestSessions") {
+  vfs::VirtualFileSystem virtualFileSystem;
+  std::stringstream output;
+  vfs::Session first(virtualFileSystem, output);
+  vfs::Session second(virtualFileSystem, output);
+
+  // sessions share vfs structure, each has its own current directory
+  first.makeDirectory("a");
+  second.makeDirectory("a/b");
+  first.changeDirectory("a");
+  second.changeDirectory("a/b");
+  REQUIRE(first.currentDirectoryName() == "a");
+  REQUIRE(second.currentDirectoryName() == "b");
+  REQUIRE(virtualFileSystem.currentDirectory->directoryName == "home");
+
+  second.makeFile("file");
+  first.list("b");
+  REQUIRE(output.str().find(" file\n") != std::string::npos);
+
+  // session in removed directory is moved to parent of removed directory
+  virtualFileSystem.remove("a");
+  REQUIRE(first.currentDirectoryName() == "home");
+  REQUIRE(second.currentDirectoryName() == "home");
+}
+
+namespace {
+// checks that children, subDirectories and files of every directory match
+template <typename Directory>
+bool consistent(const Directory *directory, std::size_t &count) {
+  ++count;
+  if (directory->children.size() !=
+      directory->subDirectories.size() + directory->files.size())
+    return false;
+  for (const auto &dir : directory->subDirectories.snapshot()) {
+    const auto child = directory->children.find(dir->directoryName);
+    if (child.directory() != dir || dir->parentDirectory != directory ||
+        !consistent(dir, count))
+      return false;
+  }
+  for (const auto &file : directory->files.snapshot()) {
+    const auto child = directory->children.find(file->fileName);
+    if (child.file() != file)
+      return false;
+  }
+  return true;
+}
+} // namespace
+
+TEST_CASE("StressSessions") {
+  vfs::VirtualFileSystem virtualFileSystem;
+  const int threadCount = 8;
+  const int operations = 20000;
+  const std::vector<std::string> names{"a", "b", "c", "a/b", "b/c",
+                                       "/home/c/a", "..", "a/b/c"};
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threadCount; ++t) {
+    threads.emplace_back([&, t]() {
+      std::stringstream output;
+      vfs::Session session(virtualFileSystem, output);
+      std::minstd_rand random(t + 1);
+      for (int i = 0; i < operations; ++i) {
+        const std::string &name = names[random() % names.size()];
+        switch (random() % 6) {
+        case 0:
+          session.makeDirectory(name);
+          break;
+        case 1:
+          session.makeFile(name);
+          break;
+        case 2:
+          session.changeDirectory(name);
+          break;
+        case 3:
+          session.list(name);
+          break;
+        case 4:
+          session.remove(name);
+          break;
+        default:
+          session.list();
+          break;
+        }
+        output.str(std::string());
+      }
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  std::size_t count = 0;
+  REQUIRE(consistent(virtualFileSystem.head, count));
+  REQUIRE(count >= 1);
+}
+
+TEST_CASE("TestEpochManager") {
+  vfs::EpochManager epochs;
+  vfs::EpochManager::Participant *reader = epochs.join();
+  int released = 0;
+  auto count = [](void *context, void *) { ++*static_cast<int *>(context); };
+
+  {
+    // memory retired while reader is in epoch is not released
+    vfs::EpochManager::Guard guard(epochs, *reader);
+    epochs.retire(&released, count, &released);
+    for (int i = 0; i < 4; ++i)
+      epochs.collect();
+    REQUIRE(released == 0);
+    REQUIRE(epochs.pending() == 1);
+  }
+  epochs.collect();
+  epochs.collect();
+  REQUIRE(released == 1);
+  REQUIRE(epochs.pending() == 0);
+
+  epochs.retire(&released, count, &released);
+  epochs.leave(reader);
+  epochs.reclaimAll();
+  REQUIRE(released == 2);
+}
+
+TEST_CASE("ReadersDuringRemove") {
+  vfs::VirtualFileSystem virtualFileSystem;
+  virtualFileSystem.makeDirectory("a");
+  std::atomic<bool> done{false};
+
+  // readers list and cd without locks, while writer recreates directories
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([&]() {
+      std::stringstream output;
+      vfs::Session session(virtualFileSystem, output);
+      while (!done.load()) {
+        session.list("a");
+        session.changeDirectory("a/b");
+        session.list();
+        session.changeDirectory("/home");
+        output.str(std::string());
+      }
+    });
+  }
+  std::stringstream output;
+  vfs::Session writer(virtualFileSystem, output);
+  for (int i = 0; i < 5000; ++i) {
+    writer.makeDirectory("a/b");
+    writer.makeFile("a/b/file" + std::to_string(i % 16));
+    writer.makeFile("a/file");
+    writer.remove("a/file");
+    writer.remove("a/b");
+  }
+  done.store(true);
+  for (auto &reader : readers)
+    reader.join();
+
+  std::size_t count = 0;
+  REQUIRE(consistent(virtualFileSystem.head, count));
+  REQUIRE(count == 2);
+}
+
+namespace {
+// contents of the file
+std::string readFile(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+// data of the file in vfs
+std::string readData(vfs::Session &session, const std::string &path) {
+  std::string data;
+  session.read(path, 0, UINT64_MAX, [&data](const char *part,
+                                            std::size_t size) {
+    data.append(part, size);
+    return true;
+  });
+  return data;
+}
+
+// backing file of spilled chunks is removed, so it is truncated through
+// descriptor of the process, spilled chunks can't be read back
+bool truncateBacking(const std::string &path) {
+  for (int fd = 0; fd < 1024; ++fd) {
+    char target[256];
+    const ssize_t size =
+        readlink(("/proc/self/fd/" + std::to_string(fd)).c_str(), target,
+                 sizeof(target));
+    if (size > 0 && std::string(target, static_cast<std::size_t>(size))
+                            .find(path) != std::string::npos)
+      return ftruncate(fd, 0) == 0;
+  }
+  return false;
+}
+} // namespace
+
+TEST_CASE("TestImage") {
+  const std::string path = "testVfs" + std::to_string(getpid()) + ".img";
+  const std::string copy = path + ".copy";
+  std::string listed;
+  {
+    vfs::VirtualFileSystem original;
+    original.makeDirectory("a");
+    original.makeDirectory("a/b");
+    original.makeFile("a/f1");
+    original.makeFile("a/b/f2");
+    original.makeDirectory("c");
+    original.makeFile("top");
+    // data of files is saved, file bigger than chunk too
+    original.append("a/f1", "hello\n", 6);
+    const std::string big(vfs::VirtualFileSystem::chunkSize * 2 + 100, 'x');
+    original.append("top", big.data(), big.size());
+    original.append("a/b/f2", big.data(), 10);
+    REQUIRE(original.save(path));
+    std::stringstream output;
+    vfs::Session session(original, output);
+    session.list();
+    session.list("a");
+    session.list("a/b");
+    session.list("c");
+    listed = output.str();
+  }
+
+  vfs::VirtualFileSystem loaded;
+  loaded.makeDirectory("discarded");
+  loaded.makeDirectory("discarded/directory_with_long_name");
+  REQUIRE(loaded.internedNames() == 1);
+  REQUIRE(loaded.load(path));
+  REQUIRE(loaded.internedNames() == 0); // released with discarded nodes
+  REQUIRE(loaded.head->directoryName == "home");
+  std::stringstream output;
+  vfs::Session session(loaded, output);
+  session.list();
+  session.list("a");
+  session.list("a/b");
+  session.list("c");
+  REQUIRE(output.str() == listed);
+  REQUIRE(readData(session, "a/f1") == "hello\n");
+  REQUIRE(readData(session, "top") ==
+          std::string(vfs::VirtualFileSystem::chunkSize * 2 + 100, 'x'));
+
+  // directories copied in memory and directories still in image are saved
+  // the same
+  REQUIRE(loaded.save(copy));
+  REQUIRE(readFile(copy) == readFile(path));
+  vfs::VirtualFileSystem copied;
+  REQUIRE(copied.load(copy));
+  std::stringstream copiedOutput;
+  vfs::Session copiedSession(copied, copiedOutput);
+  REQUIRE(readData(copiedSession, "a/b/f2") == "xxxxxxxxxx");
+
+  session.makeFile("c/new");
+  session.remove("a/b");
+  session.changeDirectory("a");
+  REQUIRE(session.currentDirectoryName() == "a");
+  output.str(std::string());
+  session.list();
+  REQUIRE(output.str().find(" f1\n") != std::string::npos);
+  REQUIRE(output.str().find(" b\n") == std::string::npos);
+  session.makeFile("f1");
+  REQUIRE(output.str().find("Directory or file already exists\n") !=
+          std::string::npos);
+
+  // invalid image is not loaded, vfs structure is not changed
+  {
+    std::ofstream invalid(copy, std::ios::binary | std::ios::trunc);
+    invalid << "not an image of vfs structure";
+  }
+  REQUIRE(!loaded.load(copy));
+  REQUIRE(!loaded.load(path + ".missing"));
+  REQUIRE(session.currentDirectoryName() == "a");
+  std::remove(path.c_str());
+  std::remove(copy.c_str());
+}
+
+TEST_CASE("TestJournal") {
+  const std::string image = "testVfs" + std::to_string(getpid()) + ".img";
+  const std::string journal = image + ".journal";
+  auto listing = [](vfs::VirtualFileSystem &fileSystem) {
+    std::stringstream output;
+    vfs::Session session(fileSystem, output);
+    session.list();
+    session.list("x");
+    session.list("x/y");
+    output << readData(session, "x/f") << readData(session, "x/g");
+    return output.str();
+  };
+
+  std::string listed;
+  {
+    vfs::VirtualFileSystem fileSystem;
+    REQUIRE(fileSystem.recover(image, journal));
+    fileSystem.makeDirectory("x");
+    fileSystem.makeDirectory("x/y");
+    fileSystem.makeFile("x/f");
+    // writes, appends and truncates are journaled, copy with its data
+    const std::string big(vfs::VirtualFileSystem::chunkSize + 10, 'b');
+    fileSystem.write("x/f", 0, big.data(), big.size());
+    fileSystem.truncate("x/f", 5);
+    fileSystem.append("x/f", "tail\n", 5);
+    fileSystem.write("x/f", 1, "A", 1);
+    fileSystem.copy("x/f", "x/g");
+    fileSystem.append("x/g", "g\n", 2);
+    fileSystem.makeFile("top");
+    fileSystem.remove("top");
+    fileSystem.makeDirectory("z");
+    fileSystem.remove("z");
+
+    // sessions share syncs of the journal
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&fileSystem, t]() {
+        std::stringstream output;
+        vfs::Session session(fileSystem, output);
+        session.changeDirectory("x/y");
+        for (int i = 0; i < 100; ++i)
+          session.makeFile("t" + std::to_string(t) + "f" + std::to_string(i));
+      });
+    }
+    for (auto &thread : threads)
+      thread.join();
+    listed = listing(fileSystem);
+  }
+
+  // mutations are replayed from journal
+  {
+    vfs::VirtualFileSystem fileSystem;
+    REQUIRE(fileSystem.recover(image, journal));
+    REQUIRE(listing(fileSystem) == listed);
+    REQUIRE(listed.find("bAbbbtail\nbAbbbtail\ng\n") != std::string::npos);
+    REQUIRE(fileSystem.checkpoint(image));
+    REQUIRE(readFile(journal).empty());
+    fileSystem.makeFile("x/y/after");
+    fileSystem.append("x/g", "after\n", 6);
+    listed = listing(fileSystem);
+  }
+
+  // record that was not completely written is dropped
+  {
+    std::ofstream torn(journal, std::ios::binary | std::ios::app);
+    torn << "torn";
+  }
+  {
+    vfs::VirtualFileSystem fileSystem;
+    REQUIRE(fileSystem.recover(image, journal));
+    REQUIRE(listing(fileSystem) == listed);
+    REQUIRE(listed.find(" after\n") != std::string::npos);
+    REQUIRE(listed.find("g\nafter\n") != std::string::npos);
+    fileSystem.closeJournal();
+    REQUIRE(!fileSystem.checkpoint(image));
+  }
+  std::remove(image.c_str());
+  std::remove(journal.c_str());
+}
+
+TEST_CASE("TestSnapshot") {
+  vfs::VirtualFileSystem fileSystem;
+  fileSystem.makeDirectory("a");
+  fileSystem.makeDirectory("a/b");
+  fileSystem.makeFile("a/f");
+  fileSystem.makeFile("top");
+
+  std::stringstream before;
+  vfs::Snapshot first = fileSystem.snapshot(before);
+  first.listRecursive();
+  const std::string dumped = before.str();
+  REQUIRE(dumped.find("/home/a/b:\nEmpty directory \n") != std::string::npos);
+
+  // snapshot doesn't see mutations done after it was taken
+  fileSystem.makeDirectory("a/c");
+  fileSystem.makeFile("a/b/g");
+  fileSystem.remove("top");
+  fileSystem.remove("a/f");
+  fileSystem.remove("a/b");
+  before.str(std::string());
+  first.listRecursive();
+  REQUIRE(before.str() == dumped);
+  before.str(std::string());
+  first.list("a/b");
+  REQUIRE(before.str() == "Empty directory \n");
+
+  std::stringstream after;
+  vfs::Snapshot second = fileSystem.snapshot(after);
+  REQUIRE(second.version() > first.version());
+  second.list("a");
+  REQUIRE(after.str().find(" c\n") != std::string::npos);
+  REQUIRE(after.str().find(" b\n") == std::string::npos);
+  after.str(std::string());
+  second.list("a/b");
+  REQUIRE(after.str() == "No such directory\n");
+
+  // releasing the older snapshot keeps what the newer one sees
+  fileSystem.makeFile("a/c/h");
+  first = fileSystem.snapshot(before);
+  fileSystem.remove("a/c");
+  after.str(std::string());
+  second.list("a/c");
+  REQUIRE(after.str() == "Empty directory \n");
+
+  // removed children are listed in their places, while directory drops
+  // erased children and grows
+  fileSystem.makeDirectory("w");
+  for (int i = 0; i < 64; ++i) {
+    fileSystem.makeDirectory("w/d" + std::to_string(i));
+    fileSystem.makeFile("w/f" + std::to_string(i));
+  }
+  std::stringstream wide;
+  vfs::Snapshot older = fileSystem.snapshot(wide);
+  older.list("w");
+  const std::string wideListing = wide.str();
+  for (int i = 0; i < 64; i += 2)
+    fileSystem.remove("w/f" + std::to_string(i));
+  fileSystem.remove("w/d1*");
+  fileSystem.makeFile("w/new");
+  std::stringstream changed;
+  vfs::Snapshot newer = fileSystem.snapshot(changed);
+  newer.list("w");
+  const std::string changedListing = changed.str();
+  for (int i = 63; i >= 0; --i) {
+    fileSystem.remove("w/d" + std::to_string(i));
+    fileSystem.makeFile("w/g" + std::to_string(i));
+  }
+  fileSystem.remove("w/f*");
+  wide.str(std::string());
+  older.list("w");
+  REQUIRE(wide.str() == wideListing);
+  changed.str(std::string());
+  newer.list("w");
+  REQUIRE(changed.str() == changedListing);
+  REQUIRE(changedListing.find(" d1\n") == std::string::npos);
+  REQUIRE(changedListing.find(" f2\n") == std::string::npos);
+  REQUIRE(changedListing.find(" f3\n") != std::string::npos);
+  REQUIRE(changedListing.find(" new\n") != std::string::npos);
+  // older snapshot is released, its changes are dropped
+  older = fileSystem.snapshot(wide);
+  changed.str(std::string());
+  newer.list("w");
+  REQUIRE(changed.str() == changedListing);
+  fileSystem.remove("w");
+
+  // writers run while snapshot is dumped
+  std::atomic<bool> done{false};
+  std::thread writer([&fileSystem, &done]() {
+    std::stringstream output;
+    vfs::Session session(fileSystem, output);
+    for (int i = 0; !done.load(); ++i) {
+      session.makeDirectory("a/d");
+      session.makeFile("a/d/f" + std::to_string(i % 8));
+      session.makeFile("a/g");
+      session.remove("a/g");
+      session.remove("a/d");
+    }
+  });
+  std::stringstream dump;
+  vfs::Snapshot during = fileSystem.snapshot(dump);
+  during.listRecursive();
+  const std::string duringDump = dump.str();
+  for (int i = 0; i < 200; ++i) {
+    dump.str(std::string());
+    during.listRecursive();
+    REQUIRE(dump.str() == duringDump);
+  }
+  done.store(true);
+  writer.join();
+}
+
+TEST_CASE("TestRecursive") {
+  vfs::VirtualFileSystem fileSystem(4);
+  const std::size_t empty = fileSystem.nodeCount();
+  std::stringstream output;
+  vfs::Session session(fileSystem, output);
+  for (int i = 0; i < 8; ++i) {
+    const std::string directory = "a/d" + std::to_string(i);
+    session.makeDirectory("a");
+    session.makeDirectory(directory);
+    session.makeDirectory(directory + "/x");
+    session.makeFile(directory + "/x/f");
+    session.makeFile(directory + "/g");
+  }
+  output.str(std::string());
+  session.diskUsage("a");
+  REQUIRE(output.str() == "16 directories, 16 files\n");
+  output.str(std::string());
+  session.find("a", "f");
+  REQUIRE(output.str().find("/home/a/d0/x/f\n/home/a/d1/x/f\n") == 0);
+
+  // copy is independent of the source, it can be made inside the source
+  session.copy("a", "a/d0/copy");
+  output.str(std::string());
+  session.diskUsage("a/d0/copy");
+  REQUIRE(output.str() == "16 directories, 16 files\n");
+  session.remove("a/d1");
+  session.copy("a/d2/g", "a/g");
+  output.str(std::string());
+  session.diskUsage("a/d0/copy");
+  session.diskUsage("a");
+  REQUIRE(output.str() ==
+          "16 directories, 16 files\n31 directories, 31 files\n");
+  output.str(std::string());
+  session.copy("a/missing", "b");
+  session.copy("a", "a/g");
+  REQUIRE(output.str() ==
+          "No such directory or file\nDirectory or file already exists\n");
+
+  // whole subtree is released, not only the directory and its files
+  session.remove("a");
+  REQUIRE(fileSystem.nodeCount() == empty);
+
+  // deep subtree is visited without recursion
+  const int depth = 100000;
+  for (int i = 0; i < depth; ++i) {
+    fileSystem.makeDirectory("d");
+    fileSystem.changeDirectory("d");
+  }
+  fileSystem.changeDirectory("");
+  output.str(std::string());
+  session.diskUsage("d");
+  REQUIRE(output.str() ==
+          std::to_string(depth - 1) + " directories, 0 files\n");
+  session.remove("d");
+  REQUIRE(fileSystem.nodeCount() == empty);
+  REQUIRE(fileSystem.currentDirectory->directoryName == "home");
+
+  // commands accept -r
+  vfs::Commands commands;
+  commands.parseInput("mkdir a a/b");
+  commands.parseInput("mkfile a/b/f");
+  commands.parseInput("cp -r a c");
+  commands.parseInput("rm -r a");
+  REQUIRE(commands.vfs.head->subDirectories.size() == 1);
+  REQUIRE(commands.vfs.head->subDirectories.at(0)->directoryName == "c");
+
+  // copy is journaled node by node
+  const std::string image = "testVfs" + std::to_string(getpid()) + ".img";
+  const std::string journal = image + ".journal";
+  {
+    vfs::VirtualFileSystem journaled(2);
+    REQUIRE(journaled.recover(image, journal));
+    journaled.makeDirectory("a");
+    journaled.makeDirectory("a/b");
+    journaled.makeFile("a/b/f");
+    journaled.copy("a", "c");
+  }
+  {
+    vfs::VirtualFileSystem recovered(2);
+    REQUIRE(recovered.recover(image, journal));
+    std::stringstream found;
+    vfs::Session reader(recovered, found);
+    reader.find("", "f");
+    REQUIRE(found.str() == "/home/a/b/f\n/home/c/b/f\n");
+  }
+  std::remove(journal.c_str());
+}
+
+TEST_CASE("TestReclaimer") {
+  vfs::EpochManager epochs;
+  std::atomic<int> released{0};
+  auto count = [](void *context, void *) {
+    ++*static_cast<std::atomic<int> *>(context);
+  };
+  // retired memory is released by reclaimer, drain waits for it
+  epochs.startReclaimer();
+  for (int i = 0; i < 10; ++i)
+    epochs.retire(&released, count, &released);
+  epochs.drain();
+  REQUIRE(released.load() == 10);
+  REQUIRE(epochs.pending() == 0);
+  epochs.stopReclaimer();
+  epochs.retire(&released, count, &released);
+  REQUIRE(epochs.pending() == 1);
+  epochs.drain();
+  REQUIRE(released.load() == 11);
+
+  // rm only unlinks subtree, reclaimer releases it
+  vfs::VirtualFileSystem fileSystem(2);
+  const std::size_t empty = fileSystem.nodeCount();
+  fileSystem.makeDirectory("big");
+  for (int i = 0; i < 100; ++i) {
+    const std::string directory = "big/d" + std::to_string(i);
+    fileSystem.makeDirectory(directory);
+    for (int j = 0; j < 10; ++j)
+      fileSystem.makeFile(directory + "/f" + std::to_string(j));
+  }
+  const auto before = fileSystem.reclaimCounters();
+  fileSystem.remove("big");
+  fileSystem.drain();
+  const auto after = fileSystem.reclaimCounters();
+  REQUIRE(after.pending == 0);
+  REQUIRE(after.releasedDirectories - before.releasedDirectories == 101);
+  REQUIRE(after.releasedFiles - before.releasedFiles == 1000);
+  REQUIRE(fileSystem.nodeCount() == empty);
+}
+
+TEST_CASE("TestOrderedList") {
+  vfs::VirtualFileSystem fileSystem;
+  std::stringstream output;
+  vfs::Session session(fileSystem, output);
+  session.makeDirectory("big");
+  for (const char *name : {"d", "a", "e", "c"})
+    session.makeFile(std::string("big/") + name);
+  session.makeDirectory("big/b");
+
+  auto names = [&session](const std::string &path,
+                          const vfs::VirtualFileSystem::ListOptions &options) {
+    std::string listed;
+    session.forEach(path, options,
+                    [&listed](const vfs::VirtualFileSystem::Entry &entry) {
+                      listed += entry.name + " ";
+                      return true;
+                    });
+    return listed;
+  };
+  vfs::VirtualFileSystem::ListOptions options;
+  REQUIRE(names("big", options) == "b d a e c ");
+  options.order = vfs::VirtualFileSystem::Order::Name;
+  REQUIRE(names("big", options) == "a b c d e ");
+
+  // pages are chained with cursor, the last page has no next page
+  options.limit = 2;
+  session.list("big", options);
+  REQUIRE(output.str().find(" a\n") != std::string::npos);
+  REQUIRE(output.str().find(" b\nNext page: --after b\n") !=
+          std::string::npos);
+  output.str(std::string());
+  options.after = "b";
+  REQUIRE(names("big", options) == "c d ");
+  options.after = "bb"; // cursor doesn't have to be listed
+  REQUIRE(names("big", options) == "c d ");
+  options.after = "d";
+  session.list("big", options);
+  REQUIRE(output.str().find(" e\n") != std::string::npos);
+  REQUIRE(output.str().find("Next page") == std::string::npos);
+  output.str(std::string());
+  options.after = "e";
+  session.list("big", options);
+  REQUIRE(output.str().empty());
+
+  // sorted children are rebuilt after directory is changed
+  session.makeFile("big/ab");
+  session.remove("big/c");
+  options.after = "a";
+  REQUIRE(names("big", options) == "ab b ");
+
+  // changes are merged into sorted children, names that are removed and
+  // created again are listed once
+  {
+    vfs::VirtualFileSystem::ListOptions byName;
+    byName.order = vfs::VirtualFileSystem::Order::Name;
+    vfs::VirtualFileSystem::ListOptions byCreation;
+    byCreation.order = vfs::VirtualFileSystem::Order::Time;
+    std::set<std::string> expected;
+    session.makeDirectory("merged");
+    std::mt19937 random(7);
+    for (int step = 0; step < 400; ++step) {
+      const std::string name = "n" + std::to_string(random() % 40);
+      if (random() % 25 == 0) {
+        session.remove("merged/n1*");
+        for (auto it = expected.begin(); it != expected.end();)
+          it = it->compare(0, 2, "n1") == 0 ? expected.erase(it) : ++it;
+      } else if (expected.count(name) != 0) {
+        session.remove("merged/" + name);
+        expected.erase(name);
+      } else {
+        if (random() % 2 == 0)
+          session.makeFile("merged/" + name);
+        else
+          session.makeDirectory("merged/" + name);
+        expected.insert(name);
+      }
+      std::string listed;
+      for (const auto &child : expected)
+        listed += child + " ";
+      if (step % 3 == 0)
+        REQUIRE(names("merged", byName) == listed);
+      if (step % 5 == 0)
+        REQUIRE(names("merged", byCreation).size() == listed.size());
+    }
+  }
+
+  // time order breaks ties by name, cursor is time/name
+  options = vfs::VirtualFileSystem::ListOptions();
+  options.order = vfs::VirtualFileSystem::Order::Time;
+  const std::string byTime = names("big", options);
+  REQUIRE(byTime.size() == 11);
+  std::size_t third = 0;
+  for (int i = 0; i < 3; ++i)
+    third = byTime.find(' ', third) + 1;
+  options.limit = 3;
+  session.list("big", options);
+  const std::string page = output.str();
+  const std::size_t next = page.find("Next page: --after ");
+  REQUIRE(next != std::string::npos);
+  options.after = page.substr(next + 19, page.size() - next - 20);
+  REQUIRE(names("big", options) == byTime.substr(third));
+  output.str(std::string());
+  options.after = "b";
+  REQUIRE(!session.forEach("big", options,
+                           [](const vfs::VirtualFileSystem::Entry &) {
+                             return true;
+                           }));
+  REQUIRE(output.str() == "Invalid cursor\n");
+  output.str(std::string());
+  session.list("none", options);
+  REQUIRE(output.str() == "No such directory\n");
+
+  // visit stops listing
+  int visited = 0;
+  options = vfs::VirtualFileSystem::ListOptions();
+  REQUIRE(session.forEach("big", options,
+                          [&visited](const vfs::VirtualFileSystem::Entry &) {
+                            return ++visited < 2;
+                          }));
+  REQUIRE(visited == 2);
+
+  // ls options
+  vfs::Commands commands;
+  commands.vfs.makeDirectory("x");
+  commands.vfs.makeDirectory("w");
+  commands.vfs.makeFile("v");
+  output.str(std::string());
+  std::streambuf *coutBuffer = std::cout.rdbuf(output.rdbuf());
+  commands.parseInput("ls --sort name --limit 2");
+  commands.parseInput("ls --sort name --after w");
+  commands.parseInput("ls --sort size");
+  commands.parseInput("ls --limit");
+  std::cout.rdbuf(coutBuffer);
+  const std::string listed = output.str();
+  REQUIRE(listed.find(" v\n") < listed.find(" w\nNext page: --after w\n"));
+  REQUIRE(listed.find(" x\nInvalid command\nInvalid command\n") !=
+          std::string::npos);
+}
+
+TEST_CASE("TestGlob") {
+  REQUIRE(vfs::Glob::isPattern("*.tmp"));
+  REQUIRE(!vfs::Glob::isPattern("a.tmp"));
+  REQUIRE(vfs::Glob("*.tmp").match("a.tmp"));
+  REQUIRE(vfs::Glob("*.tmp").match(".tmp"));
+  REQUIRE(!vfs::Glob("*.tmp").match("a.tmpx"));
+  REQUIRE(vfs::Glob("tmp_*").match("tmp_1"));
+  REQUIRE(vfs::Glob("tmp_*").prefix() == "tmp_");
+  REQUIRE(vfs::Glob("*.tmp").prefix().empty());
+  REQUIRE(vfs::Glob("a*b*c").match("abc"));
+  REQUIRE(vfs::Glob("a*b*c").match("axxbyybc"));
+  REQUIRE(!vfs::Glob("a*b*c").match("axxcb"));
+  REQUIRE(!vfs::Glob("a*bb*bc").match("abbc"));
+  REQUIRE(vfs::Glob("f?le").match("file"));
+  REQUIRE(!vfs::Glob("f?le").match("fle"));
+  REQUIRE(vfs::Glob("log[0-9]").match("log7"));
+  REQUIRE(!vfs::Glob("log[0-9]").match("logx"));
+  REQUIRE(vfs::Glob("log[!0-9]").match("logx"));
+  REQUIRE(vfs::Glob("[]a]").match("]"));
+  REQUIRE(vfs::Glob("a[b").match("a[b"));
+  REQUIRE(vfs::Glob("\\*").match("*"));
+  REQUIRE(!vfs::Glob("\\*").match("a"));
+  REQUIRE(vfs::Glob("**").match(""));
+
+  vfs::VirtualFileSystem fileSystem;
+  std::stringstream output;
+  vfs::Session session(fileSystem, output);
+  session.makeDirectory("d");
+  for (const char *name : {"b.tmp", "a.log", "tmp_2", "a.tmp", "tmp_1"})
+    session.makeFile(std::string("d/") + name);
+  session.makeDirectory("d/tmp_dir");
+  session.makeFile("d/tmp_dir/c.tmp");
+
+  // matching children are listed sorted by name
+  session.list("d/*.tmp");
+  REQUIRE(output.str().find(" a.tmp\n") < output.str().find(" b.tmp\n"));
+  REQUIRE(output.str().find("tmp_") == std::string::npos);
+  output.str(std::string());
+  session.list("d/*.txt");
+  REQUIRE(output.str() == "No such directory or file\n");
+  output.str(std::string());
+  session.find("d", "*.tmp");
+  REQUIRE(output.str() ==
+          "/home/d/a.tmp\n/home/d/b.tmp\n/home/d/tmp_dir/c.tmp\n");
+  output.str(std::string());
+
+  // prefix is looked up in children sorted by name, while they are current
+  session.list("d/tmp_?");
+  REQUIRE(output.str().find(" tmp_1\n") < output.str().find(" tmp_2\n"));
+  session.changeDirectory("d/tmp_dir");
+  session.remove("/home/d/tmp_*");
+  session.makeDirectory("back");
+  output.str(std::string());
+  session.list("/home/d");
+  REQUIRE(output.str().find("tmp_") == std::string::npos);
+  REQUIRE(output.str().find(" back\n") != std::string::npos);
+  session.remove("*.tmp");
+  output.str(std::string());
+  session.list("");
+  REQUIRE(output.str().find(" back\nf------ ") != std::string::npos);
+  REQUIRE(output.str().find(".tmp") == std::string::npos);
+  session.remove("*");
+  output.str(std::string());
+  session.list("");
+  REQUIRE(output.str() == "Empty directory \n");
+
+  // journal has names that were removed, they are not matched on replay
+  const std::string image = "testGlob" + std::to_string(getpid()) + ".img";
+  const std::string journal = image + ".journal";
+  {
+    vfs::VirtualFileSystem journaled;
+    REQUIRE(journaled.recover(image, journal));
+    journaled.makeFile("q*");
+    journaled.makeFile("qa");
+    journaled.makeFile("qb");
+    journaled.remove("q\\*");
+    journaled.remove("q[b]");
+  }
+  {
+    vfs::VirtualFileSystem recovered;
+    REQUIRE(recovered.recover(image, journal));
+    std::stringstream listed;
+    vfs::Session reader(recovered, listed);
+    reader.list();
+    REQUIRE(listed.str().find(" qa\n") != std::string::npos);
+    REQUIRE(listed.str().find(" q*\n") == std::string::npos);
+    REQUIRE(listed.str().find(" qb\n") == std::string::npos);
+  }
+  std::remove(image.c_str());
+  std::remove(journal.c_str());
+}
+
+TEST_CASE("TestStats") {
+  // every latency is in the bucket whose limits are around it
+  for (std::uint64_t value : {0, 1, 3, 4, 7, 8, 9, 100, 1000, 123456789}) {
+    const std::size_t bucket = vfs::Stats::bucketOf(value);
+    REQUIRE(value <= vfs::Stats::bucketLimit(bucket));
+    if (bucket > 0)
+      REQUIRE(value > vfs::Stats::bucketLimit(bucket - 1));
+  }
+  REQUIRE(vfs::Stats::bucketOf(UINT64_MAX) == vfs::Stats::bucketCount - 1);
+  REQUIRE(vfs::Stats::bucketLimit(vfs::Stats::bucketCount - 1) == UINT64_MAX);
+
+  vfs::Stats::Histogram histogram;
+  REQUIRE(histogram.percentile(50) == 0);
+  histogram.buckets[vfs::Stats::bucketOf(100)] = 99;
+  histogram.buckets[vfs::Stats::bucketOf(5000)] = 1;
+  histogram.count = 100;
+  histogram.max = 5000;
+  REQUIRE(histogram.percentile(50) == vfs::Stats::bucketLimit(
+                                          vfs::Stats::bucketOf(100)));
+  REQUIRE(histogram.percentile(99) == histogram.percentile(50));
+  REQUIRE(histogram.percentile(100) == 5000);
+
+#if VFS_STATS
+  // shards of sessions are merged, and kept when sessions end
+  vfs::VirtualFileSystem fileSystem;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&fileSystem, t]() {
+      std::stringstream output;
+      vfs::Session session(fileSystem, output);
+      const std::string directory = "t" + std::to_string(t);
+      session.makeDirectory(directory);
+      for (int i = 0; i < 10; ++i)
+        session.makeFile(directory + "/f" + std::to_string(i));
+      session.changeDirectory(directory);
+      session.list();
+      session.remove("f0");
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  fileSystem.drain();
+  const vfs::Stats::Snapshot stats = fileSystem.stats();
+  REQUIRE(stats[vfs::Stats::Operation::MakeDirectory].count == 4);
+  REQUIRE(stats[vfs::Stats::Operation::MakeFile].count == 40);
+  REQUIRE(stats[vfs::Stats::Operation::ChangeDirectory].count == 4);
+  REQUIRE(stats[vfs::Stats::Operation::List].count == 4);
+  REQUIRE(stats[vfs::Stats::Operation::Remove].count == 4);
+  REQUIRE(stats[vfs::Stats::Operation::Find].count == 0);
+  REQUIRE(stats[vfs::Stats::Operation::MakeFile].max > 0);
+  REQUIRE(stats[vfs::Stats::Operation::MakeFile].percentile(99) <=
+          stats[vfs::Stats::Operation::MakeFile].max);
+  REQUIRE(stats[vfs::Stats::Counter::Lookups] >= 44);
+  REQUIRE(stats.nodes == fileSystem.nodeCount());
+  REQUIRE(stats.largestFanOut == 10);
+
+  vfs::Commands commands;
+  commands.vfs.makeDirectory("a");
+  std::stringstream output;
+  std::streambuf *coutBuffer = std::cout.rdbuf(output.rdbuf());
+  commands.parseInput("stats");
+  commands.parseInput("stats now");
+  std::cout.rdbuf(coutBuffer);
+  REQUIRE(output.str().find("mkdir 1 ops, p50 ") == 0);
+  REQUIRE(output.str().find("\nnodes 2, largest directory 1 children\n") !=
+          std::string::npos);
+  REQUIRE(output.str().find("Invalid command\n") != std::string::npos);
+#endif
+}
+
+TEST_CASE("TestCompact") {
+  std::stringstream output;
+  vfs::CompactFileSystem fileSystem(output);
+  fileSystem.list();
+  REQUIRE(output.str() == "Empty directory \n");
+  output.str(std::string());
+
+  fileSystem.makeDirectory("a");
+  fileSystem.makeFile("f");
+  fileSystem.makeDirectory("a/b");
+  fileSystem.makeFile("/home/a/b/f");
+  fileSystem.makeDirectory("a/b/c");
+  REQUIRE(output.str().empty());
+  fileSystem.makeDirectory("a");
+  fileSystem.makeFile("x/f");
+  fileSystem.makeDirectory("f/d"); // file is not directory
+  fileSystem.makeFile("a/..");
+  REQUIRE(output.str() == "Directory or file already exists\n"
+                          "No such directory\n"
+                          "No such directory\n"
+                          "Invalid command\n");
+  output.str(std::string());
+  REQUIRE(fileSystem.nodeCount() == 6);
+
+  // directories are listed before files, like in VirtualFileSystem
+  fileSystem.list();
+  const std::string listed = output.str();
+  REQUIRE(listed.find("d------ ") == 0);
+  REQUIRE(listed.find(" a\nf------ ") != std::string::npos);
+  REQUIRE(listed.rfind(" f\n") == listed.size() - 3);
+  output.str(std::string());
+
+  fileSystem.diskUsage();
+  fileSystem.diskUsage("a");
+  fileSystem.find("", "f");
+  REQUIRE(output.str() == "3 directories, 2 files\n"
+                          "2 directories, 1 files\n"
+                          "/home/a/b/f\n/home/f\n");
+  output.str(std::string());
+
+  // current directory in removed subtree goes to parent of the subtree
+  fileSystem.changeDirectory("a/b/c");
+  fileSystem.changeDirectory("../..");
+  fileSystem.changeDirectory("b/c");
+  fileSystem.remove("/home/a/b");
+  fileSystem.list();
+  fileSystem.diskUsage("/home");
+  REQUIRE(output.str() == "Empty directory \n1 directories, 1 files\n");
+  REQUIRE(fileSystem.nodeCount() == 3);
+  output.str(std::string());
+
+  // ids and names of removed nodes are reused, lookups stay correct
+  fileSystem.changeDirectory("");
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < 1000; ++i)
+      fileSystem.makeFile("n" + std::to_string(i));
+    for (int i = 0; i < 1000; i += 2)
+      fileSystem.remove("n" + std::to_string(i));
+    for (int i = 0; i < 1000; i += 2)
+      fileSystem.makeDirectory("n" + std::to_string(i));
+    fileSystem.diskUsage();
+    fileSystem.find("/home", "n99*");
+    REQUIRE(output.str() == "501 directories, 501 files\n"
+                            "/home/n99\n/home/n990\n/home/n991\n/home/n992\n"
+                            "/home/n993\n/home/n994\n/home/n995\n/home/n996\n"
+                            "/home/n997\n/home/n998\n/home/n999\n");
+    output.str(std::string());
+    for (int i = 0; i < 1000; ++i)
+      fileSystem.remove("n" + std::to_string(i));
+  }
+  REQUIRE(fileSystem.nodeCount() == 3);
+  REQUIRE(fileSystem.memoryUsage() > 0);
+
+  // shell works with compact storage, output is the same as with vfs
+  const std::string script = "mkdir a a/b\nmkfile f a/f a/b/f\nmkdir a\n"
+                             "cd a/b\nrm f\ncd ..\ndu /home\nfind -name f\n"
+                             "ls b\ncd /x\n";
+  std::stringstream compactOutput, treeOutput;
+  vfs::Commands compact(vfs::Commands::Storage::Compact);
+  std::stringstream compactScript(script);
+  compact.batch(compactScript, compactOutput.rdbuf());
+  vfs::Commands tree;
+  std::stringstream treeScript(script);
+  tree.batch(treeScript, treeOutput.rdbuf());
+  REQUIRE(compactOutput.str() == treeOutput.str());
+  REQUIRE(compactOutput.str() == "Directory or file already exists\n"
+                                 "2 directories, 2 files\n/home/a/f\n"
+                                 "Empty directory \nNo such directory\n");
+  REQUIRE(tree.vfs.nodeCount() == 5);
+
+  std::stringstream unsupported("cat f\nsave image\nls --limit 1\n");
+  compactOutput.str(std::string());
+  compact.batch(unsupported, compactOutput.rdbuf());
+  REQUIRE(compactOutput.str() == "Not supported by compact storage\n"
+                                 "Not supported by compact storage\n"
+                                 "Not supported by compact storage\n");
+}
+
+TEST_CASE("TestName") {
+  vfs::NameTable table;
+  const vfs::Name empty;
+  const vfs::Name tmp = table.intern("tmp");
+  const vfs::Name inlined = table.intern("fifteen_chars15");
+  const vfs::Name interned = table.intern("sixteen_chars_16");
+  REQUIRE(sizeof(vfs::Name) == 16);
+  REQUIRE(table.size() == 1); // only long name is interned
+  REQUIRE(tmp == "tmp");
+  REQUIRE(tmp.size() == 3);
+  REQUIRE(inlined.str() == "fifteen_chars15");
+  REQUIRE(interned.str() == "sixteen_chars_16");
+  REQUIRE(empty != tmp);
+  REQUIRE(empty == table.find("", 0));
+
+  // equal names have equal handles, long name is stored once
+  {
+    const vfs::Name again = table.intern("sixteen_chars_16");
+    vfs::Name copy = again;
+    REQUIRE(again == interned);
+    REQUIRE(copy == interned);
+    REQUIRE(copy.hash() == interned.hash());
+    REQUIRE(table.find("tmp", 3) == tmp);
+    REQUIRE(table.find("sixteen_chars_16", 16) == interned);
+    REQUIRE(table.find("seventeen_chars17", 17).empty());
+    REQUIRE(table.size() == 1);
+  }
+  // names are hashed and compared by characters without the table
+  REQUIRE(vfs::Name::hashOf("tmp", 3) == tmp.hash());
+  REQUIRE(vfs::Name::hashOf("sixteen_chars_16", 16) == interned.hash());
+  REQUIRE(tmp.equals("tmp", 3));
+  REQUIRE(!tmp.equals("tm", 2));
+  REQUIRE(interned.equals("sixteen_chars_16", 16));
+  REQUIRE(!interned.equals("sixteen_chars_17", 16));
+  REQUIRE(!inlined.equals("sixteen_chars_16", 16));
+  REQUIRE(!interned.equals("fifteen_chars15", 15));
+  REQUIRE(interned < tmp); // by characters, not by handles
+  REQUIRE(inlined < interned);
+  {
+    vfs::Name released = table.intern("released_with_last_handle");
+    REQUIRE(table.size() == 2);
+    vfs::Name moved = std::move(released);
+    REQUIRE(released.empty());
+    REQUIRE(moved == "released_with_last_handle");
+  }
+  REQUIRE(table.size() == 1);
+
+  // names of directories and files are interned in vfs, and released with
+  // them
+  vfs::VirtualFileSystem fileSystem;
+  std::stringstream output;
+  vfs::Session session(fileSystem, output);
+  const std::string longName = "application_data_directory";
+  for (const char *directory : {"a", "b"}) {
+    session.makeDirectory(directory);
+    session.makeDirectory(std::string(directory) + "/" + longName);
+    session.makeFile(std::string(directory) + "/" + longName + "/x.log");
+  }
+  REQUIRE(fileSystem.internedNames() == 1);
+  session.copy("a/" + longName, "a/another_long_directory_name");
+  REQUIRE(fileSystem.internedNames() == 2);
+  session.changeDirectory("b/" + longName);
+  REQUIRE(session.currentDirectoryName() == longName);
+  session.find("/home", longName);
+  REQUIRE(output.str() == "/home/a/" + longName + "\n/home/b/" + longName +
+                              "\n");
+  output.str(std::string());
+  session.changeDirectory("/home");
+  session.remove("a");
+  session.remove("b/" + longName);
+  fileSystem.drain();
+  REQUIRE(fileSystem.internedNames() == 0);
+  session.list("b");
+  REQUIRE(output.str() == "Empty directory \n");
+}
+
+TEST_CASE("TestNameTree") {
+  // names are visited sorted, shorter name before names that start with it
+  vfs::RadixTree<int> tree;
+  for (const char *name : {"test", "team", "tea", "te", "toast", "a"})
+    tree.insert(name, std::strlen(name), static_cast<int>(tree.size()));
+  tree.insert("tea", 3, 10);
+  REQUIRE(tree.size() == 6);
+  std::string visited;
+  tree.visit("te", 2, [&visited](const std::string &name,
+                                 const std::vector<int> &values) {
+    visited += name + ":" + std::to_string(values.size()) + " ";
+    return true;
+  });
+  REQUIRE(visited == "te:1 tea:2 team:1 test:1 ");
+  REQUIRE(tree.erase("tea", 3, 10));
+  REQUIRE(!tree.erase("tea", 3, 10));
+  REQUIRE(tree.erase("te", 2, 3));
+  REQUIRE(!tree.erase("tes", 3, 0));
+  visited.clear();
+  tree.visit("t", 1, [&visited](const std::string &name,
+                                const std::vector<int> &) {
+    visited += name + " ";
+    return visited.size() < 8;
+  });
+  REQUIRE(visited == "tea team ");
+  REQUIRE(tree.size() == 5);
+
+  // name with many values keeps their positions, values are erased in any
+  // order and stay with their name when nodes are merged
+  for (int i = 0; i < 1000; ++i)
+    tree.insert("tea", 3, 100 + i);
+  for (int i = 0; i < 1000; i += 3)
+    REQUIRE(tree.erase("tea", 3, 100 + i));
+  REQUIRE(!tree.erase("tea", 3, 100));
+  REQUIRE(tree.erase("team", 4, 1));
+  std::size_t values = 0;
+  tree.visit("tea", 3, [&values](const std::string &name,
+                                 const std::vector<int> &located) {
+    REQUIRE(name == "tea");
+    values = located.size();
+    return true;
+  });
+  REQUIRE(values == 666 + 1);
+  for (int i = 999; i >= 0; --i)
+    REQUIRE(tree.erase("tea", 3, 100 + i) == (i % 3 != 0));
+  REQUIRE(tree.erase("tea", 3, 2));
+  REQUIRE(tree.size() == 3);
+
+  // tree is built by the first query, and changed by later mutations
+  vfs::VirtualFileSystem fileSystem;
+  std::stringstream output;
+  vfs::Session session(fileSystem, output);
+  session.makeDirectory("report");
+  session.makeFile("report/report.txt");
+  session.makeFile("readme");
+  session.locate("rep");
+  REQUIRE(output.str() == "/home/report\n/home/report/report.txt\n");
+  output.str(std::string());
+  session.makeDirectory("src");
+  session.makeFile("src/report.txt");
+  session.copy("report", "src/reports");
+  session.complete("re");
+  REQUIRE(output.str() == "readme\nreport\nreport.txt\nreports\n");
+  output.str(std::string());
+  session.locate("report.");
+  REQUIRE(output.str() == "/home/report/report.txt\n/home/src/report.txt\n"
+                          "/home/src/reports/report.txt\n");
+  output.str(std::string());
+  session.locate("rep", 2);
+  REQUIRE(output.str() == "/home/report\n/home/report/report.txt\n...\n");
+  output.str(std::string());
+  session.complete("re", 1);
+  REQUIRE(output.str() == "readme\n...\n");
+  output.str(std::string());
+
+  // erased directories are skipped until their subtree is released
+  session.remove("src/report.txt");
+  session.remove("report");
+  session.locate("report");
+  REQUIRE(output.str() == "/home/src/reports/report.txt\n/home/src/reports\n");
+  output.str(std::string());
+  fileSystem.drain();
+  session.remove("src");
+  session.complete("re");
+  REQUIRE(output.str() == "readme\n");
+  output.str(std::string());
+  session.locate("x");
+  REQUIRE(output.str() == "No such directory or file\n");
+  output.str(std::string());
+  session.locate("ho");
+  REQUIRE(output.str() == "/home\n");
+
+  // complete and locate take exactly one prefix
+  vfs::Commands commands;
+  std::stringstream printed;
+  std::streambuf *coutBuffer = std::cout.rdbuf(printed.rdbuf());
+  commands.parseInput("mkfile notes node");
+  commands.parseInput("complete no");
+  commands.parseInput("locate node");
+  commands.parseInput("locate");
+  commands.parseInput("complete a b");
+  std::cout.rdbuf(coutBuffer);
+  REQUIRE(printed.str() == "node\nnotes\n/home/node\nInvalid command\n"
+                           "Invalid command\n");
+}
+
+TEST_CASE("TestFileData") {
+  vfs::VirtualFileSystem fileSystem;
+  std::stringstream output;
+  vfs::Session session(fileSystem, output);
+  auto readAll = [&session](const std::string &path, std::uint64_t offset,
+                            std::uint64_t size) {
+    std::string data;
+    session.read(path, offset, size, [&data](const char *part,
+                                             std::size_t partSize) {
+      data.append(part, partSize);
+      return true;
+    });
+    return data;
+  };
+  const std::size_t chunk = vfs::VirtualFileSystem::chunkSize;
+  session.makeDirectory("d");
+  session.makeFile("d/f");
+  REQUIRE(readAll("d/f", 0, 100).empty());
+
+  // appends fill chunks, reads are views of chunks
+  std::string expected;
+  for (std::size_t i = 0; i < 3 * chunk; i += 1000) {
+    const std::string part(1000, static_cast<char>('a' + i / 1000 % 26));
+    REQUIRE(session.append("d/f", part.data(), part.size()));
+    expected += part;
+  }
+  REQUIRE(readAll("d/f", 0, UINT64_MAX) == expected);
+  REQUIRE(readAll("d/f", chunk - 10, 20) == expected.substr(chunk - 10, 20));
+  std::size_t parts = 0;
+  session.read("d/f", chunk - 10, 20, [&parts](const char *, std::size_t) {
+    ++parts;
+    return true;
+  });
+  REQUIRE(parts == 2);
+
+  // overwrite across chunks, write after the end fills gap with zeros
+  REQUIRE(session.write("d/f", chunk - 2, "xyzw", 4));
+  expected.replace(chunk - 2, 4, "xyzw");
+  REQUIRE(readAll("d/f", 0, UINT64_MAX) == expected);
+  REQUIRE(session.write("d/f", expected.size() + 5, "end", 3));
+  expected += std::string(5, '\0') + "end";
+  REQUIRE(readAll("d/f", 0, UINT64_MAX) == expected);
+  REQUIRE(session.truncate("d/f", chunk + 3));
+  expected.resize(chunk + 3);
+  REQUIRE(readAll("d/f", 0, UINT64_MAX) == expected);
+  REQUIRE(session.append("d/f", "tail", 4));
+  expected += "tail";
+  REQUIRE(readAll("d/f", chunk, UINT64_MAX) == expected.substr(chunk));
+  REQUIRE(session.truncate("d/f", 2));
+  REQUIRE(readAll("d/f", 0, UINT64_MAX) == expected.substr(0, 2));
+  REQUIRE(fileSystem.dataChunks() == 1);
+
+  // cp shares chunks, chunk that is written is copied, rm releases them
+  REQUIRE(session.truncate("d/f", 2 * chunk));
+  session.copy("d", "e");
+  REQUIRE(session.write("e/f", 0, "copy", 4));
+  REQUIRE(readAll("d/f", 0, 4) == expected.substr(0, 2) + std::string(2, '\0'));
+  REQUIRE(readAll("e/f", 0, 4) == "copy");
+  REQUIRE(fileSystem.dataChunks() == 3);
+  session.remove("d");
+  session.remove("e/f");
+  REQUIRE(fileSystem.dataChunks() == 0);
+  REQUIRE(!session.append("e/f", "x", 1));
+  REQUIRE(!session.append("e", "x", 1));
+  REQUIRE(output.str() == "No such file\nNo such file\n");
+
+  // readers see whole appends, while file is appended and truncated
+  session.makeFile("log");
+  std::atomic<bool> done{false};
+  std::thread writer([&fileSystem, &done]() {
+    vfs::Session appender(fileSystem, std::cout);
+    const std::string line(100, 'x');
+    for (int i = 0; i < 2000; ++i) {
+      if (i % 100 == 99)
+        appender.truncate("log", 0);
+      appender.append("log", line.data(), line.size());
+    }
+    done.store(true);
+  });
+  std::size_t inconsistent = 0;
+  while (!done.load()) {
+    const std::string data = readAll("log", 0, UINT64_MAX);
+    if (data.size() % 100 != 0 ||
+        data.find_first_not_of('x') != std::string::npos)
+      ++inconsistent;
+  }
+  writer.join();
+  REQUIRE(inconsistent == 0);
+
+  // cat prints data, write replaces it or appends to it
+  vfs::Commands commands;
+  std::stringstream printed;
+  std::streambuf *coutBuffer = std::cout.rdbuf(printed.rdbuf());
+  commands.parseInput("mkfile notes");
+  commands.parseInput("write notes hello  world");
+  commands.parseInput("write -a notes again");
+  commands.parseInput("cat notes");
+  commands.parseInput("write notes new");
+  commands.parseInput("cat notes");
+  commands.parseInput("write");
+  commands.parseInput("write -a");
+  commands.parseInput("cat missing");
+  std::cout.rdbuf(coutBuffer);
+  REQUIRE(printed.str() == "hello  world\nagain\nnew\nInvalid command\n"
+                           "Invalid command\nNo such file\n");
+}
+
+TEST_CASE("TestDedup") {
+  REQUIRE(vfs::xxHash64("", 0) == 0xEF46DB3751D8E999ULL);
+  REQUIRE(vfs::xxHash64("abc", 3) == 0x44BC2CF5AD770999ULL);
+  const std::string stripes(100, 'q');
+  REQUIRE(vfs::xxHash64(stripes.data(), stripes.size()) !=
+          vfs::xxHash64(stripes.data(), stripes.size() - 1));
+  // appended data hashes the same as whole data
+  vfs::AppendedHash appended;
+  for (std::size_t size : {0, 3, 31, 32, 33, 64, 65, 99, 100})
+    REQUIRE(appended.hash(stripes.data(), size) ==
+            vfs::xxHash64(stripes.data(), size));
+
+  vfs::VirtualFileSystem fileSystem;
+  std::stringstream output;
+  vfs::Session session(fileSystem, output);
+  auto readAll = [&session](const std::string &path) {
+    std::string data;
+    session.read(path, 0, UINT64_MAX,
+                 [&data](const char *part, std::size_t partSize) {
+                   data.append(part, partSize);
+                   return true;
+                 });
+    return data;
+  };
+  const std::size_t chunk = vfs::VirtualFileSystem::chunkSize;
+  std::string block(3 * chunk + 100, 'a');
+  for (std::size_t i = 0; i < block.size(); ++i)
+    block[i] = static_cast<char>('a' + i * 7 % 26);
+
+  // files with the same data share chunks, also the last partial one
+  session.makeFile("a");
+  session.makeFile("b");
+  REQUIRE(session.write("a", 0, block.data(), block.size()));
+  REQUIRE(fileSystem.dataChunks() == 4);
+  REQUIRE(session.write("b", 0, block.data(), block.size()));
+  REQUIRE(fileSystem.dataChunks() == 4);
+  vfs::VirtualFileSystem::DedupStats sizes = fileSystem.dedupStats();
+  REQUIRE(sizes.logicalBytes == 2 * block.size());
+  REQUIRE(sizes.physicalBytes == 4 * chunk);
+  REQUIRE(sizes.chunks == 4);
+
+  // shared chunk is copied when it is written, other file keeps its data
+  REQUIRE(session.write("b", chunk + 1, "xyz", 3));
+  REQUIRE(fileSystem.dataChunks() == 5);
+  REQUIRE(readAll("a") == block);
+  std::string changed = block;
+  changed.replace(chunk + 1, 3, "xyz");
+  REQUIRE(readAll("b") == changed);
+  REQUIRE(session.append("a", "tail", 4));
+  REQUIRE(readAll("b") == changed);
+  REQUIRE(readAll("a") == block + "tail");
+
+  // writing the same bytes back shares the chunk again
+  REQUIRE(session.write("b", chunk + 1, block.data() + chunk + 1, 3));
+  REQUIRE(fileSystem.dataChunks() == 5);
+  REQUIRE(session.truncate("a", block.size()));
+  REQUIRE(fileSystem.dataChunks() == 4);
+
+  // cp shares all chunks, rm releases chunk with the last reference
+  session.copy("a", "c");
+  REQUIRE(fileSystem.dataChunks() == 4);
+  REQUIRE(fileSystem.dedupStats().logicalBytes == 3 * block.size());
+  session.remove("a");
+  session.remove("b");
+  REQUIRE(fileSystem.dataChunks() == 4);
+  REQUIRE(readAll("c") == block);
+  session.remove("c");
+  sizes = fileSystem.dedupStats();
+  REQUIRE(sizes.logicalBytes == 0);
+  REQUIRE(sizes.physicalBytes == 0);
+
+  // zeros of sparse file are one chunk
+  session.makeFile("sparse");
+  REQUIRE(session.truncate("sparse", 10 * chunk));
+  REQUIRE(fileSystem.dataChunks() == 1);
+
+  // appended chunks are shared without compression and memory limit
+  session.makeFile("appended");
+  session.makeFile("again");
+  for (auto path : {"appended", "again"}) {
+    REQUIRE(session.write(path, 0, "hello\n", 6));
+    REQUIRE(session.append(path, "world\n", 6));
+  }
+  REQUIRE(fileSystem.dataChunks() == 2);
+  session.makeFile("written");
+  REQUIRE(session.write("written", 0, "hello\nworld\n", 12));
+  REQUIRE(fileSystem.dataChunks() == 2);
+  REQUIRE(readAll("again") == "hello\nworld\n");
+  // shared appended chunk is copied, and the copy is shared again
+  REQUIRE(session.append("again", "tail", 4));
+  REQUIRE(session.append("appended", "tail", 4));
+  REQUIRE(fileSystem.dataChunks() == 3);
+  REQUIRE(readAll("written") == "hello\nworld\n");
+  REQUIRE(readAll("appended") == "hello\nworld\ntail");
+  REQUIRE(output.str().empty());
+
+  vfs::Commands commands;
+  std::stringstream printed;
+  std::streambuf *coutBuffer = std::cout.rdbuf(printed.rdbuf());
+  commands.parseInput("mkfile x y");
+  commands.parseInput("write x same");
+  commands.parseInput("write y same");
+  commands.parseInput("dedupstats");
+  commands.parseInput("write -a x tail");
+  commands.parseInput("write -a y tail");
+  commands.parseInput("dedupstats");
+  commands.parseInput("dedupstats x");
+  std::cout.rdbuf(coutBuffer);
+  REQUIRE(printed.str() == "logical 10 bytes, physical 4096 bytes in 1 "
+                           "chunks, ratio 0.00244141\n"
+                           "logical 20 bytes, physical 4096 bytes in 1 "
+                           "chunks, ratio 0.00488281\nInvalid command\n");
+}
+
+TEST_CASE("TestCompression") {
+  // text compresses, random data doesn't fit, corrupted data is rejected
+  std::string text;
+  for (int i = 0; text.size() < 4096; ++i)
+    text += "line " + std::to_string(i % 50) + " of the log file\n";
+  std::vector<char> packed(text.size());
+  const std::size_t size =
+      vfs::lzCompress(text.data(), text.size(), packed.data(), packed.size());
+  REQUIRE(size > 0);
+  REQUIRE(size < text.size() / 2);
+  std::string unpacked(text.size(), '\0');
+  REQUIRE(vfs::lzDecompress(packed.data(), size, &unpacked[0],
+                            unpacked.size()));
+  REQUIRE(unpacked == text);
+  REQUIRE(!vfs::lzDecompress(packed.data(), size / 2, &unpacked[0],
+                             unpacked.size()));
+  REQUIRE(!vfs::lzDecompress(packed.data(), size, &unpacked[0],
+                             unpacked.size() - 1));
+  const std::string repeated(1000, 'r');
+  REQUIRE(vfs::lzCompress(repeated.data(), repeated.size(), packed.data(),
+                          packed.size()) < 20);
+  std::mt19937_64 random(7);
+  std::string noise(4096, '\0');
+  for (auto &byte : noise)
+    byte = static_cast<char>(random());
+  REQUIRE(vfs::lzCompress(noise.data(), noise.size(), packed.data(),
+                          noise.size() - 512) == 0);
+  REQUIRE(vfs::lzCompress("", 0, packed.data(), packed.size()) == 1);
+
+  vfs::VirtualFileSystem fileSystem;
+  std::stringstream output;
+  vfs::Session session(fileSystem, output);
+  auto readAll = [&session](const std::string &path) {
+    std::string data;
+    session.read(path, 0, UINT64_MAX,
+                 [&data](const char *part, std::size_t partSize) {
+                   data.append(part, partSize);
+                   return true;
+                 });
+    return data;
+  };
+  const std::size_t chunk = vfs::VirtualFileSystem::chunkSize;
+  std::string log;
+  for (int i = 0; log.size() < 8 * chunk; ++i)
+    log += "request " + std::to_string(i) + " took " +
+           std::to_string(i * 7 % 1000) + " us\n";
+  session.makeFile("log");
+  session.makeFile("noise");
+  REQUIRE(session.write("log", 0, log.data(), log.size()));
+  REQUIRE(session.write("noise", 0, noise.data(), noise.size()));
+  const std::size_t chunks = fileSystem.dataChunks();
+  REQUIRE(chunks == 10);
+  REQUIRE(fileSystem.compressIdle() == 0);
+
+  // chunks that are not used are compressed, random chunk stays as it is
+  fileSystem.setCompression(std::chrono::milliseconds(20), 2);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  fileSystem.compressIdle();
+  // compressed and incompressible chunks are not visited again
+  REQUIRE(fileSystem.compressIdle() == 0);
+  const std::uint64_t compressed = fileSystem.dedupStats().physicalBytes;
+  REQUIRE(compressed < log.size() / 2 + chunk);
+  REQUIRE(fileSystem.dataChunks() == chunks);
+#if VFS_STATS
+  vfs::Stats::Snapshot stats = fileSystem.stats();
+  REQUIRE(stats.compressedChunks == 9);
+  REQUIRE(stats.savedBytes == 10 * chunk - compressed);
+#endif
+
+  // readers decompress, only two decompressed chunks are kept
+  REQUIRE(readAll("log") == log);
+  REQUIRE(readAll("noise") == noise);
+  REQUIRE(fileSystem.dedupStats().physicalBytes <= compressed + 2 * chunk);
+#if VFS_STATS
+  stats = fileSystem.stats();
+  REQUIRE(stats[vfs::Stats::Operation::Decompress].count >= 9);
+#endif
+
+  // compressed chunk is copied when it is written
+  REQUIRE(session.write("log", chunk + 5, "WRITTEN", 7));
+  log.replace(chunk + 5, 7, "WRITTEN");
+  REQUIRE(session.append("log", "end\n", 4));
+  log += "end\n";
+  REQUIRE(readAll("log") == log);
+  session.copy("log", "copy");
+  REQUIRE(readAll("copy") == log);
+
+  // compressor runs while file is appended and read
+  fileSystem.setCompression(std::chrono::milliseconds(1), 1);
+  std::atomic<bool> done{false};
+  std::thread writer([&fileSystem, &done]() {
+    vfs::Session appender(fileSystem, std::cout);
+    const std::string line(100, 'x');
+    for (int i = 0; i < 2000; ++i) {
+      appender.append("log", line.data(), line.size());
+      if (i % 200 == 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    done.store(true);
+  });
+  std::size_t inconsistent = 0;
+  while (!done.load()) {
+    const std::string data = readAll("log");
+    if (data.compare(0, log.size(), log) != 0 ||
+        data.find_first_not_of('x', log.size()) != std::string::npos)
+      ++inconsistent;
+  }
+  writer.join();
+  REQUIRE(inconsistent == 0);
+  REQUIRE(readAll("copy") == log);
+  fileSystem.setCompression(std::chrono::milliseconds(0));
+  session.remove("log");
+  session.remove("copy");
+  session.remove("noise");
+  REQUIRE(fileSystem.dataChunks() == 0);
+  REQUIRE(fileSystem.dedupStats().physicalBytes == 0);
+  REQUIRE(output.str().empty());
+}
+
+TEST_CASE("TestSpill") {
+  vfs::VirtualFileSystem fileSystem;
+  std::stringstream output;
+  vfs::Session session(fileSystem, output);
+  auto readAll = [&session](const std::string &path) {
+    std::string data;
+    session.read(path, 0, UINT64_MAX,
+                 [&data](const char *part, std::size_t partSize) {
+                   data.append(part, partSize);
+                   return true;
+                 });
+    return data;
+  };
+  const std::size_t chunk = vfs::VirtualFileSystem::chunkSize;
+  std::mt19937_64 random(11);
+  auto randomData = [&random](std::size_t size) {
+    std::string data(size, '\0');
+    for (auto &byte : data)
+      byte = static_cast<char>(random());
+    return data;
+  };
+  REQUIRE(!fileSystem.setMemoryLimit(8 * chunk, "/nonexistent/vfsSpill"));
+  REQUIRE(fileSystem.setMemoryLimit(8 * chunk, "/tmp/vfsTestSpill"));
+  REQUIRE(access("/tmp/vfsTestSpill", F_OK) != 0);
+
+  // writers spill the least recently used chunks, memory stays within limit
+  std::vector<std::string> files;
+  for (int i = 0; i < 4; ++i) {
+    files.push_back(randomData(8 * chunk + 100));
+    const std::string name = "file" + std::to_string(i);
+    session.makeFile(name);
+    REQUIRE(session.write(name, 0, files.back().data(), files.back().size()));
+    REQUIRE(fileSystem.dedupStats().physicalBytes <= 8 * chunk);
+  }
+  REQUIRE(fileSystem.dataChunks() == 36);
+#if VFS_STATS
+  vfs::Stats::Snapshot stats = fileSystem.stats();
+  REQUIRE(stats.spilledChunks >= 28);
+  REQUIRE(stats.evictions == stats.spilledChunks);
+#endif
+
+  // readers page spilled chunks in, only quarter of limit is kept
+  for (int i = 0; i < 4; ++i)
+    REQUIRE(readAll("file" + std::to_string(i)) == files[i]);
+  REQUIRE(fileSystem.dedupStats().physicalBytes <= 10 * chunk);
+#if VFS_STATS
+  stats = fileSystem.stats();
+  REQUIRE(stats[vfs::Stats::Operation::PageIn].count >= 28);
+#endif
+
+  // spilled chunk is copied when it is written, copy shares spilled chunks
+  REQUIRE(session.write("file0", 5, "WRITTEN", 7));
+  files[0].replace(5, 7, "WRITTEN");
+  REQUIRE(readAll("file0") == files[0]);
+  session.copy("file1", "copy");
+  REQUIRE(readAll("copy") == files[1]);
+  session.remove("copy");
+
+  // compressed chunks are spilled compressed
+  std::string log;
+  for (int i = 0; log.size() < 4 * chunk; ++i)
+    log += "request " + std::to_string(i) + " took " +
+           std::to_string(i * 7 % 1000) + " us\n";
+  session.makeFile("log");
+  REQUIRE(session.write("log", 0, log.data(), log.size()));
+  fileSystem.setCompression(std::chrono::milliseconds(20), 2);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  fileSystem.compressIdle();
+  fileSystem.setCompression(std::chrono::milliseconds(0));
+  REQUIRE(session.write("file3", 0, files[3].data(), files[3].size()));
+  const std::string more = randomData(8 * chunk);
+  session.makeFile("more");
+  REQUIRE(session.write("more", 0, more.data(), more.size()));
+  REQUIRE(readAll("log") == log);
+  REQUIRE(readAll("more") == more);
+
+  // removed chunks release their slots
+  for (int i = 0; i < 4; ++i)
+    session.remove("file" + std::to_string(i));
+  session.remove("log");
+  session.remove("more");
+  REQUIRE(fileSystem.dataChunks() == 0);
+  REQUIRE(fileSystem.dedupStats().physicalBytes == 0);
+#if VFS_STATS
+  REQUIRE(fileSystem.stats().spilledChunks == 0);
+#endif
+  REQUIRE(output.str().empty());
+
+  // file that was read since it was written stays, the least recently used
+  // file is spilled
+  vfs::VirtualFileSystem recent;
+  std::stringstream recentOutput;
+  vfs::Session recentSession(recent, recentOutput);
+  REQUIRE(recent.setMemoryLimit(8 * chunk, "/tmp/vfsTestSpillRecent"));
+  const std::string used = randomData(4 * chunk);
+  const std::string unused = randomData(4 * chunk);
+  const std::string later = randomData(4 * chunk);
+  recentSession.makeFile("used");
+  REQUIRE(recentSession.write("used", 0, used.data(), used.size()));
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  recentSession.makeFile("unused");
+  REQUIRE(recentSession.write("unused", 0, unused.data(), unused.size()));
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  REQUIRE(readData(recentSession, "used") == used);
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  recentSession.makeFile("later");
+  REQUIRE(recentSession.write("later", 0, later.data(), later.size()));
+  REQUIRE(truncateBacking("/tmp/vfsTestSpillRecent"));
+  REQUIRE(readData(recentSession, "used") == used);
+  REQUIRE(readData(recentSession, "later") == later);
+  REQUIRE(recentOutput.str().empty());
+  REQUIRE(!recentSession.read("unused", 0, UINT64_MAX,
+                              [](const char *, std::size_t) { return true; }));
+
+  // chunks that can't be read back are reported by every command
+  vfs::VirtualFileSystem broken;
+  std::stringstream brokenOutput;
+  vfs::Session brokenSession(broken, brokenOutput);
+  REQUIRE(broken.setMemoryLimit(2 * chunk, "/tmp/vfsTestSpillBroken"));
+  const std::string lost = randomData(8 * chunk);
+  brokenSession.makeFile("lost");
+  for (std::size_t offset = 0; offset < lost.size(); offset += chunk) {
+    // the first chunks are the least recently used ones
+    REQUIRE(brokenSession.append("lost", lost.data() + offset, chunk));
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  REQUIRE(truncateBacking("/tmp/vfsTestSpillBroken"));
+  REQUIRE(!brokenSession.read("lost", 0, UINT64_MAX,
+                              [](const char *, std::size_t) { return true; }));
+  REQUIRE(!brokenSession.write("lost", 5, "x", 1));
+  REQUIRE(!brokenSession.truncate("lost", 100));
+  REQUIRE(!brokenSession.grep(
+      "x", "", [](const std::string &, std::uint64_t, const std::string &) {
+        return true;
+      }));
+  std::string unreadable;
+  for (int i = 0; i < 4; ++i)
+    unreadable += "Can't read file data\n";
+  REQUIRE(brokenOutput.str() == unreadable);
+  // file that is overwritten is not read
+  REQUIRE(brokenSession.write("lost", 0, lost.data(), lost.size()));
+  REQUIRE(readData(brokenSession, "lost") == lost);
+}
+
+TEST_CASE("TestGrep") {
+  // substring is found like std::string::find, at every offset
+  std::mt19937_64 random(5);
+  std::string letters(1000, 'a');
+  for (auto &letter : letters)
+    letter = static_cast<char>('a' + random() % 3);
+  for (std::size_t length = 0; length < 6; ++length) {
+    const vfs::Substring substring(letters.substr(500, length));
+    for (std::size_t offset = 0; offset < 100; ++offset) {
+      const char *found = substring.find(letters.data() + offset, 600 - offset);
+      const std::size_t expected =
+          letters.substr(offset, 600 - offset).find(substring.pattern());
+      REQUIRE(found == (expected == std::string::npos
+                            ? nullptr
+                            : letters.data() + offset + expected));
+    }
+  }
+  REQUIRE(vfs::Substring("abcd").find("abc", 3) == nullptr);
+
+  vfs::VirtualFileSystem fileSystem;
+  std::stringstream output;
+  vfs::Session session(fileSystem, output);
+  using Line = std::tuple<std::string, std::uint64_t, std::string>;
+  auto grep = [&session](const std::string &pattern, const std::string &path) {
+    std::vector<Line> lines;
+    session.grep(pattern, path,
+                 [&lines](const std::string &file, std::uint64_t line,
+                          const std::string &text) {
+                   lines.emplace_back(file, line, text);
+                   return true;
+                 });
+    std::sort(lines.begin(), lines.end());
+    return lines;
+  };
+  // lines with pattern, found line by line
+  auto expected = [](const std::string &file, const std::string &data,
+                     const std::string &pattern) {
+    std::vector<Line> lines;
+    std::istringstream stream(data);
+    std::string text;
+    for (std::uint64_t line = 1; std::getline(stream, text); ++line) {
+      if (text.find(pattern) != std::string::npos)
+        lines.emplace_back(
+            file, line,
+            text.substr(0, vfs::VirtualFileSystem::grepLineLimit));
+    }
+    return lines;
+  };
+
+  // random lines of few letters, so pattern crosses chunk boundaries
+  const std::size_t chunk = vfs::VirtualFileSystem::chunkSize;
+  session.makeDirectory("logs");
+  session.makeDirectory("logs/old");
+  std::vector<std::pair<std::string, std::string>> files;
+  for (int i = 0; i < 6; ++i) {
+    std::string data;
+    while (data.size() < (i + 1) * chunk)
+      data += random() % 20 == 0 ? '\n' : static_cast<char>('a' + random() % 4);
+    if (i == 5) // long line without newline
+      data += std::string(3 * chunk, 'b') + "abcd";
+    const std::string path =
+        (i % 2 == 0 ? "/home/logs/f" : "/home/logs/old/f") + std::to_string(i);
+    session.makeFile(path);
+    REQUIRE(session.write(path, 0, data.data(), data.size()));
+    files.emplace_back(path, data);
+  }
+  for (const std::string pattern : {"a", "abca", "dddd", "bbba", "abcd"}) {
+    std::vector<Line> all;
+    for (const auto &file : files) {
+      const std::vector<Line> lines =
+          expected(file.first, file.second, pattern);
+      all.insert(all.end(), lines.begin(), lines.end());
+    }
+    std::sort(all.begin(), all.end());
+    REQUIRE(grep(pattern, "logs") == all);
+    REQUIRE(grep(pattern, files[1].first) ==
+            expected(files[1].first, files[1].second, pattern));
+  }
+  REQUIRE(grep("a\nb", "logs").empty());
+  REQUIRE(grep("zzz", "").empty());
+
+  // visitor stops search
+  std::size_t visited = 0;
+  REQUIRE(session.grep("a", "/home",
+                       [&visited](const std::string &, std::uint64_t,
+                                  const std::string &) {
+                         ++visited;
+                         return false;
+                       }));
+  REQUIRE(visited == 1);
+  REQUIRE(output.str().empty());
+  REQUIRE(!session.grep("a", "missing",
+                        [](const std::string &, std::uint64_t,
+                           const std::string &) { return true; }));
+  REQUIRE(output.str() == "No such directory or file\n");
+
+  vfs::Commands commands;
+  std::stringstream printed;
+  std::streambuf *coutBuffer = std::cout.rdbuf(printed.rdbuf());
+  commands.parseInput("mkdir d");
+  commands.parseInput("mkfile d/x");
+  commands.parseInput("write d/x first line");
+  commands.parseInput("write -a d/x second line");
+  commands.parseInput("write -a d/x third");
+  commands.parseInput("grep -r line d");
+  commands.parseInput("grep third d/x");
+  commands.parseInput("grep");
+  commands.parseInput("grep a b c");
+  std::cout.rdbuf(coutBuffer);
+  REQUIRE(printed.str() == "/home/d/x:1:first line\n/home/d/x:2:second line\n"
+                           "/home/d/x:3:third\nInvalid command\n"
+                           "Invalid command\n");
+}